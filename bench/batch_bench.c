@@ -0,0 +1,86 @@
+/*
+ * Push a script of trivial lines through the shell in interactive mode
+ * (prompt, working directory and exit code for every line) and in batch mode,
+ * and in batch mode again with every line parsed (no parse cache).
+ *
+ * usage: dc_shell_bench_batch [lines] [line]
+ */
+
+#include "bench.h"
+#include "shell.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static double bench_mode(const struct dc_posix_env *env, const char *script, size_t lines, bool interactive,
+                         const struct shell_options *options);
+
+int main(int argc, char *argv[])
+{
+    struct dc_posix_env  env;
+    struct shell_options uncached;
+    char                script[] = "/tmp/dc_shell_bench_batchXXXXXX";
+    const char         *line;
+    size_t              lines;
+    FILE               *file;
+    int                 fd;
+
+    dc_posix_env_init(&env, NULL);
+    lines = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+    line  = argc > 2 ? argv[2] : "set +o pipefail";
+
+    fd = mkstemp(script);
+    if (fd == -1)
+    {
+        perror(script);
+        return EXIT_FAILURE;
+    }
+
+    file = fdopen(fd, "w");
+    for (size_t i = 0; i < lines; ++i)
+    {
+        fprintf(file, "%s\n", line);
+    }
+    fclose(file);
+
+    printf("%zu x \"%s\"\n", lines, line);
+    printf("%-12s %12s\n", "mode", "ns/line");
+    uncached.parse_cache_size = 0;
+    printf("%-12s %12.1f\n", "interactive", bench_mode(&env, script, lines, true, NULL));
+    printf("%-12s %12.1f\n", "batch", bench_mode(&env, script, lines, false, NULL));
+    printf("%-12s %12.1f\n", "uncached", bench_mode(&env, script, lines, false, &uncached));
+    unlink(script);
+
+    return EXIT_SUCCESS;
+}
+
+static double bench_mode(const struct dc_posix_env *env, const char *script, size_t lines, bool interactive,
+                         const struct shell_options *options)
+{
+    struct dc_error err;
+    FILE  *in;
+    FILE  *out;
+    double start;
+    double elapsed;
+
+    dc_error_init(&err, NULL);
+    in    = fopen(script, "r");
+    out   = fopen("/dev/null", "w");
+    start = bench_now();
+
+    if (interactive)
+    {
+        run_shell(env, &err, in, out, stderr, options);
+    }
+    else
+    {
+        run_script(env, &err, in, out, stderr, options);
+    }
+
+    elapsed = bench_now() - start;
+    fclose(in);
+    fclose(out);
+    dc_error_reset(&err);
+
+    return elapsed * 1e9 / (double)lines;
+}
@@ -0,0 +1,163 @@
+/*
+ * Copy a large file with the cat builtin, with the external cat and with each
+ * copy_fd method on its own, through the shell's redirections where there is one.
+ *
+ * usage: dc_shell_bench_cat [size in MiB] [directory]
+ */
+
+#include "bench.h"
+#include "copy.h"
+#include "shell.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static double bench_line(const struct dc_posix_env *env, const char *line);
+static double bench_method(const struct dc_posix_env *env, const char *in_name, const char *out_name,
+                           enum copy_method method);
+static void print_result(const char *name, double seconds, size_t size_mb);
+
+int main(int argc, char *argv[])
+{
+    static const char *method_names[] = {"copy_file_range", "sendfile", "splice", "read/write"};
+    struct dc_posix_env env;
+    const char         *dir;
+    size_t              size_mb;
+    char                in_name[1024];
+    char                out_name[1024];
+    char                line[4096];
+    char               *block;
+    int                 fd;
+
+    dc_posix_env_init(&env, NULL);
+    size_mb = argc > 1 ? strtoul(argv[1], NULL, 10) : 2048;
+    dir     = argc > 2 ? argv[2] : "/tmp";
+    snprintf(in_name, sizeof(in_name), "%s/dc_shell_bench_cat_in", dir);
+    snprintf(out_name, sizeof(out_name), "%s/dc_shell_bench_cat_out", dir);
+
+    fd = open(in_name, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd == -1)
+    {
+        perror(in_name);
+        return EXIT_FAILURE;
+    }
+
+    block = malloc(1024 * 1024);
+    for (size_t i = 0; i < 1024 * 1024; ++i)
+    {
+        block[i] = (char)('a' + i % 26);
+    }
+
+    for (size_t i = 0; i < size_mb; ++i)
+    {
+        if (write(fd, block, 1024 * 1024) != 1024 * 1024)
+        {
+            perror(in_name);
+            close(fd);
+            unlink(in_name);
+            return EXIT_FAILURE;
+        }
+    }
+    fsync(fd);
+    close(fd);
+    free(block);
+
+    printf("%zu MiB in %s\n", size_mb, dir);
+    printf("%-28s %10s %10s\n", "copy", "seconds", "MiB/s");
+
+    snprintf(line, sizeof(line), "cat %s > %s\n", in_name, out_name);
+    print_result("cat > (builtin)", bench_line(&env, line), size_mb);
+    unlink(out_name);
+
+    snprintf(line, sizeof(line), "cat %s >> %s\n", in_name, out_name);
+    print_result("cat >> (builtin)", bench_line(&env, line), size_mb);
+    unlink(out_name);
+
+    // a name with a / is never a builtin
+    snprintf(line, sizeof(line), "/bin/cat %s > %s\n", in_name, out_name);
+    print_result("/bin/cat >", bench_line(&env, line), size_mb);
+    unlink(out_name);
+
+    snprintf(line, sizeof(line), "/bin/cat %s | /bin/cat > %s\n", in_name, out_name);
+    print_result("/bin/cat | /bin/cat >", bench_line(&env, line), size_mb);
+    unlink(out_name);
+
+    snprintf(line, sizeof(line), "/bin/cat %s | cat > %s\n", in_name, out_name);
+    print_result("/bin/cat | cat > (builtin)", bench_line(&env, line), size_mb);
+    unlink(out_name);
+
+    for (enum copy_method method = COPY_FILE_RANGE; method <= COPY_READ_WRITE; ++method)
+    {
+        print_result(method_names[method], bench_method(&env, in_name, out_name, method), size_mb);
+        unlink(out_name);
+    }
+
+    unlink(in_name);
+
+    return EXIT_SUCCESS;
+}
+
+static double bench_line(const struct dc_posix_env *env, const char *line)
+{
+    struct dc_error err;
+    FILE  *in;
+    double start;
+    double elapsed;
+
+    // start each copy without dirty pages from the one before it
+    sync();
+    dc_error_init(&err, NULL);
+    in    = fmemopen((void *)line, strlen(line), "r");
+    start = bench_now();
+    // the redirections are applied to descriptor 1, so the output stream must be stdout
+    run_script(env, &err, in, stdout, stderr, NULL);
+    elapsed = bench_now() - start;
+    fclose(in);
+    dc_error_reset(&err);
+
+    return elapsed;
+}
+
+static double bench_method(const struct dc_posix_env *env, const char *in_name, const char *out_name,
+                           enum copy_method method)
+{
+    struct dc_error  err;
+    enum copy_method used;
+    int    in_fd;
+    int    out_fd;
+    double start;
+    double elapsed;
+
+    sync();
+    dc_error_init(&err, NULL);
+    in_fd  = open(in_name, O_RDONLY);
+    out_fd = open(out_name, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    start  = bench_now();
+    copy_fd(env, &err, in_fd, out_fd, method, &used, NULL);
+    elapsed = bench_now() - start;
+    close(in_fd);
+    close(out_fd);
+
+    // splice needs a pipe, between two files it falls back to read/write
+    if (used != method)
+    {
+        elapsed = -1;
+    }
+
+    dc_error_reset(&err);
+
+    return elapsed;
+}
+
+static void print_result(const char *name, double seconds, size_t size_mb)
+{
+    if (seconds < 0)
+    {
+        printf("%-28s %10s %10s\n", name, "n/a", "n/a");
+    }
+    else
+    {
+        printf("%-28s %10.3f %10.1f\n", name, seconds, (double)size_mb / seconds);
+    }
+}
@@ -0,0 +1,167 @@
+/*
+ * Complete a command with Tab in a PATH directory of many executables (10k by default): the first
+ * completion (reads the directory), the ones after it (nothing changed), one after a program is added
+ * (only that name is looked up again) vs. reading and checking every name in the directory each time.
+ *
+ * usage: dc_shell_bench_complete [executables] [directory]
+ */
+
+#include "bench.h"
+#include "completion.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define RUNS 100
+
+static void make_program(const char *dir, size_t number);
+static void remove_programs(const char *dir, size_t executables);
+static double bench_scan(const char *dir, const char *prefix, size_t *found);
+
+int main(int argc, char *argv[])
+{
+    static const char *prefixes[] = {
+        "prog_1",
+        "prog_12",
+        "prog_123",
+        "ec",
+    };
+    struct dc_posix_env env;
+    struct dc_error err;
+    struct completion *completion;
+    const char *const *matches;
+    const char *parent;
+    size_t executables;
+    size_t found;
+    char dir[1024];
+    char *path[2];
+    double start;
+    double warm;
+
+    dc_posix_env_init(&env, NULL);
+    dc_error_init(&err, NULL);
+    executables = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000;
+    parent      = argc > 2 ? argv[2] : "/tmp";
+    snprintf(dir, sizeof(dir), "%s/dc_shell_bench_complete", parent);
+    remove_programs(dir, executables + sizeof(prefixes) / sizeof(prefixes[0]) * RUNS);
+
+    if (mkdir(dir, 0755) != 0)
+    {
+        perror(dir);
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < executables; ++i)
+    {
+        make_program(dir, i);
+    }
+
+    printf("%zu executables\n", executables);
+    path[0]    = dir;
+    path[1]    = NULL;
+    completion = completion_create(&env, &err, path);
+    start      = bench_now();
+    found      = completion_commands(&env, &err, completion, "prog_1", 6, &matches);
+    printf("%-28s %10.1f us (%zu found)\n", "first completion", (bench_now() - start) * 1e6, found);
+
+    printf("\nus per completion, mean of %d\n", RUNS);
+    printf("%-12s %10s %12s %12s %12s\n", "prefix", "found", "unchanged", "changed", "scan");
+
+    for (size_t p = 0; p < sizeof(prefixes) / sizeof(prefixes[0]); ++p)
+    {
+        double changed;
+        double scanned;
+        size_t length;
+        size_t scan_found;
+
+        length = strlen(prefixes[p]);
+        start  = bench_now();
+
+        for (int run = 0; run < RUNS; ++run)
+        {
+            found = completion_commands(&env, &err, completion, prefixes[p], length, &matches);
+        }
+
+        warm    = (bench_now() - start) / RUNS;
+        changed = 0;
+
+        // a program is added before each one, so it is looked up and merged into the commands every time
+        for (int run = 0; run < RUNS; ++run)
+        {
+            make_program(dir, executables + p * RUNS + (size_t)run);
+            start = bench_now();
+            completion_commands(&env, &err, completion, prefixes[p], length, &matches);
+            changed += bench_now() - start;
+        }
+
+        scanned = bench_scan(dir, prefixes[p], &scan_found);
+        printf("%-12s %10zu %12.2f %12.1f %12.1f\n", prefixes[p], found, warm * 1e6, changed / RUNS * 1e6,
+               scanned * 1e6);
+    }
+
+    completion_destroy(&env, &completion);
+    remove_programs(dir, executables + sizeof(prefixes) / sizeof(prefixes[0]) * RUNS);
+
+    if (dc_error_has_error(&err))
+    {
+        fprintf(stderr, "%s\n", err.message);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static void make_program(const char *dir, size_t number)
+{
+    char path[1100];
+
+    snprintf(path, sizeof(path), "%s/prog_%zu", dir, number);
+    close(open(path, O_WRONLY | O_CREAT, 0755));
+}
+
+static void remove_programs(const char *dir, size_t executables)
+{
+    char path[1100];
+
+    for (size_t i = 0; i < executables; ++i)
+    {
+        snprintf(path, sizeof(path), "%s/prog_%zu", dir, i);
+        unlink(path);
+    }
+
+    rmdir(dir);
+}
+
+static double bench_scan(const char *dir, const char *prefix, size_t *found)
+{
+    size_t length;
+    double start;
+
+    length = strlen(prefix);
+    start  = bench_now();
+
+    // every name is read, and the ones that match are checked for being executable, without sorting them
+    for (int run = 0; run < RUNS; ++run)
+    {
+        DIR *stream;
+        struct dirent *entry;
+
+        stream = opendir(dir);
+        *found = 0;
+
+        while ((entry = readdir(stream)) != NULL)
+        {
+            if (strncmp(entry->d_name, prefix, length) == 0 && faccessat(dirfd(stream), entry->d_name, X_OK, 0) == 0)
+            {
+                ++*found;
+            }
+        }
+
+        closedir(stream);
+    }
+
+    return (bench_now() - start) / RUNS;
+}
@@ -0,0 +1,123 @@
+/*
+ * Expand a glob over a directory with many files with expand_word and with wordexp,
+ * which parse_command used before.
+ *
+ * usage: dc_shell_bench_glob [files] [directory]
+ */
+
+#include "bench.h"
+#include "expand.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wordexp.h>
+
+#define RUNS 5
+
+static double bench_expand(const struct dc_posix_env *env, const char *pattern, size_t *count);
+static double bench_wordexp(const char *pattern, size_t *count);
+
+int main(int argc, char *argv[])
+{
+    struct dc_posix_env env;
+    const char         *dir;
+    size_t              files;
+    size_t              count;
+    char                tmp[1024];
+    char                path[1200];
+    double              seconds;
+
+    dc_posix_env_init(&env, NULL);
+    files = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+    dir   = argc > 2 ? argv[2] : "/tmp";
+    snprintf(tmp, sizeof(tmp), "%s/dc_shell_bench_globXXXXXX", dir);
+
+    if (mkdtemp(tmp) == NULL)
+    {
+        perror(tmp);
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < files; ++i)
+    {
+        snprintf(path, sizeof(path), "%s/file%zu.txt", tmp, i);
+        close(open(path, O_CREAT | O_WRONLY, 0600));
+    }
+
+    snprintf(path, sizeof(path), "%s/file*.txt", tmp);
+    printf("%zu files, best of %d\n", files, RUNS);
+    printf("%-12s %10s %12s %10s\n", "expander", "ms", "ns/file", "words");
+
+    seconds = bench_expand(&env, path, &count);
+    printf("%-12s %10.2f %12.1f %10zu\n", "expand_word", seconds * 1e3, seconds * 1e9 / (double)files, count);
+    seconds = bench_wordexp(path, &count);
+    printf("%-12s %10.2f %12.1f %10zu\n", "wordexp", seconds * 1e3, seconds * 1e9 / (double)files, count);
+
+    for (size_t i = 0; i < files; ++i)
+    {
+        snprintf(path, sizeof(path), "%s/file%zu.txt", tmp, i);
+        unlink(path);
+    }
+    rmdir(tmp);
+
+    return EXIT_SUCCESS;
+}
+
+static double bench_expand(const struct dc_posix_env *env, const char *pattern, size_t *count)
+{
+    struct dc_error   err;
+    struct arena     *arena;
+    struct expansion  expansion;
+    double            best;
+
+    dc_error_init(&err, NULL);
+    arena = arena_create(env, &err, 4096);
+    best  = 0;
+
+    for (int run = 0; run < RUNS; ++run)
+    {
+        double start;
+        double elapsed;
+
+        memset(&expansion, 0, sizeof(expansion));
+        start = bench_now();
+        expand_word(env, &err, arena, NULL, pattern, strlen(pattern), &expansion);
+        elapsed = bench_now() - start;
+        *count  = expansion.count;
+        arena_reset(arena);
+        best = run == 0 || elapsed < best ? elapsed : best;
+    }
+
+    arena_destroy(env, &arena);
+    dc_error_reset(&err);
+
+    return best;
+}
+
+static double bench_wordexp(const char *pattern, size_t *count)
+{
+    wordexp_t exp;
+    double    best;
+
+    best = 0;
+
+    for (int run = 0; run < RUNS; ++run)
+    {
+        double start;
+        double elapsed;
+
+        start = bench_now();
+        *count = wordexp(pattern, &exp, WRDE_NOCMD) == 0 ? exp.we_wordc : 0;
+        elapsed = bench_now() - start;
+
+        if (*count > 0)
+        {
+            wordfree(&exp);
+        }
+
+        best = run == 0 || elapsed < best ? elapsed : best;
+    }
+
+    return best;
+}
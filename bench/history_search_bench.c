@@ -0,0 +1,225 @@
+/*
+ * Search a large history (100k entries by default) the way Ctrl-R does while a query is typed,
+ * a key at a time: with the trigram index vs. a scan of every entry. Also times building the index
+ * from the whole history, saving it and loading it again (what a new session does instead of building it).
+ *
+ * usage: dc_shell_bench_history_search [entries] [directory]
+ */
+
+#include "bench.h"
+#include "history.h"
+#include "history_index.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RUNS 5
+
+#define RESULTS 64
+
+static void fill_history(struct history *history, size_t entries);
+static double bench_index(const struct dc_posix_env *env, struct history_index *index, const struct history *history,
+                          const char *query, size_t length, size_t *found);
+static double bench_scan(const struct history *history, const char *query, size_t length, size_t *found);
+
+int main(int argc, char *argv[])
+{
+    static const char *queries[] = {
+        "docker run",
+        "git commit -m 'fix 42",
+        "ssh host7",
+    };
+    struct dc_posix_env env;
+    struct dc_error err;
+    struct history *history;
+    struct history_index *index;
+    const char *dir;
+    size_t entries;
+    char path[1024];
+    char index_path[1100];
+    double start;
+
+    dc_posix_env_init(&env, NULL);
+    dc_error_init(&err, NULL);
+    entries = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+    dir     = argc > 2 ? argv[2] : "/tmp";
+    snprintf(path, sizeof(path), "%s/dc_shell_bench_history", dir);
+    snprintf(index_path, sizeof(index_path), "%s.idx", path);
+    unlink(path);
+    unlink(index_path);
+
+    // room for every entry, so none are overwritten
+    history = history_open(&env, &err, path, entries * 64 + 4096);
+
+    if (history == NULL)
+    {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+
+    fill_history(history, entries);
+    printf("%zu entries\n", entries);
+
+    index = history_index_open(&env, &err, index_path);
+    start = bench_now();
+    history_index_update(&env, &err, index, history);
+    printf("%-28s %10.1f ms (%zu trigrams)\n", "index the whole history", (bench_now() - start) * 1e3, index->count);
+    start = bench_now();
+    history_index_save(&env, &err, index);
+    printf("%-28s %10.1f ms\n", "save the index", (bench_now() - start) * 1e3);
+    history_index_close(&env, &index);
+    start = bench_now();
+    index = history_index_open(&env, &err, index_path);
+    printf("%-28s %10.1f ms\n", "load the index", (bench_now() - start) * 1e3);
+    history_add(history, "echo one more", 13);
+    start = bench_now();
+    history_index_update(&env, &err, index, history);
+    printf("%-28s %10.1f us\n", "index the first new entry", (bench_now() - start) * 1e6);
+    start = bench_now();
+
+    // the first one grows the postings the load made just big enough, after that an entry is cheap
+    for (int i = 0; i < 100; ++i)
+    {
+        char line[32];
+        int length;
+
+        length = snprintf(line, sizeof(line), "echo %d more", i);
+        history_add(history, line, (size_t)length);
+        history_index_update(&env, &err, index, history);
+    }
+
+    printf("%-28s %10.1f us\n", "index a new entry (mean)", (bench_now() - start) * 1e6 / 100);
+
+    if (dc_error_has_error(&err))
+    {
+        fprintf(stderr, "%s\n", err.message);
+        return EXIT_FAILURE;
+    }
+
+    printf("\nus per key typed, best of %d\n", RUNS);
+    printf("%-24s %10s %10s %12s %12s\n", "query", "commands", "entries", "index", "scan");
+
+    for (size_t q = 0; q < sizeof(queries) / sizeof(queries[0]); ++q)
+    {
+        for (size_t length = 1; length <= strlen(queries[q]); ++length)
+        {
+            double indexed;
+            double scanned;
+            size_t found;
+            size_t scan_found;
+
+            indexed = bench_index(&env, index, history, queries[q], length, &found);
+            scanned = bench_scan(history, queries[q], length, &scan_found);
+            printf("%-24.*s %10zu %10zu %12.1f %12.1f\n", (int)length, queries[q], found, scan_found, indexed * 1e6,
+                   scanned * 1e6);
+        }
+    }
+
+    history_index_close(&env, &index);
+    history_close(&env, &history);
+    unlink(path);
+    unlink(index_path);
+
+    return EXIT_SUCCESS;
+}
+
+static void fill_history(struct history *history, size_t entries)
+{
+    static const char *formats[] = {
+        "git commit -m 'fix %u'",
+        "git checkout feature-%u",
+        "make -j%u",
+        "cd /home/user/projects/project%u",
+        "ssh host%u.example.com",
+        "grep -rn pattern%u src include",
+        "docker run --rm -it image:%u",
+        "vim src/file%u.c",
+        "ls -l /var/log/app%u",
+        "kill -9 %u",
+    };
+    unsigned int seed;
+    char line[128];
+
+    seed = 12345;
+
+    for (size_t i = 0; i < entries; ++i)
+    {
+        unsigned int kind;
+        unsigned int number;
+        int length;
+
+        // a few commands come up far more often than the rest, like a real history
+        seed   = seed * 1103515245 + 12345;
+        kind   = (seed >> 16) % 10;
+        seed   = seed * 1103515245 + 12345;
+        number = (seed >> 16) % (kind < 3 ? 50 : 5000);
+        length = snprintf(line, sizeof(line), formats[kind], number);
+        history_add(history, line, (size_t)length);
+    }
+}
+
+static double bench_index(const struct dc_posix_env *env, struct history_index *index, const struct history *history,
+                          const char *query, size_t length, size_t *found)
+{
+    struct dc_error err;
+    uint64_t results[RESULTS];
+    double best;
+
+    dc_error_init(&err, NULL);
+    best = 0;
+
+    for (int run = 0; run < RUNS; ++run)
+    {
+        double start;
+        double elapsed;
+
+        start   = bench_now();
+        *found  = history_index_search(env, &err, index, history, query, length, results, RESULTS);
+        elapsed = bench_now() - start;
+        best    = run == 0 || elapsed < best ? elapsed : best;
+    }
+
+    return best;
+}
+
+static double bench_scan(const struct history *history, const char *query, size_t length, size_t *found)
+{
+    char *line;
+    char *wanted;
+    size_t size;
+    double best;
+
+    size   = history->capacity / 4 + 1;
+    line   = malloc(size);
+    wanted = strndup(query, length);
+    best   = 0;
+
+    for (int run = 0; run < RUNS; ++run)
+    {
+        uint64_t position;
+        double start;
+        double elapsed;
+
+        // every entry is read and checked, without even ranking the ones that match
+        start  = bench_now();
+        *found = 0;
+
+        for (position = history_end(history); history_previous(history, position, &position);)
+        {
+            size_t line_length;
+
+            if (history_read(history, position, line, size, &line_length) && strstr(line, wanted))
+            {
+                ++*found;
+            }
+        }
+
+        elapsed = bench_now() - start;
+        best    = run == 0 || elapsed < best ? elapsed : best;
+    }
+
+    free(wanted);
+    free(line);
+
+    return best;
+}
@@ -0,0 +1,300 @@
+/*
+ * Read a multi-MiB script a line at a time the way the shell does: with the input reader on the file's
+ * descriptor and through its stream, with getline into one reused buffer and trimmed in place,
+ * and with getline into a new buffer for every line that is trimmed and copied twice.
+ *
+ * usage: dc_shell_bench_input [size in MiB] [directory]
+ */
+
+#include "bench.h"
+#include "input.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RUNS 5
+
+enum method
+{
+    METHOD_INPUT_FD,
+    METHOD_INPUT_STREAM,
+    METHOD_GETLINE,
+    METHOD_GETLINE_STRDUP,
+};
+
+static int write_script(const char *name, size_t size);
+static double bench_method(const struct dc_posix_env *env, const char *name, enum method method, size_t *lines,
+                           size_t *reads);
+static size_t read_input(const struct dc_posix_env *env, FILE *stream, bool use_fd, size_t *reads);
+static size_t read_getline(FILE *stream);
+static size_t read_getline_strdup(FILE *stream);
+static char *trim(char *line, size_t length, size_t *trimmed_length);
+
+int main(int argc, char *argv[])
+{
+    static const char *method_names[] = {
+        [METHOD_INPUT_FD]       = "input (fd)",
+        [METHOD_INPUT_STREAM]   = "input (stream)",
+        [METHOD_GETLINE]        = "getline + trim",
+        [METHOD_GETLINE_STRDUP] = "getline + strdup x2",
+    };
+    struct dc_posix_env env;
+    const char *dir;
+    size_t size_mb;
+    char name[1024];
+
+    dc_posix_env_init(&env, NULL);
+    size_mb = argc > 1 ? strtoul(argv[1], NULL, 10) : 64;
+    dir     = argc > 2 ? argv[2] : "/tmp";
+    snprintf(name, sizeof(name), "%s/dc_shell_bench_input", dir);
+
+    if (write_script(name, size_mb * 1024 * 1024) == -1)
+    {
+        perror(name);
+        unlink(name);
+        return EXIT_FAILURE;
+    }
+
+    printf("%zu MiB script, best of %d\n", size_mb, RUNS);
+    printf("%-20s %10s %14s %10s\n", "method", "MiB/s", "lines/s", "reads");
+
+    for (enum method method = METHOD_INPUT_FD; method <= METHOD_GETLINE_STRDUP; ++method)
+    {
+        double seconds;
+        size_t lines;
+        size_t reads;
+
+        seconds = bench_method(&env, name, method, &lines, &reads);
+        printf("%-20s %10.1f %14.0f", method_names[method], (double)size_mb / seconds, (double)lines / seconds);
+
+        if (method == METHOD_INPUT_FD || method == METHOD_INPUT_STREAM)
+        {
+            printf(" %10zu\n", reads);
+        }
+        else
+        {
+            printf(" %10s\n", "-");
+        }
+    }
+
+    unlink(name);
+
+    return EXIT_SUCCESS;
+}
+
+static int write_script(const char *name, size_t size)
+{
+    static const char *lines[] = {
+        "echo hello world",
+        "",
+        "    cd /usr/local/share/dc_shell/examples",
+        "# a comment that explains what the next few lines of the script are doing",
+        "gcc -Wall -Wextra -O2 -o hello hello.c main.c util.c 2> errors.txt",
+        "\tls -l | grep txt | sort | uniq > list.txt",
+        "FOO=bar BAR=\"$HOME/bin\" ./configure --prefix=/usr/local --enable-shared --disable-static   ",
+    };
+    char long_line[2048];
+    FILE *stream;
+    size_t written;
+    size_t i;
+
+    // now and then a line as long as a generated command, much longer than the rest
+    memset(long_line, 'x', sizeof(long_line) - 1);
+    long_line[sizeof(long_line) - 1] = '\0';
+    stream  = fopen(name, "w");
+    written = 0;
+
+    if (stream == NULL)
+    {
+        return -1;
+    }
+
+    for (i = 0; written < size; ++i)
+    {
+        const char *line;
+
+        line = i % 100 == 99 ? long_line : lines[i % (sizeof(lines) / sizeof(lines[0]))];
+
+        if (fprintf(stream, "%s\n", line) < 0)
+        {
+            fclose(stream);
+            return -1;
+        }
+
+        written += strlen(line) + 1;
+    }
+
+    return fclose(stream);
+}
+
+static double bench_method(const struct dc_posix_env *env, const char *name, enum method method, size_t *lines,
+                           size_t *reads)
+{
+    double best;
+
+    best   = 0;
+    *reads = 0;
+
+    for (int run = 0; run < RUNS; ++run)
+    {
+        FILE *stream;
+        double start;
+        double elapsed;
+
+        stream = fopen(name, "r");
+        start  = bench_now();
+
+        switch (method)
+        {
+            case METHOD_INPUT_FD:
+            {
+                *lines = read_input(env, stream, true, reads);
+                break;
+            }
+            case METHOD_INPUT_STREAM:
+            {
+                *lines = read_input(env, stream, false, reads);
+                break;
+            }
+            case METHOD_GETLINE:
+            {
+                *lines = read_getline(stream);
+                break;
+            }
+            case METHOD_GETLINE_STRDUP:
+            default:
+            {
+                *lines = read_getline_strdup(stream);
+                break;
+            }
+        }
+
+        elapsed = bench_now() - start;
+        fclose(stream);
+        best = run == 0 || elapsed < best ? elapsed : best;
+    }
+
+    return best;
+}
+
+static size_t read_input(const struct dc_posix_env *env, FILE *stream, bool use_fd, size_t *reads)
+{
+    struct dc_error err;
+    struct input *input;
+    size_t lines;
+
+    dc_error_init(&err, NULL);
+    input = input_create(env, &err, stream);
+    lines = 0;
+
+    if (!use_fd)
+    {
+        input->fd = -1;
+    }
+
+    for (;;)
+    {
+        size_t length;
+
+        read_command_line(env, &err, input, &length);
+
+        if (dc_error_has_error(&err) || (length == 0 && input->eof))
+        {
+            break;
+        }
+
+        ++lines;
+    }
+
+    *reads = input->reads;
+    input_destroy(env, &input);
+    dc_error_reset(&err);
+
+    return lines;
+}
+
+static size_t read_getline(FILE *stream)
+{
+    char *buffer;
+    size_t capacity;
+    size_t lines;
+    ssize_t length;
+
+    buffer   = NULL;
+    capacity = 0;
+    lines    = 0;
+
+    while ((length = getline(&buffer, &capacity, stream)) != -1)
+    {
+        size_t trimmed_length;
+
+        trim(buffer, (size_t)length, &trimmed_length);
+        ++lines;
+    }
+
+    free(buffer);
+
+    return lines;
+}
+
+static size_t read_getline_strdup(FILE *stream)
+{
+    size_t lines;
+
+    lines = 0;
+
+    for (;;)
+    {
+        char *buffer;
+        char *line;
+        char *current_line;
+        size_t capacity;
+        size_t trimmed_length;
+        ssize_t length;
+
+        buffer   = NULL;
+        capacity = 0;
+        length   = getline(&buffer, &capacity, stream);
+
+        if (length == -1)
+        {
+            free(buffer);
+            break;
+        }
+
+        // the line was copied once when it was read and again into the shell's state
+        line         = strdup(trim(buffer, (size_t)length, &trimmed_length));
+        current_line = strdup(line);
+        free(current_line);
+        free(line);
+        free(buffer);
+        ++lines;
+    }
+
+    return lines;
+}
+
+static char *trim(char *line, size_t length, size_t *trimmed_length)
+{
+    char *start;
+    char *end;
+
+    start = line;
+    end   = line + length;
+
+    while (end > start && isspace((unsigned char)end[-1]))
+    {
+        --end;
+    }
+
+    while (start < end && isspace((unsigned char)*start))
+    {
+        ++start;
+    }
+
+    *end            = '\0';
+    *trimmed_length = (size_t)(end - start);
+
+    return start;
+}
@@ -0,0 +1,502 @@
+/*
+ * Parse throughput over a corpus of command lines (bench/corpus/parse.txt), replayed
+ * the way the shell parses a line: separate_line, then parse_command for each command,
+ * from an arena that is reset after the line. Each section of the corpus is reported
+ * in ns per line, heap allocations per line and arena allocations per line, next to the
+ * regex and wordexp parser parse_command replaced, kept here as legacy_parse_command
+ * (with its off by one allocations for the stdin and stderr file names fixed).
+ *
+ * Globs are matched in the current directory. Heap allocations are counted by replacing
+ * malloc, which only works with glibc, elsewhere the column is 0.
+ *
+ * usage: dc_shell_bench_parse [iterations] [corpus]
+ */
+
+#include "bench.h"
+#include "command.h"
+#include <dc_posix/dc_stdlib.h>
+#include <regex.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wordexp.h>
+
+// the most sections a corpus can have
+#define MAX_SECTIONS 32
+
+/*! \struct legacy_regexes
+    \brief The redirection regexes the legacy parser used from struct state.
+*/
+struct legacy_regexes
+{
+    regex_t in;  /**< [ \t\f\v]<.* */
+    regex_t out; /**< [ \t\f\v][1^2]?>[>]?.* */
+    regex_t err; /**< [ \t\f\v]2>[>]?.* */
+};
+
+/*! \struct corpus
+    \brief The lines of the corpus file, in the order of their sections.
+*/
+struct corpus
+{
+    char **lines;                    /**< the lines */
+    size_t count;                    /**< the number of lines */
+    char *names[MAX_SECTIONS];       /**< the name of each section */
+    size_t starts[MAX_SECTIONS + 1]; /**< the first line of each section, and the end of the last one */
+    size_t sections;                 /**< the number of sections */
+};
+
+/*! \struct result
+    \brief What replaying some lines cost, per line.
+*/
+struct result
+{
+    double ns;    /**< the time */
+    double heap;  /**< the calls to malloc, calloc and realloc */
+    double arena; /**< the allocations from the arena */
+};
+
+static size_t heap_allocations; /**< the number of calls to malloc, calloc and realloc so far */
+
+static bool read_corpus(const char *path, struct corpus *corpus);
+static void free_corpus(struct corpus *corpus);
+static void legacy_parse_command(const struct dc_posix_env *env, struct dc_error *err,
+                                 const struct legacy_regexes *regexes, struct command *command);
+static struct result bench_lexer(const struct dc_posix_env *env, char **lines, size_t count, size_t iterations);
+static struct result bench_legacy(const struct dc_posix_env *env, const struct legacy_regexes *regexes, char **lines,
+                                  size_t count, size_t iterations);
+static void print_result(const char *name, size_t count, struct result lexer, struct result legacy);
+
+#ifdef __GLIBC__
+// glibc lets a program replace malloc, and its own functions (wordexp, strdup, ...) then call the replacement
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+    heap_allocations++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    heap_allocations++;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    heap_allocations++;
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    struct dc_posix_env   env;
+    struct legacy_regexes regexes;
+    struct corpus         corpus;
+    const char           *path;
+    size_t                iterations;
+    struct result         total_lexer;
+    struct result         total_legacy;
+
+    dc_posix_env_init(&env, NULL);
+    iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : 2000;
+    path       = argc > 2 ? argv[2] : DC_SHELL_PARSE_CORPUS;
+
+    if (!read_corpus(path, &corpus))
+    {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+
+    regcomp(&regexes.in, "[ \\t\\f\\v]<.*", REG_EXTENDED);
+    regcomp(&regexes.out, "[ \\t\\f\\v][1^2]?>[>]?.*", REG_EXTENDED);
+    regcomp(&regexes.err, "[ \\t\\f\\v]2>[>]?.*", REG_EXTENDED);
+    memset(&total_lexer, 0, sizeof(total_lexer));
+    memset(&total_legacy, 0, sizeof(total_legacy));
+
+    printf("%s: %zu lines, %zu iterations\n", path, corpus.count, iterations);
+    printf("%-12s %6s %10s %12s %12s %12s %14s\n", "section", "lines", "ns/line", "allocs/line", "arena/line",
+           "legacy ns", "legacy allocs");
+
+    for (size_t i = 0; i < corpus.sections; ++i)
+    {
+        struct result lexer;
+        struct result legacy;
+        size_t count;
+
+        count  = corpus.starts[i + 1] - corpus.starts[i];
+        lexer  = bench_lexer(&env, &corpus.lines[corpus.starts[i]], count, iterations);
+        legacy = bench_legacy(&env, &regexes, &corpus.lines[corpus.starts[i]], count, iterations);
+        print_result(corpus.names[i], count, lexer, legacy);
+
+        total_lexer.ns    += lexer.ns * (double)count;
+        total_lexer.heap  += lexer.heap * (double)count;
+        total_lexer.arena += lexer.arena * (double)count;
+        total_legacy.ns   += legacy.ns * (double)count;
+        total_legacy.heap += legacy.heap * (double)count;
+    }
+
+    total_lexer.ns    /= (double)corpus.count;
+    total_lexer.heap  /= (double)corpus.count;
+    total_lexer.arena /= (double)corpus.count;
+    total_legacy.ns   /= (double)corpus.count;
+    total_legacy.heap /= (double)corpus.count;
+    print_result("total", corpus.count, total_lexer, total_legacy);
+    printf("%-12s %6s %10.0f %12s %12s %12.0f\n", "lines/sec", "", 1e9 / total_lexer.ns, "", "", 1e9 / total_legacy.ns);
+
+    regfree(&regexes.in);
+    regfree(&regexes.out);
+    regfree(&regexes.err);
+    free_corpus(&corpus);
+
+    return EXIT_SUCCESS;
+}
+
+static bool read_corpus(const char *path, struct corpus *corpus)
+{
+    FILE *file;
+    char *line;
+    size_t capacity;
+    ssize_t length;
+
+    memset(corpus, 0, sizeof(*corpus));
+    file = fopen(path, "r");
+
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    line     = NULL;
+    capacity = 0;
+
+    while ((length = getline(&line, &capacity, file)) != -1)
+    {
+        if (length > 0 && line[length - 1] == '\n')
+        {
+            line[--length] = '\0';
+        }
+
+        if (strncmp(line, "# ", 2) == 0 && corpus->sections < MAX_SECTIONS && corpus->count == corpus->starts[corpus->sections])
+        {
+            // a section with no lines yet is renamed, so the comments at the top of the file are not a section
+            free(corpus->names[corpus->sections]);
+            corpus->names[corpus->sections] = strdup(&line[2]);
+        }
+        else if (strncmp(line, "# ", 2) == 0 && corpus->sections + 1 < MAX_SECTIONS)
+        {
+            corpus->starts[++corpus->sections] = corpus->count;
+            corpus->names[corpus->sections]    = strdup(&line[2]);
+        }
+        else if (length > 0 && line[0] != '#')
+        {
+            corpus->lines = realloc(corpus->lines, (corpus->count + 1) * sizeof(char *));
+            corpus->lines[corpus->count++] = strdup(line);
+        }
+    }
+
+    if (corpus->count > corpus->starts[corpus->sections])
+    {
+        corpus->sections++;
+    }
+    corpus->starts[corpus->sections] = corpus->count;
+
+    free(line);
+    fclose(file);
+
+    return true;
+}
+
+static void free_corpus(struct corpus *corpus)
+{
+    for (size_t i = 0; i < corpus->count; ++i)
+    {
+        free(corpus->lines[i]);
+    }
+
+    for (size_t i = 0; i < MAX_SECTIONS; ++i)
+    {
+        free(corpus->names[i]);
+    }
+
+    free(corpus->lines);
+}
+
+static struct result bench_lexer(const struct dc_posix_env *env, char **lines, size_t count, size_t iterations)
+{
+    struct dc_error err;
+    struct arena   *arena;
+    struct result   result;
+    size_t          heap;
+    double          start;
+
+    dc_error_init(&err, NULL);
+    arena = arena_create(env, &err, 4096);
+    memset(&result, 0, sizeof(result));
+
+    // one pass to grow the arena, as the shell will have done after its first few lines
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t commands;
+        const char *syntax_error;
+
+        separate_line(env, &err, arena, lines[i], &commands, &syntax_error);
+        arena_reset(arena);
+    }
+
+    heap  = heap_allocations;
+    start = bench_now();
+
+    for (size_t n = 0; n < iterations; ++n)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            struct command *commands;
+            size_t          commands_count;
+            const char     *syntax_error;
+
+            commands = separate_line(env, &err, arena, lines[i], &commands_count, &syntax_error);
+
+            for (size_t j = 0; j < commands_count && syntax_error == NULL; ++j)
+            {
+                syntax_error = parse_command(env, &err, NULL, &commands[j]);
+            }
+
+            dc_error_reset(&err);
+            result.arena += (double)arena->allocations;
+            arena_reset(arena);
+        }
+    }
+
+    result.ns    = (bench_now() - start) * 1e9 / (double)(iterations * count);
+    result.heap  = (double)(heap_allocations - heap) / (double)(iterations * count);
+    result.arena /= (double)(iterations * count);
+    arena_destroy(env, &arena);
+
+    return result;
+}
+
+static struct result bench_legacy(const struct dc_posix_env *env, const struct legacy_regexes *regexes, char **lines,
+                                  size_t count, size_t iterations)
+{
+    struct dc_error err;
+    struct result   result;
+    size_t          heap;
+    double          start;
+
+    dc_error_init(&err, NULL);
+    memset(&result, 0, sizeof(result));
+    heap  = heap_allocations;
+    start = bench_now();
+
+    for (size_t n = 0; n < iterations; ++n)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            struct command *commands;
+            size_t          commands_count;
+            const char     *syntax_error;
+
+            // the legacy parser was given each command of the line, as separate_line split it
+            commands = separate_line(env, &err, NULL, lines[i], &commands_count, &syntax_error);
+
+            for (size_t j = 0; j < commands_count; ++j)
+            {
+                legacy_parse_command(env, &err, regexes, &commands[j]);
+                destroy_command(env, &commands[j]);
+            }
+
+            free(commands);
+            dc_error_reset(&err);
+        }
+    }
+
+    result.ns   = (bench_now() - start) * 1e9 / (double)(iterations * count);
+    result.heap = (double)(heap_allocations - heap) / (double)(iterations * count);
+
+    return result;
+}
+
+static void print_result(const char *name, size_t count, struct result lexer, struct result legacy)
+{
+    printf("%-12s %6zu %10.1f %12.2f %12.2f %12.1f %14.2f\n", name, count, lexer.ns, lexer.heap, lexer.arena, legacy.ns,
+           legacy.heap);
+}
+
+static void legacy_parse_command(const struct dc_posix_env *env, struct dc_error *err,
+                                 const struct legacy_regexes *regexes, struct command *command)
+{
+    wordexp_t exp_main;
+    int status_main;
+    char *string;
+    regmatch_t match;
+    enum redirection_type type;
+    int matched;
+    const char *append = ">>";
+
+    string  = strdup(command->line);
+    matched = regexec(&regexes->err,
+                      string,
+                      1,
+                      &match,
+                      0);
+
+    if (matched == 0)
+    {
+        char *str2;
+        char *str;
+        wordexp_t exp;
+        int status;
+        size_t size;
+        // Offset of the first character of the stderr file name from the start. " 2>"
+        size_t offset = 3;
+
+        regoff_t length = match.rm_eo - match.rm_so;
+
+        str = malloc(length + 1);
+        strncpy(str, &string[match.rm_so], length);
+        string[match.rm_so] = '\0';
+        str[length] = '\0';
+
+        type = REDIRECTION_WRITE;
+        if (strstr(str, append))
+        {
+            offset++;
+            type = REDIRECTION_APPEND;
+        }
+
+        size = length - offset;
+        str2 = dc_malloc(env, err, sizeof(char) * (size + 1));
+        strncpy(str2, &str[offset], size);
+        str2[size] = '\0';
+        // wordexp
+        status = wordexp(str2, &exp, 0);
+        if (status == 0)
+        {
+            append_redirection(env, err, command, type, STDERR_FILENO, -1, exp.we_wordv[0]);
+            wordfree(&exp);
+        }
+        else
+        {
+            command->exit_code = 1;
+        }
+        free(str2);
+        free(str);
+    }
+
+    matched = regexec(&regexes->out,
+                      string,
+                      1,
+                      &match,
+                      0);
+
+    if (matched == 0)
+    {
+        char *str2;
+        char *str;
+        wordexp_t exp;
+        int status;
+        size_t size;
+        // Offset of the first character of the stdout file name from the start. " >"
+        size_t offset = 2;
+
+        regoff_t length = match.rm_eo - match.rm_so;
+
+        str = malloc(length + 1);
+        strncpy(str, &string[match.rm_so], length);
+        string[match.rm_so] = '\0';
+        str[length] = '\0';
+
+        type = REDIRECTION_WRITE;
+        if (strstr(str, append))
+        {
+            offset++;
+            type = REDIRECTION_APPEND;
+        }
+
+        size = length - offset;
+        str2 = dc_malloc(env, err, sizeof(char) * (size + 1));
+        strncpy(str2, &str[offset], size);
+        str2[size] = '\0';
+
+        // wordexp
+        status = wordexp(str2, &exp, 0);
+        if (status == 0)
+        {
+            append_redirection(env, err, command, type, STDOUT_FILENO, -1, exp.we_wordv[0]);
+            wordfree(&exp);
+        }
+        else
+        {
+            command->exit_code = 1;
+        }
+        free(str2);
+        free(str);
+    }
+
+    matched = regexec(&regexes->in,
+                      string,
+                      1,
+                      &match,
+                      0);
+
+    if (matched == 0)
+    {
+        char *str2;
+        char *str;
+        wordexp_t exp;
+        int status;
+        size_t size;
+        // Offset of the first character of the stdin file name from the start. " <"
+        size_t offset = 2;
+
+        regoff_t length = match.rm_eo - match.rm_so;
+
+        str = malloc(length + 1);
+        strncpy(str, &string[match.rm_so], length);
+        string[match.rm_so] = '\0';
+        str[length] = '\0';
+
+        size = length - offset;
+        str2 = dc_malloc(env, err, sizeof(char) * (size + 1));
+        strncpy(str2, &str[offset], size);
+        str2[size] = '\0';
+        // wordexp
+        status = wordexp(str2, &exp, 0);
+        if (status == 0)
+        {
+            append_redirection(env, err, command, REDIRECTION_READ, STDIN_FILENO, -1, exp.we_wordv[0]);
+            wordfree(&exp);
+        }
+        else
+        {
+            command->exit_code = 1;
+        }
+        free(str2);
+        free(str);
+    }
+
+    status_main = wordexp(string, &exp_main, 0);
+    if (status_main == 0)
+    {
+        command->argc = exp_main.we_wordc;
+        command->argv = dc_calloc(env, err, (exp_main.we_wordc + 2), sizeof(char *));
+
+        for (size_t i = 1; i < exp_main.we_wordc; ++i)
+        {
+            command->argv[i] = strdup(exp_main.we_wordv[i]);
+        }
+        command->command = strdup(exp_main.we_wordv[0]);
+        wordfree(&exp_main);
+    }
+    else
+    {
+        command->exit_code = 1;
+    }
+
+    free(string);
+}
@@ -0,0 +1,181 @@
+/*
+ * Throughput of scan_span on 1 MiB lines with each scanner the CPU supports,
+ * and of the lexer and separate_line (which use it) on the same lines.
+ *
+ * usage: dc_shell_bench_scan [size in KiB]
+ */
+
+#include "bench.h"
+#include "command.h"
+#include "lexer.h"
+#include "scan.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define RUNS 10
+
+static char *make_line(const char *pattern, size_t size);
+static double bench_scan(const struct scan_set *set, const char *line, size_t length, size_t *count);
+static double bench_lexer(const char *line, size_t length, size_t *count);
+static double bench_separate(const struct dc_posix_env *env, const char *line, size_t *count);
+
+int main(int argc, char *argv[])
+{
+    static const struct
+    {
+        const char *name;
+        const char *pattern;
+    } lines[] = {
+        {"words", "gcc -Wall -O2 -o hello hello.c "},
+        {"paths", "/usr/local/share/dc_shell/examples/scripts/test.sh "},
+        {"quoted", "'a long argument with spaces in it that is quoted so nothing in it is special' "},
+        {"plain", "abcdefghijklmnopqrstuvwxyz0123456789"},
+    };
+    static const char word_chars[] = " \t\n\v\f\r<>&'\"\\$`*?[";
+    struct dc_posix_env env;
+    size_t size;
+
+    dc_posix_env_init(&env, NULL);
+    size = (argc > 1 ? strtoul(argv[1], NULL, 10) : 1024) * 1024;
+    printf("%zu byte lines, best of %d\n", size, RUNS);
+    printf("%-8s %-14s %10s %10s\n", "line", "scanner", "MiB/s", "stops");
+
+    for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); ++i)
+    {
+        char *line;
+        double seconds;
+        size_t count;
+
+        line = make_line(lines[i].pattern, size);
+
+        for (enum scan_impl impl = SCAN_TABLE; impl <= SCAN_AVX2; ++impl)
+        {
+            struct scan_set set;
+
+            scan_set_init(&set, word_chars, sizeof(word_chars) - 1);
+
+            if (scan_set_use(&set, impl))
+            {
+                seconds = bench_scan(&set, line, size, &count);
+                printf("%-8s %-14s %10.1f %10zu\n", lines[i].name, scan_impl_name(impl),
+                       (double)size / seconds / (1024 * 1024), count);
+            }
+        }
+
+        seconds = bench_lexer(line, size, &count);
+        printf("%-8s %-14s %10.1f %10zu\n", lines[i].name, "lexer", (double)size / seconds / (1024 * 1024), count);
+        seconds = bench_separate(&env, line, &count);
+        printf("%-8s %-14s %10.1f %10zu\n", lines[i].name, "separate_line", (double)size / seconds / (1024 * 1024),
+               count);
+        free(line);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static char *make_line(const char *pattern, size_t size)
+{
+    char *line;
+    size_t length;
+
+    line   = malloc(size + 1);
+    length = strlen(pattern);
+
+    for (size_t i = 0; i < size; i += length)
+    {
+        memcpy(&line[i], pattern, size - i < length ? size - i : length);
+    }
+
+    line[size] = '\0';
+
+    return line;
+}
+
+static double bench_scan(const struct scan_set *set, const char *line, size_t length, size_t *count)
+{
+    double best;
+
+    best = 0;
+
+    for (int run = 0; run < RUNS; ++run)
+    {
+        double start;
+        double elapsed;
+        size_t pos;
+
+        *count = 0;
+        start  = bench_now();
+
+        for (pos = scan_span(set, line, length); pos < length; pos += 1 + scan_span(set, &line[pos + 1], length - pos - 1))
+        {
+            ++*count;
+        }
+
+        elapsed = bench_now() - start;
+        best    = run == 0 || elapsed < best ? elapsed : best;
+    }
+
+    return best;
+}
+
+static double bench_lexer(const char *line, size_t length, size_t *count)
+{
+    char *buffer;
+    double best;
+
+    buffer = malloc(length + 1);
+    best   = 0;
+
+    for (int run = 0; run < RUNS; ++run)
+    {
+        struct lexer lexer;
+        struct token token;
+        double start;
+        double elapsed;
+
+        *count = 0;
+        start  = bench_now();
+        lexer_init(&lexer, line, buffer);
+
+        while (lexer_next(&lexer, &token) && token.type != TOKEN_END)
+        {
+            ++*count;
+        }
+
+        elapsed = bench_now() - start;
+        best    = run == 0 || elapsed < best ? elapsed : best;
+    }
+
+    free(buffer);
+
+    return best;
+}
+
+static double bench_separate(const struct dc_posix_env *env, const char *line, size_t *count)
+{
+    struct dc_error err;
+    struct arena *arena;
+    double best;
+
+    dc_error_init(&err, NULL);
+    arena = arena_create(env, &err, 4096);
+    best  = 0;
+
+    for (int run = 0; run < RUNS; ++run)
+    {
+        const char *syntax_error;
+        double start;
+        double elapsed;
+
+        start = bench_now();
+        separate_line(env, &err, arena, line, count, &syntax_error);
+        elapsed = bench_now() - start;
+        arena_reset(arena);
+        best = run == 0 || elapsed < best ? elapsed : best;
+    }
+
+    arena_destroy(env, &arena);
+    dc_error_reset(&err);
+
+    return best;
+}
@@ -0,0 +1,111 @@
+/*
+ * Compare the posix_spawn launcher used by execute() with the fork + execv
+ * launcher it replaced, for a small shell and for a shell with a large RSS.
+ *
+ * usage: dc_shell_bench_spawn [iterations] [large RSS in MiB]
+ */
+
+#include "bench.h"
+#include "execute.h"
+#include <dc_util/strings.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static double bench_spawn(const struct dc_posix_env *env, struct dc_error *err, size_t iterations, char **path);
+static double bench_fork(size_t iterations, char **path);
+
+int main(int argc, char *argv[])
+{
+    struct dc_posix_env env;
+    struct dc_error     err;
+    char              **path;
+    size_t              iterations;
+    size_t              large_mb;
+    char               *ballast;
+
+    dc_posix_env_init(&env, NULL);
+    dc_error_init(&err, NULL);
+    iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : 500;
+    large_mb   = argc > 2 ? strtoul(argv[2], NULL, 10) : 1024;
+    path       = dc_strs_to_array(&env, &err, 4, "/usr/local/bin", "/usr/bin", "/bin", NULL);
+
+    printf("%-8s %12s %12s\n", "rss", "spawn us", "fork us");
+    printf("%-8s %12.1f %12.1f\n", "small", bench_spawn(&env, &err, iterations, path), bench_fork(iterations, path));
+
+    // Touch every page so that fork has to copy the page tables for all of it.
+    ballast = malloc(large_mb * 1024 * 1024);
+    if (ballast == NULL)
+    {
+        fprintf(stderr, "cannot allocate %zu MiB\n", large_mb);
+        return EXIT_FAILURE;
+    }
+    memset(ballast, 1, large_mb * 1024 * 1024);
+    printf("%-4zuMiB  %12.1f %12.1f\n",
+           large_mb,
+           bench_spawn(&env, &err, iterations, path),
+           bench_fork(iterations, path));
+    free(ballast);
+
+    dc_strs_destroy_array(&env, 4, path);
+    free(path);
+    dc_error_reset(&err);
+
+    return EXIT_SUCCESS;
+}
+
+static double bench_spawn(const struct dc_posix_env *env, struct dc_error *err, size_t iterations, char **path)
+{
+    struct path_cache *path_cache;
+    double start;
+    double elapsed;
+
+    path_cache = path_cache_create(env, err, path);
+    start      = bench_now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        struct command command;
+
+        memset(&command, 0, sizeof(struct command));
+        command.command = strdup("true");
+        command.argc    = 1;
+        command.argv    = calloc(2, sizeof(char *));
+        execute(env, err, &command, path_cache);
+        destroy_command(env, &command);
+    }
+
+    elapsed = bench_now() - start;
+    path_cache_destroy(env, &path_cache);
+
+    return elapsed * 1e6 / (double)iterations;
+}
+
+static double bench_fork(size_t iterations, char **path)
+{
+    double start;
+
+    start = bench_now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        pid_t pid;
+        int   status;
+
+        pid = fork();
+        if (pid == 0)
+        {
+            char  cmd[1024];
+            char *args[2] = {cmd, NULL};
+
+            for (size_t index = 0; path[index]; ++index)
+            {
+                snprintf(cmd, sizeof(cmd), "%s/%s", path[index], "true");
+                execv(cmd, args);
+            }
+            _exit(127);
+        }
+        waitpid(pid, &status, 0);
+    }
+
+    return (bench_now() - start) * 1e6 / (double)iterations;
+}
@@ -0,0 +1,154 @@
+/*
+ * libFuzzer harness for the parser. The input is a script: each line is separated
+ * and parsed the way the shell does it (read_command_line, separate_line, lex_command,
+ * read_heredocs for the bodies that follow, then expand_command), from an arena reset after the line.
+ *
+ * Built with Clang it is linked with libFuzzer:
+ *   dc_shell_fuzz_parse new_corpus ../bench/corpus
+ * With any other compiler it gets a main that runs each file it is given once:
+ *   dc_shell_fuzz_parse ../bench/corpus/parse.txt crash-1234
+ */
+
+#include "command.h"
+#include "input.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+#ifdef DC_SHELL_FUZZ_MAIN
+static int run_file(const char *path);
+#endif
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static struct dc_posix_env env;
+    static struct arena       *arena;
+    struct dc_error            err;
+    FILE                      *stream;
+    char                      *copy;
+    struct input              *input;
+
+    // fmemopen needs at least one byte
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    dc_posix_env_init(&env, NULL);
+    dc_error_init(&err, NULL);
+
+    // the arena is kept between inputs, as the shell keeps it between lines
+    if (arena == NULL)
+    {
+        arena = arena_create(&env, &err, 4096);
+    }
+
+    copy = malloc(size);
+    memcpy(copy, data, size);
+    stream = fmemopen(copy, size, "r");
+    input  = input_create(&env, &err, stream);
+
+    while (stream && dc_error_has_no_error(&err))
+    {
+        struct command *commands;
+        const char     *syntax_error;
+        char           *line;
+        size_t          length;
+        size_t          count;
+
+        line = read_command_line(&env, &err, input, &length);
+
+        if (line == NULL || (length == 0 && input->eof))
+        {
+            break;
+        }
+
+        commands = separate_line(&env, &err, arena, line, &count, &syntax_error);
+
+        for (size_t i = 0; i < count && syntax_error == NULL && dc_error_has_no_error(&err); ++i)
+        {
+            syntax_error = lex_command(&env, &err, &commands[i]);
+        }
+
+        for (size_t i = 0; i < count && syntax_error == NULL && dc_error_has_no_error(&err); ++i)
+        {
+            read_heredocs(&env, &err, NULL, &commands[i], input, NULL, NULL);
+        }
+
+        // the shell expands each pipeline just before it runs
+        for (size_t i = 0; i < count && syntax_error == NULL && dc_error_has_no_error(&err); ++i)
+        {
+            syntax_error = expand_command(&env, &err, NULL, &commands[i]);
+        }
+
+        arena_reset(arena);
+    }
+
+    if (stream)
+    {
+        fclose(stream);
+    }
+
+    input_destroy(&env, &input);
+    free(copy);
+    dc_error_reset(&err);
+
+    return 0;
+}
+
+#ifdef DC_SHELL_FUZZ_MAIN
+int main(int argc, char *argv[])
+{
+    int status;
+
+    status = EXIT_SUCCESS;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (run_file(argv[i]) != 0)
+        {
+            perror(argv[i]);
+            status = EXIT_FAILURE;
+        }
+    }
+
+    return status;
+}
+
+static int run_file(const char *path)
+{
+    FILE    *file;
+    uint8_t *data;
+    long     size;
+
+    file = fopen(path, "rb");
+
+    if (file == NULL || fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) < 0 || fseek(file, 0, SEEK_SET) != 0)
+    {
+        if (file)
+        {
+            fclose(file);
+        }
+        return -1;
+    }
+
+    data = malloc((size_t)size + 1);
+
+    if (fread(data, 1, (size_t)size, file) != (size_t)size)
+    {
+        free(data);
+        fclose(file);
+        return -1;
+    }
+
+    LLVMFuzzerTestOneInput(data, (size_t)size);
+    printf("%s: %ld bytes\n", path, size);
+    free(data);
+    fclose(file);
+
+    return 0;
+}
+#endif
@@ -0,0 +1,149 @@
+#ifndef DC_SHELL_ARENA_H
+#define DC_SHELL_ARENA_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <dc_posix/dc_posix_env.h>
+#include <stddef.h>
+
+/*! \struct arena_block
+    \brief One chunk of memory handed out by an arena.
+*/
+struct arena_block
+{
+    struct arena_block *next; /**< the block to use once this one is full */
+    size_t size;              /**< the number of bytes in data */
+    size_t used;              /**< the number of bytes handed out */
+    max_align_t data[];       /**< the memory */
+};
+
+/*! \struct arena
+    \brief Bump allocator for everything that lives as long as one command line.
+
+    Memory is handed out from a list of blocks and is never freed on its own,
+    arena_reset makes all of it available again at once. The blocks are kept
+    so a shell that runs similar lines stops calling malloc after the first one.
+*/
+struct arena
+{
+    struct arena_block *first;   /**< the first block, where a reset starts again */
+    struct arena_block *current; /**< the block allocations come from */
+    size_t block_size;           /**< the size of a new block (a larger allocation gets a block of its own size) */
+    size_t blocks;               /**< the number of blocks */
+    size_t allocations;          /**< the number of allocations since the last reset */
+    size_t bytes;                /**< the number of bytes handed out since the last reset */
+};
+
+/**
+ * Create an arena.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param block_size the size of each block.
+ * @return the arena (must be destroyed with arena_destroy) or NULL.
+ */
+struct arena *arena_create(const struct dc_posix_env *env, struct dc_error *err, size_t block_size);
+
+/**
+ * Free an arena and all of its blocks.
+ *
+ * @param env the posix environment.
+ * @param parena the arena, set to NULL.
+ */
+void arena_destroy(const struct dc_posix_env *env, struct arena **parena);
+
+/**
+ * Make all of the memory in the arena available again, without freeing any blocks.
+ * Everything allocated from the arena before the reset must no longer be used.
+ *
+ * @param arena the arena, can be NULL.
+ */
+void arena_reset(struct arena *arena);
+
+/**
+ * Allocate memory, aligned for any type.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena the arena, or NULL to use malloc.
+ * @param size the number of bytes.
+ * @return the memory or NULL.
+ */
+void *arena_alloc(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, size_t size);
+
+/**
+ * Allocate memory set to 0.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena the arena, or NULL to use calloc.
+ * @param count the number of elements.
+ * @param size the size of each element.
+ * @return the memory or NULL.
+ */
+void *arena_calloc(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, size_t count,
+                   size_t size);
+
+/**
+ * Grow an allocation. The most recent allocation grows in place if the block has room,
+ * anything else is copied (the old memory is not reused until the next reset).
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena the arena, or NULL to use realloc.
+ * @param ptr the memory to grow, can be NULL.
+ * @param old_size the size of ptr.
+ * @param size the new size.
+ * @return the memory or NULL (ptr is unchanged).
+ */
+void *arena_realloc(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, void *ptr,
+                    size_t old_size, size_t size);
+
+/**
+ * Copy at most length characters of a string.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena the arena, or NULL to use malloc.
+ * @param str the string.
+ * @param length the maximum number of characters to copy.
+ * @return the copy or NULL.
+ */
+char *arena_strndup(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, const char *str,
+                    size_t length);
+
+/**
+ * Copy a string.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena the arena, or NULL to use malloc.
+ * @param str the string.
+ * @return the copy or NULL.
+ */
+char *arena_strdup(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, const char *str);
+
+/**
+ * Give back memory. Memory from an arena is only reclaimed by arena_reset, so this only frees when arena is NULL.
+ *
+ * @param arena the arena the memory came from, or NULL if it came from malloc.
+ * @param ptr the memory, can be NULL.
+ */
+void arena_free(struct arena *arena, void *ptr);
+
+#endif // DC_SHELL_ARENA_H
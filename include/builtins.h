@@ -19,8 +19,48 @@
  */
 
 #include "execute.h"
+#include "jobs.h"
 #include <dc_posix/dc_posix_env.h>
 
+/**
+ * Run a builtin. Every builtin in the table is run through this signature,
+ * its output goes to state->stdout and its error messages to state->stderr.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param state the current state
+ */
+typedef void (*builtin_func)(const struct dc_posix_env *env, struct dc_error *err,
+                             struct command *command, struct state *state);
+
+/*! \struct builtin
+    \brief A command that is run inside the shell rather than as a program.
+*/
+struct builtin
+{
+  const char *name;  /**< the command name */
+  builtin_func func; /**< runs the builtin */
+};
+
+/**
+ * Find the builtin for a command name.
+ * The table is sorted by name so this is a binary search.
+ *
+ * @param env the posix environment.
+ * @param name the command name.
+ * @return the builtin or NULL if the command is not a builtin.
+ */
+const struct builtin *find_builtin(const struct dc_posix_env *env, const char *name);
+
+/**
+ * Get a builtin by its place in the table, to go through all of them (eg. to complete a command name).
+ *
+ * @param index the place in the table.
+ * @return the builtin, or NULL past the last one.
+ */
+const struct builtin *builtin_at(size_t index);
+
 /**
  * Change the working directory.
  * ~ is converted to the users home directory.
@@ -30,9 +70,232 @@
  * @param env the posix environment.
  * @param err the error object
  * @param command the command information
+ * @param cwd the cached working directory, replaced once the directory has changed (NULL to keep none)
  * @param errstream the stream to print error messages to
  */
 void builtin_cd(const struct dc_posix_env *env, struct dc_error *err,
-                struct command *command, FILE *errstream);
+                struct command *command, char **cwd, FILE *errstream);
+
+/**
+ * Display or change the cache of programs found in the PATH directories.
+ * - no arguments displays the cached commands with their hit counts and the total hits and misses.
+ * - -r forgets every cached command.
+ * - any other arguments are looked up and added to the cache.
+ * The command->exit_code is set to 0 on success or 1 if an argument cannot be found.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param path_cache the cache of programs
+ * @param outstream the stream to display the cache on
+ * @param errstream the stream to print error messages to
+ */
+void builtin_hash(const struct dc_posix_env *env, struct dc_error *err,
+                  struct command *command, struct path_cache *path_cache, FILE *outstream, FILE *errstream);
+
+/**
+ * Set or unset shell options.
+ * - -o name turns the option on, +o name turns it off.
+ * - -o on its own displays the options.
+ * - -e and +e are the same as -o errexit and +o errexit.
+ * The options are errexit (exit the shell when a line fails), pipefail (see execute_pipeline)
+ * and rusage (print the resources used by every program).
+ * The command->exit_code is set to 0 on success or 1 for an unknown option.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param state the state holding the options
+ * @param errstream the stream to print error messages to
+ */
+void builtin_set(const struct dc_posix_env *env, struct dc_error *err,
+                 struct command *command, struct state *state, FILE *errstream);
+
+/**
+ * Display the background jobs and their status.
+ * Jobs that have finished are removed once they are displayed.
+ * The command->exit_code is set to 0.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param jobs the job table
+ * @param outstream the stream to display the jobs on
+ */
+void builtin_jobs(const struct dc_posix_env *env, struct dc_error *err,
+                  struct command *command, struct jobs *jobs, FILE *outstream);
+
+/**
+ * Wait for background jobs to finish.
+ * - no arguments waits for every job and sets the command->exit_code to 0.
+ * - otherwise waits for each job (see jobs_find) and sets the command->exit_code to that of the last one,
+ *   or 127 if a job does not exist.
+ * - ^C (see jobs_control) stops the wait and sets the command->exit_code to 128 + the signal, the jobs keep running.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param jobs the job table
+ * @param errstream the stream to print error messages to
+ */
+void builtin_wait(const struct dc_posix_env *env, struct dc_error *err,
+                  struct command *command, struct jobs *jobs, FILE *errstream);
+
+/**
+ * Move a job (the most recent one if there is no argument) to the foreground and wait for it.
+ * With job control the job is given the terminal while it runs.
+ * The command->exit_code is set to that of the job, or 1 if the job does not exist.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param jobs the job table
+ * @param outstream the stream to print the job line on
+ * @param errstream the stream to print error messages to
+ */
+void builtin_fg(const struct dc_posix_env *env, struct dc_error *err,
+                struct command *command, struct jobs *jobs, FILE *outstream, FILE *errstream);
+
+/**
+ * Continue a stopped job (the most recent one if there is no argument) in the background.
+ * The command->exit_code is set to 0, or 1 if the job does not exist.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param jobs the job table
+ * @param outstream the stream to print the job line on
+ * @param errstream the stream to print error messages to
+ */
+void builtin_bg(const struct dc_posix_env *env, struct dc_error *err,
+                struct command *command, struct jobs *jobs, FILE *outstream, FILE *errstream);
+
+/**
+ * Print the working directory.
+ * The command->exit_code is set to 0 on success or 1 on failure.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param outstream the stream to print the directory on
+ * @param errstream the stream to print error messages to
+ */
+void builtin_pwd(const struct dc_posix_env *env, struct dc_error *err,
+                 struct command *command, FILE *outstream, FILE *errstream);
+
+/**
+ * Print the arguments separated by spaces and followed by a newline.
+ * - -n as the first argument leaves off the newline.
+ * The command->exit_code is set to 0.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param outstream the stream to print the arguments on
+ */
+void builtin_echo(const struct dc_posix_env *env, struct dc_error *err,
+                  struct command *command, FILE *outstream);
+
+/**
+ * Replace the shell with a program, or apply redirections to the shell itself.
+ * - no arguments keeps the redirections for the rest of the shell (exec 4>log).
+ * - otherwise the first argument is the program to run, found the same way as any command,
+ *   with command->envp as its environment (or environ if it is NULL).
+ * The command->exit_code is set to 0 when there is no program, to 127 if the program cannot be found,
+ * to 126 if it cannot be run, or to the error code when a redirection fails.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param path_cache the cache of programs
+ * @param jobs the job table, job control is turned off for the program
+ * @param outstream the stream to flush before the redirections
+ * @param errstream the stream to print error messages to
+ */
+void builtin_exec(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                  struct path_cache *path_cache, struct jobs *jobs, FILE *outstream, FILE *errstream);
+
+/**
+ * Copy the files named by the arguments, or stdin if there are none, to the output.
+ * - - as an argument copies stdin.
+ * The data is moved by the kernel where it can be (see copy_fd), so cat a > b runs without
+ * starting a program or copying through the shell.
+ * The command->exit_code is set to 0 on success or 1 if any file could not be copied.
+ * ^C (see jobs_control) stops the copy and sets the command->exit_code to 128 + the signal.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param jobs the job table, for the interrupt flag (can be NULL)
+ * @param outstream the stream to copy the files to, it must have a descriptor
+ * @param errstream the stream to print error messages to
+ */
+void builtin_cat(const struct dc_posix_env *env, struct dc_error *err,
+                 struct command *command, struct jobs *jobs, FILE *outstream, FILE *errstream);
+
+/**
+ * Run a command once for each argument after :::, several at a time (see parallel_run).
+ * parallel [-j N] [-k | --keep-order] command [arg...] ::: arg...
+ * - {} in the command is replaced by the argument, without one the argument is added at the end.
+ * - -j N runs at most N at once (0 for no limit), the default is the number of processors.
+ * - -k or --keep-order prints the output of each run in argument order rather than as it is written.
+ * The runs that failed are listed on the error stream once they have all finished.
+ * The command->exit_code is set to the number of runs that failed (101 for more than 100),
+ * or 2 if the arguments are not valid.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param path_cache the cache of programs found in the PATH directories
+ * @param jobs the job table
+ * @param outstream the stream the output goes to, it must have a descriptor
+ * @param errstream the stream to print error messages to
+ */
+void builtin_parallel(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                      struct path_cache *path_cache, struct jobs *jobs, FILE *outstream, FILE *errstream);
+
+/**
+ * Export variables to the programs the shell runs (see vars_set).
+ * - NAME=value sets and exports the variable, NAME on its own exports the shell variable if it is set.
+ * - no arguments displays the exported variables.
+ * Setting PATH also changes the directories the shell searches (see path_cache_set_path).
+ * The command->exit_code is set to 0 on success or 1 if a name is not valid.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param state the state holding the PATH directories
+ * @param errstream the stream to print error messages to
+ */
+void builtin_export(const struct dc_posix_env *env, struct dc_error *err,
+                    struct command *command, struct state *state, FILE *errstream);
+
+/**
+ * Remove variables (see vars_unset).
+ * Removing PATH leaves the shell with no directories to search.
+ * The command->exit_code is set to 0 on success or 1 if a name is not valid.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param state the state holding the PATH directories
+ * @param errstream the stream to print error messages to
+ */
+void builtin_unset(const struct dc_posix_env *env, struct dc_error *err,
+                   struct command *command, struct state *state, FILE *errstream);
+
+/**
+ * Set the shell variables of a command that is only assignments (FOO=1 with no command).
+ * The variables are not exported unless they already were, assigning PATH also changes
+ * the directories the shell searches.
+ * The command->exit_code is set to 0.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command with the assignments
+ * @param state the state holding the variables
+ */
+void assign_variables(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                      struct state *state);
 
 #endif // DC_SHELL_BUILTINS_H
@@ -18,43 +18,190 @@
  *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include "arena.h"
 #include "state.h"
 #include <dc_posix/dc_posix_env.h>
+#include <sys/resource.h>
+
+struct editor;
+struct token;
+struct vars;
+
+/*! \enum command_connector
+    \brief How a command is joined to the command after it.
+*/
+enum command_connector
+{
+  CONNECTOR_NONE, /**< the last command on the line */
+  CONNECTOR_PIPE, /**< the stdout of the command is the stdin of the next one (|) */
+  CONNECTOR_BACKGROUND, /**< the pipeline ending with the command runs in the background (&) */
+  CONNECTOR_SEQUENCE, /**< the next pipeline runs after this one (;) */
+  CONNECTOR_AND, /**< the next pipeline runs only if this one succeeds (&&) */
+  CONNECTOR_OR, /**< the next pipeline runs only if this one fails (||) */
+};
+
+/*! \enum redirection_type
+    \brief What a redirection does to its descriptor.
+*/
+enum redirection_type
+{
+  REDIRECTION_READ,       /**< open the file for reading (N< file) */
+  REDIRECTION_WRITE,      /**< create or truncate the file (N> file) */
+  REDIRECTION_APPEND,     /**< create the file or add to the end of it (N>> file) */
+  REDIRECTION_READ_WRITE, /**< create or open the file for reading and writing (N<> file) */
+  REDIRECTION_DUP,        /**< make the descriptor a copy of another one (N>&M, N<&M) */
+  REDIRECTION_CLOSE,      /**< close the descriptor (N>&-, N<&-) */
+  REDIRECTION_HEREDOC,    /**< read the text in file (N<< word, N<<- word and N<<< word) */
+};
+
+/*! \struct redirection
+    \brief One redirection of a command, they are applied in the order they appear.
+*/
+struct redirection
+{
+  enum redirection_type type; /**< what to do */
+  int fd;                     /**< the descriptor being redirected */
+  int source_fd;              /**< the descriptor to copy, for REDIRECTION_DUP */
+  char *file;                 /**< the file, the text for REDIRECTION_HEREDOC, NULL for a dup or close */
+  char *delimiter;            /**< the line that ends a here-document whose body has not been read, otherwise NULL */
+  bool strip_tabs;            /**< <<- removes the tabs at the start of each line of the body */
+  bool literal;               /**< the delimiter was quoted, so the body is not expanded */
+};
 
 /*! \struct command
-    \brief The commands to enter, currently there is only one.
+    \brief One of the commands entered on the line.
 
     The state passed around to the FSM functions.
 */
 struct command
 {
+  struct arena *arena;      /**< where all of the strings and argv are allocated, NULL for malloc */
   char *line;               /**< the current command line */
   char *command;            /**< the program/builtin to run */
   size_t argc;              /**< the number of arguments to the command */
   char **argv;              /**< the arguments to the command, arg[0] must be NULL */
-  char *stdin_file;         /**< the file to redirect stdin from */
-  char *stdout_file;        /**< the file to redirect stdout to */
-  bool stdout_overwrite;    /**< append or overwrite the stdout file (true = overwrite) */
-  char *stderr_file;        /**< the file to redirect strderr to */
-  bool stderr_overwrite;    /**< append or overwrite the strerr file (true = overwrite) */
+  struct redirection *redirections; /**< the redirections, in the order they are applied */
+  size_t redirection_count; /**< the number of redirections */
+  char **assignments;       /**< the NAME=value words before the command, with the values expanded */
+  size_t assignment_count;  /**< the number of assignments */
+  char **envp;              /**< the environment the program runs with (see vars_envp), NULL for environ */
   int exit_code;            /**< the exit code from the program/builtin */
+  struct rusage rusage;     /**< the resources used by the program (all 0 for a builtin) */
+  enum command_connector connector; /**< how the command is joined to the next one */
+  bool expanded;            /**< a word was expanded (~, $ or a glob) or there is a here-document, so parsing the line again can give something else */
+  struct token *tokens;     /**< kept by lex_command for expand_command (see lex_command), otherwise NULL */
+  size_t token_count;       /**< the number of tokens */
+  char *token_text;         /**< the text of the tokens (see lexer_init) */
 };
 
 /**
  * Parse the command. Take the command->line and use it to fill in all of the fields.
+ * The line is split into words and redirections in one pass (see lexer_next).
+ * It is lex_command followed by expand_command.
+ * Words with ~, $ or glob characters are expanded by expand_word, which never runs command substitution.
+ * The parameters are looked up in state->vars (or the environment if it is NULL).
+ * NAME=value words before the command are added to command->assignments (see expand_assignment).
+ * Redirections are added to command->redirections in order; &> file is 1> file followed by 2>&1,
+ * and >& with a word that is not a descriptor number (or -) is the same as &>.
+ * A here-string (<<< word) is the expanded word and a newline, a here-document (<< word) only
+ * records its delimiter, its body is read from the lines after the command by read_heredocs.
  *
  * @param env the posix environment.
  * @param err the error object.
- * @param state the current state, to set the fatal_error and access the command line and regex for redirection.
+ * @param state the current state.
  * @param command the command to parse.
+ * @return NULL, or the unexpected token (or the unmatched quote) if there is a syntax error.
  */
-void parse_command(const struct dc_posix_env *env, struct dc_error *err,
-                   struct state *state, struct command *command);
+const char *parse_command(const struct dc_posix_env *env, struct dc_error *err,
+                          struct state *state, struct command *command);
 
 /**
+ * The first half of parse_command: split the command into tokens and check them for syntax errors.
+ * A command with nothing to expand is filled in straight away. Otherwise (always for a command with a
+ * here-document) the tokens are kept and only the here-documents are added, so that read_heredocs can read
+ * their bodies; expand_command fills in the rest just before the command runs, so that it sees what the
+ * commands before it on the line did (eg. cd dir; echo * or X=1; echo $X).
  *
- * @param env
- * @param command
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param command the command to parse.
+ * @return NULL, or the unexpected token (or the unmatched quote) if there is a syntax error.
+ */
+const char *lex_command(const struct dc_posix_env *env, struct dc_error *err, struct command *command);
+
+/**
+ * The second half of parse_command: expand the words kept by lex_command and fill in the command.
+ * The here-documents stay where they were among the redirections, with the bodies read since.
+ * Nothing is done if the command was already filled in.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param state the current state, the parameters are looked up in state->vars (or the environment if it is NULL).
+ * @param command the command to expand.
+ * @return NULL, or the operator if a >& or <& is followed by a word that expands to something other than a descriptor.
+ */
+const char *expand_command(const struct dc_posix_env *env, struct dc_error *err, struct state *state,
+                           struct command *command);
+
+/**
+ * Separate a line into commands at each unquoted |, &, ;, && and ||.
+ * Each command gets a copy of its part of the line (trimmed) and the connector to the next command.
+ * The commands and everything parse_command later adds to them are allocated from the arena.
+ * An & that is part of a redirection (eg. 2>&1) does not separate commands.
+ * A line may end with ; or & but not with |, && or ||.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena where to allocate the commands, or NULL to use malloc.
+ * @param line the line to separate.
+ * @param count set to the number of commands.
+ * @param syntax_error set to the unexpected token if a command is empty, otherwise NULL.
+ * @return the commands (must be freed with destroy_command and arena_free) or NULL on a syntax error.
+ */
+struct command *separate_line(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                              const char *line, size_t *count, const char **syntax_error);
+
+/**
+ * Add a redirection to the end of the command's redirections.
+ * The file is copied into the command's arena (or malloced if it has none).
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param command the command.
+ * @param type what the redirection does.
+ * @param fd the descriptor being redirected.
+ * @param source_fd the descriptor to copy for REDIRECTION_DUP, otherwise ignored.
+ * @param file the file for the types that open one, otherwise NULL.
+ */
+void append_redirection(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                        enum redirection_type type, int fd, int source_fd, const char *file);
+
+/**
+ * Read the bodies of the command's here-documents from the lines that follow the command line.
+ * A body runs up to a line that is only the delimiter (after the leading tabs are removed for <<-)
+ * or to the end of the input. Unless the delimiter was quoted the body is expanded by expand_text,
+ * when it is read or, for a command kept by lex_command, by expand_command.
+ * The body becomes the redirection's file and the delimiter is cleared.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param vars the variables the body is expanded with, or NULL for the environment.
+ * @param command the command.
+ * @param input where to read the lines from.
+ * @param editor the editor the command line was read with, to read the lines with instead of input (after
+ *               a "> " prompt), or NULL.
+ * @param prompt where to print the "> " prompt before each line read from input, or NULL for no prompt.
+ * @return false if the input ended before a delimiter (the lines that were read are still used).
+ */
+bool read_heredocs(const struct dc_posix_env *env, struct dc_error *err, const struct vars *vars,
+                   struct command *command, struct input *input, struct editor *editor, FILE *prompt);
+
+/**
+ * Free the strings and argv of a command and clear it.
+ * Nothing is freed for a command allocated from an arena, the memory is reclaimed when the arena is reset.
+ *
+ * @param env the posix environment.
+ * @param command the command.
  */
 void destroy_command(const struct dc_posix_env *env, struct command *command);
 
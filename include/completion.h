@@ -0,0 +1,136 @@
+#ifndef DC_SHELL_COMPLETION_H
+#define DC_SHELL_COMPLETION_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <time.h>
+#include <dc_posix/dc_posix_env.h>
+
+/*! \struct completion_dir
+    \brief The sorted names in a directory, read again only once the directory has changed.
+*/
+struct completion_dir
+{
+    char *path;              /**< the directory, NULL for an unused slot */
+    bool executables;        /**< only executable files are kept (a PATH directory), otherwise every name is */
+    int watch;               /**< the inotify watch on the directory, -1 for none */
+    bool stale;              /**< the directory changed (or was never read), the names are read again before use */
+    dev_t dev;               /**< the device of the directory when it was read */
+    ino_t ino;               /**< the inode of the directory when it was read */
+    struct timespec mtime;   /**< the modification time when it was read, for when there is no inotify */
+    char *changed;           /**< the names inotify reported a change to since, each null terminated, in one block */
+    size_t changed_size;     /**< the bytes used in changed */
+    size_t changed_capacity; /**< the size of changed */
+    char *names;             /**< the names, each null terminated (a directory's with a / after it), in one block */
+    size_t names_size;       /**< the bytes used in names */
+    size_t names_capacity;   /**< the size of names */
+    const char **sorted;     /**< the names, sorted */
+    size_t count;            /**< the number of names */
+    size_t sorted_capacity;  /**< the size of sorted */
+    size_t cursor;           /**< the next name to merge into the commands */
+};
+
+/*! \struct completion
+    \brief The commands (the builtins and the executables in the PATH directories) and file names Tab completes.
+
+    Every PATH directory is read once into a sorted list of names and watched with inotify. Completing
+    drains the pending inotify events without waiting and looks up again only the names they report
+    (a stat each, inserted into or removed from the sorted list), then merges the sorted lists again, so a
+    completion with nothing changed is two binary searches in the merged list of commands. A directory is
+    only read again when it was removed or replaced, or events were lost. Completing a file name uses the
+    same kind of list for the directory it is in, kept for the last directory a file name was completed in.
+    Without inotify (not Linux) a directory is read again when its modification time changed.
+*/
+struct completion
+{
+    int inotify;                 /**< the inotify instance, -1 if there is none */
+    struct completion_dir *dirs; /**< the PATH directories */
+    size_t dir_count;            /**< the number of PATH directories */
+    struct completion_dir files; /**< the directory file names were last completed in */
+    const char **builtins;       /**< the builtins' names, sorted */
+    size_t builtin_count;        /**< the number of builtins */
+    bool commands_stale;         /**< a PATH directory changed since commands was merged */
+    const char **commands;       /**< every command name once, sorted */
+    size_t command_count;        /**< the number of commands */
+    size_t command_capacity;     /**< the size of commands */
+    const char **found;          /**< the file names a completion found, without the hidden ones */
+    size_t found_capacity;       /**< the size of found */
+};
+
+/**
+ * Create the completion lists for some PATH directories (nothing is read until the first completion).
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param path the PATH directories, NULL terminated, they are copied.
+ * @return the completion lists.
+ */
+struct completion *completion_create(const struct dc_posix_env *env, struct dc_error *err, char **path);
+
+/**
+ * Free the completion lists, close the inotify instance and set the pointer to NULL.
+ *
+ * @param env the posix environment.
+ * @param pcompletion the completion lists to destroy.
+ */
+void completion_destroy(const struct dc_posix_env *env, struct completion **pcompletion);
+
+/**
+ * Use a new set of PATH directories (eg. PATH was changed).
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param completion the completion lists.
+ * @param path the PATH directories, NULL terminated, they are copied.
+ */
+void completion_set_path(const struct dc_posix_env *env, struct dc_error *err, struct completion *completion,
+                         char **path);
+
+/**
+ * Find the commands that start with a prefix.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param completion the completion lists.
+ * @param prefix the start of the command.
+ * @param length the length of the prefix.
+ * @param matches set to the first command found, the rest follow it in order (valid until the next completion).
+ * @return the number of commands found.
+ */
+size_t completion_commands(const struct dc_posix_env *env, struct dc_error *err, struct completion *completion,
+                           const char *prefix, size_t length, const char *const **matches);
+
+/**
+ * Find the names in a directory that start with a prefix. Hidden names are only found for a prefix starting with a dot.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param completion the completion lists.
+ * @param directory the directory, relative to the working directory if it does not start with /.
+ * @param prefix the start of the name.
+ * @param length the length of the prefix.
+ * @param matches set to the first name found, the rest follow it in order (valid until the next completion).
+ * @return the number of names found.
+ */
+size_t completion_files(const struct dc_posix_env *env, struct dc_error *err, struct completion *completion,
+                        const char *directory, const char *prefix, size_t length, const char *const **matches);
+
+#endif // DC_SHELL_COMPLETION_H
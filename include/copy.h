@@ -0,0 +1,56 @@
+#ifndef DC_SHELL_COPY_H
+#define DC_SHELL_COPY_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <dc_posix/dc_posix_env.h>
+#include <signal.h>
+#include <sys/types.h>
+
+/*! \enum copy_method
+    \brief The ways to move data between two descriptors, fastest first.
+*/
+enum copy_method
+{
+    COPY_FILE_RANGE = 0, /**< copy_file_range: file to file in the kernel, may share extents */
+    COPY_SENDFILE,       /**< sendfile: file to anything in the kernel */
+    COPY_SPLICE,         /**< splice: to or from a pipe in the kernel */
+    COPY_READ_WRITE,     /**< read and write through a buffer in the shell */
+};
+
+/**
+ * Copy everything left in in_fd to out_fd, starting at the current offsets.
+ * The methods are tried in order from first, falling back to the next one when the kernel
+ * does not support it for these descriptors (eg. O_APPEND or a different file system),
+ * and ending with a read/write loop. The offsets are advanced as the data is copied.
+ * The copy stops early, without an error, once *interrupted is set (eg. by ^C, see jobs_control);
+ * it is checked between chunks and a read or write it cuts short is not an error.
+ *
+ * @param env the posix environment.
+ * @param err the error object, set if a read or write fails.
+ * @param in_fd the descriptor to copy from.
+ * @param out_fd the descriptor to copy to.
+ * @param first the first method to try.
+ * @param used set to the last method used, can be NULL.
+ * @param interrupted stop copying when it is set, can be NULL.
+ * @return the number of bytes copied.
+ */
+off_t copy_fd(const struct dc_posix_env *env, struct dc_error *err, int in_fd, int out_fd, enum copy_method first,
+              enum copy_method *used, const volatile sig_atomic_t *interrupted);
+
+#endif // DC_SHELL_COPY_H
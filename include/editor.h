@@ -0,0 +1,122 @@
+#ifndef DC_SHELL_EDITOR_H
+#define DC_SHELL_EDITOR_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <termios.h>
+#include <dc_posix/dc_posix_env.h>
+
+struct completion;
+struct history;
+struct history_index;
+
+// the most matches Ctrl-R goes through for one query
+#define EDITOR_SEARCH_RESULTS 64
+
+// the longest Ctrl-R query, with its null byte
+#define EDITOR_QUERY_SIZE 128
+
+// the most choices Tab lists
+#define EDITOR_LIST_MAX 100
+
+/*! \struct editor
+    \brief Reads a line from a terminal in raw mode so it can be edited, and the history browsed, as it is typed.
+
+    Keys (emacs style, as in bash):
+    - Left/Right, Ctrl-B/Ctrl-F: move a character
+    - Home/End, Ctrl-A/Ctrl-E: move to the start or end of the line
+    - Up/Down, Ctrl-P/Ctrl-N: the previous or next history entry
+    - Backspace, Delete: delete before or under the cursor
+    - Ctrl-U/Ctrl-K: delete to the start or end of the line, Ctrl-W: delete the word before the cursor
+    - Ctrl-L: clear the screen, Ctrl-C: give up the line, Ctrl-D: end the input on an empty line
+    - Ctrl-R: search the history as the query is typed, Ctrl-R again for the next match, Ctrl-G to give up the search
+      (any other key takes the match and is then used as usual)
+    - Tab: complete the command or file name before the cursor, listing the choices when it cannot go further
+    The terminal is only in raw mode while a line is read, programs run with its normal settings.
+*/
+struct editor
+{
+    int in;                  /**< the terminal to read keys from */
+    int out;                 /**< the terminal to draw the line on */
+    struct termios cooked;   /**< the terminal settings to put back after a line */
+    struct history *history; /**< the entries Up and Down go through, NULL for none (not owned) */
+    struct history_index *index; /**< the index Ctrl-R searches, NULL for none (not owned) */
+    struct completion *completion; /**< the commands and file names Tab completes, NULL for none (not owned) */
+    char *line;              /**< the line being edited, null terminated */
+    size_t capacity;         /**< the size of line */
+    size_t length;           /**< the length of the line */
+    size_t cursor;           /**< where in the line the cursor is */
+    char *saved;             /**< the line that was being typed before Up or Ctrl-R, put back by Down past the newest entry or Ctrl-G */
+    size_t saved_capacity;   /**< the size of saved */
+    uint64_t end;            /**< history_end when the line was started, Down past the newest entry goes back to saved */
+    uint64_t browsing;       /**< the history entry shown, or end when the line is the one being typed */
+    const char *prompt;      /**< the prompt the line is drawn after */
+    char *screen;            /**< the bytes of the next redraw, written at once so the line does not flicker */
+    size_t screen_capacity;  /**< the size of screen */
+    bool searching;          /**< Ctrl-R was pressed and the keys go to the query */
+    char query[EDITOR_QUERY_SIZE]; /**< what is being searched for, null terminated */
+    size_t query_length;     /**< the length of the query */
+    uint64_t results[EDITOR_SEARCH_RESULTS]; /**< the entries that match the query, best first */
+    size_t result_count;     /**< the number of results */
+    size_t result;           /**< the result shown */
+    char search_prompt[EDITOR_QUERY_SIZE + 32]; /**< the prompt drawn while searching */
+    char pending[64];        /**< keys that were read but not used yet (eg. pasted text) */
+    size_t pending_start;    /**< the next key in pending */
+    size_t pending_end;      /**< the end of the keys in pending */
+};
+
+/**
+ * Create an editor for a terminal.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param in the descriptor to read from.
+ * @param out the descriptor to draw on.
+ * @param history the history for Up and Down, or NULL.
+ * @param index the index of the history for Ctrl-R, or NULL.
+ * @param completion the commands and file names for Tab, or NULL.
+ * @return the editor, or NULL if in is not a terminal (err is not set for that).
+ */
+struct editor *editor_create(const struct dc_posix_env *env, struct dc_error *err, int in, int out,
+                             struct history *history, struct history_index *index, struct completion *completion);
+
+/**
+ * Free the editor and set the pointer to NULL.
+ *
+ * @param env the posix environment.
+ * @param peditor the editor to destroy.
+ */
+void editor_destroy(const struct dc_posix_env *env, struct editor **peditor);
+
+/**
+ * Read a line, letting it be edited until Enter is pressed.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param editor the editor.
+ * @param prompt the prompt to draw before the line.
+ * @param length set to the length of the line.
+ * @return the line (valid until the next call), "" if it was given up with Ctrl-C, or NULL at the end of the input.
+ */
+char *editor_read_line(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor,
+                       const char *prompt, size_t *length);
+
+#endif // DC_SHELL_EDITOR_H
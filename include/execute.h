@@ -19,19 +19,106 @@
  */
 
 #include "command.h"
+#include "path_cache.h"
 #include <dc_posix/dc_posix_env.h>
 #include <stdio.h>
 
 /**
- * Create a child process, exec the command with any redirection, set the exit code.
+ * Create a child process with posix_spawn, exec the command with any redirection, set the exit code.
+ * The redirection files are opened by the shell and passed to the child as spawn file actions,
+ * so the shell's memory is never copied the way it is with fork.
+ * A file named by more than one redirection of the same kind is only opened once (eg. > log 2> log).
  * If there is an err executing the command print an err message.
  * If the command cannot be found set the command->exit_code to 127.
+ * The program gets command->envp as its environment, or the shell's environ if it is NULL.
+ * The resources used by the child are stored in command->rusage.
  *
  * @param env the posix environment.
  * @param err the err object
  * @param command the command to execute
- * @param path the directories to search for the command
+ * @param path_cache the cache of programs found in the PATH directories
  */
-void execute(const struct dc_posix_env *env, struct dc_error *err, struct command *command, char **path);
+void execute(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+             struct path_cache *path_cache);
+
+/**
+ * Execute the commands of a pipeline (a | b | c), each reading the output of the one before it.
+ * Every command is started before waiting for any of them, then they are all reaped.
+ * The exit code and resource usage of each command is set.
+ *
+ * @param env the posix environment.
+ * @param err the err object
+ * @param commands the commands in the pipeline
+ * @param count the number of commands
+ * @param path_cache the cache of programs found in the PATH directories
+ * @param pipefail return the exit code of the last command that failed instead of the last command
+ * @return the exit code of the pipeline.
+ */
+int execute_pipeline(const struct dc_posix_env *env, struct dc_error *err, struct command *commands, size_t count,
+                     struct path_cache *path_cache, bool pipefail);
+
+/**
+ * Wait for the commands of a pipeline started by launch_pipeline, setting the exit code and resource usage of each.
+ * With stop a command that stops (eg. ^Z) is not waited for any longer, it keeps its pid and gets
+ * 128 + the stop signal as its exit code; the pid of every other command is set to -1.
+ *
+ * @param commands the commands in the pipeline
+ * @param count the number of commands
+ * @param pids the process of each command (-1 if it was not started)
+ * @param pipefail return the exit code of the last command that failed instead of the last command
+ * @param stop stop waiting for a command when it stops
+ * @return the exit code of the pipeline.
+ */
+int wait_pipeline(struct command *commands, size_t count, pid_t *pids, bool pipefail, bool stop);
+
+/*! \struct saved_fds
+    \brief The shell's own descriptors that the redirections of a builtin replaced.
+*/
+struct saved_fds
+{
+    int *fds;     /**< the descriptors that were redirected */
+    int *copies;  /**< a close on exec copy of each one, -1 if it was not open */
+    size_t count; /**< the number of descriptors saved */
+};
+
+/**
+ * Apply the I/O redirections of a builtin to the shell's own descriptors, in order.
+ * The shell's descriptors are saved so that restore_shell can put them back; streams
+ * writing to them must be flushed before and after the builtin runs.
+ * If a file cannot be opened (or a descriptor to copy is not open) the command->exit_code
+ * is set and nothing is redirected.
+ *
+ * @param env the posix environment.
+ * @param err the err object
+ * @param command the builtin command
+ * @param saved set to the saved descriptors, or NULL to keep the redirections (exec)
+ * @return true if the builtin should run.
+ */
+bool redirect_shell(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                    struct saved_fds *saved);
+
+/**
+ * Undo redirect_shell.
+ *
+ * @param saved the saved descriptors from redirect_shell, emptied once they are restored.
+ */
+void restore_shell(struct saved_fds *saved);
+
+/**
+ * Start the commands of a pipeline without waiting for them.
+ * The exit code of each command that cannot be started is set.
+ *
+ * @param env the posix environment.
+ * @param err the err object
+ * @param commands the commands in the pipeline
+ * @param count the number of commands
+ * @param path_cache the cache of programs found in the PATH directories
+ * @param pgid the process group to join, 0 for a new group or -1 to stay in the shell's group.
+ *             A job gets its own group so that it can be stopped and continued as a whole, and so that
+ *             signals from the terminal (eg. ^C) only reach the one in the foreground.
+ * @param pids set to the process of each command (-1 if it was not started)
+ */
+void launch_pipeline(const struct dc_posix_env *env, struct dc_error *err, struct command *commands, size_t count,
+                     struct path_cache *path_cache, pid_t pgid, pid_t *pids);
 
 #endif // DC_SHELL_EXECUTE_H
@@ -0,0 +1,90 @@
+#ifndef DC_SHELL_EXPAND_H
+#define DC_SHELL_EXPAND_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "arena.h"
+#include <dc_posix/dc_posix_env.h>
+
+struct vars;
+
+/*! \struct expansion
+    \brief The words that a word expands to.
+*/
+struct expansion
+{
+    char **words;    /**< the words, allocated from the arena */
+    size_t count;    /**< the number of words */
+    size_t capacity; /**< the number of slots in words (it doubles as it fills) */
+};
+
+/**
+ * Expand a word the way the shell does, without running anything:
+ * a leading ~ or ~user, $NAME, ${NAME}, ${NAME-word}, ${NAME:-word}, ${#NAME} and $$,
+ * then splitting the unquoted results of the parameters at the IFS characters,
+ * then pathname expansion of the unquoted *, ? and [...] and finally removing the quotes.
+ * Command substitution ($(...) and `...`) is kept as text, it is never run.
+ *
+ * A glob that matches is replaced by the sorted paths, read with opendir/readdir one directory
+ * at a time; a glob that matches nothing is kept as it is. The words are appended to the expansion,
+ * so a glob that matches a huge directory costs one copy of each name and log2(n) reallocations.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena where to allocate the words and the array, or NULL to use malloc.
+ * @param vars the variables the parameters are looked up in (see vars_get), or NULL for the environment.
+ * @param word the word as it was typed, with the quotes.
+ * @param length the number of characters in word.
+ * @param expansion the words are added to the end (start with all fields 0).
+ */
+void expand_word(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, const struct vars *vars,
+                 const char *word, size_t length, struct expansion *expansion);
+
+/**
+ * Expand the value of an assignment (the part after the = of NAME=value) the way the shell does:
+ * the same as expand_word but the parameters are not split and there is no pathname expansion,
+ * so the value is always one word.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena where to allocate the value, or NULL to use malloc.
+ * @param vars the variables the parameters are looked up in, or NULL for the environment.
+ * @param value the value as it was typed, with the quotes.
+ * @param length the number of characters in value.
+ * @return the expanded value.
+ */
+char *expand_assignment(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                        const struct vars *vars, const char *value, size_t length);
+
+/**
+ * Expand the parameters in a block of text the way the shell does inside double quotes,
+ * but with the quotes kept as text: $NAME, ${...} and $$ are replaced by their values
+ * without splitting or globbing, and \ only quotes $, ` and \. Used for the body of a here-document.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena where to allocate the text, or NULL to use malloc.
+ * @param vars the variables the parameters are looked up in, or NULL for the environment.
+ * @param text the text.
+ * @param length the number of characters in text.
+ * @return the expanded text.
+ */
+char *expand_text(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, const struct vars *vars,
+                  const char *text, size_t length);
+
+#endif // DC_SHELL_EXPAND_H
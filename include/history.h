@@ -0,0 +1,132 @@
+#ifndef DC_SHELL_HISTORY_H
+#define DC_SHELL_HISTORY_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <dc_posix/dc_posix_env.h>
+
+// the size of the ring in a new history file, about 10000 typical commands
+#define HISTORY_DEFAULT_CAPACITY (1024 * 1024)
+
+/*! \struct history_header
+    \brief The start of a history file, followed by the ring of entries.
+
+    Entries are written one after another around the ring, each as its position, its length,
+    the text (padded to 8 bytes) and its total size, so the entry before one is found from the size before it.
+    A position counts every byte ever written, the ring offset is the position modulo the capacity.
+*/
+struct history_header
+{
+    uint64_t magic;     /**< HISTORY_MAGIC */
+    uint64_t capacity;  /**< the size of the ring in bytes, a multiple of 8 */
+    uint64_t head;      /**< the position after the newest entry, moved atomically by every session that adds one */
+};
+
+/*! \struct history
+    \brief The command history, in a file shared by every session and mapped into memory.
+
+    Opening the file maps it and nothing is read, however many entries it has.
+    Adding an entry reserves its bytes by moving the head with an atomic add, writes them and then
+    writes the entry's position last, so several sessions can add entries at once without a lock.
+    A reader only trusts an entry whose position is written and whose bytes have not been reused
+    by the time it has finished copying them.
+*/
+struct history
+{
+    int fd;                         /**< the history file */
+    struct history_header *header;  /**< the mapped file */
+    unsigned char *ring;            /**< the entries, after the header */
+    size_t capacity;                /**< the size of the ring */
+    size_t map_size;                /**< the size of the mapping */
+};
+
+/**
+ * Open (or create) a history file and map it.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param path the history file.
+ * @param capacity the size of the ring if the file is created, rounded up to a multiple of 8.
+ * @return the history, or NULL if the file is not a history file (err is not set for that).
+ */
+struct history *history_open(const struct dc_posix_env *env, struct dc_error *err, const char *path,
+                             size_t capacity);
+
+/**
+ * Unmap and close the history file and set the pointer to NULL.
+ *
+ * @param env the posix environment.
+ * @param phistory the history to close.
+ */
+void history_close(const struct dc_posix_env *env, struct history **phistory);
+
+/**
+ * Add an entry after the newest one, overwriting the oldest entries when the ring is full.
+ * A line longer than a quarter of the ring is not added.
+ *
+ * @param history the history.
+ * @param line the text.
+ * @param length the length of the text.
+ * @return the position of the entry, or UINT64_MAX if it was not added.
+ */
+uint64_t history_add(struct history *history, const char *line, size_t length);
+
+/**
+ * Get the position after the newest entry, where history_previous starts.
+ *
+ * @param history the history.
+ * @return the position.
+ */
+uint64_t history_end(const struct history *history);
+
+/**
+ * Find the entry before a position.
+ *
+ * @param history the history.
+ * @param position an entry's position, or history_end.
+ * @param previous set to the position of the entry before it.
+ * @return false if there is no such entry (it was overwritten, or is still being written by another session).
+ */
+bool history_previous(const struct history *history, uint64_t position, uint64_t *previous);
+
+/**
+ * Find the entry after a position.
+ *
+ * @param history the history.
+ * @param position an entry's position.
+ * @param next set to the position of the entry after it, or history_end if it is the newest.
+ * @return false if the entry at position is not valid.
+ */
+bool history_next(const struct history *history, uint64_t position, uint64_t *next);
+
+/**
+ * Copy the text of an entry.
+ *
+ * @param history the history.
+ * @param position the entry's position.
+ * @param line where to copy the text, it is null terminated.
+ * @param size the size of line.
+ * @param length set to the length of the text, which is more than was copied if it is size or more.
+ * @return false if the entry is not valid.
+ */
+bool history_read(const struct history *history, uint64_t position, char *line, size_t size, size_t *length);
+
+#endif // DC_SHELL_HISTORY_H
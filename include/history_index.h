@@ -0,0 +1,150 @@
+#ifndef DC_SHELL_HISTORY_INDEX_H
+#define DC_SHELL_HISTORY_INDEX_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <dc_posix/dc_posix_env.h>
+
+struct history;
+
+/*! \struct history_postings
+    \brief The entries a trigram (three bytes in a row) appears in.
+*/
+struct history_postings
+{
+    uint32_t key;      /**< the three bytes, plus 1 << 24 so an empty slot is 0 */
+    uint32_t count;    /**< the number of entries */
+    uint32_t capacity; /**< the size of seqs */
+    uint32_t *seqs;    /**< the entries' sequence numbers, oldest first */
+};
+
+/*! \struct history_match
+    \brief A different command found by a search, with every time it was entered adding to its score.
+*/
+struct history_match
+{
+    uint64_t hash;     /**< the hash of the command, 0 for an empty slot */
+    uint64_t position; /**< the newest entry of the command */
+    double score;      /**< the sum over its entries of a weight that is smaller the older the entry is */
+};
+
+/*! \struct history_index
+    \brief A trigram index of the history, for searching it as the query is typed.
+
+    Every entry gets a sequence number in the order it was indexed, and each trigram of its text
+    has the entry's number added to its postings. A search only looks at the entries in the
+    postings of the query's rarest trigram (each one is checked, a trigram can match where the query does not).
+    The index is saved next to the history file and loaded from there, then only the entries added since
+    (by this session or any other) are indexed.
+*/
+struct history_index
+{
+    char *path;                       /**< the file the index is saved to, NULL to not save it */
+    uint64_t *entries;                /**< the position of each entry, by sequence number from base_seq */
+    size_t entry_count;               /**< the number of entries */
+    size_t entry_capacity;            /**< the size of entries */
+    size_t live;                      /**< the first entry that has not been overwritten in the history */
+    uint32_t base_seq;                /**< the sequence number of entries[0] */
+    uint64_t indexed_end;             /**< the history position up to which entries are indexed */
+    uint64_t stalled;                 /**< an entry an update waited for another session to finish writing */
+    struct history_postings *slots;   /**< the trigrams, in an open addressing hash table */
+    size_t capacity;                  /**< the number of slots, always a power of 2 */
+    size_t count;                     /**< the number of trigrams */
+    char *text;                       /**< an entry being checked by a search */
+    size_t text_capacity;             /**< the size of text */
+    struct history_match *matches;    /**< the commands found by a search, in a hash table */
+    size_t match_capacity;            /**< the number of slots in matches */
+    uint64_t *pending;                /**< the positions of the entries found by history_index_update */
+    size_t pending_capacity;          /**< the size of pending */
+};
+
+/**
+ * Create an index, loading it from a file if there is a valid one.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param path the file the index is kept in, or NULL to keep it only in memory.
+ * @return the index.
+ */
+struct history_index *history_index_open(const struct dc_posix_env *env, struct dc_error *err, const char *path);
+
+/**
+ * Free the index (without saving it) and set the pointer to NULL.
+ *
+ * @param env the posix environment.
+ * @param pindex the index to close.
+ */
+void history_index_close(const struct dc_posix_env *env, struct history_index **pindex);
+
+/**
+ * Write the index to its file, replacing the file at once so another session never loads half of one.
+ * Entries that were overwritten in the history are left out.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param index the index.
+ */
+void history_index_save(const struct dc_posix_env *env, struct dc_error *err, struct history_index *index);
+
+/**
+ * Index an entry. Entries must be added in the order they are in the history.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param index the index.
+ * @param position the entry's position in the history.
+ * @param line the entry's text.
+ * @param length the length of the text.
+ */
+void history_index_add(const struct dc_posix_env *env, struct dc_error *err, struct history_index *index,
+                       uint64_t position, const char *line, size_t length);
+
+/**
+ * Index the entries added to the history since the last update (by any session),
+ * and forget the ones that have been overwritten.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param index the index.
+ * @param history the history.
+ */
+void history_index_update(const struct dc_posix_env *env, struct dc_error *err, struct history_index *index,
+                          const struct history *history);
+
+/**
+ * Find the commands that contain a query, best first: a command scores more the more times
+ * it was entered and the more recently.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param index the index.
+ * @param history the history.
+ * @param query the text to look for.
+ * @param length the length of the query.
+ * @param results set to the newest entry of each command found.
+ * @param max the most results.
+ * @return the number of results.
+ */
+size_t history_index_search(const struct dc_posix_env *env, struct dc_error *err, struct history_index *index,
+                            const struct history *history, const char *query, size_t length, uint64_t *results,
+                            size_t max);
+
+#endif // DC_SHELL_HISTORY_INDEX_H
@@ -20,17 +20,92 @@
 
 #include <dc_posix/dc_posix_env.h>
 #include <dc_posix/dc_stdlib.h>
+#include <stdbool.h>
 #include <stdio.h>
 
+/*! \struct input
+    \brief The lines of a stream, read in large blocks into one buffer and handed out in place.
+
+    A file or terminal is read with read(2) on its descriptor, so the bytes are not copied through
+    the stream's own buffer first; a stream without a descriptor (eg. fmemopen) is read with fread.
+    Each line is terminated in place and is only valid until the next line is read.
+*/
+struct input
+{
+    FILE *stream;     /**< the stream the lines come from, NULL for no input */
+    int fd;           /**< the stream's descriptor, -1 to read through the stream */
+    char *buffer;     /**< the bytes read, grown when a line does not fit */
+    size_t capacity;  /**< the size of buffer */
+    size_t start;     /**< the first byte that has not been returned */
+    size_t end;       /**< the end of the bytes read */
+    bool eof;         /**< the stream has ended (there may still be lines in the buffer) */
+    size_t reads;     /**< the number of reads from the stream */
+};
+
+/**
+ * Create the reader for a stream. Nothing is read until the first line is asked for.
+ * The stream must not be read any other way while the reader is used.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param stream the stream to read from (eg. stdin), or NULL for no input.
+ * @return the reader.
+ */
+struct input *input_create(const struct dc_posix_env *env, struct dc_error *err, FILE *stream);
+
+/**
+ * Free the reader (not the stream) and set the pointer to NULL.
+ *
+ * @param env the posix environment.
+ * @param pinput the reader to destroy.
+ */
+void input_destroy(const struct dc_posix_env *env, struct input **pinput);
+
+/**
+ * Read the next line, without the newline. The newline is replaced by a null byte in the buffer.
+ * The last line of the stream does not need to end with a newline.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param input the reader.
+ * @param length set to the length of the line.
+ * @return the line, inside the buffer, or NULL at the end of the stream (or on an error).
+ */
+char *input_read_line(const struct dc_posix_env *env, struct dc_error *err, struct input *input, size_t *length);
+
+/**
+ * Give back the bytes that were read ahead of the current line, so that a program that reads
+ * the same descriptor starts at the next line (as fflush does for a stream).
+ * It only works for a descriptor that can seek (eg. a file), a pipe or terminal keeps its bytes in the buffer.
+ *
+ * @param input the reader.
+ */
+void input_release(struct input *input);
+
+/**
+ * Trim the whitespace from both ends of a line, in place.
+ * A '\0' inside the line ends it, the way it would end a string.
+ *
+ * @param line the line.
+ * @param length the length of the line.
+ * @param trimmed_length set to the length of the trimmed line.
+ * @return the start of the trimmed line, inside line.
+ */
+char *input_trim(char *line, size_t length, size_t *trimmed_length);
+
 /**
  * Read the command line from the user.
+ * The line is trimmed in place inside the reader's buffer, nothing is copied or allocated
+ * once the buffer is big enough. A '\0' inside the line ends it, the way it would end a string.
+ * The line is only valid until the next call (or the next input_read_line).
  *
  * @param env the posix environment.
  * @param err the error object
- * @param stream The stream to read from (eg. stdin)
- * @param line_size the maximum characters to read.
- * @return The command line that the user entered.
+ * @param input the reader for the stream (eg. stdin).
+ * @param line_size set to the length of the line.
+ * @return The command line that the user entered, inside the buffer ("" at the end of the stream, see input->eof).
  */
-char *read_command_line(const struct dc_posix_env *env, struct dc_error *err, FILE *stream, size_t *line_size);
+char *read_command_line(const struct dc_posix_env *env, struct dc_error *err, struct input *input,
+                        size_t *line_size);
 
 #endif // DC_SHELL_INPUT_H
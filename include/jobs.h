@@ -0,0 +1,227 @@
+#ifndef DC_SHELL_JOBS_H
+#define DC_SHELL_JOBS_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <dc_posix/dc_posix_env.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+/*! \enum job_status
+    \brief The state of a background job.
+*/
+enum job_status
+{
+  JOB_RUNNING, /**< at least one process is running */
+  JOB_STOPPED, /**< a process was stopped (eg. SIGSTOP or SIGTSTP) */
+  JOB_DONE,    /**< every process has exited */
+};
+
+/*! \struct job
+    \brief A pipeline running in the background.
+*/
+struct job
+{
+  int id;                 /**< the job number shown as [id] */
+  char *line;             /**< the command line that started the job */
+  pid_t pgid;             /**< the process group of the job */
+  pid_t *pids;            /**< the process of each command (-1 once reaped or if it could not be started) */
+  int *exit_codes;        /**< the exit code of each command */
+  size_t pid_count;       /**< the number of commands */
+  size_t live;            /**< the number of processes not yet reaped */
+  bool pipefail;          /**< the exit code is the last failure rather than the last command */
+  enum job_status status; /**< running, stopped or done */
+};
+
+/**
+ * The number of job control signals (SIGINT, SIGQUIT, SIGTSTP, SIGTTIN and SIGTTOU) that a shell
+ * with job control handles itself.
+ */
+#define JOBS_SIGNAL_COUNT 5
+
+/*! \struct jobs
+    \brief The job table.
+
+    Children are reaped with WNOHANG when a SIGCHLD has arrived, so a background job
+    never blocks the shell. Foreground commands are waited for by pid so they are never
+    reaped here.
+
+    With job control (see jobs_control) every pipeline runs in its own process group and the
+    terminal is given to the one in the foreground, so ^C and ^Z only reach that pipeline.
+*/
+struct jobs
+{
+  struct job *job;                                 /**< the jobs, in the order they were started */
+  size_t count;                                    /**< the number of jobs */
+  struct sigaction old_sigchld;                    /**< the SIGCHLD action to restore */
+  int terminal;                                    /**< the terminal of the shell, -1 without job control */
+  pid_t pgid;                                      /**< the process group of the shell */
+  volatile sig_atomic_t *interrupted;              /**< set to the signal when ^C or ^\ reaches the shell */
+  struct sigaction old_signals[JOBS_SIGNAL_COUNT]; /**< the job control signal actions to restore */
+};
+
+/**
+ * Create the job table and start listening for SIGCHLD.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @return the job table.
+ */
+struct jobs *jobs_create(const struct dc_posix_env *env, struct dc_error *err);
+
+/**
+ * Free the job table, restore the SIGCHLD action (and the job control ones) and set the pointer to NULL.
+ * Jobs that are still running are left running.
+ *
+ * @param env the posix environment.
+ * @param pjobs the job table to destroy.
+ */
+void jobs_destroy(const struct dc_posix_env *env, struct jobs **pjobs);
+
+/**
+ * Turn on job control for an interactive shell.
+ * A shell started in the background waits until it is in the foreground, then SIGTSTP, SIGTTIN and
+ * SIGTTOU are ignored, the shell is put in its own process group and that group is given the terminal.
+ * SIGINT and SIGQUIT only set jobs->interrupted to the signal, without SA_RESTART, so that anything the shell
+ * is blocked in (eg. wait) can be interrupted.
+ * Nothing is done if the descriptor is not the controlling terminal.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param jobs the job table.
+ * @param terminal the terminal descriptor (eg. STDIN_FILENO).
+ */
+void jobs_control(const struct dc_posix_env *env, struct dc_error *err, struct jobs *jobs, int terminal);
+
+/**
+ * Turn off job control, restoring the job control signal actions (eg. before exec replaces the shell).
+ *
+ * @param jobs the job table.
+ */
+void jobs_release(struct jobs *jobs);
+
+/**
+ * Give the terminal to a process group, or back to the shell with jobs->pgid.
+ * Nothing is done without job control.
+ *
+ * @param jobs the job table.
+ * @param pgid the process group to put in the foreground.
+ */
+void jobs_foreground(struct jobs *jobs, pid_t pgid);
+
+/**
+ * Add a job for processes that were just started.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param jobs the job table.
+ * @param line the command line of the job.
+ * @param pids the process of each command (-1 if it could not be started).
+ * @param exit_codes the exit code of each command that could not be started.
+ * @param count the number of commands.
+ * @param pipefail the exit code is the last failure rather than the last command.
+ * @return the new job.
+ */
+struct job *jobs_add(const struct dc_posix_env *env, struct dc_error *err, struct jobs *jobs, const char *line,
+                     const pid_t *pids, const int *exit_codes, size_t count, bool pipefail);
+
+/**
+ * Reap any job processes that have changed state, without blocking.
+ * Nothing is done unless a SIGCHLD arrived since the last call.
+ *
+ * @param jobs the job table.
+ */
+void jobs_reap(struct jobs *jobs);
+
+/**
+ * Record the status of a process that was reaped outside of the job table (eg. by waitpid(-1)).
+ *
+ * @param jobs the job table.
+ * @param pid the process that was reaped.
+ * @param status the status from waitpid.
+ * @return true if the process belongs to a job.
+ */
+bool jobs_update(struct jobs *jobs, pid_t pid, int status);
+
+/**
+ * Reap, print a notice for every job that finished and remove it.
+ *
+ * @param env the posix environment.
+ * @param jobs the job table.
+ * @param stream the stream to print the notices on (NULL to remove the jobs without a notice).
+ */
+void jobs_notify(const struct dc_posix_env *env, struct jobs *jobs, FILE *stream);
+
+/**
+ * Find a job.
+ * - NULL, "%%", "%+" or "%" is the most recent job.
+ * - "%n" is job number n.
+ * - "n" is the job containing process n.
+ *
+ * @param env the posix environment.
+ * @param jobs the job table.
+ * @param spec the job to find.
+ * @return the job or NULL if there is no such job.
+ */
+struct job *jobs_find(const struct dc_posix_env *env, struct jobs *jobs, const char *spec);
+
+/**
+ * Wait for the job to finish or stop, or for jobs->interrupted to be set (the job is left as it is).
+ *
+ * @param jobs the job table.
+ * @param job the job to wait for.
+ * @return the exit code of the job, 128 + SIGTSTP if it stopped or 128 + the signal if it was interrupted.
+ */
+int jobs_wait(struct jobs *jobs, struct job *job);
+
+/**
+ * Continue a stopped job.
+ *
+ * @param jobs the job table.
+ * @param job the job to continue.
+ */
+void jobs_continue(struct jobs *jobs, struct job *job);
+
+/**
+ * Remove a job from the table.
+ *
+ * @param env the posix environment.
+ * @param jobs the job table.
+ * @param job the job to remove.
+ */
+void jobs_remove(const struct dc_posix_env *env, struct jobs *jobs, struct job *job);
+
+/**
+ * Display every job and its status.
+ *
+ * @param env the posix environment.
+ * @param jobs the job table.
+ * @param stream the stream to display the jobs on.
+ */
+void jobs_display(const struct dc_posix_env *env, struct jobs *jobs, FILE *stream);
+
+/**
+ * Get the exit code of a finished job.
+ *
+ * @param job the job.
+ * @return the exit code.
+ */
+int job_exit_code(const struct job *job);
+
+#endif // DC_SHELL_JOBS_H
@@ -0,0 +1,112 @@
+#ifndef DC_SHELL_LEXER_H
+#define DC_SHELL_LEXER_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*! \enum token_type
+    \brief The kinds of token in a command.
+*/
+enum token_type
+{
+    TOKEN_WORD,     /**< a word, with the quotes removed */
+    TOKEN_REDIRECT, /**< a redirection and the file name after it */
+    TOKEN_END,      /**< the end of the command */
+};
+
+/*! \enum redirect_type
+    \brief The redirection operators.
+*/
+enum redirect_type
+{
+    REDIRECT_IN,         /**< N< file, N defaults to 0 */
+    REDIRECT_OUT,        /**< N> file, N defaults to 1 */
+    REDIRECT_APPEND,     /**< N>> file, N defaults to 1 */
+    REDIRECT_IN_OUT,     /**< N<> file, N defaults to 0 */
+    REDIRECT_DUP_IN,     /**< N<&M (or N<&-), N defaults to 0 */
+    REDIRECT_DUP_OUT,    /**< N>&M (or N>&-), N defaults to 1 */
+    REDIRECT_OUT_ERR,    /**< &> file, both 1 and 2 */
+    REDIRECT_APPEND_ERR, /**< &>> file, both 1 and 2 */
+    REDIRECT_HEREDOC,    /**< N<< word, the lines up to word, N defaults to 0 */
+    REDIRECT_HEREDOC_TAB,/**< N<<- word, the same with the leading tabs removed */
+    REDIRECT_HERESTRING, /**< N<<< word, the word and a newline, N defaults to 0 */
+};
+
+/*! \struct token
+    \brief A word or redirection from the command.
+*/
+struct token
+{
+    enum token_type type;          /**< the kind of token */
+    const char *raw;               /**< the word (the file name of a redirection) as it was typed, with quotes */
+    size_t raw_length;             /**< the number of characters in raw */
+    char *text;                    /**< the word with the quotes removed, stored in the lexer buffer */
+    bool expand;                   /**< the word has an unquoted ~, $ or glob character (or a $ in double quotes) */
+    enum redirect_type redirect;   /**< the operator, for a TOKEN_REDIRECT */
+    int fd;                        /**< the descriptor being redirected, for a TOKEN_REDIRECT (1 for &> and &>>) */
+};
+
+/*! \struct lexer
+    \brief Splits a command into tokens in a single pass over the characters.
+
+    Quotes are handled as the shell does: nothing is special inside '...',
+    only \ and $ are special inside "..." and \ quotes the next character outside of quotes.
+    The text of every word is copied into a buffer supplied by the caller, one after the other,
+    so the tokens stay valid until the buffer is freed. Runs of ordinary characters are found
+    with scan_span and copied with memcpy, not looked at one at a time.
+*/
+struct lexer
+{
+    const char *pos;   /**< the next character to look at */
+    const char *end;   /**< the '\0' at the end of the command */
+    char *buffer;      /**< where the text of the words goes */
+    size_t used;       /**< the number of characters of the buffer used */
+    const char *error; /**< the unexpected token (eg. "newline" or ">") or the missing quote, NULL if there is no error */
+    bool redirects;    /**< the command has a < or > in it, without one no token can be a redirection */
+};
+
+/**
+ * Start splitting a command.
+ * The command is checked for < and > (with scan_span) once, so a command without them never looks for a redirection.
+ *
+ * @param lexer the lexer.
+ * @param line the command, it must stay valid while the tokens are used.
+ * @param buffer the buffer for the text of the words, at least strlen(line) + 1 characters.
+ */
+void lexer_init(struct lexer *lexer, const char *line, char *buffer);
+
+/**
+ * Get the next token.
+ *
+ * @param lexer the lexer.
+ * @param token set to the next token, TOKEN_END at the end of the command.
+ * @return false if there is a syntax error (see lexer->error).
+ */
+bool lexer_next(struct lexer *lexer, struct token *token);
+
+/**
+ * Get the operator of a redirection as it is typed, for messages.
+ *
+ * @param redirect the operator.
+ * @return the operator, eg. ">>" or "<&".
+ */
+const char *lexer_operator(enum redirect_type redirect);
+
+#endif // DC_SHELL_LEXER_H
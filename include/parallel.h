@@ -0,0 +1,101 @@
+#ifndef DC_SHELL_PARALLEL_H
+#define DC_SHELL_PARALLEL_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <dc_posix/dc_posix_env.h>
+#include <stdio.h>
+#include "command.h"
+#include "jobs.h"
+#include "path_cache.h"
+
+/*! \struct parallel_job
+    \brief One run of the command, with {} replaced by an argument.
+*/
+struct parallel_job
+{
+    struct command command; /**< the command to run, its exit_code and rusage are set once it is reaped */
+    pid_t pid;              /**< the process, -1 once it has been reaped or if it could not be started */
+    bool done;              /**< the process has been reaped (or never started) */
+    char *output;           /**< the file buffering the output with keep_order, NULL once it is copied */
+};
+
+/*! \struct parallel
+    \brief Runs a command once per argument with a bounded number of processes at a time.
+
+    At most slots processes are running. Any child is reaped with waitpid(-1) and the
+    next job is started as soon as one finishes. A child that belongs to a background
+    job is passed on to the job table (see jobs_update).
+    With job control the processes share a process group that has the terminal while the run lasts,
+    so ^C reaches them; a job killed by ^C stops any more jobs from starting.
+*/
+struct parallel
+{
+    struct parallel_job *job;      /**< a job for each argument, in argument order */
+    size_t count;                  /**< the number of jobs */
+    size_t slots;                  /**< the most processes to run at once */
+    bool keep_order;               /**< buffer each job's output and print it in argument order */
+    size_t running;                /**< the number of processes running */
+    size_t failed;                 /**< the number of jobs with a non zero exit code */
+    pid_t pgid;                    /**< the process group of the running jobs, 0 for a new one or -1 for the shell's */
+};
+
+/**
+ * Create the jobs for a command template and its arguments.
+ * Every {} in the template is replaced by the argument, if there are none the argument is added at the end.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param template the command and its arguments.
+ * @param template_count the number of words in the template.
+ * @param args the arguments, one job for each.
+ * @param arg_count the number of arguments.
+ * @param slots the most processes to run at once (at least 1).
+ * @param keep_order buffer each job's output and print it in argument order.
+ * @return the jobs to run.
+ */
+struct parallel *parallel_create(const struct dc_posix_env *env, struct dc_error *err, char **template,
+                                 size_t template_count, char **args, size_t arg_count, size_t slots,
+                                 bool keep_order);
+
+/**
+ * Free the jobs and set the pointer to NULL.
+ *
+ * @param env the posix environment.
+ * @param pparallel the jobs to destroy.
+ */
+void parallel_destroy(const struct dc_posix_env *env, struct parallel **pparallel);
+
+/**
+ * Run every job and wait for them all to finish.
+ * The processes write to the shell's descriptors, or with keep_order to a temporary file that is
+ * copied to out_fd once every job before it is done.
+ * A job killed by SIGINT or SIGQUIT (^C or ^\) stops any more jobs from starting.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param parallel the jobs to run.
+ * @param path_cache the cache of programs found in the PATH directories.
+ * @param jobs the job table, for children that are not part of the run and for job control (can be NULL).
+ * @param out_fd where the buffered output goes.
+ * @return the number of jobs that failed.
+ */
+size_t parallel_run(const struct dc_posix_env *env, struct dc_error *err, struct parallel *parallel,
+                    struct path_cache *path_cache, struct jobs *jobs, int out_fd);
+
+#endif // DC_SHELL_PARALLEL_H
@@ -0,0 +1,120 @@
+#ifndef DC_SHELL_PARSE_CACHE_H
+#define DC_SHELL_PARSE_CACHE_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "arena.h"
+#include <dc_posix/dc_posix_env.h>
+#include <stdio.h>
+
+struct command;
+
+/*! \struct parse_cache_entry
+    \brief The parsed commands of one line.
+*/
+struct parse_cache_entry
+{
+    size_t hash;                          /**< the hash of the line */
+    char *line;                           /**< the line */
+    struct arena *arena;                  /**< holds the line, the commands and all of their strings */
+    struct command *commands;             /**< the parsed commands, never changed once added */
+    size_t command_count;                 /**< the number of commands */
+    struct parse_cache_entry *next;       /**< the next entry in the same bucket */
+    struct parse_cache_entry *newer;      /**< the entry used after this one, NULL for the most recent */
+    struct parse_cache_entry *older;      /**< the entry used before this one, NULL for the least recent */
+};
+
+/*! \struct parse_cache
+    \brief Line to parsed commands, so that a line that is run again is not lexed and parsed again.
+
+    Entries are chained in a hash table keyed by the line and kept in least recently used order.
+    When the cache is full the least recently used line is dropped to make room.
+    A line is only added if none of its words were expanded (~, $ or a glob), since parsing
+    those again can give a different result.
+*/
+struct parse_cache
+{
+    struct parse_cache_entry **buckets;   /**< the hash table */
+    size_t bucket_count;                  /**< the number of buckets, always a power of 2 */
+    size_t capacity;                      /**< the most lines kept */
+    size_t count;                         /**< the number of lines kept */
+    struct parse_cache_entry *newest;     /**< the most recently used entry */
+    struct parse_cache_entry *oldest;     /**< the least recently used entry, dropped first */
+    size_t hits;                          /**< the number of lines answered from the cache */
+    size_t misses;                        /**< the number of lines that had to be parsed */
+};
+
+/**
+ * Create an empty cache.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param capacity the most lines to keep (must be more than 0).
+ * @return the cache.
+ */
+struct parse_cache *parse_cache_create(const struct dc_posix_env *env, struct dc_error *err, size_t capacity);
+
+/**
+ * Free the cache, and every line in it, and set the pointer to NULL.
+ *
+ * @param env the posix environment.
+ * @param pcache the cache to destroy.
+ */
+void parse_cache_destroy(const struct dc_posix_env *env, struct parse_cache **pcache);
+
+/**
+ * Look up a line. On a hit the commands are copied into the arena, ready to run, so
+ * that running them (eg. removing time or setting the exit code) leaves the cache alone.
+ * The strings are shared with the cache and must not be changed.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param cache the cache.
+ * @param arena where to allocate the commands (see separate_line), must not be NULL.
+ * @param line the line.
+ * @param commands set to the commands on a hit.
+ * @param count set to the number of commands on a hit.
+ * @return true on a hit.
+ */
+bool parse_cache_lookup(const struct dc_posix_env *env, struct dc_error *err, struct parse_cache *cache,
+                        struct arena *arena, const char *line, struct command **commands, size_t *count);
+
+/**
+ * Add the parsed commands of a line, dropping the least recently used line if the cache is full.
+ * Nothing is added if a word of any of the commands was expanded or it has a here-document.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param cache the cache.
+ * @param line the line.
+ * @param commands the commands, after parse_command and before they are run.
+ * @param count the number of commands.
+ */
+void parse_cache_add(const struct dc_posix_env *env, struct dc_error *err, struct parse_cache *cache,
+                     const char *line, const struct command *commands, size_t count);
+
+/**
+ * Display the number of lines kept and the hit and miss counts.
+ *
+ * @param env the posix environment.
+ * @param cache the cache.
+ * @param stream the stream to display the counts on.
+ */
+void parse_cache_display(const struct dc_posix_env *env, const struct parse_cache *cache, FILE *stream);
+
+#endif // DC_SHELL_PARSE_CACHE_H
@@ -0,0 +1,114 @@
+#ifndef DC_SHELL_PATH_CACHE_H
+#define DC_SHELL_PATH_CACHE_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <dc_posix/dc_posix_env.h>
+#include <stdio.h>
+#include <time.h>
+
+/*! \struct path_cache_entry
+    \brief A resolved (or unresolvable) command.
+*/
+struct path_cache_entry
+{
+    char *name;        /**< the command name, NULL if the slot is empty */
+    char *program;     /**< the absolute path of the program, NULL if the command was not found */
+    size_t dir_index;  /**< the PATH directory the program was found in (the last one if it is not executable) */
+    size_t hits;       /**< the number of times the entry was used */
+};
+
+/*! \struct path_cache
+    \brief Command name to program lookup, so that PATH is only searched once per command.
+
+    Entries are stored in an open addressing hash table keyed by the command name.
+    An entry is only trusted while the modification time of every PATH directory up
+    to the one it was found in is unchanged, otherwise the whole cache is flushed.
+*/
+struct path_cache
+{
+    char **path;                     /**< the PATH directories (not owned) */
+    size_t dir_count;                /**< the number of PATH directories */
+    struct timespec *dir_mtimes;     /**< the modification time of each PATH directory when the cache was filled */
+    struct path_cache_entry *entries; /**< the hash table */
+    size_t capacity;                 /**< the number of slots in the hash table, always a power of 2 */
+    size_t count;                    /**< the number of used slots */
+    size_t hits;                     /**< the number of lookups answered from the cache */
+    size_t misses;                   /**< the number of lookups that had to search PATH */
+};
+
+/**
+ * Create an empty cache for the given PATH directories.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param path the PATH directories, NULL terminated. The cache does not take ownership.
+ * @return the cache.
+ */
+struct path_cache *path_cache_create(const struct dc_posix_env *env, struct dc_error *err, char **path);
+
+/**
+ * Free the cache and set the pointer to NULL.
+ *
+ * @param env the posix environment.
+ * @param pcache the cache to destroy.
+ */
+void path_cache_destroy(const struct dc_posix_env *env, struct path_cache **pcache);
+
+/**
+ * Use a new set of PATH directories (eg. PATH was changed), flushing every entry.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param cache the cache.
+ * @param path the PATH directories, NULL terminated. The cache does not take ownership.
+ */
+void path_cache_set_path(const struct dc_posix_env *env, struct dc_error *err, struct path_cache *cache, char **path);
+
+/**
+ * Forget every entry (the hit and miss counts are kept).
+ *
+ * @param env the posix environment.
+ * @param cache the cache.
+ */
+void path_cache_flush(const struct dc_posix_env *env, struct path_cache *cache);
+
+/**
+ * Find the program for a command name, searching PATH only if the cache has no valid entry.
+ * A file that exists but is not executable is returned if nothing executable is found,
+ * so that running it reports a permission error rather than "not found".
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param cache the cache.
+ * @param name the command name (must not contain a '/').
+ * @return the path to the program, owned by the cache, or NULL if it cannot be found.
+ */
+const char *path_cache_lookup(const struct dc_posix_env *env, struct dc_error *err, struct path_cache *cache,
+                              const char *name);
+
+/**
+ * Display the cached commands and the hit and miss counts.
+ *
+ * @param env the posix environment.
+ * @param cache the cache.
+ * @param stream the stream to display the cache on.
+ */
+void path_cache_display(const struct dc_posix_env *env, const struct path_cache *cache, FILE *stream);
+
+#endif // DC_SHELL_PATH_CACHE_H
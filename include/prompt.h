@@ -0,0 +1,109 @@
+#ifndef DC_SHELL_PROMPT_H
+#define DC_SHELL_PROMPT_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <dc_posix/dc_posix_env.h>
+
+/*! \enum prompt_part_type
+    \brief What a part of the prompt shows.
+*/
+enum prompt_part_type
+{
+    PROMPT_TEXT,       /**< text that does not change (including `\u`, `\h` and `\$`, which are filled in once) */
+    PROMPT_DIRECTORY,  /**< the working directory */
+    PROMPT_HOME,       /**< the working directory with the home directory shown as ~ (`\w`) */
+    PROMPT_BASENAME,   /**< the last directory of the working directory (`\W`) */
+    PROMPT_EXIT_CODE,  /**< the exit code of the most recent line (`\?`) */
+    PROMPT_JOBS,       /**< the number of background jobs (`\j`) */
+};
+
+/*! \struct prompt_part
+    \brief A piece of the prompt.
+*/
+struct prompt_part
+{
+    enum prompt_part_type type; /**< what the part shows */
+    size_t offset;              /**< where the text of a PROMPT_TEXT part starts in text */
+    size_t length;              /**< the length of the text */
+};
+
+/*! \struct prompt
+    \brief PS1 compiled into the parts that are the same for every prompt and the ones that change.
+
+    The prompt is the working directory in brackets, then PS1 (eg. [/tmp] 3=D ).
+    The escapes are looked up once, when the prompt is compiled: the user, the host name and whether
+    the shell runs as root do not change, and the home directory is read once. Rendering copies the text
+    and fills in the working directory, exit code and job count from the shell's state, into a buffer
+    that is reused for every prompt, so it makes no system calls.
+    - `\u` the user name
+    - `\h` the host name up to the first dot, `\H` all of it
+    - `\w` the working directory with the home directory shown as ~, `\W` its last directory
+    - `\$` # for root, otherwise $
+    - `\?` the exit code of the most recent line
+    - `\j` the number of background jobs
+    - `\n` a new line, `\\` a backslash
+    Any other backslash is shown as it is.
+*/
+struct prompt
+{
+    char *text;                /**< the text of every PROMPT_TEXT part */
+    size_t text_size;          /**< the bytes used in text */
+    struct prompt_part *parts; /**< the parts, in order */
+    size_t part_count;         /**< the number of parts */
+    char *home;                /**< the home directory, NULL if HOME is not set */
+    size_t home_length;        /**< the length of home */
+    char *buffer;              /**< the prompt most recently rendered */
+    size_t capacity;           /**< the size of buffer */
+};
+
+/**
+ * Compile a prompt.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param ps1 the prompt shown after the working directory, with escapes.
+ * @return the compiled prompt.
+ */
+struct prompt *prompt_create(const struct dc_posix_env *env, struct dc_error *err, const char *ps1);
+
+/**
+ * Free a prompt and set the pointer to NULL.
+ *
+ * @param env the posix environment.
+ * @param pprompt the prompt to destroy.
+ */
+void prompt_destroy(const struct dc_posix_env *env, struct prompt **pprompt);
+
+/**
+ * Render a prompt.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param prompt the prompt.
+ * @param cwd the working directory, NULL if it is not known.
+ * @param exit_code the exit code of the most recent line.
+ * @param jobs the number of background jobs.
+ * @return the prompt, valid until the next render.
+ */
+const char *prompt_render(const struct dc_posix_env *env, struct dc_error *err, struct prompt *prompt,
+                          const char *cwd, int exit_code, size_t jobs);
+
+#endif // DC_SHELL_PROMPT_H
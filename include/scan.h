@@ -0,0 +1,99 @@
+#ifndef DC_SHELL_SCAN_H
+#define DC_SHELL_SCAN_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// the most bytes a set can hold
+#define SCAN_SET_MAX 32
+
+/*! \enum scan_impl
+    \brief The ways a line can be scanned, slowest first.
+*/
+enum scan_impl
+{
+    SCAN_TABLE, /**< one lookup per byte */
+    SCAN_SWAR,  /**< 8 bytes at a time in a 64 bit word, used for small sets where there is no vector unit */
+    SCAN_SSE2,  /**< 16 bytes at a time, compared against each byte of the set */
+    SCAN_AVX2,  /**< 32 bytes at a time, two nibble lookups however big the set is */
+};
+
+/*! \struct scan_set
+    \brief The bytes to stop at, with the tables every scanner needs built once.
+
+    The scanner is picked by scan_set_init from what the CPU supports (see __builtin_cpu_supports),
+    so the check is done once per set and not once per line.
+*/
+struct scan_set
+{
+    unsigned char bytes[SCAN_SET_MAX]; /**< the bytes in the set, all below 128 */
+    size_t count;                      /**< the number of bytes in the set */
+    bool members[UCHAR_MAX + 1];       /**< true for the bytes in the set */
+    unsigned char low[16];             /**< for each low nibble, a bit for the high nibble of each byte with it */
+    enum scan_impl impl;               /**< the scanner used by scan_span */
+};
+
+/**
+ * Build a set and pick the fastest scanner for it.
+ *
+ * @param set the set.
+ * @param bytes the bytes to stop at, they must all be ASCII.
+ * @param count the number of bytes, at most SCAN_SET_MAX ('\0' can be one of them).
+ */
+void scan_set_init(struct scan_set *set, const char *bytes, size_t count);
+
+/**
+ * Check if a scanner can be used on this CPU.
+ *
+ * @param impl the scanner.
+ * @return true if it can be used.
+ */
+bool scan_supported(enum scan_impl impl);
+
+/**
+ * Use a specific scanner for a set (for tests and benchmarks).
+ *
+ * @param set the set.
+ * @param impl the scanner.
+ * @return false, and the set is unchanged, if the CPU does not support it.
+ */
+bool scan_set_use(struct scan_set *set, enum scan_impl impl);
+
+/**
+ * Get the name of a scanner, for messages.
+ *
+ * @param impl the scanner.
+ * @return the name (eg. "avx2").
+ */
+const char *scan_impl_name(enum scan_impl impl);
+
+/**
+ * Find the first byte of a text that is in the set.
+ * Only the length bytes are read, the text does not have to be terminated.
+ *
+ * @param set the set.
+ * @param text the text.
+ * @param length the number of bytes of the text.
+ * @return the index of the first byte in the set, or length if there is none.
+ */
+size_t scan_span(const struct scan_set *set, const char *text, size_t length);
+
+#endif // DC_SHELL_SCAN_H
@@ -41,6 +41,17 @@ enum shell_states
   DESTROY_STATE,                  /**< destroy the state */             // 10
 };
 
+// the number of lines kept in the parse cache when it is not set (see shell_options)
+#define PARSE_CACHE_DEFAULT_SIZE 256
+
+/*! \struct shell_options
+    \brief The settings (from the command line, the environment or ~/.dcshell.conf) the shell runs with.
+*/
+struct shell_options
+{
+  size_t parse_cache_size; /**< the most lines kept in the parse cache (see parse_cache), 0 to parse every line */
+};
+
 /**
  * Run the shell FSM.
  *
@@ -49,9 +60,28 @@ enum shell_states
  * @param in the keyboard (stdin) file
  * @param out the keyboard (stdout) file
  * @param err the keyboard (stderr) file
+ * @param options the settings, NULL for the defaults
  *
  * @return the exit code from the shell.
  */
-int run_shell(const struct dc_posix_env *env, struct dc_error *error, FILE *in, FILE *out, FILE *err);
+int run_shell(const struct dc_posix_env *env, struct dc_error *error, FILE *in, FILE *out, FILE *err,
+              const struct shell_options *options);
+
+/**
+ * Run the shell FSM over a script (a file or a stdin that is not a terminal).
+ * There is no prompt and exit codes are not printed, out is block buffered
+ * and the shell stops at a syntax error or, after set -e, at the first line that fails.
+ *
+ * @param env the posix environment.
+ * @param error the error object
+ * @param in the script
+ * @param out the stdout file
+ * @param err the stderr file
+ * @param options the settings, NULL for the defaults
+ *
+ * @return the exit code of the last line that was run.
+ */
+int run_script(const struct dc_posix_env *env, struct dc_error *error, FILE *in, FILE *out, FILE *err,
+               const struct shell_options *options);
 
 #endif // DC_SHELL_SHELL_H
@@ -22,13 +22,11 @@
 #include "shell.h"
 
 /**
- * Set up the initial state:
- *  - in_redirect_regex  "[ \t\f\v]<.*"
- *  - out_redirect_regex "[ \t\f\v][1^2]?>[>]?.*"
- *  - err_redirect_regex "[ \t\f\v]2>[>]?.*"
+ * Set up the initial state (redirections are found by the lexer, nothing is compiled for them):
  *  - path the PATH environ var separated into directories
  *  - prompt the PS1 environ var or "$" if PS1 not set
  *  - max_line_length the value of _SC_ARG_MAX (see sysconf)
+ *  - vars the shell's variables, starting with the environment (see vars_create)
  *
  * @param env the posix environment.
  * @param err the error object
@@ -60,7 +58,7 @@ int reset_state(const struct dc_posix_env *env, struct dc_error *err,
                 void *arg);
 
 /**
- * Prompt the user and read the command line (see read_command_line).
+ * Report finished background jobs (see jobs_notify), prompt the user and read the command line (see read_command_line).
  * Sets the state->current_line and current_line_length.
  *
  * @param env the posix environment.
@@ -72,32 +70,41 @@ int read_commands(const struct dc_posix_env *env, struct dc_error *err,
                   void *arg);
 
 /**
- * Separate the commands. In the current implementation there is only one command.
- * Sets the state->command.
+ * Separate the commands of a pipeline (see separate_line).
+ * Sets the state->command and state->command_count.
+ * A line found in state->parse_cache is already parsed and goes straight to EXECUTE_COMMANDS.
  *
  * @param env the posix environment.
  * @param err the error object
  * @param arg the current struct state
- * @return PARSE_COMMANDS or SEPARATE_ERROR
+ * @return PARSE_COMMANDS, EXECUTE_COMMANDS (cached), RESET_STATE (on a syntax error) or SEPARATE_ERROR
  */
 int separate_commands(const struct dc_posix_env *env, struct dc_error *err,
                       void *arg);
 
 /**
  * Parse the commands (see parse_command)
+ * A syntax error sets the exit code to 2 and, in a script, exits the shell.
+ * The parsed commands are added to state->parse_cache (see parse_cache_add).
  *
  * @param env the posix environment.
  * @param err the error object
  * @param arg the current struct state
- * @return EXECUTE_COMMANDS or PARSE_ERROR
+ * @return EXECUTE_COMMANDS, RESET_STATE or EXIT (syntax error) or PARSE_ERROR
  */
 int parse_commands(const struct dc_posix_env *env, struct dc_error *err,
                    void *arg);
 
 
 /**
- * Run the command (see execute).
- * If the command->command is cd run builtin_cd
+ * Run each pipeline on the line (see execute and execute_pipeline), in order.
+ * A pipeline ending with & is started in the background and added to the job table.
+ * A pipeline after && only runs if the one before it succeeded, after || only if it failed.
+ * A command on its own that is a builtin (see find_builtin) runs in the shell rather than as a program.
+ * A command that is only assignments (FOO=1) sets shell variables, FOO=1 cmd only sets FOO in the
+ * environment of cmd. Programs get the exported variables as their environment (see vars_envp).
+ * A pipeline starting with time prints the real, user and system time it took to stderr.
+ * With set -o rusage the resources used by every program are printed to stderr.
  *
  * @param env the posix environment.
  * @param err the error object
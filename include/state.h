@@ -18,12 +18,22 @@
  *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#include <regex.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <dc_posix/dc_posix_env.h>
 
+struct arena;
 struct command;
+struct completion;
+struct editor;
+struct history;
+struct history_index;
+struct parse_cache;
+struct path_cache;
+struct prompt;
+struct jobs;
+struct input;
+struct vars;
 
 /*! \struct state
     \brief The current FSM state.
@@ -35,15 +45,31 @@ struct state
   FILE *stdin;                  /** stream to read commands from */
   FILE *stdout;                 /** stream to print the prompt to */
   FILE *stderr;                 /** stream to print error messages to */
-  regex_t *in_redirect_regex;   /**< stdin regex */
-  regex_t *out_redirect_regex;  /**< stdout regex */
-  regex_t *err_redirect_regex;  /**< stderr regex */
   char **path;                  /**< PATH environ var broken up */
+  struct path_cache *path_cache; /**< programs already found in the path directories */
   char *prompt;                 /**< Prompt to display before a command is entered */
+  struct prompt *prompt_template; /**< the prompt compiled once, rendered before every line */
+  char *cwd;                    /**< the working directory, read at the start and again by cd, NULL if it is not known */
   size_t max_line_length;       /**< the largest possible line */
-  char *current_line;           /**< the line the user most recently entered */
+  struct input *input;          /**< reads the lines of stdin into one buffer, reused for every line */
+  char *current_line;           /**< the line the user most recently entered (points into the input's buffer) */
   size_t current_line_length;   /**< the length of the most recently line */
-  struct command *command;      /**< the commands to execute - currently only one */
+  struct arena *arena;          /**< where everything for the current line is allocated, reset by do_reset_state */
+  struct parse_cache *parse_cache; /**< the commands of lines already parsed, NULL to parse every line (set by the caller) */
+  struct command *command;      /**< the commands to execute, in the order they appear on the line */
+  size_t command_count;         /**< the number of commands */
+  bool pipefail;                /**< a pipeline fails if any command in it fails (set -o pipefail) */
+  bool errexit;                 /**< exit the shell as soon as a line fails (set -e) */
+  bool log_rusage;              /**< print the resources used by every program to stderr (set -o rusage) */
+  bool log_allocs;              /**< print the arena allocations for every line to stderr (set -o allocs) */
+  bool interactive;             /**< show the prompt, exit codes and job notices (set by the caller, false for a script) */
+  int exit_code;                /**< the exit code of the most recent line */
+  struct jobs *jobs;            /**< the commands running in the background */
+  struct vars *vars;            /**< the shell's variables, the exported ones are the environment of the programs it runs */
+  struct history *history;      /**< the lines entered at the terminal, shared with the other sessions, NULL for none */
+  struct history_index *history_index; /**< the index Ctrl-R searches, saved next to the history file, NULL for none */
+  struct editor *editor;        /**< reads lines from the terminal so they can be edited, NULL if stdin is not a terminal */
+  struct completion *completion; /**< the commands and file names the editor completes, NULL if there is no editor */
   bool fatal_error;             /**< should the error terminate the shell (true = terminate) */
 };
 
@@ -55,13 +55,23 @@ char **parse_path(const struct dc_posix_env *env, struct dc_error *err,
                   const char *path_str);
 
 /**
- * Reset the state for the next read, freeing any dynamically allocated memory.
+ * Reset the state for the next read. The commands and everything in them are released at once by resetting the arena.
  *
  * @param env the posix environment.
  * @param err the error object
  */
 void do_reset_state(const struct dc_posix_env *env, struct dc_error *err, struct state *state);
 
+/**
+ * Display how much was allocated from the arena for the current line (set -o allocs),
+ * and the parse cache hits and misses so far.
+ *
+ * @param env the posix environment.
+ * @param state the state to display.
+ * @param stream the stream to display the statistics on.
+ */
+void display_allocs(const struct dc_posix_env *env, const struct state *state, FILE *stream);
+
 /**
  * Display the state values to the given stream.
  *
@@ -0,0 +1,145 @@
+#ifndef DC_SHELL_VARS_H
+#define DC_SHELL_VARS_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "arena.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <dc_posix/dc_posix_env.h>
+
+/*! \struct var
+    \brief One shell variable.
+*/
+struct var
+{
+    char *entry;        /**< NAME=value, the form envp needs, NULL for an empty slot */
+    size_t name_length; /**< the length of the name, the value starts after the = */
+    size_t hash;        /**< the hash of the name */
+    bool exported;      /**< the variable is passed to the programs the shell runs */
+};
+
+/*! \struct vars
+    \brief The shell's variables, in an open addressing hash table.
+
+    Slots are found by linear probing from the hash of the name, and removing a variable
+    moves the ones after it back so there are no tombstones.
+    The environment for programs (envp) is built from the exported variables the first time
+    it is needed and kept until an exported variable is set or removed.
+*/
+struct vars
+{
+    struct var *slots;     /**< the table */
+    size_t capacity;       /**< the number of slots, always a power of 2 */
+    size_t count;          /**< the number of variables */
+    char **envp;           /**< the exported variables, NULL terminated, NULL until vars_envp builds it */
+    size_t envp_capacity;  /**< the number of pointers envp has room for */
+    bool envp_stale;       /**< an exported variable changed after envp was built */
+    size_t envp_builds;    /**< the number of times envp was built */
+};
+
+/**
+ * Create the variables, with every variable in an environment exported.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param environment the NAME=value strings to start with (eg. environ), NULL terminated, or NULL for none.
+ * @return the variables.
+ */
+struct vars *vars_create(const struct dc_posix_env *env, struct dc_error *err, char **environment);
+
+/**
+ * Free the variables and set the pointer to NULL.
+ *
+ * @param env the posix environment.
+ * @param pvars the variables to destroy.
+ */
+void vars_destroy(const struct dc_posix_env *env, struct vars **pvars);
+
+/**
+ * Get the value of a variable.
+ *
+ * @param vars the variables.
+ * @param name the name, it does not have to end with a null byte.
+ * @param length the number of characters in name.
+ * @return the value or NULL if it is not set.
+ */
+const char *vars_get(const struct vars *vars, const char *name, size_t length);
+
+/**
+ * Set a variable. A variable that is already exported stays exported.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param vars the variables.
+ * @param name the name, it does not have to end with a null byte.
+ * @param length the number of characters in name.
+ * @param value the value.
+ * @param export also export the variable.
+ */
+void vars_set(const struct dc_posix_env *env, struct dc_error *err, struct vars *vars, const char *name,
+              size_t length, const char *value, bool export);
+
+/**
+ * Export a variable that is already set.
+ *
+ * @param vars the variables.
+ * @param name the name, it does not have to end with a null byte.
+ * @param length the number of characters in name.
+ * @return false if the variable is not set.
+ */
+bool vars_export(struct vars *vars, const char *name, size_t length);
+
+/**
+ * Remove a variable.
+ *
+ * @param vars the variables.
+ * @param name the name, it does not have to end with a null byte.
+ * @param length the number of characters in name.
+ * @return false if the variable was not set.
+ */
+bool vars_unset(struct vars *vars, const char *name, size_t length);
+
+/**
+ * Get the environment for a program: the exported variables as NAME=value.
+ * The array is rebuilt only if an exported variable changed since the last call,
+ * and it is only valid until the next change.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param vars the variables.
+ * @return the NULL terminated environment.
+ */
+char **vars_envp(const struct dc_posix_env *env, struct dc_error *err, struct vars *vars);
+
+/**
+ * Get the environment for a program with some variables added or replaced (FOO=1 cmd),
+ * without changing the shell's variables.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param vars the variables.
+ * @param arena where to allocate the array, or NULL to use malloc.
+ * @param assignments the NAME=value strings to add.
+ * @param count the number of assignments.
+ * @return the NULL terminated environment, the strings belong to vars and assignments.
+ */
+char **vars_envp_with(const struct dc_posix_env *env, struct dc_error *err, struct vars *vars,
+                      struct arena *arena, char **assignments, size_t count);
+
+#endif // DC_SHELL_VARS_H
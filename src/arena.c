@@ -0,0 +1,251 @@
+#include <errno.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_string.h>
+#include "arena.h"
+
+/**
+ * Round a size up so the next allocation is aligned for any type.
+ *
+ * @param size the size.
+ * @return the rounded size.
+ */
+static size_t align_size(size_t size);
+
+/**
+ * Allocate a block.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param size the number of bytes it holds.
+ * @return the empty block or NULL.
+ */
+static struct arena_block *create_block(const struct dc_posix_env *env, struct dc_error *err, size_t size);
+
+struct arena *arena_create(const struct dc_posix_env *env, struct dc_error *err, size_t block_size)
+{
+    struct arena *arena;
+
+    arena = dc_malloc(env, err, sizeof(struct arena));
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    arena->block_size  = align_size(block_size);
+    arena->first       = create_block(env, err, arena->block_size);
+    arena->current     = arena->first;
+    arena->blocks      = 1;
+    arena->allocations = 0;
+    arena->bytes       = 0;
+
+    if (dc_error_has_error(err))
+    {
+        free(arena);
+        return NULL;
+    }
+
+    return arena;
+}
+
+void arena_destroy(const struct dc_posix_env *env, struct arena **parena)
+{
+    struct arena_block *block;
+
+    (void)env;
+
+    if (*parena == NULL)
+    {
+        return;
+    }
+
+    block = (*parena)->first;
+
+    while (block)
+    {
+        struct arena_block *next;
+
+        next = block->next;
+        free(block);
+        block = next;
+    }
+
+    free(*parena);
+    *parena = NULL;
+}
+
+void arena_reset(struct arena *arena)
+{
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    // the later blocks are emptied as allocations reach them
+    arena->current       = arena->first;
+    arena->current->used = 0;
+    arena->allocations   = 0;
+    arena->bytes         = 0;
+}
+
+void *arena_alloc(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, size_t size)
+{
+    struct arena_block *block;
+    size_t aligned;
+    void *ptr;
+
+    if (arena == NULL)
+    {
+        return dc_malloc(env, err, size);
+    }
+
+    aligned = align_size(size == 0 ? 1 : size);
+    block   = arena->current;
+
+    while (block->used + aligned > block->size)
+    {
+        if (block->next == NULL)
+        {
+            block->next = create_block(env, err, aligned > arena->block_size ? aligned : arena->block_size);
+
+            if (dc_error_has_error(err))
+            {
+                return NULL;
+            }
+
+            arena->blocks++;
+        }
+
+        block       = block->next;
+        block->used = 0;
+    }
+
+    ptr             = (char *)block->data + block->used;
+    block->used    += aligned;
+    arena->current  = block;
+    arena->allocations++;
+    arena->bytes   += size;
+
+    return ptr;
+}
+
+void *arena_calloc(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, size_t count,
+                   size_t size)
+{
+    void *ptr;
+
+    if (arena == NULL)
+    {
+        return dc_calloc(env, err, count, size);
+    }
+
+    if (size != 0 && count > SIZE_MAX / size)
+    {
+        DC_ERROR_RAISE_ERRNO(err, ENOMEM);
+        return NULL;
+    }
+
+    ptr = arena_alloc(env, err, arena, count * size);
+
+    if (ptr)
+    {
+        dc_memset(env, ptr, 0, count * size);
+    }
+
+    return ptr;
+}
+
+void *arena_realloc(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, void *ptr,
+                    size_t old_size, size_t size)
+{
+    struct arena_block *block;
+    void *grown;
+
+    if (arena == NULL)
+    {
+        return dc_realloc(env, err, ptr, size);
+    }
+
+    block = arena->current;
+
+    // the most recent allocation can grow into the rest of its block
+    if (ptr && (char *)ptr + align_size(old_size == 0 ? 1 : old_size) == (char *)block->data + block->used &&
+        (size_t)((char *)ptr - (char *)block->data) + align_size(size) <= block->size)
+    {
+        block->used   = (size_t)((char *)ptr - (char *)block->data) + align_size(size);
+        arena->bytes += size - old_size;
+        return ptr;
+    }
+
+    grown = arena_alloc(env, err, arena, size);
+
+    if (grown && ptr)
+    {
+        dc_memcpy(env, grown, ptr, old_size < size ? old_size : size);
+    }
+
+    return grown;
+}
+
+char *arena_strndup(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, const char *str,
+                    size_t length)
+{
+    char *copy;
+    size_t len;
+
+    len = 0;
+
+    while (len < length && str[len])
+    {
+        len++;
+    }
+
+    copy = arena_alloc(env, err, arena, len + 1);
+
+    if (copy)
+    {
+        dc_memcpy(env, copy, str, len);
+        copy[len] = '\0';
+    }
+
+    return copy;
+}
+
+char *arena_strdup(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, const char *str)
+{
+    return arena_strndup(env, err, arena, str, dc_strlen(env, str));
+}
+
+void arena_free(struct arena *arena, void *ptr)
+{
+    if (arena == NULL)
+    {
+        free(ptr);
+    }
+}
+
+static size_t align_size(size_t size)
+{
+    return (size + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1);
+}
+
+static struct arena_block *create_block(const struct dc_posix_env *env, struct dc_error *err, size_t size)
+{
+    struct arena_block *block;
+
+    block = dc_malloc(env, err, sizeof(struct arena_block) + size);
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+
+    return block;
+}
@@ -1,11 +1,190 @@
 #include <builtins.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stddef.h>
+#include <dc_posix/dc_fcntl.h>
+#include <dc_posix/dc_stdlib.h>
 #include <dc_posix/dc_unistd.h>
+#include <dc_util/filesystem.h>
 #include <dc_util/path.h>
 #include <dc_posix/dc_string.h>
 #include <stdlib.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "completion.h"
+#include "copy.h"
+#include "parallel.h"
+#include "util.h"
+#include "vars.h"
+
+extern char **environ;
+
+static void dispatch_bg(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                        struct state *state);
+static void dispatch_cat(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                         struct state *state);
+static void dispatch_cd(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                        struct state *state);
+static void dispatch_echo(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                          struct state *state);
+static void dispatch_exec(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                          struct state *state);
+static void dispatch_export(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                            struct state *state);
+static void dispatch_false(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                           struct state *state);
+static void dispatch_fg(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                        struct state *state);
+static void dispatch_hash(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                          struct state *state);
+static void dispatch_jobs(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                          struct state *state);
+static void dispatch_parallel(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                              struct state *state);
+static void dispatch_pwd(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                         struct state *state);
+static void dispatch_set(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                         struct state *state);
+static void dispatch_true(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                          struct state *state);
+static void dispatch_unset(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                           struct state *state);
+static void dispatch_wait(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                          struct state *state);
+
+/**
+ * Check that a string can be used as a variable name ([A-Za-z_][A-Za-z0-9_]*).
+ *
+ * @param name the name to check.
+ * @param length the length of the name.
+ * @return true if the name is valid.
+ */
+static bool is_valid_name(const char *name, size_t length);
+
+/**
+ * Check if a variable name is PATH.
+ *
+ * @param name the name, it does not have to end with a null byte.
+ * @param length the length of the name.
+ * @return true for PATH.
+ */
+static bool is_path(const char *name, size_t length);
+
+/**
+ * Replace the PATH directories and the directories the path cache searches.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param state the state holding the PATH directories
+ * @param path_str the new PATH or NULL if it was removed
+ */
+static void update_path(const struct dc_posix_env *env, struct dc_error *err, struct state *state,
+                        const char *path_str);
+
+/**
+ * Copy one input of cat to the output.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param name the name of the input for error messages
+ * @param in_fd the input
+ * @param out_fd the output
+ * @param interrupted stop copying when it is set (^C), can be NULL
+ * @param errstream the stream to print error messages to
+ * @return true if the input was copied.
+ */
+static bool cat_fd(const struct dc_posix_env *env, struct dc_error *err, const char *name, int in_fd, int out_fd,
+                   const volatile sig_atomic_t *interrupted, FILE *errstream);
+
+/**
+ * The shell options for set -o, in the order they are displayed.
+ */
+static const struct
+{
+    const char *name; /**< the option name */
+    size_t offset;    /**< the offset of the bool in struct state */
+} options[] = {
+    {"allocs",   offsetof(struct state, log_allocs)},
+    {"errexit",  offsetof(struct state, errexit)},
+    {"pipefail", offsetof(struct state, pipefail)},
+    {"rusage",   offsetof(struct state, log_rusage)},
+};
+
+/**
+ * Get the flag in the state for one of the options.
+ *
+ * @param state the state holding the options.
+ * @param index the index of the option.
+ * @return the flag.
+ */
+static bool *option_flag(struct state *state, size_t index);
+
+/**
+ * The builtins, sorted by name for find_builtin.
+ * exit is not here, it ends the shell rather than running a command (see execute_commands).
+ */
+static const struct builtin builtins[] = {
+    {"bg",       dispatch_bg},
+    {"cat",      dispatch_cat},
+    {"cd",       dispatch_cd},
+    {"echo",     dispatch_echo},
+    {"exec",     dispatch_exec},
+    {"export",   dispatch_export},
+    {"false",    dispatch_false},
+    {"fg",       dispatch_fg},
+    {"hash",     dispatch_hash},
+    {"jobs",     dispatch_jobs},
+    {"parallel", dispatch_parallel},
+    {"pwd",      dispatch_pwd},
+    {"set",      dispatch_set},
+    {"true",     dispatch_true},
+    {"unset",    dispatch_unset},
+    {"wait",     dispatch_wait},
+};
+
+const struct builtin *find_builtin(const struct dc_posix_env *env, const char *name)
+{
+    size_t low;
+    size_t high;
+
+    low  = 0;
+    high = sizeof(builtins) / sizeof(builtins[0]);
+
+    while (low < high)
+    {
+        size_t middle;
+        int order;
+
+        middle = low + (high - low) / 2;
+        order  = dc_strcmp(env, name, builtins[middle].name);
+
+        if (order == 0)
+        {
+            return &builtins[middle];
+        }
+
+        if (order < 0)
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+
+    return NULL;
+}
+
+const struct builtin *builtin_at(size_t index)
+{
+    return index < sizeof(builtins) / sizeof(builtins[0]) ? &builtins[index] : NULL;
+}
 
 void builtin_cd(const struct dc_posix_env *env, struct dc_error *err,
-                struct command *command, FILE *errstream)
+                struct command *command, char **cwd, FILE *errstream)
 {
     char *path;
     if (command->argv[1] == NULL)
@@ -22,6 +201,22 @@ void builtin_cd(const struct dc_posix_env *env, struct dc_error *err,
     }
     // No errors exit code is 0.
     command->exit_code = 0;
+
+    // the prompt shows the directory without asking for it again, so it is only read when it changes
+    if (cwd && dc_error_has_no_error(err))
+    {
+        free(*cwd);
+        *cwd = dc_get_working_dir(env, err);
+
+        // the directory did change, it only has no name to show (eg. it was removed)
+        if (dc_error_has_error(err))
+        {
+            free(*cwd);
+            *cwd = NULL;
+            dc_error_reset(err);
+        }
+    }
+
     if (dc_error_has_error(err))
     {
         // Error -> exit code is 1.
@@ -53,3 +248,762 @@ void builtin_cd(const struct dc_posix_env *env, struct dc_error *err,
     }
     free(path);
 }
+
+void builtin_hash(const struct dc_posix_env *env, struct dc_error *err,
+                  struct command *command, struct path_cache *path_cache, FILE *outstream, FILE *errstream)
+{
+    command->exit_code = 0;
+
+    if (command->argv[1] == NULL)
+    {
+        path_cache_display(env, path_cache, outstream);
+        return;
+    }
+
+    for (size_t i = 1; command->argv[i]; ++i)
+    {
+        if (dc_strcmp(env, command->argv[i], "-r") == 0)
+        {
+            path_cache_flush(env, path_cache);
+        }
+        else if (dc_strchr(env, command->argv[i], '/') == NULL &&
+                 path_cache_lookup(env, err, path_cache, command->argv[i]) == NULL)
+        {
+            fprintf(errstream, "hash: %s: not found\n", command->argv[i]);
+            command->exit_code = 1;
+        }
+    }
+}
+
+void builtin_set(const struct dc_posix_env *env, struct dc_error *err,
+                 struct command *command, struct state *state, FILE *errstream)
+{
+    (void)err;
+
+    command->exit_code = 0;
+
+    for (size_t i = 1; command->argv[i]; ++i)
+    {
+        bool on = command->argv[i][0] == '-';
+
+        if (dc_strcmp(env, command->argv[i], "-e") == 0 || dc_strcmp(env, command->argv[i], "+e") == 0)
+        {
+            state->errexit = on;
+        }
+        else if (dc_strcmp(env, command->argv[i], "-o") != 0 && dc_strcmp(env, command->argv[i], "+o") != 0)
+        {
+            fprintf(errstream, "set: %s: invalid option\n", command->argv[i]);
+            command->exit_code = 1;
+        }
+        else if (command->argv[i + 1] == NULL)
+        {
+            for (size_t j = 0; j < sizeof(options) / sizeof(options[0]); ++j)
+            {
+                fprintf(state->stdout, "%s\t%s\n", options[j].name, *option_flag(state, j) ? "on" : "off");
+            }
+        }
+        else
+        {
+            bool found = false;
+
+            ++i;
+            for (size_t j = 0; j < sizeof(options) / sizeof(options[0]) && !found; ++j)
+            {
+                if (dc_strcmp(env, command->argv[i], options[j].name) == 0)
+                {
+                    *option_flag(state, j) = on;
+                    found = true;
+                }
+            }
+
+            if (!found)
+            {
+                fprintf(errstream, "set: %s: invalid option name\n", command->argv[i]);
+                command->exit_code = 1;
+            }
+        }
+    }
+}
+
+void builtin_jobs(const struct dc_posix_env *env, struct dc_error *err,
+                  struct command *command, struct jobs *jobs, FILE *outstream)
+{
+    (void)err;
+
+    jobs_display(env, jobs, outstream);
+
+    for (size_t i = jobs->count; i > 0; --i)
+    {
+        if (jobs->job[i - 1].status == JOB_DONE)
+        {
+            jobs_remove(env, jobs, &jobs->job[i - 1]);
+        }
+    }
+
+    command->exit_code = 0;
+}
+
+void builtin_wait(const struct dc_posix_env *env, struct dc_error *err,
+                  struct command *command, struct jobs *jobs, FILE *errstream)
+{
+    (void)err;
+
+    command->exit_code = 0;
+
+    if (command->argv[1] == NULL)
+    {
+        while (jobs->count > 0)
+        {
+            jobs_wait(jobs, &jobs->job[0]);
+
+            // ^C stops the wait, the jobs keep running
+            if (*jobs->interrupted)
+            {
+                command->exit_code = 128 + *jobs->interrupted;
+                return;
+            }
+
+            jobs_remove(env, jobs, &jobs->job[0]);
+        }
+        return;
+    }
+
+    for (size_t i = 1; command->argv[i] && !*jobs->interrupted; ++i)
+    {
+        struct job *job;
+
+        job = jobs_find(env, jobs, command->argv[i]);
+
+        if (job == NULL)
+        {
+            fprintf(errstream, "wait: %s: no such job\n", command->argv[i]);
+            command->exit_code = 127;
+            continue;
+        }
+
+        command->exit_code = jobs_wait(jobs, job);
+
+        if (job->status == JOB_DONE)
+        {
+            jobs_remove(env, jobs, job);
+        }
+    }
+}
+
+void builtin_fg(const struct dc_posix_env *env, struct dc_error *err,
+                struct command *command, struct jobs *jobs, FILE *outstream, FILE *errstream)
+{
+    struct job *job;
+
+    (void)err;
+
+    job = jobs_find(env, jobs, command->argv[1]);
+
+    if (job == NULL)
+    {
+        fprintf(errstream, "fg: %s: no such job\n", command->argv[1] ? command->argv[1] : "current");
+        command->exit_code = 1;
+        return;
+    }
+
+    fprintf(outstream, "%s\n", job->line);
+    fflush(outstream);
+
+    jobs_foreground(jobs, job->pgid);
+
+    if (job->status == JOB_STOPPED)
+    {
+        jobs_continue(jobs, job);
+    }
+
+    command->exit_code = jobs_wait(jobs, job);
+    jobs_foreground(jobs, jobs->pgid);
+
+    if (job->status == JOB_DONE)
+    {
+        jobs_remove(env, jobs, job);
+    }
+    else
+    {
+        fprintf(outstream, "[%d] Stopped\t%s\n", job->id, job->line);
+    }
+}
+
+void builtin_bg(const struct dc_posix_env *env, struct dc_error *err,
+                struct command *command, struct jobs *jobs, FILE *outstream, FILE *errstream)
+{
+    struct job *job;
+
+    (void)err;
+
+    job = jobs_find(env, jobs, command->argv[1]);
+
+    if (job == NULL)
+    {
+        fprintf(errstream, "bg: %s: no such job\n", command->argv[1] ? command->argv[1] : "current");
+        command->exit_code = 1;
+        return;
+    }
+
+    jobs_continue(jobs, job);
+    fprintf(outstream, "[%d] %s &\n", job->id, job->line);
+    command->exit_code = 0;
+}
+
+void builtin_pwd(const struct dc_posix_env *env, struct dc_error *err,
+                 struct command *command, FILE *outstream, FILE *errstream)
+{
+    char *cwd;
+
+    cwd = dc_get_working_dir(env, err);
+
+    if (dc_error_has_error(err) || cwd == NULL)
+    {
+        fprintf(errstream, "pwd: cannot get the working directory\n");
+        command->exit_code = 1;
+        free(cwd);
+        return;
+    }
+
+    fprintf(outstream, "%s\n", cwd);
+    free(cwd);
+    command->exit_code = 0;
+}
+
+void builtin_echo(const struct dc_posix_env *env, struct dc_error *err,
+                  struct command *command, FILE *outstream)
+{
+    bool newline;
+    const char *separator;
+    size_t i;
+
+    (void)err;
+    newline   = true;
+    separator = "";
+    i         = 1;
+
+    if (command->argv[1] && dc_strcmp(env, command->argv[1], "-n") == 0)
+    {
+        newline = false;
+        i++;
+    }
+
+    for (; command->argv[i]; ++i)
+    {
+        fputs(separator, outstream);
+        fputs(command->argv[i], outstream);
+        separator = " ";
+    }
+
+    if (newline)
+    {
+        fputc('\n', outstream);
+    }
+
+    command->exit_code = 0;
+}
+
+void builtin_cat(const struct dc_posix_env *env, struct dc_error *err,
+                 struct command *command, struct jobs *jobs, FILE *outstream, FILE *errstream)
+{
+    const volatile sig_atomic_t *interrupted;
+    int out_fd;
+
+    // anything the shell has already printed goes before the files
+    fflush(outstream);
+    out_fd             = fileno(outstream);
+    interrupted        = jobs ? jobs->interrupted : NULL;
+    command->exit_code = 0;
+
+    if (out_fd == -1)
+    {
+        fprintf(errstream, "cat: the output has no descriptor\n");
+        command->exit_code = 1;
+        return;
+    }
+
+    if (command->argv[1] == NULL && !cat_fd(env, err, "-", STDIN_FILENO, out_fd, interrupted, errstream))
+    {
+        command->exit_code = 1;
+    }
+
+    for (size_t i = 1; command->argv[i] && !(interrupted && *interrupted); ++i)
+    {
+        int in_fd;
+
+        if (dc_strcmp(env, command->argv[i], "-") == 0)
+        {
+            in_fd = STDIN_FILENO;
+        }
+        else
+        {
+            in_fd = dc_open(env, err, command->argv[i], DC_O_RDONLY, 0);
+
+            if (dc_error_has_error(err))
+            {
+                fprintf(errstream, "cat: %s: %s\n", command->argv[i], strerror(err->err_code));
+                dc_error_reset(err);
+                command->exit_code = 1;
+                continue;
+            }
+        }
+
+        if (!cat_fd(env, err, command->argv[i], in_fd, out_fd, interrupted, errstream))
+        {
+            command->exit_code = 1;
+        }
+
+        if (in_fd != STDIN_FILENO)
+        {
+            close(in_fd);
+        }
+    }
+
+    if (interrupted && *interrupted)
+    {
+        command->exit_code = 128 + *interrupted;
+    }
+}
+
+void builtin_parallel(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                      struct path_cache *path_cache, struct jobs *jobs, FILE *outstream, FILE *errstream)
+{
+    struct parallel *parallel;
+    size_t slots;
+    bool keep_order;
+    size_t first;
+    size_t separator;
+    size_t arg_count;
+
+    slots      = (size_t)sysconf(_SC_NPROCESSORS_ONLN);
+    keep_order = false;
+    first      = 1;
+
+    for (; command->argv[first] && command->argv[first][0] == '-'; ++first)
+    {
+        const char *number;
+        char *end;
+
+        if (dc_strcmp(env, command->argv[first], "-k") == 0 ||
+            dc_strcmp(env, command->argv[first], "--keep-order") == 0)
+        {
+            keep_order = true;
+            continue;
+        }
+
+        if (dc_strncmp(env, command->argv[first], "-j", 2) != 0)
+        {
+            fprintf(errstream, "parallel: %s: invalid option\n", command->argv[first]);
+            command->exit_code = 2;
+            return;
+        }
+
+        // -j N or -jN
+        number = command->argv[first][2] != '\0' ? &command->argv[first][2] : command->argv[++first];
+
+        if (number == NULL || !isdigit((unsigned char)number[0]) || (slots = strtoul(number, &end, 10), *end != '\0'))
+        {
+            fprintf(errstream, "parallel: %s: invalid number of jobs\n", number ? number : "");
+            command->exit_code = 2;
+            return;
+        }
+    }
+
+    for (separator = first; command->argv[separator] && dc_strcmp(env, command->argv[separator], ":::") != 0;)
+    {
+        ++separator;
+    }
+
+    if (separator == first || command->argv[separator] == NULL)
+    {
+        fprintf(errstream, "parallel: usage: parallel [-j N] [--keep-order] command [arg...] ::: arg...\n");
+        command->exit_code = 2;
+        return;
+    }
+
+    for (arg_count = 0; command->argv[separator + 1 + arg_count]; ++arg_count)
+    {
+    }
+
+    // anything the shell has already printed goes before the output of the runs
+    fflush(outstream);
+    fflush(errstream);
+
+    parallel = parallel_create(env, err, &command->argv[first], separator - first, &command->argv[separator + 1],
+                               arg_count, slots, keep_order);
+
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    // every run gets the environment of the parallel command itself
+    for (size_t i = 0; i < parallel->count; ++i)
+    {
+        parallel->job[i].command.envp = command->envp;
+    }
+
+    parallel_run(env, err, parallel, path_cache, jobs, fileno(outstream));
+
+    if (parallel->failed > 0)
+    {
+        fprintf(errstream, "parallel: %zu of %zu failed\n", parallel->failed, parallel->count);
+
+        for (size_t i = 0; i < parallel->count; ++i)
+        {
+            if (parallel->job[i].command.exit_code != 0)
+            {
+                fprintf(errstream, "parallel: exit %d: %s\n", parallel->job[i].command.exit_code,
+                        parallel->job[i].command.line);
+            }
+        }
+    }
+
+    command->exit_code = parallel->failed > 100 ? 101 : (int)parallel->failed;
+    parallel_destroy(env, &parallel);
+}
+
+void builtin_exec(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                  struct path_cache *path_cache, struct jobs *jobs, FILE *outstream, FILE *errstream)
+{
+    const char *program;
+    sigset_t mask;
+    int terminal;
+
+    // anything already printed belongs to the descriptors from before the redirections
+    fflush(outstream);
+    fflush(errstream);
+
+    if (!redirect_shell(env, err, command, NULL))
+    {
+        return;
+    }
+
+    command->exit_code = 0;
+
+    if (command->argv[1] == NULL)
+    {
+        return;
+    }
+
+    if (dc_strchr(env, command->argv[1], '/'))
+    {
+        program = command->argv[1];
+    }
+    else
+    {
+        program = path_cache_lookup(env, err, path_cache, command->argv[1]);
+    }
+
+    if (program == NULL)
+    {
+        fprintf(errstream, "command: %s not found\n", command->argv[1]);
+        command->exit_code = 127;
+        return;
+    }
+
+    // same as a program started by launch, the shell's blocked and ignored signals are not inherited
+    sigemptyset(&mask);
+    sigprocmask(SIG_SETMASK, &mask, NULL);
+    terminal = jobs->terminal;
+    jobs_release(jobs);
+    execve(program, &command->argv[1], command->envp ? command->envp : environ);
+
+    fprintf(errstream, "exec: %s: %s\n", command->argv[1], strerror(errno));
+    command->exit_code = errno == ENOENT ? 127 : 126;
+
+    if (terminal != -1)
+    {
+        jobs_control(env, err, jobs, terminal);
+    }
+}
+
+void builtin_export(const struct dc_posix_env *env, struct dc_error *err,
+                    struct command *command, struct state *state, FILE *errstream)
+{
+    command->exit_code = 0;
+
+    if (command->argv[1] == NULL)
+    {
+        char **envp;
+
+        envp = vars_envp(env, err, state->vars);
+
+        for (char **var = envp; var && *var; ++var)
+        {
+            fprintf(state->stdout, "export %s\n", *var);
+        }
+        return;
+    }
+
+    for (size_t i = 1; command->argv[i]; ++i)
+    {
+        char *equals;
+        size_t length;
+
+        equals = dc_strchr(env, command->argv[i], '=');
+        length = equals ? (size_t)(equals - command->argv[i]) : dc_strlen(env, command->argv[i]);
+
+        if (!is_valid_name(command->argv[i], length))
+        {
+            fprintf(errstream, "export: `%s': not a valid identifier\n", command->argv[i]);
+            command->exit_code = 1;
+            continue;
+        }
+
+        // without a value a shell variable is exported as it is, one that is not set is left alone
+        if (equals == NULL)
+        {
+            vars_export(state->vars, command->argv[i], length);
+            continue;
+        }
+
+        vars_set(env, err, state->vars, command->argv[i], length, equals + 1, true);
+
+        if (dc_error_has_no_error(err) && is_path(command->argv[i], length))
+        {
+            update_path(env, err, state, equals + 1);
+        }
+
+        if (dc_error_has_error(err))
+        {
+            fprintf(errstream, "export: %s: %s\n", command->argv[i], err->message);
+            command->exit_code = 1;
+            dc_error_reset(err);
+        }
+    }
+}
+
+void builtin_unset(const struct dc_posix_env *env, struct dc_error *err,
+                   struct command *command, struct state *state, FILE *errstream)
+{
+    command->exit_code = 0;
+
+    for (size_t i = 1; command->argv[i]; ++i)
+    {
+        if (!is_valid_name(command->argv[i], dc_strlen(env, command->argv[i])))
+        {
+            fprintf(errstream, "unset: `%s': not a valid identifier\n", command->argv[i]);
+            command->exit_code = 1;
+            continue;
+        }
+
+        if (vars_unset(state->vars, command->argv[i], dc_strlen(env, command->argv[i])) &&
+            dc_strcmp(env, command->argv[i], "PATH") == 0)
+        {
+            update_path(env, err, state, NULL);
+        }
+
+        if (dc_error_has_error(err))
+        {
+            command->exit_code = 1;
+            dc_error_reset(err);
+        }
+    }
+}
+
+void assign_variables(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                      struct state *state)
+{
+    command->exit_code = 0;
+
+    for (size_t i = 0; i < command->assignment_count && dc_error_has_no_error(err); ++i)
+    {
+        const char *assignment;
+        size_t length;
+
+        // the parser only makes assignments of valid names, so there is always an =
+        assignment = command->assignments[i];
+        length     = (size_t)(dc_strchr(env, assignment, '=') - assignment);
+        vars_set(env, err, state->vars, assignment, length, &assignment[length + 1], false);
+
+        if (dc_error_has_no_error(err) && is_path(assignment, length))
+        {
+            update_path(env, err, state, &assignment[length + 1]);
+        }
+    }
+}
+
+static bool is_valid_name(const char *name, size_t length)
+{
+    if (length == 0 || isdigit((unsigned char)name[0]))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        if (!isalnum((unsigned char)name[i]) && name[i] != '_')
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool is_path(const char *name, size_t length)
+{
+    return length == 4 && strncmp(name, "PATH", 4) == 0;
+}
+
+static void update_path(const struct dc_posix_env *env, struct dc_error *err, struct state *state,
+                        const char *path_str)
+{
+    char **path;
+
+    path = parse_path(env, err, path_str ? path_str : "");
+
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    // the cache does not own the directories, so it must stop using the old ones before they are freed
+    path_cache_set_path(env, err, state->path_cache, path);
+
+    if (state->completion)
+    {
+        completion_set_path(env, err, state->completion, path);
+    }
+
+    for (size_t i = 0; state->path && state->path[i]; ++i)
+    {
+        free(state->path[i]);
+    }
+    free(state->path);
+    state->path = path;
+}
+
+static void dispatch_bg(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                        struct state *state)
+{
+    builtin_bg(env, err, command, state->jobs, state->stdout, state->stderr);
+}
+
+static bool cat_fd(const struct dc_posix_env *env, struct dc_error *err, const char *name, int in_fd, int out_fd,
+                   const volatile sig_atomic_t *interrupted, FILE *errstream)
+{
+    struct stat in_stat;
+    struct stat out_stat;
+
+    // cat a >> a would never reach the end of a
+    if (fstat(in_fd, &in_stat) == 0 && fstat(out_fd, &out_stat) == 0 && S_ISREG(in_stat.st_mode) &&
+        in_stat.st_dev == out_stat.st_dev && in_stat.st_ino == out_stat.st_ino)
+    {
+        fprintf(errstream, "cat: %s: input file is output file\n", name);
+        return false;
+    }
+
+    copy_fd(env, err, in_fd, out_fd, COPY_FILE_RANGE, NULL, interrupted);
+
+    if (dc_error_has_error(err))
+    {
+        fprintf(errstream, "cat: %s: %s\n", name, strerror(err->err_code));
+        dc_error_reset(err);
+        return false;
+    }
+
+    return true;
+}
+
+static void dispatch_cat(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                         struct state *state)
+{
+    builtin_cat(env, err, command, state->jobs, state->stdout, state->stderr);
+}
+
+static void dispatch_cd(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                        struct state *state)
+{
+    builtin_cd(env, err, command, &state->cwd, state->stderr);
+}
+
+static void dispatch_echo(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                          struct state *state)
+{
+    builtin_echo(env, err, command, state->stdout);
+}
+
+static void dispatch_exec(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                          struct state *state)
+{
+    builtin_exec(env, err, command, state->path_cache, state->jobs, state->stdout, state->stderr);
+}
+
+static void dispatch_export(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                            struct state *state)
+{
+    builtin_export(env, err, command, state, state->stderr);
+}
+
+static void dispatch_false(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                           struct state *state)
+{
+    (void)env;
+    (void)err;
+    (void)state;
+    command->exit_code = 1;
+}
+
+static void dispatch_fg(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                        struct state *state)
+{
+    builtin_fg(env, err, command, state->jobs, state->stdout, state->stderr);
+}
+
+static void dispatch_hash(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                          struct state *state)
+{
+    builtin_hash(env, err, command, state->path_cache, state->stdout, state->stderr);
+}
+
+static void dispatch_jobs(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                          struct state *state)
+{
+    builtin_jobs(env, err, command, state->jobs, state->stdout);
+}
+
+static void dispatch_parallel(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                              struct state *state)
+{
+    builtin_parallel(env, err, command, state->path_cache, state->jobs, state->stdout, state->stderr);
+}
+
+static void dispatch_pwd(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                         struct state *state)
+{
+    builtin_pwd(env, err, command, state->stdout, state->stderr);
+}
+
+static void dispatch_set(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                         struct state *state)
+{
+    builtin_set(env, err, command, state, state->stderr);
+}
+
+static void dispatch_true(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                          struct state *state)
+{
+    (void)env;
+    (void)err;
+    (void)state;
+    command->exit_code = 0;
+}
+
+static void dispatch_unset(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                           struct state *state)
+{
+    builtin_unset(env, err, command, state, state->stderr);
+}
+
+static void dispatch_wait(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                          struct state *state)
+{
+    builtin_wait(env, err, command, state->jobs, state->stderr);
+}
+
+static bool *option_flag(struct state *state, size_t index)
+{
+    return (bool *)((char *)state + options[index].offset);
+}
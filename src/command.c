@@ -1,211 +1,1068 @@
+#include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
 #include <dc_util/path.h>
+#include <dc_posix/dc_stdio.h>
 #include <dc_posix/dc_stdlib.h>
-#include <wordexp.h>
+#include <dc_posix/dc_string.h>
+#include <unistd.h>
 #include "command.h"
+#include "editor.h"
+#include "expand.h"
+#include "input.h"
+#include "lexer.h"
+#include "scan.h"
 
-void parse_command(const struct dc_posix_env *env, struct dc_error *err,
-                   struct state *state, struct command *command)
+/**
+ * Add a command for part of a line to the end of the commands.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena where to allocate the commands.
+ * @param commands the commands, reallocated to make room.
+ * @param count the number of commands, incremented.
+ * @param start the start of the command in the line.
+ * @param length the number of characters in the command.
+ * @param connector how the command is joined to the next one.
+ * @return false if the command is empty (only whitespace).
+ */
+static bool add_command(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                        struct command **commands, size_t *count, const char *start, size_t length,
+                        enum command_connector connector);
+
+/**
+ * Fill in the command's words, assignments and redirections from its tokens.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param vars the variables to expand the words with.
+ * @param command the command, argv is allocated and the rest are added to.
+ * @param tokens the tokens of the command.
+ * @param count the number of tokens.
+ * @param heredocs the here-documents added by lex_command, in order, or NULL to add them from the tokens.
+ *                 A body that was read is expanded unless its delimiter was quoted.
+ * @return NULL, or the redirection operator if a >& or <& is not followed by a descriptor (or -).
+ */
+static const char *build_command(const struct dc_posix_env *env, struct dc_error *err, const struct vars *vars,
+                                 struct command *command, const struct token *tokens, size_t count,
+                                 const struct redirection *heredocs);
+
+/**
+ * Add a word, after expanding it, to the end of the command's arguments.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param vars the variables to expand the word with.
+ * @param command the command.
+ * @param capacity the number of slots in command->argv, updated if it grows.
+ * @param token the word.
+ */
+static void add_words(const struct dc_posix_env *env, struct dc_error *err, const struct vars *vars,
+                      struct command *command, size_t *capacity, const struct token *token);
+
+/**
+ * Add a NAME=value word that comes before the command to command->assignments.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param vars the variables to expand the value with.
+ * @param command the command.
+ * @param token the word.
+ * @return false if the word is not an assignment (it is the command, or an argument).
+ */
+static bool add_assignment(const struct dc_posix_env *env, struct dc_error *err, const struct vars *vars,
+                           struct command *command, const struct token *token);
+
+/**
+ * Add a word to the command: the first one is the command, the rest go in argv.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param command the command.
+ * @param capacity the number of slots in command->argv, updated if it grows.
+ * @param word the word, allocated from the command's arena (the command takes ownership of it).
+ */
+static void add_word(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                     size_t *capacity, char *word);
+
+/**
+ * Add the redirections for a redirection token (see append_redirection).
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param vars the variables to expand the file name with.
+ * @param command the command.
+ * @param token the redirection.
+ * @return false if a >& or <& is not followed by a descriptor (or -).
+ */
+static bool add_redirection(const struct dc_posix_env *env, struct dc_error *err, const struct vars *vars,
+                            struct command *command, const struct token *token);
+
+/**
+ * Redirect stdout to the file and stderr to stdout (&> file or &>> file).
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param command the command.
+ * @param append add to the end of the file rather than truncating it.
+ * @param file the file.
+ */
+static void add_out_err(const struct dc_posix_env *env, struct dc_error *err, struct command *command, bool append,
+                        const char *file);
+
+/**
+ * Add a here-document whose body is read later by read_heredocs (<< word or <<- word).
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param command the command.
+ * @param token the redirection, its word is the delimiter.
+ */
+static void add_heredoc(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                        const struct token *token);
+
+/**
+ * Join two strings from the command's arena into a new one, the first is freed.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena where the strings are allocated.
+ * @param first the first string.
+ * @param separator what goes between them.
+ * @param second the second string.
+ * @return the joined string.
+ */
+static char *join_text(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, char *first,
+                       const char *separator, const char *second);
+
+/**
+ * Check that a word is a descriptor number.
+ *
+ * @param word the word.
+ * @return true if the word is only digits.
+ */
+static bool is_descriptor(const char *word);
+
+/**
+ * Check what follows a >& or <&: a descriptor number, - to close it, or (for >& on stdout) a file.
+ *
+ * @param redirect the operator.
+ * @param fd the descriptor being redirected.
+ * @param word the word after the operator.
+ * @return false if the word can not follow the operator, true for the other operators.
+ */
+static bool is_dup_target(enum redirect_type redirect, int fd, const char *word);
+
+/**
+ * Get the length of the name of a NAME=value word, as it was typed.
+ *
+ * @param raw the word with its quotes.
+ * @param raw_length the number of characters in raw.
+ * @return the length of the name, 0 if the word is not an assignment.
+ */
+static size_t assignment_name_length(const char *raw, size_t raw_length);
+
+/**
+ * Skip a quoted part of a line.
+ *
+ * @param c the opening ' or ".
+ * @param end the end of the line.
+ * @return the character after the closing quote, or end if it is not closed.
+ */
+static const char *skip_quoted(const char *c, const char *end);
+
+static struct scan_set separator_set;    /**< the characters separate_line has to look at outside of quotes */
+static struct scan_set double_quote_set; /**< the characters separate_line has to look at inside "..." */
+static bool sets_ready;                  /**< true once the sets are built */
+
+const char *parse_command(const struct dc_posix_env *env, struct dc_error *err,
+                          struct state *state, struct command *command)
 {
-    wordexp_t exp_main;
-    int status_main;
-    char *string;
-    regmatch_t match;
-    int matched;
-    const char *append = ">>";
+    const char *syntax_error;
 
-    string  = strdup(command->line);
-    matched = regexec(state->err_redirect_regex,
-                      string,
-                      1,
-                      &match,
-                      0);
+    syntax_error = lex_command(env, err, command);
 
-    if (matched == 0)
+    if (syntax_error == NULL && dc_error_has_no_error(err))
     {
-        char *str2;
-        char *str;
-        wordexp_t exp;
-        int status;
-        size_t size;
-        // Offset of the first character of the stderr file name from the start. " 2>"
-        size_t offset = 3;
+        syntax_error = expand_command(env, err, state, command);
+    }
+
+    return syntax_error;
+}
+
+const char *lex_command(const struct dc_posix_env *env, struct dc_error *err, struct command *command)
+{
+    struct lexer lexer;
+    struct token token;
+    struct token *tokens;
+    char *buffer;
+    size_t count;
+    size_t capacity;
+    size_t name_length;
+    bool named;
+    bool deferred;
 
-        regoff_t length = match.rm_eo - match.rm_so;
+    buffer = arena_alloc(env, err, command->arena, dc_strlen(env, command->line) + 1);
 
-        str = malloc(length + 1);
-        strncpy(str, &string[match.rm_so], length);
-        string[match.rm_so] = '\0';
-        str[length] = '\0';
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
 
-        if (strstr(str, append))
+    tokens   = NULL;
+    count    = 0;
+    capacity = 0;
+    named    = false;
+    deferred = false;
+    lexer_init(&lexer, command->line, buffer);
+
+    while (dc_error_has_no_error(err) && lexer.error == NULL && lexer_next(&lexer, &token) && token.type != TOKEN_END)
+    {
+        if (count == capacity)
         {
-            offset++;
-            command->stderr_overwrite = true;
+            struct token *grown;
+
+            grown = arena_realloc(env, err, command->arena, tokens, capacity * sizeof(struct token),
+                                  (capacity ? capacity * 2 : 8) * sizeof(struct token));
+
+            if (dc_error_has_error(err))
+            {
+                break;
+            }
+
+            tokens   = grown;
+            capacity = capacity ? capacity * 2 : 8;
         }
 
-        size = length - offset;
-        str2 = dc_malloc(env, err, sizeof(char) * size);
-        strncpy(str2, &str[offset], size);
-        str2[size] = '\0';
-        // wordexp
-        status = wordexp(str2, &exp, 0);
-        if (status == 0)
+        tokens[count++] = token;
+        deferred        = deferred || token.expand || (token.type == TOKEN_REDIRECT &&
+                                                       (token.redirect == REDIRECT_HEREDOC ||
+                                                        token.redirect == REDIRECT_HEREDOC_TAB));
+
+        // the value of an assignment before the command can start with a ~ that the lexer does not mark
+        if (token.type == TOKEN_WORD && !named)
         {
-            command->stderr_file = strdup(exp.we_wordv[0]);
-            wordfree(&exp);
+            name_length = assignment_name_length(token.raw, token.raw_length);
+            named       = name_length == 0;
+            deferred    = deferred || (!named && token.raw[name_length + 1] == '~');
         }
-        else
+        else if (token.type == TOKEN_REDIRECT && !token.expand && !is_dup_target(token.redirect, token.fd, token.text))
         {
-            state->fatal_error = true;
+            lexer.error = lexer_operator(token.redirect);
         }
-        free(str2);
-        free(str);
     }
 
-    matched = regexec(state->out_redirect_regex,
-                      string,
-                      1,
-                      &match,
-                      0);
+    if (dc_error_has_no_error(err) && lexer.error == NULL && deferred)
+    {
+        // the words are expanded by expand_command, only the here-documents are needed before then (for read_heredocs)
+        command->expanded    = true;
+        command->tokens      = tokens;
+        command->token_count = count;
+        command->token_text  = buffer;
+
+        for (size_t i = 0; i < count && dc_error_has_no_error(err); ++i)
+        {
+            if (tokens[i].type == TOKEN_REDIRECT &&
+                (tokens[i].redirect == REDIRECT_HEREDOC || tokens[i].redirect == REDIRECT_HEREDOC_TAB))
+            {
+                add_heredoc(env, err, command, &tokens[i]);
+            }
+        }
 
-    if (matched == 0)
+        return NULL;
+    }
+
+    // nothing to expand, so the command is the same whenever it runs and is built now
+    if (dc_error_has_no_error(err) && lexer.error == NULL)
     {
-        char *str2;
-        char *str;
-        wordexp_t exp;
-        int status;
-        size_t size;
-        // Offset of the first character of the stdout file name from the start. " >"
-        size_t offset = 2;
+        lexer.error = build_command(env, err, NULL, command, tokens, count, NULL);
+    }
 
-        regoff_t length = match.rm_eo - match.rm_so;
+    arena_free(command->arena, tokens);
+    arena_free(command->arena, buffer);
 
-        str = malloc(length + 1);
-        strncpy(str, &string[match.rm_so], length);
-        string[match.rm_so] = '\0';
-        str[length] = '\0';
+    return lexer.error;
+}
 
-        if (strstr(str, append))
+const char *expand_command(const struct dc_posix_env *env, struct dc_error *err, struct state *state,
+                           struct command *command)
+{
+    struct redirection *heredocs;
+    const char *syntax_error;
+
+    if (command->tokens == NULL)
+    {
+        return NULL;
+    }
+
+    // the here-documents, with their bodies if they have been read, go back in among the other redirections
+    heredocs                   = command->redirections;
+    command->redirections      = NULL;
+    command->redirection_count = 0;
+    syntax_error               = build_command(env, err, state ? state->vars : NULL, command, command->tokens,
+                                               command->token_count, heredocs);
+
+    arena_free(command->arena, heredocs);
+    arena_free(command->arena, command->tokens);
+    arena_free(command->arena, command->token_text);
+    command->tokens      = NULL;
+    command->token_count = 0;
+    command->token_text  = NULL;
+
+    return syntax_error;
+}
+
+static const char *build_command(const struct dc_posix_env *env, struct dc_error *err, const struct vars *vars,
+                                 struct command *command, const struct token *tokens, size_t count,
+                                 const struct redirection *heredocs)
+{
+    const char *syntax_error;
+    size_t capacity;
+
+    // argv[0] is filled in with the program when it is started and the array always ends with NULL
+    syntax_error  = NULL;
+    capacity      = 8;
+    command->argc = 0;
+    command->argv = arena_calloc(env, err, command->arena, capacity, sizeof(char *));
+
+    for (size_t i = 0; i < count && dc_error_has_no_error(err) && syntax_error == NULL; ++i)
+    {
+        const struct token *token;
+        struct redirection *redirection;
+
+        token = &tokens[i];
+
+        if (token->type == TOKEN_WORD)
         {
-            offset++;
-            command->stdout_overwrite = true;
+            // FOO=1 is only an assignment before the command
+            if (command->command != NULL || !add_assignment(env, err, vars, command, token))
+            {
+                add_words(env, err, vars, command, &capacity, token);
+            }
         }
+        else if (heredocs && (token->redirect == REDIRECT_HEREDOC || token->redirect == REDIRECT_HEREDOC_TAB))
+        {
+            append_redirection(env, err, command, REDIRECTION_HEREDOC, token->fd, -1, NULL);
 
-        size = length - offset;
-        str2 = dc_malloc(env, err, sizeof(char) * (size + 1));
-        strncpy(str2, &str[offset], size);
-        str2[size] = '\0';
+            if (dc_error_has_error(err))
+            {
+                break;
+            }
 
-        // wordexp
-        status = wordexp(str2, &exp, 0);
-        if (status == 0)
+            // the body was read as it was typed, it is expanded along with the words
+            redirection  = &command->redirections[command->redirection_count - 1];
+            *redirection = *heredocs++;
+
+            if (!redirection->literal && redirection->delimiter == NULL && redirection->file)
+            {
+                redirection->file = expand_text(env, err, command->arena, vars, redirection->file,
+                                                dc_strlen(env, redirection->file));
+            }
+        }
+        else if (!add_redirection(env, err, vars, command, token))
         {
-            command->stdout_file = strdup(exp.we_wordv[0]);
-            wordfree(&exp);
+            syntax_error = lexer_operator(token->redirect);
         }
-        else
+    }
+
+    return syntax_error;
+}
+
+static void add_words(const struct dc_posix_env *env, struct dc_error *err, const struct vars *vars,
+                      struct command *command, size_t *capacity, const struct token *token)
+{
+    struct expansion expansion;
+
+    if (!token->expand)
+    {
+        add_word(env, err, command, capacity, arena_strdup(env, err, command->arena, token->text));
+        return;
+    }
+
+    // the expansions the lexer does not do (~, $VAR and globs) start again from the word as it was typed
+    command->expanded = true;
+    dc_memset(env, &expansion, 0, sizeof(struct expansion));
+    expand_word(env, err, command->arena, vars, token->raw, token->raw_length, &expansion);
+
+    for (size_t i = 0; i < expansion.count; ++i)
+    {
+        add_word(env, err, command, capacity, expansion.words[i]);
+    }
+
+    arena_free(command->arena, expansion.words);
+}
+
+static bool add_assignment(const struct dc_posix_env *env, struct dc_error *err, const struct vars *vars,
+                           struct command *command, const struct token *token)
+{
+    const char *raw;
+    size_t name_length;
+    char *value;
+    char *assignment;
+    char **assignments;
+
+    raw         = token->raw;
+    name_length = assignment_name_length(raw, token->raw_length);
+
+    if (name_length == 0)
+    {
+        return false;
+    }
+
+    // the lexer only marks a ~ at the start of a word, in an assignment it starts the value
+    if (token->expand || raw[name_length + 1] == '~')
+    {
+        command->expanded = true;
+        value = expand_assignment(env, err, command->arena, vars, &raw[name_length + 1],
+                                  token->raw_length - name_length - 1);
+    }
+    else
+    {
+        // the name has no quotes, so the text without them starts with the same NAME=
+        value = arena_strdup(env, err, command->arena, &token->text[name_length + 1]);
+    }
+
+    assignment = arena_strndup(env, err, command->arena, raw, name_length + 1);
+
+    if (dc_error_has_no_error(err))
+    {
+        assignment = join_text(env, err, command->arena, assignment, "", value);
+    }
+
+    arena_free(command->arena, value);
+    assignments = arena_realloc(env, err, command->arena, command->assignments,
+                                command->assignment_count * sizeof(char *),
+                                (command->assignment_count + 1) * sizeof(char *));
+
+    if (dc_error_has_error(err))
+    {
+        arena_free(command->arena, assignment);
+        return true;
+    }
+
+    assignments[command->assignment_count++] = assignment;
+    command->assignments                     = assignments;
+
+    return true;
+}
+
+static void add_word(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                     size_t *capacity, char *word)
+{
+    if (dc_error_has_error(err))
+    {
+        arena_free(command->arena, word);
+        return;
+    }
+
+    if (command->command == NULL)
+    {
+        command->command = word;
+        command->argc    = 1;
+        return;
+    }
+
+    // room for the word and the NULL after it
+    if (command->argc + 2 > *capacity)
+    {
+        char **argv;
+
+        argv = arena_realloc(env, err, command->arena, command->argv, *capacity * sizeof(char *),
+                             *capacity * 2 * sizeof(char *));
+
+        if (dc_error_has_error(err))
         {
-            state->fatal_error = true;
+            arena_free(command->arena, word);
+            return;
         }
-        free(str2);
-        free(str);
+
+        dc_memset(env, &argv[*capacity], 0, *capacity * sizeof(char *));
+        command->argv = argv;
+        *capacity    *= 2;
     }
 
-    matched = regexec(state->in_redirect_regex,
-                      string,
-                      1,
-                      &match,
-                      0);
+    command->argv[command->argc++] = word;
+}
+
+static bool add_redirection(const struct dc_posix_env *env, struct dc_error *err, const struct vars *vars,
+                            struct command *command, const struct token *token)
+{
+    char *name;
 
-    if (matched == 0)
+    name = NULL;
+
+    // the delimiter of a here-document is never expanded
+    if (token->redirect == REDIRECT_HEREDOC || token->redirect == REDIRECT_HEREDOC_TAB)
     {
-        char *str2;
-        char *str;
-        wordexp_t exp;
-        int status;
-        size_t size;
-        // Offset of the first character of the stdin file name from the start. " <"
-        size_t offset = 2;
+        add_heredoc(env, err, command, token);
+        return true;
+    }
 
-        regoff_t length = match.rm_eo - match.rm_so;
+    if (token->expand)
+    {
+        struct expansion expansion;
 
-        str = malloc(length + 1);
-        strncpy(str, &string[match.rm_so], length);
-        string[match.rm_so] = '\0';
-        str[length] = '\0';
+        command->expanded = true;
+        dc_memset(env, &expansion, 0, sizeof(struct expansion));
+        expand_word(env, err, command->arena, vars, token->raw, token->raw_length, &expansion);
 
-        size = length - offset;
-        str2 = dc_malloc(env, err, sizeof(char) * size);
-        strncpy(str2, &str[offset], size);
-        str2[size] = '\0';
-        // wordexp
-        status = wordexp(str2, &exp, 0);
-        if (status == 0)
+        // only the first word counts if the file name expands to more than one, a here-string keeps them all
+        for (size_t i = 0; i < expansion.count; ++i)
         {
-            command->stdin_file = strdup(exp.we_wordv[0]);
-            wordfree(&exp);
+            if (i == 0)
+            {
+                name = expansion.words[i];
+            }
+            else if (token->redirect == REDIRECT_HERESTRING)
+            {
+                name = join_text(env, err, command->arena, name, " ", expansion.words[i]);
+                arena_free(command->arena, expansion.words[i]);
+            }
+            else
+            {
+                arena_free(command->arena, expansion.words[i]);
+            }
+        }
+
+        arena_free(command->arena, expansion.words);
+    }
+
+    if (name == NULL)
+    {
+        name = arena_strdup(env, err, command->arena, token->text);
+    }
+
+    if (dc_error_has_error(err))
+    {
+        return true;
+    }
+
+    switch (token->redirect)
+    {
+        case REDIRECT_IN:
+            append_redirection(env, err, command, REDIRECTION_READ, token->fd, -1, name);
+            break;
+        case REDIRECT_OUT:
+            append_redirection(env, err, command, REDIRECTION_WRITE, token->fd, -1, name);
+            break;
+        case REDIRECT_APPEND:
+            append_redirection(env, err, command, REDIRECTION_APPEND, token->fd, -1, name);
+            break;
+        case REDIRECT_IN_OUT:
+            append_redirection(env, err, command, REDIRECTION_READ_WRITE, token->fd, -1, name);
+            break;
+        case REDIRECT_HERESTRING:
+            name = join_text(env, err, command->arena, name, "", "\n");
+            append_redirection(env, err, command, REDIRECTION_HEREDOC, token->fd, -1, name);
+            break;
+        case REDIRECT_OUT_ERR:
+        case REDIRECT_APPEND_ERR:
+            add_out_err(env, err, command, token->redirect == REDIRECT_APPEND_ERR, name);
+            break;
+        case REDIRECT_DUP_IN:
+        case REDIRECT_DUP_OUT:
+            if (!is_dup_target(token->redirect, token->fd, name))
+            {
+                arena_free(command->arena, name);
+                return false;
+            }
+
+            if (dc_strcmp(env, name, "-") == 0)
+            {
+                append_redirection(env, err, command, REDIRECTION_CLOSE, token->fd, -1, NULL);
+            }
+            else if (is_descriptor(name))
+            {
+                append_redirection(env, err, command, REDIRECTION_DUP, token->fd, atoi(name), NULL);
+            }
+            else
+            {
+                // >& file is an old way of writing &> file
+                add_out_err(env, err, command, false, name);
+            }
+            break;
+        case REDIRECT_HEREDOC:
+        case REDIRECT_HEREDOC_TAB:
+        default:
+            break;
+    }
+
+    arena_free(command->arena, name);
+
+    return true;
+}
+
+static void add_out_err(const struct dc_posix_env *env, struct dc_error *err, struct command *command, bool append,
+                        const char *file)
+{
+    append_redirection(env, err, command, append ? REDIRECTION_APPEND : REDIRECTION_WRITE, STDOUT_FILENO, -1, file);
+    append_redirection(env, err, command, REDIRECTION_DUP, STDERR_FILENO, STDOUT_FILENO, NULL);
+}
+
+static void add_heredoc(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                        const struct token *token)
+{
+    struct redirection *redirection;
+
+    append_redirection(env, err, command, REDIRECTION_HEREDOC, token->fd, -1, NULL);
+
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    // the body comes from the lines after this one, so the line can not be cached on its own
+    command->expanded       = true;
+    redirection             = &command->redirections[command->redirection_count - 1];
+    redirection->delimiter  = arena_strdup(env, err, command->arena, token->text);
+    redirection->strip_tabs = token->redirect == REDIRECT_HEREDOC_TAB;
+
+    // any quoting in the delimiter, even 'EOF' or E\OF, turns off expansion of the body
+    for (size_t i = 0; i < token->raw_length && !redirection->literal; ++i)
+    {
+        redirection->literal = token->raw[i] == '\'' || token->raw[i] == '"' || token->raw[i] == '\\';
+    }
+}
+
+static char *join_text(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, char *first,
+                       const char *separator, const char *second)
+{
+    size_t first_length;
+    size_t separator_length;
+    size_t second_length;
+    char *joined;
+
+    first_length     = dc_strlen(env, first);
+    separator_length = dc_strlen(env, separator);
+    second_length    = dc_strlen(env, second);
+    joined           = arena_alloc(env, err, arena, first_length + separator_length + second_length + 1);
+
+    if (dc_error_has_error(err))
+    {
+        return first;
+    }
+
+    dc_memcpy(env, joined, first, first_length);
+    dc_memcpy(env, &joined[first_length], separator, separator_length);
+    dc_memcpy(env, &joined[first_length + separator_length], second, second_length + 1);
+    arena_free(arena, first);
+
+    return joined;
+}
+
+bool read_heredocs(const struct dc_posix_env *env, struct dc_error *err, const struct vars *vars,
+                   struct command *command, struct input *input, struct editor *editor, FILE *prompt)
+{
+    bool complete;
+
+    complete = true;
+
+    for (size_t i = 0; i < command->redirection_count && dc_error_has_no_error(err); ++i)
+    {
+        struct redirection *redirection = &command->redirections[i];
+        char *body;
+        size_t length;
+        size_t body_capacity;
+        bool found;
+
+        if (redirection->delimiter == NULL)
+        {
+            continue;
+        }
+
+        body          = NULL;
+        length        = 0;
+        body_capacity = 0;
+        found         = false;
+
+        while (!found && dc_error_has_no_error(err))
+        {
+            const char *text;
+            size_t text_length;
+
+            // the editor reads ahead of the line it returns (eg. a pasted body), so the rest has to come from it too
+            if (editor)
+            {
+                text = editor_read_line(env, err, editor, "> ", &text_length);
+            }
+            else
+            {
+                if (prompt)
+                {
+                    fputs("> ", prompt);
+                    fflush(prompt);
+                }
+
+                text = input_read_line(env, err, input, &text_length);
+            }
+
+            if (text == NULL)
+            {
+                break;
+            }
+
+            while (redirection->strip_tabs && *text == '\t')
+            {
+                ++text;
+                --text_length;
+            }
+
+            if (dc_strncmp(env, text, redirection->delimiter, text_length) == 0 &&
+                redirection->delimiter[text_length] == '\0')
+            {
+                found = true;
+                continue;
+            }
+
+            if (length + text_length + 2 > body_capacity)
+            {
+                char *grown;
+
+                body_capacity = body_capacity == 0 ? 256 : body_capacity;
+
+                while (length + text_length + 2 > body_capacity)
+                {
+                    body_capacity *= 2;
+                }
+
+                grown = dc_realloc(env, err, body, body_capacity);
+
+                if (dc_error_has_error(err))
+                {
+                    break;
+                }
+
+                body = grown;
+            }
+
+            dc_memcpy(env, &body[length], text, text_length);
+            length += text_length;
+            body[length++] = '\n';
+            body[length]   = '\0';
+        }
+
+        complete = complete && found;
+
+        // a command kept by lex_command expands the body when it expands its words
+        if (redirection->literal || command->tokens)
+        {
+            redirection->file = arena_strndup(env, err, command->arena, body ? body : "", length);
         }
         else
         {
-            state->fatal_error = true;
+            redirection->file = expand_text(env, err, command->arena, vars, body ? body : "", length);
         }
-        free(str2);
-        free(str);
+
+        arena_free(command->arena, redirection->delimiter);
+        redirection->delimiter = NULL;
+        free(body);
     }
 
-    status_main = wordexp(string, &exp_main, 0);
-    if (status_main == 0)
+    return complete;
+}
+
+static bool is_descriptor(const char *word)
+{
+    size_t length;
+
+    length = strspn(word, "0123456789");
+
+    // longer than this is too big to be a descriptor anyway
+    return length > 0 && length < 6 && word[length] == '\0';
+}
+
+static bool is_dup_target(enum redirect_type redirect, int fd, const char *word)
+{
+    if (redirect != REDIRECT_DUP_IN && redirect != REDIRECT_DUP_OUT)
+    {
+        return true;
+    }
+
+    return strcmp(word, "-") == 0 || is_descriptor(word) || (redirect == REDIRECT_DUP_OUT && fd == STDOUT_FILENO);
+}
+
+static size_t assignment_name_length(const char *raw, size_t raw_length)
+{
+    size_t name_length;
+
+    // the name is as it was typed, a quote anywhere in it makes the word an ordinary one
+    if (raw_length == 0 || !(isalpha((unsigned char)raw[0]) || raw[0] == '_'))
     {
-        command->argc = exp_main.we_wordc;
-        command->argv = dc_calloc(env, err, (exp_main.we_wordc + 2), sizeof(char *));
+        return 0;
+    }
+
+    for (name_length = 1; name_length < raw_length && (isalnum((unsigned char)raw[name_length]) ||
+                                                      raw[name_length] == '_'); ++name_length)
+    {
+    }
 
-        for (size_t i = 1; i < exp_main.we_wordc; ++i)
+    if (name_length == raw_length || raw[name_length] != '=')
+    {
+        return 0;
+    }
+
+    return name_length;
+}
+
+void append_redirection(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                        enum redirection_type type, int fd, int source_fd, const char *file)
+{
+    struct redirection *redirections;
+    struct redirection *redirection;
+
+    redirections = arena_realloc(env, err, command->arena, command->redirections,
+                                 command->redirection_count * sizeof(struct redirection),
+                                 (command->redirection_count + 1) * sizeof(struct redirection));
+
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    command->redirections  = redirections;
+    redirection            = &redirections[command->redirection_count];
+    redirection->type       = type;
+    redirection->fd         = fd;
+    redirection->source_fd  = type == REDIRECTION_DUP ? source_fd : -1;
+    redirection->file       = file ? arena_strdup(env, err, command->arena, file) : NULL;
+    redirection->delimiter  = NULL;
+    redirection->strip_tabs = false;
+    redirection->literal    = false;
+
+    if (dc_error_has_no_error(err))
+    {
+        command->redirection_count++;
+    }
+}
+
+struct command *separate_line(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                              const char *line, size_t *count, const char **syntax_error)
+{
+    struct command *commands;
+    const char *start;
+    const char *end;
+    const char *c;
+
+    if (!sets_ready)
+    {
+        scan_set_init(&separator_set, "|&;'\"\\", 6);
+        scan_set_init(&double_quote_set, "\"\\", 2);
+        sets_ready = true;
+    }
+
+    commands      = NULL;
+    *count        = 0;
+    *syntax_error = NULL;
+    start         = line;
+    end           = line + dc_strlen(env, line);
+
+    // only these characters separate commands or hide a separator, everything between them is skipped at once
+    for (c = line; (c += scan_span(&separator_set, c, (size_t)(end - c))) < end;)
+    {
+        if (*c == '\'' || *c == '"')
+        {
+            c = skip_quoted(c, end);
+            continue;
+        }
+
+        if (*c == '\\' && c[1])
+        {
+            ++c;
+        }
+        else if ((*c == '|' && c[1] == '|') || (*c == '&' && c[1] == '&'))
+        {
+            enum command_connector connector = *c == '|' ? CONNECTOR_OR : CONNECTOR_AND;
+
+            if (!add_command(env, err, arena, &commands, count, start, (size_t)(c - start), connector))
+            {
+                *syntax_error = connector == CONNECTOR_OR ? "||" : "&&";
+                break;
+            }
+            ++c;
+            start = c + 1;
+        }
+        else if (*c == ';')
+        {
+            if (!add_command(env, err, arena, &commands, count, start, (size_t)(c - start), CONNECTOR_SEQUENCE))
+            {
+                *syntax_error = ";";
+                break;
+            }
+            start = c + 1;
+        }
+        else if (*c == '|')
+        {
+            if (!add_command(env, err, arena, &commands, count, start, (size_t)(c - start), CONNECTOR_PIPE))
+            {
+                *syntax_error = "|";
+                break;
+            }
+            start = c + 1;
+        }
+        else if (*c == '&' && c[1] == '>')
         {
-            command->argv[i] = strdup(exp_main.we_wordv[i]);
+            // &> redirects stdout and stderr, it is not a background job
+            ++c;
         }
-        command->command = strdup(exp_main.we_wordv[0]);
-        wordfree(&exp_main);
+        else if (*c == '&' && c > line && (c[-1] == '>' || c[-1] == '<'))
+        {
+            // 2>&1
+        }
+        else if (*c == '&')
+        {
+            if (!add_command(env, err, arena, &commands, count, start, (size_t)(c - start), CONNECTOR_BACKGROUND))
+            {
+                *syntax_error = "&";
+                break;
+            }
+            start = c + 1;
+        }
+        ++c;
     }
-    else
+
+    // "ls |" and "ls &&" are missing a command, "ls &" and "ls ;" are not, and an empty line on its own is not an error
+    if (*syntax_error == NULL && dc_error_has_no_error(err) &&
+        !add_command(env, err, arena, &commands, count, start, (size_t)(end - start), CONNECTOR_NONE) && *count > 0 &&
+        (commands[*count - 1].connector == CONNECTOR_PIPE || commands[*count - 1].connector == CONNECTOR_AND ||
+         commands[*count - 1].connector == CONNECTOR_OR))
+    {
+        *syntax_error = "newline";
+    }
+
+    if (*syntax_error || dc_error_has_error(err))
+    {
+        for (size_t i = 0; i < *count; ++i)
+        {
+            destroy_command(env, &commands[i]);
+        }
+        arena_free(arena, commands);
+        commands = NULL;
+        *count   = 0;
+    }
+
+    return commands;
+}
+
+static const char *skip_quoted(const char *c, const char *end)
+{
+    const char *close;
+
+    if (*c == '\'')
     {
-        state->fatal_error = true;
+        close = memchr(c + 1, '\'', (size_t)(end - c - 1));
+
+        return close ? close + 1 : end;
+    }
+
+    close = c + 1;
+
+    while ((close += scan_span(&double_quote_set, close, (size_t)(end - close))) < end)
+    {
+        if (*close == '"')
+        {
+            return close + 1;
+        }
+
+        // \ quotes the next character inside "..." too
+        close += close + 1 < end ? 2 : 1;
     }
 
-    free(string);
+    return end;
+}
+
+static bool add_command(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                        struct command **commands, size_t *count, const char *start, size_t length,
+                        enum command_connector connector)
+{
+    struct command *resized;
+    struct command *command;
+
+    while (length > 0 && isspace((unsigned char)*start))
+    {
+        ++start;
+        --length;
+    }
+
+    while (length > 0 && isspace((unsigned char)start[length - 1]))
+    {
+        --length;
+    }
+
+    if (length == 0)
+    {
+        return false;
+    }
+
+    resized = arena_realloc(env, err, arena, *commands, *count * sizeof(struct command),
+                            (*count + 1) * sizeof(struct command));
+
+    if (dc_error_has_error(err))
+    {
+        return true;
+    }
+
+    *commands = resized;
+    command   = &resized[*count];
+    dc_memset(env, command, 0, sizeof(struct command));
+    command->arena = arena;
+    command->line  = arena_strndup(env, err, arena, start, length);
+
+    if (dc_error_has_error(err))
+    {
+        return true;
+    }
+
+    command->connector = connector;
+    (*count)++;
+
+    return true;
 }
 
 void destroy_command(const struct dc_posix_env *env, struct command *command)
 {
     if (command)
     {
-        free(command->line);
+        arena_free(command->arena, command->line);
         command->line = NULL;
 
-        free(command->command);
+        arena_free(command->arena, command->command);
         command->command = NULL;
 
         for (size_t i = 0; i < command->argc; ++i)
         {
-            free(command->argv[i]);
+            arena_free(command->arena, command->argv[i]);
             command->argv[i] = NULL;
         }
 
-        free(command->argv);
+        arena_free(command->arena, command->argv);
         command->argv = NULL;
 
         command->argc = 0;
-        free(command->stdin_file);
-        command->stdin_file = NULL;
+        for (size_t i = 0; i < command->redirection_count; ++i)
+        {
+            arena_free(command->arena, command->redirections[i].file);
+            arena_free(command->arena, command->redirections[i].delimiter);
+        }
 
-        free(command->stdout_file);
-        command->stdout_file = NULL;
+        arena_free(command->arena, command->redirections);
+        command->redirections      = NULL;
+        command->redirection_count = 0;
 
-        free(command->stderr_file);
-        command->stderr_file = NULL;
+        for (size_t i = 0; i < command->assignment_count; ++i)
+        {
+            arena_free(command->arena, command->assignments[i]);
+        }
 
-        command->stdout_overwrite = false;
-        command->stderr_overwrite = false;
+        arena_free(command->arena, command->assignments);
+        command->assignments      = NULL;
+        command->assignment_count = 0;
+        arena_free(command->arena, command->tokens);
+        arena_free(command->arena, command->token_text);
+        command->tokens      = NULL;
+        command->token_count = 0;
+        command->token_text  = NULL;
+        command->envp             = NULL;
+        dc_memset(env, &command->rusage, 0, sizeof(struct rusage));
+        command->connector = CONNECTOR_NONE;
     }
 }
@@ -0,0 +1,1030 @@
+// d_type is a BSD extension, it saves a stat for most names
+#define _DEFAULT_SOURCE
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <dc_posix/dc_stdlib.h>
+#include "builtins.h"
+#include "completion.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+// the changes that add, remove or rename a name in a directory, or make a file executable, or remove the directory
+#define COMPLETION_WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_DELETE_SELF | \
+                               IN_MOVE_SELF | IN_ONLYDIR)
+
+// past this many bytes of changed names reading the whole directory again is cheaper than a stat for each
+#define COMPLETION_CHANGED_MAX 65536
+
+/**
+ * Set up a directory slot.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param dir the slot.
+ * @param path the directory, copied.
+ * @param executables true to keep only executable files.
+ */
+static void init_dir(const struct dc_posix_env *env, struct dc_error *err, struct completion_dir *dir,
+                     const char *path, bool executables);
+
+/**
+ * Free what a directory slot holds, stop watching the directory and leave the slot unused.
+ *
+ * @param completion the completion lists.
+ * @param dir the slot.
+ */
+static void free_dir(const struct completion *completion, struct completion_dir *dir);
+
+/**
+ * Use the pending inotify events, without waiting for any: record the names that changed in each directory,
+ * or mark it stale when the directory itself changed.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param completion the completion lists.
+ */
+static void drain_events(const struct dc_posix_env *env, struct dc_error *err, struct completion *completion);
+
+/**
+ * Record a name inotify reported a change to, so it is looked up again before the next completion.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param dir the directory.
+ * @param name the name.
+ */
+static void record_change(const struct dc_posix_env *env, struct dc_error *err, struct completion_dir *dir,
+                          const char *name);
+
+/**
+ * Bring a directory's names up to date before a completion.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param completion the completion lists.
+ * @param dir the directory.
+ * @return true if the names changed.
+ */
+static bool refresh_dir(const struct dc_posix_env *env, struct dc_error *err, struct completion *completion,
+                        struct completion_dir *dir);
+
+/**
+ * Check whether a directory has to be read again.
+ *
+ * @param completion the completion lists.
+ * @param dir the directory.
+ * @return true if it changed since it was read.
+ */
+static bool is_stale(const struct completion *completion, struct completion_dir *dir);
+
+/**
+ * Read the names in a directory, after watching it so a change made while it is read is not missed.
+ * A directory that cannot be read has no names.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param completion the completion lists.
+ * @param dir the directory.
+ */
+static void read_dir(const struct dc_posix_env *env, struct dc_error *err, struct completion *completion,
+                     struct completion_dir *dir);
+
+/**
+ * Look up again the names that changed in a directory, removing each from the sorted names and inserting
+ * it again if it is still kept. The directory is read again if the block of names is full.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param completion the completion lists.
+ * @param dir the directory.
+ */
+static void update_names(const struct dc_posix_env *env, struct dc_error *err, struct completion *completion,
+                         struct completion_dir *dir);
+
+/**
+ * Decide whether a name in a directory is kept, and whether it is a directory.
+ *
+ * @param dir the directory being read.
+ * @param fd the open directory.
+ * @param name the name.
+ * @param type the type readdir gave the name, DT_UNKNOWN if there is none.
+ * @param is_directory set to true if the name is a directory.
+ * @return true if the name is kept.
+ */
+static bool keep_name(const struct completion_dir *dir, int fd, const char *name, unsigned char type,
+                      bool *is_directory);
+
+/**
+ * Remove a name (or the directory with that name) from a directory's sorted names, if it is there.
+ *
+ * @param dir the directory.
+ * @param name the name.
+ */
+static void remove_name(struct completion_dir *dir, const char *name);
+
+/**
+ * Add a name to a directory's block of names and insert it in the sorted names, if the block has room for it.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param dir the directory.
+ * @param name the name.
+ * @param is_directory true to put a / after it.
+ * @return false if the block is full (it cannot grow without moving the names the sorted names point at).
+ */
+static bool insert_name(const struct dc_posix_env *env, struct dc_error *err, struct completion_dir *dir,
+                        const char *name, bool is_directory);
+
+/**
+ * Append a name to a directory's block of names.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param dir the directory.
+ * @param name the name.
+ * @param is_directory true to put a / after it.
+ */
+static void add_name(const struct dc_posix_env *env, struct dc_error *err, struct completion_dir *dir,
+                     const char *name, bool is_directory);
+
+/**
+ * Point sorted at every name in the block and sort them.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param dir the directory.
+ */
+static void sort_names(const struct dc_posix_env *env, struct dc_error *err, struct completion_dir *dir);
+
+/**
+ * Merge the sorted builtins and the sorted names of every PATH directory into one sorted list with each name once.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param completion the completion lists.
+ */
+static void merge_commands(const struct dc_posix_env *env, struct dc_error *err, struct completion *completion);
+
+/**
+ * Find the sorted names that start with a prefix, with two binary searches.
+ *
+ * @param names the sorted names.
+ * @param count the number of names.
+ * @param prefix the prefix.
+ * @param length the length of the prefix.
+ * @param first set to the first name found.
+ * @return the number of names found.
+ */
+static size_t find_prefix(const char **names, size_t count, const char *prefix, size_t length, size_t *first);
+
+/**
+ * Find where a name is, or would go, in sorted names.
+ *
+ * @param names the sorted names.
+ * @param count the number of names.
+ * @param name the name.
+ * @param position set to the position of the name, or of the first name after it.
+ * @return true if the name is there.
+ */
+static bool find_name(const char **names, size_t count, const char *name, size_t *position);
+
+/**
+ * Order names for qsort.
+ *
+ * @param a a const char *.
+ * @param b a const char *.
+ * @return the order.
+ */
+static int compare_names(const void *a, const void *b);
+
+struct completion *completion_create(const struct dc_posix_env *env, struct dc_error *err, char **path)
+{
+    struct completion *completion;
+    size_t count;
+
+    completion = dc_calloc(env, err, 1, sizeof(struct completion));
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    // without inotify the directories' modification times are checked instead
+#ifdef __linux__
+    completion->inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#else
+    completion->inotify = -1;
+#endif
+    completion->files.watch = -1;
+
+    for (count = 0; builtin_at(count); ++count)
+    {
+    }
+
+    completion->builtins = dc_malloc(env, err, (count + 1) * sizeof(const char *));
+
+    if (dc_error_has_error(err))
+    {
+        completion_destroy(env, &completion);
+        return NULL;
+    }
+
+    // exit is not in the builtin table, the shell ends rather than running it
+    completion->builtins[0] = "exit";
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        completion->builtins[i + 1] = builtin_at(i)->name;
+    }
+
+    completion->builtin_count = count + 1;
+    qsort(completion->builtins, completion->builtin_count, sizeof(const char *), compare_names);
+    completion_set_path(env, err, completion, path);
+
+    if (dc_error_has_error(err))
+    {
+        completion_destroy(env, &completion);
+        return NULL;
+    }
+
+    return completion;
+}
+
+void completion_destroy(const struct dc_posix_env *env, struct completion **pcompletion)
+{
+    struct completion *completion;
+
+    (void)env;
+    completion = *pcompletion;
+
+    if (completion)
+    {
+        for (size_t i = 0; i < completion->dir_count; ++i)
+        {
+            free_dir(completion, &completion->dirs[i]);
+        }
+
+        free_dir(completion, &completion->files);
+
+        if (completion->inotify != -1)
+        {
+            close(completion->inotify);
+        }
+
+        free(completion->dirs);
+        free(completion->builtins);
+        free(completion->commands);
+        free(completion->found);
+        free(completion);
+    }
+
+    *pcompletion = NULL;
+}
+
+void completion_set_path(const struct dc_posix_env *env, struct dc_error *err, struct completion *completion,
+                         char **path)
+{
+    size_t count;
+
+    for (size_t i = 0; i < completion->dir_count; ++i)
+    {
+        free_dir(completion, &completion->dirs[i]);
+    }
+
+    free(completion->dirs);
+    completion->dirs           = NULL;
+    completion->dir_count      = 0;
+    completion->command_count  = 0;
+    completion->commands_stale = true;
+
+    for (count = 0; path && path[count]; ++count)
+    {
+    }
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    completion->dirs = dc_calloc(env, err, count, sizeof(struct completion_dir));
+
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < count && dc_error_has_no_error(err); ++i)
+    {
+        init_dir(env, err, &completion->dirs[i], path[i], true);
+        completion->dir_count++;
+    }
+}
+
+size_t completion_commands(const struct dc_posix_env *env, struct dc_error *err, struct completion *completion,
+                           const char *prefix, size_t length, const char *const **matches)
+{
+    size_t first;
+    size_t count;
+
+    drain_events(env, err, completion);
+
+    for (size_t i = 0; i < completion->dir_count && dc_error_has_no_error(err); ++i)
+    {
+        if (refresh_dir(env, err, completion, &completion->dirs[i]))
+        {
+            completion->commands_stale = true;
+        }
+    }
+
+    if (completion->commands_stale && dc_error_has_no_error(err))
+    {
+        merge_commands(env, err, completion);
+    }
+
+    if (dc_error_has_error(err))
+    {
+        return 0;
+    }
+
+    count    = find_prefix(completion->commands, completion->command_count, prefix, length, &first);
+    *matches = &completion->commands[first];
+
+    return count;
+}
+
+size_t completion_files(const struct dc_posix_env *env, struct dc_error *err, struct completion *completion,
+                        const char *directory, const char *prefix, size_t length, const char *const **matches)
+{
+    struct completion_dir *dir;
+    struct stat status;
+    size_t first;
+    size_t count;
+    size_t found;
+
+    dir = &completion->files;
+    drain_events(env, err, completion);
+
+    // a relative directory names another one after cd, so the slot is only reused for the same inode
+    if (dir->path == NULL || strcmp(dir->path, directory) != 0 || stat(directory, &status) == -1 ||
+        status.st_dev != dir->dev || status.st_ino != dir->ino)
+    {
+        free_dir(completion, dir);
+        init_dir(env, err, dir, directory, false);
+    }
+
+    if (dc_error_has_no_error(err))
+    {
+        refresh_dir(env, err, completion, dir);
+    }
+
+    if (dc_error_has_error(err))
+    {
+        return 0;
+    }
+
+    count = find_prefix(dir->sorted, dir->count, prefix, length, &first);
+
+    if (completion->found_capacity < count)
+    {
+        const char **grown;
+
+        grown = dc_realloc(env, err, completion->found, count * sizeof(const char *));
+
+        if (dc_error_has_error(err))
+        {
+            return 0;
+        }
+
+        completion->found          = grown;
+        completion->found_capacity = count;
+    }
+
+    found = 0;
+
+    // like ls, the hidden names are left out unless the dot is typed
+    for (size_t i = first; i < first + count; ++i)
+    {
+        if (dir->sorted[i][0] != '.' || (length > 0 && prefix[0] == '.'))
+        {
+            completion->found[found++] = dir->sorted[i];
+        }
+    }
+
+    *matches = completion->found;
+
+    return found;
+}
+
+static void init_dir(const struct dc_posix_env *env, struct dc_error *err, struct completion_dir *dir,
+                     const char *path, bool executables)
+{
+    memset(dir, 0, sizeof(struct completion_dir));
+    dir->watch       = -1;
+    dir->stale       = true;
+    dir->executables = executables;
+    dir->path        = dc_malloc(env, err, strlen(path) + 1);
+
+    if (dc_error_has_no_error(err))
+    {
+        strcpy(dir->path, path);
+    }
+}
+
+static void free_dir(const struct completion *completion, struct completion_dir *dir)
+{
+#ifdef __linux__
+    if (dir->watch != -1)
+    {
+        inotify_rm_watch(completion->inotify, dir->watch);
+    }
+#else
+    (void)completion;
+#endif
+
+    free(dir->path);
+    free(dir->changed);
+    free(dir->names);
+    free(dir->sorted);
+    memset(dir, 0, sizeof(struct completion_dir));
+    dir->watch = -1;
+}
+
+static void drain_events(const struct dc_posix_env *env, struct dc_error *err, struct completion *completion)
+{
+#ifdef __linux__
+    union
+    {
+        struct inotify_event event;
+        char bytes[4096];
+    } buffer;
+    ssize_t count;
+
+    if (completion->inotify == -1)
+    {
+        return;
+    }
+
+    while ((count = read(completion->inotify, buffer.bytes, sizeof(buffer.bytes))) > 0)
+    {
+        for (ssize_t offset = 0; offset < count;)
+        {
+            const struct inotify_event *event;
+
+            event   = (const struct inotify_event *)(const void *)&buffer.bytes[offset];
+            offset += (ssize_t)(sizeof(struct inotify_event) + event->len);
+
+            // events were lost, any directory may have changed
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                for (size_t i = 0; i < completion->dir_count; ++i)
+                {
+                    completion->dirs[i].stale = true;
+                }
+
+                completion->files.stale = true;
+                continue;
+            }
+
+            for (size_t i = 0; i <= completion->dir_count; ++i)
+            {
+                struct completion_dir *dir;
+
+                dir = i < completion->dir_count ? &completion->dirs[i] : &completion->files;
+
+                if (dir->watch != event->wd)
+                {
+                    continue;
+                }
+
+                // a name in the directory changed, otherwise the directory itself did
+                if (event->len > 0)
+                {
+                    record_change(env, err, dir, event->name);
+                }
+                else
+                {
+                    dir->stale = true;
+                }
+
+                // the directory was removed, the kernel dropped the watch
+                if (event->mask & IN_IGNORED)
+                {
+                    dir->watch = -1;
+                }
+            }
+        }
+    }
+#else
+    (void)env;
+    (void)err;
+    (void)completion;
+#endif
+}
+
+static void record_change(const struct dc_posix_env *env, struct dc_error *err, struct completion_dir *dir,
+                          const char *name)
+{
+    size_t length;
+
+    // the whole directory is read again anyway
+    if (dir->stale)
+    {
+        return;
+    }
+
+    length = strlen(name);
+
+    if (dir->changed_size + length + 1 > COMPLETION_CHANGED_MAX)
+    {
+        dir->stale        = true;
+        dir->changed_size = 0;
+        return;
+    }
+
+    // a new file usually comes as a create then an attrib (or a modify) for the same name
+    if (dir->changed_size > 0)
+    {
+        size_t last;
+
+        for (last = dir->changed_size - 1; last > 0 && dir->changed[last - 1] != '\0'; --last)
+        {
+        }
+
+        if (strcmp(&dir->changed[last], name) == 0)
+        {
+            return;
+        }
+    }
+
+    if (dir->changed_size + length + 1 > dir->changed_capacity)
+    {
+        char *grown;
+        size_t capacity;
+
+        capacity = dir->changed_capacity ? dir->changed_capacity * 2 : 1024;
+        capacity = capacity < dir->changed_size + length + 1 ? COMPLETION_CHANGED_MAX : capacity;
+        grown    = dc_realloc(env, err, dir->changed, capacity);
+
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+
+        dir->changed          = grown;
+        dir->changed_capacity = capacity;
+    }
+
+    memcpy(&dir->changed[dir->changed_size], name, length + 1);
+    dir->changed_size += length + 1;
+}
+
+static bool refresh_dir(const struct dc_posix_env *env, struct dc_error *err, struct completion *completion,
+                        struct completion_dir *dir)
+{
+    if (is_stale(completion, dir))
+    {
+        read_dir(env, err, completion, dir);
+        return true;
+    }
+
+    if (dir->changed_size > 0)
+    {
+        update_names(env, err, completion, dir);
+        return true;
+    }
+
+    return false;
+}
+
+static bool is_stale(const struct completion *completion, struct completion_dir *dir)
+{
+    struct stat status;
+
+    if (dir->stale || completion->inotify != -1)
+    {
+        return dir->stale;
+    }
+
+    if (stat(dir->path, &status) == -1)
+    {
+        status.st_mtim.tv_sec  = -1;
+        status.st_mtim.tv_nsec = 0;
+    }
+
+    return status.st_mtim.tv_sec != dir->mtime.tv_sec || status.st_mtim.tv_nsec != dir->mtime.tv_nsec;
+}
+
+static void read_dir(const struct dc_posix_env *env, struct dc_error *err, struct completion *completion,
+                     struct completion_dir *dir)
+{
+    struct dirent *entry;
+    struct stat status;
+    DIR *stream;
+
+#ifdef __linux__
+    if (completion->inotify != -1 && dir->watch == -1)
+    {
+        dir->watch = inotify_add_watch(completion->inotify, dir->path, COMPLETION_WATCH_MASK);
+    }
+#endif
+
+    dir->names_size   = 0;
+    dir->count        = 0;
+    dir->changed_size = 0;
+    dir->mtime.tv_sec  = -1;
+    dir->mtime.tv_nsec = 0;
+
+    // a directory that is not there (yet) stays stale while it is not watched, it is tried again next time
+    dir->stale = completion->inotify != -1 && dir->watch == -1;
+    stream     = opendir(dir->path);
+
+    if (stream == NULL)
+    {
+        return;
+    }
+
+    if (fstat(dirfd(stream), &status) == 0)
+    {
+        dir->dev   = status.st_dev;
+        dir->ino   = status.st_ino;
+        dir->mtime = status.st_mtim;
+    }
+
+    while (dc_error_has_no_error(err) && (entry = readdir(stream)) != NULL)
+    {
+        bool is_directory;
+
+        if (keep_name(dir, dirfd(stream), entry->d_name, entry->d_type, &is_directory))
+        {
+            add_name(env, err, dir, entry->d_name, is_directory);
+        }
+    }
+
+    closedir(stream);
+    sort_names(env, err, dir);
+}
+
+static void update_names(const struct dc_posix_env *env, struct dc_error *err, struct completion *completion,
+                         struct completion_dir *dir)
+{
+    int fd;
+
+    fd = open(dir->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (fd == -1)
+    {
+        read_dir(env, err, completion, dir);
+        return;
+    }
+
+    for (size_t offset = 0; offset < dir->changed_size && dc_error_has_no_error(err);)
+    {
+        const char *name;
+        bool is_directory;
+
+        name    = &dir->changed[offset];
+        offset += strlen(name) + 1;
+        remove_name(dir, name);
+
+        if (keep_name(dir, fd, name, DT_UNKNOWN, &is_directory) && !insert_name(env, err, dir, name, is_directory))
+        {
+            close(fd);
+            read_dir(env, err, completion, dir);
+            return;
+        }
+    }
+
+    dir->changed_size = 0;
+    close(fd);
+}
+
+static bool keep_name(const struct completion_dir *dir, int fd, const char *name, unsigned char type,
+                      bool *is_directory)
+{
+    struct stat status;
+
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+    {
+        return false;
+    }
+
+    *is_directory = type == DT_DIR;
+
+    // a file's type is enough to list it, a program needs its mode and a link (or an unknown type) its target
+    if (type == DT_DIR || (!dir->executables && type == DT_REG))
+    {
+        return !dir->executables;
+    }
+
+    if (fstatat(fd, name, &status, 0) == -1)
+    {
+        // a link to nothing is still a name in the directory, a name that was removed is not
+        return !dir->executables && fstatat(fd, name, &status, AT_SYMLINK_NOFOLLOW) == 0;
+    }
+
+    *is_directory = S_ISDIR(status.st_mode);
+
+    if (dir->executables)
+    {
+        return S_ISREG(status.st_mode) && (status.st_mode & (S_IXUSR | S_IXGRP | S_IXOTH));
+    }
+
+    return true;
+}
+
+static void remove_name(struct completion_dir *dir, const char *name)
+{
+    char directory[NAME_MAX + 2];
+    size_t length;
+    size_t position;
+
+    length = strlen(name);
+
+    if (length > NAME_MAX)
+    {
+        return;
+    }
+
+    memcpy(directory, name, length);
+    directory[length]     = '/';
+    directory[length + 1] = '\0';
+
+    if (find_name(dir->sorted, dir->count, name, &position) ||
+        find_name(dir->sorted, dir->count, directory, &position))
+    {
+        // the name's bytes stay in the block until the directory is read again
+        memmove(&dir->sorted[position], &dir->sorted[position + 1], (dir->count - position - 1) * sizeof(const char *));
+        dir->count--;
+    }
+}
+
+static bool insert_name(const struct dc_posix_env *env, struct dc_error *err, struct completion_dir *dir,
+                        const char *name, bool is_directory)
+{
+    const char *added;
+    size_t position;
+
+    if (dir->names_size + strlen(name) + 2 > dir->names_capacity)
+    {
+        return false;
+    }
+
+    if (dir->sorted_capacity <= dir->count)
+    {
+        const char **grown;
+        size_t capacity;
+
+        capacity = dir->count * 2 + 16;
+        grown    = dc_realloc(env, err, dir->sorted, capacity * sizeof(const char *));
+
+        if (dc_error_has_error(err))
+        {
+            return true;
+        }
+
+        dir->sorted          = grown;
+        dir->sorted_capacity = capacity;
+    }
+
+    added = &dir->names[dir->names_size];
+    add_name(env, err, dir, name, is_directory);
+    find_name(dir->sorted, dir->count - 1, added, &position);
+    memmove(&dir->sorted[position + 1], &dir->sorted[position], (dir->count - 1 - position) * sizeof(const char *));
+    dir->sorted[position] = added;
+
+    return true;
+}
+
+static void add_name(const struct dc_posix_env *env, struct dc_error *err, struct completion_dir *dir,
+                     const char *name, bool is_directory)
+{
+    size_t length;
+
+    length = strlen(name);
+
+    if (dir->names_size + length + 2 > dir->names_capacity)
+    {
+        char *grown;
+        size_t capacity;
+
+        for (capacity = dir->names_capacity ? dir->names_capacity * 2 : 4096;
+             capacity < dir->names_size + length + 2; capacity *= 2)
+        {
+        }
+
+        grown = dc_realloc(env, err, dir->names, capacity);
+
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+
+        dir->names          = grown;
+        dir->names_capacity = capacity;
+    }
+
+    memcpy(&dir->names[dir->names_size], name, length);
+    dir->names_size += length;
+
+    if (is_directory)
+    {
+        dir->names[dir->names_size++] = '/';
+    }
+
+    dir->names[dir->names_size++] = '\0';
+    dir->count++;
+}
+
+static void sort_names(const struct dc_posix_env *env, struct dc_error *err, struct completion_dir *dir)
+{
+    size_t offset;
+
+    if (dir->sorted_capacity < dir->count)
+    {
+        const char **grown;
+
+        grown = dc_realloc(env, err, dir->sorted, dir->count * sizeof(const char *));
+
+        if (dc_error_has_error(err))
+        {
+            dir->count = 0;
+            return;
+        }
+
+        dir->sorted          = grown;
+        dir->sorted_capacity = dir->count;
+    }
+
+    // the block may have moved while it grew, so the pointers are only taken now
+    offset = 0;
+
+    for (size_t i = 0; i < dir->count; ++i)
+    {
+        dir->sorted[i] = &dir->names[offset];
+        offset        += strlen(dir->sorted[i]) + 1;
+    }
+
+    qsort(dir->sorted, dir->count, sizeof(const char *), compare_names);
+}
+
+static void merge_commands(const struct dc_posix_env *env, struct dc_error *err, struct completion *completion)
+{
+    size_t total;
+    size_t builtin;
+
+    total = completion->builtin_count;
+
+    for (size_t i = 0; i < completion->dir_count; ++i)
+    {
+        total                      += completion->dirs[i].count;
+        completion->dirs[i].cursor  = 0;
+    }
+
+    if (completion->command_capacity < total)
+    {
+        const char **grown;
+
+        grown = dc_realloc(env, err, completion->commands, total * sizeof(const char *));
+
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+
+        completion->commands         = grown;
+        completion->command_capacity = total;
+    }
+
+    completion->command_count = 0;
+    builtin                   = 0;
+
+    // every list is sorted already, so the next command is the least of the names at the front of the lists
+    for (;;)
+    {
+        struct completion_dir *from;
+        const char *next;
+
+        from = NULL;
+        next = builtin < completion->builtin_count ? completion->builtins[builtin] : NULL;
+
+        for (size_t i = 0; i < completion->dir_count; ++i)
+        {
+            struct completion_dir *dir;
+
+            dir = &completion->dirs[i];
+
+            if (dir->cursor < dir->count && (next == NULL || strcmp(dir->sorted[dir->cursor], next) < 0))
+            {
+                from = dir;
+                next = dir->sorted[dir->cursor];
+            }
+        }
+
+        if (next == NULL)
+        {
+            break;
+        }
+
+        if (from)
+        {
+            from->cursor++;
+        }
+        else
+        {
+            builtin++;
+        }
+
+        // a program in more than one directory (or with the name of a builtin) is completed once
+        if (completion->command_count == 0 || strcmp(completion->commands[completion->command_count - 1], next) != 0)
+        {
+            completion->commands[completion->command_count++] = next;
+        }
+    }
+
+    completion->commands_stale = false;
+}
+
+static size_t find_prefix(const char **names, size_t count, const char *prefix, size_t length, size_t *first)
+{
+    size_t low;
+    size_t high;
+    size_t end;
+
+    // the first name not before the prefix
+    for (low = 0, high = count; low < high;)
+    {
+        size_t middle;
+
+        middle = low + (high - low) / 2;
+
+        if (strncmp(names[middle], prefix, length) < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    *first = low;
+
+    // the first name after every name that starts with the prefix
+    for (end = count; low < end;)
+    {
+        size_t middle;
+
+        middle = low + (end - low) / 2;
+
+        if (strncmp(names[middle], prefix, length) <= 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            end = middle;
+        }
+    }
+
+    return end - *first;
+}
+
+static bool find_name(const char **names, size_t count, const char *name, size_t *position)
+{
+    size_t low;
+    size_t high;
+
+    for (low = 0, high = count; low < high;)
+    {
+        size_t middle;
+
+        middle = low + (high - low) / 2;
+
+        if (strcmp(names[middle], name) < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    *position = low;
+
+    return low < count && strcmp(names[low], name) == 0;
+}
+
+static int compare_names(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
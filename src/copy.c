@@ -0,0 +1,211 @@
+// copy_file_range and splice are Linux extensions
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_unistd.h>
+#include "copy.h"
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+#define COPY_CHUNK_SIZE (1 << 30)
+#define COPY_BUFFER_SIZE (128 * 1024)
+
+/**
+ * Move the next chunk from in_fd to out_fd in the kernel.
+ *
+ * @param in_fd the descriptor to copy from.
+ * @param out_fd the descriptor to copy to.
+ * @param method COPY_FILE_RANGE, COPY_SENDFILE or COPY_SPLICE.
+ * @return the number of bytes moved, 0 at the end of the input or -1 with errno set.
+ */
+static ssize_t copy_chunk(int in_fd, int out_fd, enum copy_method method);
+
+/**
+ * Check if the method cannot be used for the descriptors, so the next one should be tried.
+ *
+ * @param error the errno from the method.
+ * @return true if the error means the method is not supported for these descriptors.
+ */
+static bool unsupported(int error);
+
+/**
+ * Check if the copy has been interrupted.
+ *
+ * @param interrupted the flag, can be NULL.
+ * @return true if the flag is set.
+ */
+static bool stopped(const volatile sig_atomic_t *interrupted);
+
+/**
+ * Copy through a buffer in the shell.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param in_fd the descriptor to copy from.
+ * @param out_fd the descriptor to copy to.
+ * @param interrupted stop copying when it is set, can be NULL.
+ * @return the number of bytes copied.
+ */
+static off_t copy_read_write(const struct dc_posix_env *env, struct dc_error *err, int in_fd, int out_fd,
+                             const volatile sig_atomic_t *interrupted);
+
+off_t copy_fd(const struct dc_posix_env *env, struct dc_error *err, int in_fd, int out_fd, enum copy_method first,
+              enum copy_method *used, const volatile sig_atomic_t *interrupted)
+{
+    struct stat in_stat;
+    struct stat out_stat;
+    bool in_file;
+    bool any_pipe;
+    off_t total;
+
+    total = 0;
+
+    if (fstat(in_fd, &in_stat) == -1 || fstat(out_fd, &out_stat) == -1)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        return 0;
+    }
+
+    // Files in /proc and /sys claim to be empty, only the read/write loop sees their contents
+    in_file  = S_ISREG(in_stat.st_mode) && in_stat.st_size > 0;
+    any_pipe = S_ISFIFO(in_stat.st_mode) || S_ISFIFO(out_stat.st_mode);
+
+    for (enum copy_method method = first; method < COPY_READ_WRITE; ++method)
+    {
+        ssize_t moved;
+
+        if ((method == COPY_FILE_RANGE && !(in_file && S_ISREG(out_stat.st_mode))) ||
+            (method == COPY_SENDFILE && !in_file) ||
+            (method == COPY_SPLICE && !any_pipe))
+        {
+            continue;
+        }
+
+        do
+        {
+            // an interrupted copy ends as if the input had
+            moved = stopped(interrupted) ? 0 : copy_chunk(in_fd, out_fd, method);
+
+            if (moved > 0)
+            {
+                total += moved;
+            }
+        }
+        while (moved > 0 || (moved == -1 && errno == EINTR));
+
+        if (moved == 0)
+        {
+            if (used)
+            {
+                *used = method;
+            }
+
+            return total;
+        }
+
+        if (!unsupported(errno))
+        {
+            DC_ERROR_RAISE_ERRNO(err, errno);
+            return total;
+        }
+        // anything already copied moved the offsets along, the next method carries on from there
+    }
+
+    if (used)
+    {
+        *used = COPY_READ_WRITE;
+    }
+
+    return total + copy_read_write(env, err, in_fd, out_fd, interrupted);
+}
+
+static ssize_t copy_chunk(int in_fd, int out_fd, enum copy_method method)
+{
+#ifdef __linux__
+    switch (method)
+    {
+        case COPY_FILE_RANGE:
+            return copy_file_range(in_fd, NULL, out_fd, NULL, COPY_CHUNK_SIZE, 0);
+        case COPY_SENDFILE:
+            return sendfile(out_fd, in_fd, NULL, COPY_CHUNK_SIZE);
+        case COPY_SPLICE:
+            return splice(in_fd, NULL, out_fd, NULL, COPY_CHUNK_SIZE, SPLICE_F_MOVE | SPLICE_F_MORE);
+        case COPY_READ_WRITE:
+        default:
+            break;
+    }
+#else
+    (void)in_fd;
+    (void)out_fd;
+    (void)method;
+#endif
+    errno = ENOSYS;
+
+    return -1;
+}
+
+static bool unsupported(int error)
+{
+    // copy_file_range gives EBADF for an O_APPEND output
+    return error == EINVAL || error == EXDEV || error == ENOSYS || error == EOPNOTSUPP || error == EBADF ||
+           error == ESPIPE;
+}
+
+static bool stopped(const volatile sig_atomic_t *interrupted)
+{
+    return interrupted != NULL && *interrupted;
+}
+
+static off_t copy_read_write(const struct dc_posix_env *env, struct dc_error *err, int in_fd, int out_fd,
+                             const volatile sig_atomic_t *interrupted)
+{
+    char *buffer;
+    off_t total;
+    ssize_t count;
+
+    buffer = dc_malloc(env, err, COPY_BUFFER_SIZE);
+    total  = 0;
+
+    if (dc_error_has_error(err))
+    {
+        return 0;
+    }
+
+    while (!stopped(interrupted) && (count = dc_read(env, err, in_fd, buffer, COPY_BUFFER_SIZE)) > 0)
+    {
+        for (ssize_t written = 0; written < count && dc_error_has_no_error(err);)
+        {
+            ssize_t n;
+
+            n = dc_write(env, err, out_fd, buffer + written, (size_t)(count - written));
+
+            if (n > 0)
+            {
+                written += n;
+                total   += n;
+            }
+        }
+
+        if (dc_error_has_error(err))
+        {
+            break;
+        }
+    }
+
+    // the signal that set the flag also cut the read or write short
+    if (stopped(interrupted) && dc_error_has_error(err) && err->err_code == EINTR)
+    {
+        dc_error_reset(err);
+    }
+
+    free(buffer);
+
+    return total;
+}
@@ -0,0 +1,1085 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <dc_posix/dc_stdlib.h>
+#include "completion.h"
+#include "editor.h"
+#include "history.h"
+#include "history_index.h"
+
+// room for a typical command before the line has to grow
+#define EDITOR_INITIAL_CAPACITY 256
+
+// the width to assume when the terminal does not say
+#define EDITOR_DEFAULT_COLUMNS 80
+
+// the byte a letter key sends with Ctrl held
+#define CONTROL(c) ((c) & 0x1F)
+
+/*! \enum key
+    \brief The keys that are not a single byte, after the escape sequence for them is read.
+*/
+enum key
+{
+    KEY_EOF = -1,    /**< the input ended (or could not be read) */
+    KEY_UNKNOWN = 256, /**< an escape sequence for a key the editor does not use */
+    KEY_LEFT,
+    KEY_RIGHT,
+    KEY_UP,
+    KEY_DOWN,
+    KEY_HOME,
+    KEY_END,
+    KEY_DELETE,
+};
+
+/**
+ * Get the next byte from the terminal, reading more if none are pending.
+ *
+ * @param err the error object.
+ * @param editor the editor.
+ * @param byte set to the byte.
+ * @return false at the end of the input or on an error.
+ */
+static bool next_byte(struct dc_error *err, struct editor *editor, unsigned char *byte);
+
+/**
+ * Read a key, turning an escape sequence (eg. ESC [ A for Up) into one key.
+ *
+ * @param err the error object.
+ * @param editor the editor.
+ * @return the byte, a key from enum key, or KEY_EOF.
+ */
+static int read_key(struct dc_error *err, struct editor *editor);
+
+/**
+ * Make sure the line has room for a number of bytes and the null byte.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param editor the editor.
+ * @param length the number of bytes.
+ * @return false if it could not grow.
+ */
+static bool reserve(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor, size_t length);
+
+/**
+ * Insert a byte at the cursor and move the cursor past it.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param editor the editor.
+ * @param c the byte.
+ */
+static void insert(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor, char c);
+
+/**
+ * Delete the bytes between two places in the line and move the cursor to the first.
+ *
+ * @param editor the editor.
+ * @param from the first byte to delete.
+ * @param to the byte after the last one to delete.
+ */
+static void erase(struct editor *editor, size_t from, size_t to);
+
+/**
+ * Show the history entry before (or after) the one shown, keeping the line being typed for when Down comes back to it.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param editor the editor.
+ * @param older true for Up, false for Down.
+ */
+static void browse(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor, bool older);
+
+/**
+ * Copy the line into saved, to be put back later.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param editor the editor.
+ * @return false if saved could not grow.
+ */
+static bool save_line(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor);
+
+/**
+ * Put the line back to the one kept by save_line.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param editor the editor.
+ */
+static void restore_line(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor);
+
+/**
+ * Start a Ctrl-R search, with the entries other sessions added since the last one indexed first.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param editor the editor.
+ */
+static void start_search(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor);
+
+/**
+ * Use a key while searching.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param editor the editor.
+ * @param key the key.
+ * @return false if the key ended the search and is still to be used as usual.
+ */
+static bool search_key(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor, int key);
+
+/**
+ * Search for the query and show the best match, or leave the line as it is if nothing matches.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param editor the editor.
+ */
+static void run_search(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor);
+
+/**
+ * Show a match, with the cursor where the query is in it.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param editor the editor.
+ */
+static void show_result(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor);
+
+/**
+ * Complete the word before the cursor: a command name if it is the first word of a command,
+ * otherwise (or if it has a /) a file name. The longest start every choice has in common is inserted,
+ * with a space after it if there is only one choice (and it is not a directory), and the choices are
+ * listed when the word cannot go any further.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param editor the editor.
+ */
+static void complete(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor);
+
+/**
+ * Write the choices for a completion below the line, in columns like ls, then go to a new line for the prompt.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param editor the editor.
+ * @param matches the choices.
+ * @param count the number of choices.
+ */
+static void list_matches(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor,
+                         const char *const *matches, size_t count);
+
+/**
+ * Make sure the screen buffer has room for a number of bytes.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param editor the editor.
+ * @param size the number of bytes.
+ * @return false if it could not grow.
+ */
+static bool reserve_screen(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor, size_t size);
+
+/**
+ * Get the width of the terminal.
+ *
+ * @param editor the editor.
+ * @return the number of columns.
+ */
+static size_t terminal_columns(const struct editor *editor);
+
+/**
+ * Replace the line with a history entry.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param editor the editor.
+ * @param position the entry.
+ * @return false if the entry could not be read.
+ */
+static bool load_entry(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor,
+                       uint64_t position);
+
+/**
+ * Draw the prompt and the line over the current terminal line and put the cursor where it is in the line.
+ * A line too long for the terminal scrolls sideways to keep the cursor in view.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param editor the editor.
+ */
+static void refresh(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor);
+
+/**
+ * Write all of some bytes to the terminal.
+ *
+ * @param fd the terminal.
+ * @param bytes the bytes.
+ * @param count the number of bytes.
+ */
+static void write_all(int fd, const char *bytes, size_t count);
+
+/**
+ * Put the terminal in raw mode: keys are not echoed, lines are not collected and Ctrl-C is a key.
+ *
+ * @param editor the editor.
+ * @return false if the terminal settings could not be changed.
+ */
+static bool enable_raw(struct editor *editor);
+
+struct editor *editor_create(const struct dc_posix_env *env, struct dc_error *err, int in, int out,
+                             struct history *history, struct history_index *index, struct completion *completion)
+{
+    struct editor *editor;
+
+    if (!isatty(in))
+    {
+        return NULL;
+    }
+
+    editor = dc_calloc(env, err, 1, sizeof(struct editor));
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    editor->in         = in;
+    editor->out        = out;
+    editor->history    = history;
+    editor->index      = index;
+    editor->completion = completion;
+    editor->capacity   = EDITOR_INITIAL_CAPACITY;
+    editor->line       = dc_malloc(env, err, editor->capacity);
+
+    if (dc_error_has_error(err))
+    {
+        editor_destroy(env, &editor);
+        return NULL;
+    }
+
+    editor->line[0] = '\0';
+
+    return editor;
+}
+
+void editor_destroy(const struct dc_posix_env *env, struct editor **peditor)
+{
+    (void)env;
+
+    if (*peditor)
+    {
+        free((*peditor)->line);
+        free((*peditor)->saved);
+        free((*peditor)->screen);
+        free(*peditor);
+    }
+
+    *peditor = NULL;
+}
+
+char *editor_read_line(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor,
+                       const char *prompt, size_t *length)
+{
+    bool done;
+    bool eof;
+    bool cancelled;
+
+    editor->length    = 0;
+    editor->cursor    = 0;
+    editor->line[0]   = '\0';
+    editor->prompt    = prompt;
+    editor->end       = editor->history ? history_end(editor->history) : 0;
+    editor->browsing  = editor->end;
+    editor->searching = false;
+    done              = false;
+    eof               = false;
+    cancelled         = false;
+
+    if (!enable_raw(editor))
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        return NULL;
+    }
+
+    refresh(env, err, editor);
+
+    while (!done && dc_error_has_no_error(err))
+    {
+        int key;
+
+        key = read_key(err, editor);
+
+        if (editor->searching && search_key(env, err, editor, key))
+        {
+            refresh(env, err, editor);
+            continue;
+        }
+
+        switch (key)
+        {
+            case KEY_EOF:
+            {
+                eof  = true;
+                done = true;
+                break;
+            }
+            case '\r':
+            case '\n':
+            {
+                done = true;
+                break;
+            }
+            case CONTROL('c'):
+            {
+                cancelled = true;
+                done      = true;
+                break;
+            }
+            case CONTROL('d'):
+            {
+                // like bash, Ctrl-D only ends the input when there is nothing typed
+                if (editor->length == 0)
+                {
+                    eof  = true;
+                    done = true;
+                }
+                else if (editor->cursor < editor->length)
+                {
+                    erase(editor, editor->cursor, editor->cursor + 1);
+                }
+                break;
+            }
+            case KEY_DELETE:
+            {
+                if (editor->cursor < editor->length)
+                {
+                    erase(editor, editor->cursor, editor->cursor + 1);
+                }
+                break;
+            }
+            case 127:
+            case CONTROL('h'):
+            {
+                if (editor->cursor > 0)
+                {
+                    erase(editor, editor->cursor - 1, editor->cursor);
+                }
+                break;
+            }
+            case KEY_LEFT:
+            case CONTROL('b'):
+            {
+                if (editor->cursor > 0)
+                {
+                    editor->cursor--;
+                }
+                break;
+            }
+            case KEY_RIGHT:
+            case CONTROL('f'):
+            {
+                if (editor->cursor < editor->length)
+                {
+                    editor->cursor++;
+                }
+                break;
+            }
+            case KEY_HOME:
+            case CONTROL('a'):
+            {
+                editor->cursor = 0;
+                break;
+            }
+            case KEY_END:
+            case CONTROL('e'):
+            {
+                editor->cursor = editor->length;
+                break;
+            }
+            case KEY_UP:
+            case CONTROL('p'):
+            {
+                browse(env, err, editor, true);
+                break;
+            }
+            case KEY_DOWN:
+            case CONTROL('n'):
+            {
+                browse(env, err, editor, false);
+                break;
+            }
+            case CONTROL('u'):
+            {
+                erase(editor, 0, editor->cursor);
+                break;
+            }
+            case CONTROL('k'):
+            {
+                erase(editor, editor->cursor, editor->length);
+                break;
+            }
+            case CONTROL('w'):
+            {
+                size_t start;
+
+                for (start = editor->cursor; start > 0 && editor->line[start - 1] == ' '; --start)
+                {
+                }
+
+                for (; start > 0 && editor->line[start - 1] != ' '; --start)
+                {
+                }
+
+                erase(editor, start, editor->cursor);
+                break;
+            }
+            case CONTROL('r'):
+            {
+                start_search(env, err, editor);
+                break;
+            }
+            case '\t':
+            {
+                if (editor->completion)
+                {
+                    complete(env, err, editor);
+                }
+                else
+                {
+                    insert(env, err, editor, '\t');
+                }
+                break;
+            }
+            case CONTROL('l'):
+            {
+                write_all(editor->out, "\x1b[H\x1b[2J", 7);
+                break;
+            }
+            default:
+            {
+                // the other control characters (and keys the editor does not know) do nothing
+                if (key >= ' ' && key < 256)
+                {
+                    insert(env, err, editor, (char)key);
+                }
+                break;
+            }
+        }
+
+        if (!done)
+        {
+            refresh(env, err, editor);
+        }
+    }
+
+    // the cursor goes to the end so the output of the command starts on the next line
+    editor->cursor = editor->length;
+    refresh(env, err, editor);
+
+    // like bash, a line given up stays on the screen with ^C after it
+    if (cancelled)
+    {
+        write_all(editor->out, "^C", 2);
+        erase(editor, 0, editor->length);
+    }
+
+    write_all(editor->out, "\r\n", 2);
+    tcsetattr(editor->in, TCSADRAIN, &editor->cooked);
+    *length = editor->length;
+
+    return eof || dc_error_has_error(err) ? NULL : editor->line;
+}
+
+static bool next_byte(struct dc_error *err, struct editor *editor, unsigned char *byte)
+{
+    if (editor->pending_start == editor->pending_end)
+    {
+        ssize_t count;
+
+        do
+        {
+            count = read(editor->in, editor->pending, sizeof(editor->pending));
+        }
+        while (count == -1 && errno == EINTR);
+
+        if (count == -1)
+        {
+            DC_ERROR_RAISE_ERRNO(err, errno);
+            return false;
+        }
+
+        if (count == 0)
+        {
+            return false;
+        }
+
+        editor->pending_start = 0;
+        editor->pending_end   = (size_t)count;
+    }
+
+    *byte = (unsigned char)editor->pending[editor->pending_start++];
+
+    return true;
+}
+
+static int read_key(struct dc_error *err, struct editor *editor)
+{
+    unsigned char byte;
+    unsigned char kind;
+    unsigned int number;
+
+    if (!next_byte(err, editor, &byte))
+    {
+        return KEY_EOF;
+    }
+
+    if (byte != 0x1B)
+    {
+        return byte;
+    }
+
+    // ESC [ A, ESC O A (application mode) or ESC [ 3 ~
+    if (!next_byte(err, editor, &kind) || (kind != '[' && kind != 'O') || !next_byte(err, editor, &byte))
+    {
+        return KEY_UNKNOWN;
+    }
+
+    number = 0;
+
+    while (byte >= '0' && byte <= '9')
+    {
+        number = number * 10 + (unsigned int)(byte - '0');
+
+        if (!next_byte(err, editor, &byte))
+        {
+            return KEY_UNKNOWN;
+        }
+    }
+
+    switch (byte)
+    {
+        case 'A':
+        {
+            return KEY_UP;
+        }
+        case 'B':
+        {
+            return KEY_DOWN;
+        }
+        case 'C':
+        {
+            return KEY_RIGHT;
+        }
+        case 'D':
+        {
+            return KEY_LEFT;
+        }
+        case 'H':
+        {
+            return KEY_HOME;
+        }
+        case 'F':
+        {
+            return KEY_END;
+        }
+        case '~':
+        {
+            return number == 1 || number == 7 ? KEY_HOME :
+                   number == 4 || number == 8 ? KEY_END :
+                   number == 3 ? KEY_DELETE : KEY_UNKNOWN;
+        }
+        default:
+        {
+            return KEY_UNKNOWN;
+        }
+    }
+}
+
+static bool reserve(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor, size_t length)
+{
+    char *grown;
+    size_t capacity;
+
+    if (length < editor->capacity)
+    {
+        return true;
+    }
+
+    for (capacity = editor->capacity * 2; capacity <= length; capacity *= 2)
+    {
+    }
+
+    grown = dc_realloc(env, err, editor->line, capacity);
+
+    if (dc_error_has_error(err))
+    {
+        return false;
+    }
+
+    editor->line     = grown;
+    editor->capacity = capacity;
+
+    return true;
+}
+
+static void insert(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor, char c)
+{
+    if (!reserve(env, err, editor, editor->length + 1))
+    {
+        return;
+    }
+
+    memmove(&editor->line[editor->cursor + 1], &editor->line[editor->cursor], editor->length - editor->cursor + 1);
+    editor->line[editor->cursor] = c;
+    editor->cursor++;
+    editor->length++;
+}
+
+static void erase(struct editor *editor, size_t from, size_t to)
+{
+    memmove(&editor->line[from], &editor->line[to], editor->length - to + 1);
+    editor->length -= to - from;
+    editor->cursor  = from;
+}
+
+static void browse(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor, bool older)
+{
+    uint64_t position;
+
+    if (editor->history == NULL)
+    {
+        return;
+    }
+
+    if (older)
+    {
+        if (!history_previous(editor->history, editor->browsing, &position))
+        {
+            return;
+        }
+
+        // the line being typed is kept for when Down comes back past the newest entry
+        if (editor->browsing == editor->end && !save_line(env, err, editor))
+        {
+            return;
+        }
+
+        if (load_entry(env, err, editor, position))
+        {
+            editor->browsing = position;
+        }
+    }
+    else if (editor->browsing != editor->end)
+    {
+        if (history_next(editor->history, editor->browsing, &position) && position < editor->end &&
+            load_entry(env, err, editor, position))
+        {
+            editor->browsing = position;
+        }
+        else
+        {
+            restore_line(env, err, editor);
+        }
+    }
+}
+
+static bool save_line(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor)
+{
+    if (editor->saved_capacity < editor->length + 1)
+    {
+        char *grown;
+
+        grown = dc_realloc(env, err, editor->saved, editor->length + 1);
+
+        if (dc_error_has_error(err))
+        {
+            return false;
+        }
+
+        editor->saved          = grown;
+        editor->saved_capacity = editor->length + 1;
+    }
+
+    memcpy(editor->saved, editor->line, editor->length + 1);
+
+    return true;
+}
+
+static void restore_line(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor)
+{
+    if (editor->saved && reserve(env, err, editor, strlen(editor->saved)))
+    {
+        editor->length = strlen(editor->saved);
+        editor->cursor = editor->length;
+        memcpy(editor->line, editor->saved, editor->length + 1);
+        editor->browsing = editor->end;
+    }
+}
+
+static void start_search(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor)
+{
+    if (editor->history == NULL || editor->index == NULL || !save_line(env, err, editor))
+    {
+        return;
+    }
+
+    history_index_update(env, err, editor->index, editor->history);
+    editor->searching    = true;
+    editor->query[0]     = '\0';
+    editor->query_length = 0;
+    editor->result_count = 0;
+    editor->result       = 0;
+}
+
+static bool search_key(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor, int key)
+{
+    switch (key)
+    {
+        case CONTROL('r'):
+        {
+            if (editor->result + 1 < editor->result_count)
+            {
+                editor->result++;
+                show_result(env, err, editor);
+            }
+            return true;
+        }
+        case 127:
+        case CONTROL('h'):
+        {
+            if (editor->query_length > 0)
+            {
+                editor->query[--editor->query_length] = '\0';
+                run_search(env, err, editor);
+            }
+            return true;
+        }
+        case CONTROL('g'):
+        {
+            editor->searching = false;
+            restore_line(env, err, editor);
+            return true;
+        }
+        default:
+        {
+            if (key == '\t' || (key >= ' ' && key < 256 && key != 127))
+            {
+                if (editor->query_length + 1 < sizeof(editor->query))
+                {
+                    editor->query[editor->query_length++] = (char)key;
+                    editor->query[editor->query_length]   = '\0';
+                    run_search(env, err, editor);
+                }
+                return true;
+            }
+
+            // the match becomes the line being typed
+            editor->searching = false;
+            editor->browsing  = editor->end;
+            return false;
+        }
+    }
+}
+
+static void run_search(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor)
+{
+    editor->result_count = history_index_search(env, err, editor->index, editor->history, editor->query,
+                                                editor->query_length, editor->results, EDITOR_SEARCH_RESULTS);
+    editor->result       = 0;
+
+    // like bash, a query that matches nothing leaves the last match on the line
+    if (editor->result_count > 0)
+    {
+        show_result(env, err, editor);
+    }
+}
+
+static void show_result(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor)
+{
+    const char *match;
+
+    if (load_entry(env, err, editor, editor->results[editor->result]))
+    {
+        match          = strstr(editor->line, editor->query);
+        editor->cursor = match ? (size_t)(match - editor->line) : editor->length;
+    }
+}
+
+static bool load_entry(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor,
+                       uint64_t position)
+{
+    size_t length;
+
+    // an entry that was overwritten while it was copied leaves an empty line rather than part of one
+    if (!history_read(editor->history, position, editor->line, editor->capacity, &length) ||
+        (length >= editor->capacity &&
+         (!reserve(env, err, editor, length) ||
+          !history_read(editor->history, position, editor->line, editor->capacity, &length))))
+    {
+        editor->length = 0;
+        editor->cursor = 0;
+        editor->line[0] = '\0';
+        return false;
+    }
+
+    editor->length = length;
+    editor->cursor = length;
+
+    return true;
+}
+
+static void complete(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor)
+{
+    const char *const *matches;
+    const char *slash;
+    size_t start;
+    size_t before;
+    size_t name;
+    size_t typed;
+    size_t common;
+    size_t count;
+    bool command;
+
+    // the word is everything back to a space or an operator (quotes are not taken into account)
+    for (start = editor->cursor; start > 0 && strchr(" \t|;&<>()", editor->line[start - 1]) == NULL; --start)
+    {
+    }
+
+    for (before = start; before > 0 && editor->line[before - 1] == ' '; --before)
+    {
+    }
+
+    command = before == 0 || strchr("|;&(", editor->line[before - 1]) != NULL;
+    slash   = NULL;
+
+    for (size_t i = start; i < editor->cursor; ++i)
+    {
+        slash = editor->line[i] == '/' ? &editor->line[i] : slash;
+    }
+
+    if (command && slash == NULL)
+    {
+        name  = start;
+        count = completion_commands(env, err, editor->completion, &editor->line[start], editor->cursor - start,
+                                    &matches);
+    }
+    else
+    {
+        char *directory;
+        size_t length;
+
+        // the directory is the word up to its last /, the name is what follows
+        name      = slash ? (size_t)(slash - editor->line) + 1 : start;
+        length    = slash ? name - start : 1;
+        directory = dc_malloc(env, err, length + 1);
+
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+
+        memcpy(directory, slash ? &editor->line[start] : ".", length);
+        directory[length] = '\0';
+        count = completion_files(env, err, editor->completion, directory, &editor->line[name], editor->cursor - name,
+                                 &matches);
+        free(directory);
+    }
+
+    if (count == 0)
+    {
+        write_all(editor->out, "\a", 1);
+        return;
+    }
+
+    // the choices are sorted, so what they all start with is what the first and the last start with
+    typed = editor->cursor - name;
+
+    for (common = typed; matches[0][common] != '\0' && matches[0][common] == matches[count - 1][common]; ++common)
+    {
+    }
+
+    for (size_t i = typed; i < common; ++i)
+    {
+        insert(env, err, editor, matches[0][i]);
+    }
+
+    if (count == 1 && matches[0][common - 1] != '/')
+    {
+        insert(env, err, editor, ' ');
+    }
+    else if (count > 1 && common == typed)
+    {
+        list_matches(env, err, editor, matches, count);
+    }
+}
+
+static void list_matches(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor,
+                         const char *const *matches, size_t count)
+{
+    size_t shown;
+    size_t width;
+    size_t columns;
+    size_t rows;
+    size_t used;
+
+    shown = count < EDITOR_LIST_MAX ? count : EDITOR_LIST_MAX;
+    width = 0;
+
+    for (size_t i = 0; i < shown; ++i)
+    {
+        width = strlen(matches[i]) > width ? strlen(matches[i]) : width;
+    }
+
+    width  += 2;
+    columns = terminal_columns(editor) / width > 0 ? terminal_columns(editor) / width : 1;
+    rows    = (shown + columns - 1) / columns;
+
+    if (!reserve_screen(env, err, editor, rows * (columns * width + 2) + 64))
+    {
+        return;
+    }
+
+    // down the columns, like ls
+    used = (size_t)sprintf(editor->screen, "\r\n");
+
+    for (size_t row = 0; row < rows; ++row)
+    {
+        for (size_t column = 0; column < columns && column * rows + row < shown; ++column)
+        {
+            used += (size_t)sprintf(&editor->screen[used], "%-*s", (int)width, matches[column * rows + row]);
+        }
+
+        used += (size_t)sprintf(&editor->screen[used], "\r\n");
+    }
+
+    if (shown < count)
+    {
+        used += (size_t)sprintf(&editor->screen[used], "(%zu more)\r\n", count - shown);
+    }
+
+    write_all(editor->out, editor->screen, used);
+}
+
+static bool reserve_screen(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor, size_t size)
+{
+    char *grown;
+
+    if (editor->screen_capacity >= size)
+    {
+        return true;
+    }
+
+    grown = dc_realloc(env, err, editor->screen, size);
+
+    if (dc_error_has_error(err))
+    {
+        return false;
+    }
+
+    editor->screen          = grown;
+    editor->screen_capacity = size;
+
+    return true;
+}
+
+static size_t terminal_columns(const struct editor *editor)
+{
+    struct winsize size;
+
+    return ioctl(editor->out, TIOCGWINSZ, &size) == 0 && size.ws_col > 0 ? size.ws_col : EDITOR_DEFAULT_COLUMNS;
+}
+
+static void refresh(const struct dc_posix_env *env, struct dc_error *err, struct editor *editor)
+{
+    const char *prompt;
+    size_t columns;
+    size_t prompt_length;
+    size_t width;
+    size_t start;
+    size_t shown;
+    size_t needed;
+    int count;
+
+    columns       = terminal_columns(editor);
+    // while searching, the query and whether it matches take the place of the prompt
+    if (editor->searching)
+    {
+        snprintf(editor->search_prompt, sizeof(editor->search_prompt), "(%sreverse-i-search)`%s': ",
+                 editor->query_length > 0 && editor->result_count == 0 ? "failed " : "", editor->query);
+    }
+
+    prompt        = editor->searching ? editor->search_prompt : editor->prompt;
+    prompt_length = strlen(prompt);
+    width         = columns > prompt_length + 1 ? columns - prompt_length - 1 : 1;
+    start         = editor->cursor > width ? editor->cursor - width : 0;
+    shown         = editor->length - start < width ? editor->length - start : width;
+    needed        = prompt_length + shown + 32;
+
+    if (!reserve_screen(env, err, editor, needed))
+    {
+        return;
+    }
+
+    // back to the start of the row, the prompt and the line, clear what was after them and move back to the cursor
+    count = snprintf(editor->screen, editor->screen_capacity, "\r%s%.*s\x1b[K", prompt, (int)shown,
+                     &editor->line[start]);
+
+    if (start + shown > editor->cursor)
+    {
+        count += snprintf(&editor->screen[count], editor->screen_capacity - (size_t)count, "\x1b[%zuD",
+                          start + shown - editor->cursor);
+    }
+
+    write_all(editor->out, editor->screen, (size_t)count);
+}
+
+static void write_all(int fd, const char *bytes, size_t count)
+{
+    while (count > 0)
+    {
+        ssize_t written;
+
+        written = write(fd, bytes, count);
+
+        if (written == -1 && errno == EINTR)
+        {
+            continue;
+        }
+
+        // the line cannot be drawn, there is nothing better to do than keep reading keys
+        if (written <= 0)
+        {
+            return;
+        }
+
+        bytes += written;
+        count -= (size_t)written;
+    }
+}
+
+static bool enable_raw(struct editor *editor)
+{
+    struct termios raw;
+
+    // taken every time, so a change made with stty between lines is kept
+    if (tcgetattr(editor->in, &editor->cooked) == -1)
+    {
+        return false;
+    }
+
+    raw = editor->cooked;
+    raw.c_iflag &= (tcflag_t)~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+    raw.c_lflag &= (tcflag_t)~(ECHO | ICANON | IEXTEN | ISIG);
+    raw.c_cflag |= CS8;
+    raw.c_cc[VMIN]  = 1;
+    raw.c_cc[VTIME] = 0;
+
+    return tcsetattr(editor->in, TCSADRAIN, &raw) != -1;
+}
@@ -1,4 +1,12 @@
+// wait4 and memfd_create are not part of POSIX
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <unistd.h>
+#include <spawn.h>
+#include <sys/mman.h>
 #include <sys/wait.h>
 #include <stdlib.h>
 #include "execute.h"
@@ -8,22 +16,143 @@
 #include <dc_posix/dc_stdlib.h>
 
 /**
- * Setup any I/O redirections for the process.
+ * Open the I/O redirection files for the process and add the redirections, in order, to the spawn file actions.
+ * The files are opened by the shell so that an open failure is reported separately from an exec failure,
+ * the child only dup2s them onto the descriptors they redirect.
+ * The pipe descriptors are dup2ed first so that a file redirection replaces the pipe.
+ *
+ * @param env the posix environment.
+ * @param err the err object.
+ * @param command the command to execute
+ * @param pipe_fds the pipe descriptors for stdin and stdout (-1 if not part of a pipeline)
+ * @param actions the spawn file actions to add the redirections to
+ * @param error_fd set to the shell descriptor the child's stderr ends up as (-1 if it is closed)
+ * @return the opened files (see open_redirections).
+ */
+int *redirect(const struct dc_posix_env *env, struct dc_error *err, struct command *command, const int pipe_fds[2],
+              posix_spawn_file_actions_t *actions, int *error_fd);
+
+/**
+ * Open the I/O redirection files of the command.
+ * A file named by more than one redirection of the same type is opened once and shared.
+ * The descriptors are close on exec and numbered above any descriptor the redirections name,
+ * so applying the redirections can never replace one of them.
+ * Stops at the first file that cannot be opened, or a descriptor to copy that is not open (EBADF).
+ *
+ * @param env the posix environment.
+ * @param err the err object.
+ * @param command the command to execute
+ * @return the descriptor opened for each redirection (-1 for a dup or close),
+ *         NULL if there are no redirections or one of them failed.
+ */
+static int *open_redirections(const struct dc_posix_env *env, struct dc_error *err, const struct command *command);
+
+/**
+ * Close the files opened by open_redirections and free the array.
+ *
+ * @param command the command.
+ * @param opened the opened files, may be NULL.
+ */
+static void close_redirections(const struct command *command, int *opened);
+
+/**
+ * Get the open flags for a redirection to a file.
+ *
+ * @param type the redirection.
+ * @return the flags.
+ */
+static int open_flags(enum redirection_type type);
+
+/**
+ * Put the text of a here-document behind a descriptor it can be read from.
+ * Text that fits in a pipe without the write blocking (PIPE_BUF) goes into a pipe, anything
+ * bigger into a memfd_create file, so the body never touches the disk and the shell never
+ * waits on the reader.
+ *
+ * @param env the posix environment.
+ * @param err the err object.
+ * @param text the text.
+ * @return the descriptor to read the text from (close on exec), or -1 on an error.
+ */
+static int open_heredoc(const struct dc_posix_env *env, struct dc_error *err, const char *text);
+
+/**
+ * Write all of a buffer, retrying short writes.
+ *
+ * @param fd where to write.
+ * @param data the data.
+ * @param length the number of bytes.
+ * @return false if the write failed (errno is set).
+ */
+static bool write_all(int fd, const char *data, size_t length);
+
+/**
+ * Find the lowest descriptor above every descriptor named by the command's redirections (and at least 10).
+ *
+ * @param command the command.
+ * @return the descriptor.
+ */
+static int lowest_unnamed_fd(const struct command *command);
+
+/**
+ * Check that the descriptor a redirection copies will be open when the redirection is applied:
+ * either an earlier redirection of the command set it up, or it is one of the shell's
+ * descriptors that a program would inherit.
+ *
+ * @param command the command.
+ * @param index the redirection.
+ * @return true if the descriptor can be copied.
+ */
+static bool source_is_open(const struct command *command, size_t index);
+
+/**
+ * Save a copy of one of the shell's descriptors before it is redirected, once per descriptor.
+ *
+ * @param saved the saved descriptors.
+ * @param fd the descriptor.
+ * @param lowest the lowest descriptor the copy can be.
+ */
+static void save_fd(struct saved_fds *saved, int fd, int lowest);
+
+/**
+ * Find the program to run.
+ * A command containing a '/' is used as is, otherwise it is looked up in the PATH cache.
+ *
  * @param env the posix environment.
  * @param err the err object.
  * @param command the command to execute
+ * @param path_cache the cache of programs found in the PATH directories
+ * @return the path to the program (must be freed) or NULL if it cannot be found.
  */
-void redirect(const struct dc_posix_env *env, struct dc_error *err, struct command *command);
+char *resolve(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+              struct path_cache *path_cache);
 
 /**
- * Run the process
+ * Start the process without waiting for it.
+ * If the process cannot be started the command->exit_code is set.
+ *
  * @param env the posix environment.
  * @param err the err object.
  * @param command the command to execute
- * @param path array of PATH directories to search for the program
- * @return Only returns if all of the calls to execv fail
+ * @param path_cache the cache of programs found in the PATH directories
+ * @param pipe_fds the pipe descriptors for stdin and stdout (-1 if not part of a pipeline)
+ * @param pgid the process group to join, 0 for a new group or -1 to stay in the shell's group
+ * @return the process id or -1 if the process was not started.
+ */
+pid_t launch(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+             struct path_cache *path_cache, const int pipe_fds[2], pid_t pgid);
+
+/**
+ * Wait for the process to finish and set the command->exit_code and command->rusage.
+ * A process killed by a signal has an exit code of 128 + the signal number.
+ * With stop the wait also ends when the process stops, then the exit code is 128 + the stop signal.
+ *
+ * @param pid the process to wait for.
+ * @param command the command that was executed.
+ * @param stop return when the process stops too.
+ * @return true if the process stopped, it must be waited for again.
  */
-int run(const struct dc_posix_env *env, struct dc_error *err, struct command *command, char **path);
+bool reap(pid_t pid, struct command *command, bool stop);
 
 /**
  * Handles error for run function (execv).
@@ -33,123 +162,696 @@ int run(const struct dc_posix_env *env, struct dc_error *err, struct command *co
  */
 int handle_run_error(struct dc_error *err, struct command *command);
 
-void execute(const struct dc_posix_env *env, struct dc_error *err, struct command *command, char **path)
+void execute(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+             struct path_cache *path_cache)
 {
-    pid_t pid = fork();
-    if (pid == 0)
+    const int no_pipe[2] = {-1, -1};
+    pid_t pid;
+
+    pid = launch(env, err, command, path_cache, no_pipe, -1);
+
+    if (pid > 0)
     {
-        // Child process
-        int status;
-        redirect(env, err, command);
-        if (dc_error_has_error(err))
+        reap(pid, command, false);
+    }
+}
+
+int execute_pipeline(const struct dc_posix_env *env, struct dc_error *err, struct command *commands, size_t count,
+                     struct path_cache *path_cache, bool pipefail)
+{
+    pid_t *pids;
+    int status;
+
+    pids = dc_calloc(env, err, count, sizeof(pid_t));
+
+    if (dc_error_has_error(err))
+    {
+        return EXIT_FAILURE;
+    }
+
+    launch_pipeline(env, err, commands, count, path_cache, -1, pids);
+    status = wait_pipeline(commands, count, pids, pipefail, false);
+    free(pids);
+
+    return status;
+}
+
+int wait_pipeline(struct command *commands, size_t count, pid_t *pids, bool pipefail, bool stop)
+{
+    int status;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (pids[i] > 0 && !reap(pids[i], &commands[i], stop))
         {
-            exit(err->err_code);
+            pids[i] = -1;
         }
-        run(env, err, command, path);
-        status = handle_run_error(err, command);
-        if (status == 127)
+    }
+
+    // The status of the last command, or with pipefail the last command that failed.
+    status = commands[count - 1].exit_code;
+    if (pipefail)
+    {
+        for (size_t i = count; i > 0 && status == 0; --i)
         {
-            fprintf(stderr, "command: %s not found\n", command->command);
+            status = commands[i - 1].exit_code;
         }
-        exit(status);
     }
-    else
+
+    return status;
+}
+
+void launch_pipeline(const struct dc_posix_env *env, struct dc_error *err, struct command *commands, size_t count,
+                     struct path_cache *path_cache, pid_t pgid, pid_t *pids)
+{
+    int next_in;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        pids[i] = -1;
+    }
+
+    // Every stage is started before waiting on any of them, otherwise a full pipe would block the writer.
+    next_in = -1;
+    for (size_t i = 0; i < count; ++i)
     {
-        // Main process
-        int status;
-        waitpid(pid, &status, 0);
+        int stage_fds[2] = {next_in, -1};
+        int fds[2]       = {-1, -1};
+
+        if (i + 1 < count)
+        {
+            if (pipe(fds) == -1)
+            {
+                DC_ERROR_RAISE_ERRNO(err, errno);
+                break;
+            }
+            // only the dup2ed copies may survive into the children
+            fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+            fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+            stage_fds[1] = fds[1];
+        }
 
-        if (WIFEXITED(status))
+        pids[i] = launch(env, err, &commands[i], path_cache, stage_fds, pgid);
+
+        // the rest of the pipeline joins the group of the first process
+        if (pgid == 0 && pids[i] > 0)
+        {
+            pgid = pids[i];
+        }
+        if (next_in != -1)
+        {
+            close(next_in);
+        }
+        if (fds[1] != -1)
         {
-            int es = WEXITSTATUS(status);
-            command->exit_code = es;
+            close(fds[1]);
         }
+        next_in = fds[0];
+    }
+
+    if (next_in != -1)
+    {
+        close(next_in);
     }
 }
 
-void redirect(const struct dc_posix_env *env, struct dc_error *err, struct command *command)
+pid_t launch(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+             struct path_cache *path_cache, const int pipe_fds[2], pid_t pgid)
 {
-    if (command->stdin_file)
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t mask;
+    sigset_t defaults;
+    char *program;
+    pid_t pid;
+    int *opened;
+    int error_fd;
+    int status;
+
+    pid = -1;
+    posix_spawn_file_actions_init(&actions);
+    opened = redirect(env, err, command, pipe_fds, &actions, &error_fd);
+
+    if (dc_error_has_error(err))
     {
-        int fd;
-        fd = dc_open(env, err, command->stdin_file, DC_O_RDONLY, 0);
-        if (dc_error_has_no_error(err))
+        // Same as the child exiting with the error code before it could exec.
+        command->exit_code = err->err_code;
+        dc_error_reset(err);
+        program = NULL;
+    }
+    else if (command->command == NULL)
+    {
+        // only redirections (eg. > file): the files are created but there is nothing to run
+        command->exit_code = 0;
+        program = NULL;
+    }
+    else
+    {
+        program = resolve(env, err, command, path_cache);
+
+        if (program == NULL)
         {
-            dc_dup2(env, err, fd, STDIN_FILENO);
+            dprintf(error_fd, "command: %s not found\n", command->command);
+            command->exit_code = 127;
         }
-        dc_close(env, err, fd);
     }
-    if (command->stdout_file)
+
+    if (program && command->arena)
     {
-        unsigned int option = DC_O_TRUNC;
-        int fd;
-        if (command->stdout_overwrite)
+        // everything in the command must come from its arena, so it can be dropped with the rest of the line
+        char *copy;
+
+        copy = arena_strdup(env, err, command->arena, program);
+        free(program);
+        program = copy;
+    }
+
+    if (program)
+    {
+        arena_free(command->arena, command->argv[0]);
+        command->argv[0] = program;
+
+        // The shell may block signals (eg. SIGCHLD) that the program must not inherit, and a program
+        // must take ^C and ^Z from the terminal even though a shell with job control does not (see jobs_control).
+        sigemptyset(&mask);
+        sigemptyset(&defaults);
+        sigaddset(&defaults, SIGINT);
+        sigaddset(&defaults, SIGQUIT);
+        sigaddset(&defaults, SIGTSTP);
+        sigaddset(&defaults, SIGTTIN);
+        sigaddset(&defaults, SIGTTOU);
+        posix_spawnattr_init(&attr);
+        posix_spawnattr_setsigmask(&attr, &mask);
+        posix_spawnattr_setsigdefault(&attr, &defaults);
+        if (pgid == -1)
+        {
+            posix_spawnattr_setflags(&attr, (short)(POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF));
+        }
+        else
         {
-            option = DC_O_APPEND;
+            posix_spawnattr_setpgroup(&attr, pgid);
+            posix_spawnattr_setflags(&attr,
+                                     (short)(POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETPGROUP));
         }
-        fd = dc_open(env, err, command->stdout_file, DC_O_CREAT | DC_O_WRONLY | option, S_IRWXU);
-        if (dc_error_has_no_error(err))
+
+        status = posix_spawn(&pid, program, &actions, &attr, command->argv, command->envp ? command->envp : environ);
+        posix_spawnattr_destroy(&attr);
+
+        if (status != 0)
         {
-            dc_dup2(env, err, fd, STDOUT_FILENO);
+            struct dc_error spawn_err;
+
+            pid = -1;
+            dc_error_init(&spawn_err, NULL);
+            DC_ERROR_RAISE_ERRNO(&spawn_err, status);
+            command->exit_code = handle_run_error(&spawn_err, command);
+            dc_error_reset(&spawn_err);
+
+            if (command->exit_code == 127)
+            {
+                dprintf(error_fd, "command: %s not found\n", command->command);
+            }
         }
-        dc_close(env, err, fd);
     }
-    if (command->stderr_file)
+
+    close_redirections(command, opened);
+    posix_spawn_file_actions_destroy(&actions);
+
+    return pid;
+}
+
+bool reap(pid_t pid, struct command *command, bool stop)
+{
+    int status;
+
+    for (;;)
     {
-        unsigned int option = DC_O_TRUNC;
+        if (wait4(pid, &status, stop ? WUNTRACED : 0, &command->rusage) == -1)
+        {
+            if (errno != EINTR)
+            {
+                return false;
+            }
+        }
+        else if (!WIFSTOPPED(status))
+        {
+            break;
+        }
+        else if (WSTOPSIG(status) == SIGTTIN || WSTOPSIG(status) == SIGTTOU)
+        {
+            // it used the terminal before the shell gave it the terminal, it has it now
+            kill(pid, SIGCONT);
+        }
+        else
+        {
+            command->exit_code = 128 + WSTOPSIG(status);
+            return true;
+        }
+    }
+
+    if (WIFEXITED(status))
+    {
+        int es = WEXITSTATUS(status);
+        command->exit_code = es;
+    }
+    else if (WIFSIGNALED(status))
+    {
+        command->exit_code = 128 + WTERMSIG(status);
+    }
+
+    return false;
+}
+
+int *redirect(const struct dc_posix_env *env, struct dc_error *err, struct command *command, const int pipe_fds[2],
+              posix_spawn_file_actions_t *actions, int *error_fd)
+{
+    int std_fds[3];
+    int *opened;
+
+    std_fds[STDIN_FILENO]  = STDIN_FILENO;
+    std_fds[STDOUT_FILENO] = STDOUT_FILENO;
+    std_fds[STDERR_FILENO] = STDERR_FILENO;
+
+    if (pipe_fds[0] != -1)
+    {
+        posix_spawn_file_actions_adddup2(actions, pipe_fds[0], STDIN_FILENO);
+        std_fds[STDIN_FILENO] = pipe_fds[0];
+    }
+    if (pipe_fds[1] != -1)
+    {
+        posix_spawn_file_actions_adddup2(actions, pipe_fds[1], STDOUT_FILENO);
+        std_fds[STDOUT_FILENO] = pipe_fds[1];
+    }
+
+    *error_fd = STDERR_FILENO;
+    opened    = open_redirections(env, err, command);
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < command->redirection_count; ++i)
+    {
+        const struct redirection *redirection = &command->redirections[i];
         int fd;
-        if (command->stderr_overwrite)
+
+        if (redirection->type == REDIRECTION_DUP)
         {
-            option = DC_O_APPEND;
+            posix_spawn_file_actions_adddup2(actions, redirection->source_fd, redirection->fd);
+            fd = redirection->source_fd <= STDERR_FILENO ? std_fds[redirection->source_fd] : redirection->source_fd;
         }
-        fd = dc_open(env, err, command->stderr_file, DC_O_CREAT | DC_O_WRONLY | option, S_IRWXU);
-        if (dc_error_has_no_error(err))
+        else if (redirection->type == REDIRECTION_CLOSE)
         {
-            dc_dup2(env, err, fd, STDERR_FILENO);
+            posix_spawn_file_actions_addclose(actions, redirection->fd);
+            fd = -1;
+        }
+        else
+        {
+            posix_spawn_file_actions_adddup2(actions, opened[i], redirection->fd);
+            fd = opened[i];
+        }
+
+        // which of the shell's descriptors each standard one ends up as, for the messages the shell prints
+        if (redirection->fd <= STDERR_FILENO)
+        {
+            std_fds[redirection->fd] = fd;
         }
-        dc_close(env, err, fd);
     }
+
+    *error_fd = std_fds[STDERR_FILENO];
+
+    return opened;
 }
 
-int run(const struct dc_posix_env *env, struct dc_error *err, struct command *command, char **path)
+static int *open_redirections(const struct dc_posix_env *env, struct dc_error *err, const struct command *command)
 {
-    if (dc_strchr(env, command->command, '/'))
+    int *opened;
+    int lowest;
+
+    if (command->redirection_count == 0)
     {
-        command->argv[0] = dc_strdup(env, err, command->command);
-        dc_execv(env, err, command->argv[0], command->argv);
+        return NULL;
     }
-    else
+
+    for (size_t i = 0; i < command->redirection_count; ++i)
+    {
+        if (command->redirections[i].type == REDIRECTION_DUP && !source_is_open(command, i))
+        {
+            DC_ERROR_RAISE_ERRNO(err, EBADF);
+            return NULL;
+        }
+    }
+
+    opened = dc_malloc(env, err, command->redirection_count * sizeof(int));
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    lowest = lowest_unnamed_fd(command);
+
+    for (size_t i = 0; i < command->redirection_count; ++i)
     {
-        if (!path[0])
+        const struct redirection *redirection = &command->redirections[i];
+
+        opened[i] = -1;
+
+        if (redirection->file == NULL || dc_error_has_error(err))
         {
-            DC_ERROR_RAISE_ERRNO(err, ENOENT);
+            continue;
+        }
+
+        if (redirection->type == REDIRECTION_HEREDOC)
+        {
+            // each here-document is read on its own, even when the text is the same
+            opened[i] = open_heredoc(env, err, redirection->file);
         }
         else
         {
-            size_t index = 0;
-            while(path[index])
+            // > log 2> log shares one open file (and offset) instead of two that write over each other
+            for (size_t j = 0; j < i && opened[i] == -1; ++j)
             {
-                size_t len = dc_strlen(env, path[index]) + dc_strlen(env, command->command);
-                char *cmd;
-                char *temp = dc_malloc(env, err, len * sizeof(char));
-                sprintf(temp, "%s/%s", path[index], command->command);
-                cmd = dc_strdup(env, err, temp);
-                command->argv[0] = dc_strdup(env, err, cmd);
-                dc_execv(env, err, cmd, command->argv);
-                if (dc_error_has_error(err))
+                if (opened[j] != -1 && command->redirections[j].type == redirection->type &&
+                    dc_strcmp(env, command->redirections[j].file, redirection->file) == 0)
                 {
-                    if (!dc_error_is_errno(err, ENOENT))
-                    {
-                        break;
-                    }
+                    opened[i] = opened[j];
                 }
-                index++;
-                free(cmd);
-                free(temp);
             }
+
+            if (opened[i] == -1)
+            {
+                opened[i] = dc_open(env, err, redirection->file, open_flags(redirection->type) | O_CLOEXEC, S_IRWXU);
+            }
+        }
+
+        if (opened[i] != -1 && opened[i] < lowest)
+        {
+            int moved;
+
+            moved = fcntl(opened[i], F_DUPFD_CLOEXEC, lowest);
+
+            if (moved == -1)
+            {
+                DC_ERROR_RAISE_ERRNO(err, errno);
+            }
+
+            close(opened[i]);
+            opened[i] = moved;
+        }
+    }
+
+    if (dc_error_has_error(err))
+    {
+        close_redirections(command, opened);
+        return NULL;
+    }
+
+    return opened;
+}
+
+static int open_flags(enum redirection_type type)
+{
+    switch (type)
+    {
+        case REDIRECTION_READ:
+            return DC_O_RDONLY;
+        case REDIRECTION_APPEND:
+            return DC_O_CREAT | DC_O_WRONLY | DC_O_APPEND;
+        case REDIRECTION_READ_WRITE:
+            return DC_O_CREAT | DC_O_RDWR;
+        case REDIRECTION_WRITE:
+        case REDIRECTION_DUP:
+        case REDIRECTION_CLOSE:
+        case REDIRECTION_HEREDOC:
+        default:
+            return DC_O_CREAT | DC_O_WRONLY | DC_O_TRUNC;
+    }
+}
+
+static int open_heredoc(const struct dc_posix_env *env, struct dc_error *err, const char *text)
+{
+    size_t length;
+    int fd;
+
+    length = dc_strlen(env, text);
+
+    if (length <= PIPE_BUF)
+    {
+        int fds[2];
+
+        if (pipe(fds) == -1)
+        {
+            DC_ERROR_RAISE_ERRNO(err, errno);
+            return -1;
+        }
+
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+        // the pipe is empty, so this much is written without waiting for a reader
+        if (!write_all(fds[1], text, length))
+        {
+            DC_ERROR_RAISE_ERRNO(err, errno);
+            close(fds[0]);
+            fds[0] = -1;
+        }
+
+        close(fds[1]);
+
+        return fds[0];
+    }
+
+    fd = memfd_create("dc_shell heredoc", MFD_CLOEXEC);
+
+    if (fd == -1)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        return -1;
+    }
+
+    if (!write_all(fd, text, length) || lseek(fd, 0, SEEK_SET) == -1)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static bool write_all(int fd, const char *data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t written;
+
+        written = write(fd, data, length);
+
+        if (written == -1 && errno != EINTR)
+        {
+            return false;
+        }
+
+        if (written > 0)
+        {
+            data   += written;
+            length -= (size_t)written;
+        }
+    }
+
+    return true;
+}
+
+static void close_redirections(const struct command *command, int *opened)
+{
+    if (opened == NULL)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < command->redirection_count; ++i)
+    {
+        bool shared = false;
+
+        for (size_t j = 0; j < i && !shared; ++j)
+        {
+            shared = opened[j] == opened[i];
+        }
+
+        if (opened[i] != -1 && !shared)
+        {
+            close(opened[i]);
+        }
+    }
+
+    free(opened);
+}
+
+static int lowest_unnamed_fd(const struct command *command)
+{
+    int lowest = 10;
+
+    for (size_t i = 0; i < command->redirection_count; ++i)
+    {
+        if (command->redirections[i].fd >= lowest)
+        {
+            lowest = command->redirections[i].fd + 1;
+        }
+        if (command->redirections[i].source_fd >= lowest)
+        {
+            lowest = command->redirections[i].source_fd + 1;
+        }
+    }
+
+    return lowest;
+}
+
+static bool source_is_open(const struct command *command, size_t index)
+{
+    int source_fd;
+    int flags;
+
+    source_fd = command->redirections[index].source_fd;
+
+    for (size_t i = index; i > 0; --i)
+    {
+        if (command->redirections[i - 1].fd == source_fd)
+        {
+            return command->redirections[i - 1].type != REDIRECTION_CLOSE;
+        }
+    }
+
+    // the shell's own descriptors (eg. the script it is reading) are close on exec and not for the commands
+    flags = fcntl(source_fd, F_GETFD);
+
+    return source_fd <= STDERR_FILENO || (flags != -1 && (flags & FD_CLOEXEC) == 0);
+}
+
+bool redirect_shell(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                    struct saved_fds *saved)
+{
+    int *opened;
+    int lowest;
+
+    if (saved)
+    {
+        saved->fds    = NULL;
+        saved->copies = NULL;
+        saved->count  = 0;
+    }
+
+    opened = open_redirections(env, err, command);
+
+    if (saved && command->redirection_count > 0 && dc_error_has_no_error(err))
+    {
+        saved->fds    = dc_malloc(env, err, command->redirection_count * sizeof(int));
+        saved->copies = dc_malloc(env, err, command->redirection_count * sizeof(int));
+    }
+
+    if (dc_error_has_error(err))
+    {
+        // Same as a program that could not be started (see launch).
+        command->exit_code = err->err_code;
+        dc_error_reset(err);
+        close_redirections(command, opened);
+
+        if (saved)
+        {
+            restore_shell(saved);
         }
+
+        return false;
     }
-    return EXIT_FAILURE;
+
+    lowest = lowest_unnamed_fd(command);
+
+    for (size_t i = 0; i < command->redirection_count; ++i)
+    {
+        const struct redirection *redirection = &command->redirections[i];
+
+        if (saved)
+        {
+            save_fd(saved, redirection->fd, lowest);
+        }
+
+        if (redirection->type == REDIRECTION_DUP)
+        {
+            dup2(redirection->source_fd, redirection->fd);
+        }
+        else if (redirection->type == REDIRECTION_CLOSE)
+        {
+            close(redirection->fd);
+        }
+        else
+        {
+            dup2(opened[i], redirection->fd);
+        }
+    }
+
+    close_redirections(command, opened);
+
+    return true;
+}
+
+static void save_fd(struct saved_fds *saved, int fd, int lowest)
+{
+    for (size_t i = 0; i < saved->count; ++i)
+    {
+        if (saved->fds[i] == fd)
+        {
+            return;
+        }
+    }
+
+    // above every redirected descriptor and close on exec so that the saved copy never leaks into a program
+    saved->fds[saved->count]    = fd;
+    saved->copies[saved->count] = fcntl(fd, F_DUPFD_CLOEXEC, lowest);
+    saved->count++;
+}
+
+void restore_shell(struct saved_fds *saved)
+{
+    for (size_t i = 0; i < saved->count; ++i)
+    {
+        if (saved->copies[i] == -1)
+        {
+            // it was not open before the builtin
+            close(saved->fds[i]);
+        }
+        else
+        {
+            dup2(saved->copies[i], saved->fds[i]);
+            close(saved->copies[i]);
+        }
+    }
+
+    free(saved->fds);
+    free(saved->copies);
+    saved->fds    = NULL;
+    saved->copies = NULL;
+    saved->count  = 0;
+}
+
+char *resolve(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+              struct path_cache *path_cache)
+{
+    const char *program;
+
+    if (dc_strchr(env, command->command, '/'))
+    {
+        return dc_strdup(env, err, command->command);
+    }
+
+    program = path_cache_lookup(env, err, path_cache, command->command);
+
+    if (program == NULL)
+    {
+        return NULL;
+    }
+
+    return dc_strdup(env, err, program);
 }
 
 int handle_run_error(struct dc_error *err, struct command *command)
@@ -0,0 +1,1014 @@
+// d_type is not part of POSIX
+#define _DEFAULT_SOURCE
+
+#include <dirent.h>
+#include <fnmatch.h>
+#include <pwd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_string.h>
+#include "expand.h"
+#include "vars.h"
+
+#define DEFAULT_IFS " \t\n"
+
+/*! \struct buffer
+    \brief A string that grows as characters are added.
+*/
+struct buffer
+{
+    char *data;      /**< the characters, always ending with a null byte once something is added */
+    size_t length;   /**< the number of characters */
+    size_t capacity; /**< the size of data */
+};
+
+/*! \struct field
+    \brief The word being built, it becomes one or more words once it is finished.
+*/
+struct field
+{
+    struct buffer text;    /**< the word with the quotes removed */
+    struct buffer pattern; /**< the word for fnmatch, with the quoted glob characters escaped */
+    bool glob;             /**< there is an unquoted *, ? or [ */
+    bool started;          /**< there is a word, even if it is empty (eg. "") */
+};
+
+/**
+ * Add characters to a buffer.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param buffer the buffer.
+ * @param str the characters.
+ * @param length the number of characters.
+ */
+static void buffer_append(const struct dc_posix_env *env, struct dc_error *err, struct buffer *buffer,
+                          const char *str, size_t length);
+
+/**
+ * Add characters that are not special (quoted or from a quoted parameter) to the field.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param field the field.
+ * @param str the characters.
+ * @param length the number of characters.
+ */
+static void append_literal(const struct dc_posix_env *env, struct dc_error *err, struct field *field,
+                           const char *str, size_t length);
+
+/**
+ * Add an unquoted character to the field, *, ? and [ start a glob.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param field the field.
+ * @param c the character.
+ */
+static void append_unquoted(const struct dc_posix_env *env, struct dc_error *err, struct field *field, char c);
+
+/**
+ * Add the value of a parameter to the field. Outside of double quotes the value is split at the IFS characters.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena where to allocate the words.
+ * @param field the field.
+ * @param expansion where the fields that are split off go.
+ * @param value the value.
+ * @param length the number of characters in value.
+ * @param quoted the parameter is in double quotes.
+ * @param ifs the characters to split at.
+ */
+static void append_value(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                         struct field *field, struct expansion *expansion, const char *value, size_t length,
+                         bool quoted, const char *ifs);
+
+/**
+ * Turn the field into words (the paths it matches, or the text) and start the next one.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena where to allocate the words.
+ * @param field the field, emptied.
+ * @param expansion the words are added to the end.
+ */
+static void finish_field(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                         struct field *field, struct expansion *expansion);
+
+/**
+ * Expand a ~ or ~user at the start of the word.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param vars the variables (HOME), or NULL for the environment.
+ * @param field the field.
+ * @param c the ~.
+ * @param end the end of the word.
+ * @return the character after the user name, or c if it is not expanded (eg. the user does not exist).
+ */
+static const char *expand_tilde(const struct dc_posix_env *env, struct dc_error *err, const struct vars *vars,
+                                struct field *field, const char *c, const char *end);
+
+/**
+ * Expand $NAME, $$ or ${...}.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena where to allocate the words.
+ * @param vars the variables, or NULL for the environment.
+ * @param field the field.
+ * @param expansion where the fields that are split off go.
+ * @param c the $.
+ * @param end the end of the word.
+ * @param quoted the $ is in double quotes.
+ * @param ifs the characters to split at.
+ * @return the character after the parameter.
+ */
+static const char *expand_parameter(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                                    const struct vars *vars, struct field *field, struct expansion *expansion,
+                                    const char *c, const char *end, bool quoted, const char *ifs);
+
+/**
+ * Expand ${NAME}, ${NAME-word}, ${NAME:-word} or ${#NAME}. Anything else is kept as text.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena where to allocate the words.
+ * @param vars the variables, or NULL for the environment.
+ * @param field the field.
+ * @param expansion where the fields that are split off go.
+ * @param c the $.
+ * @param end the end of the word.
+ * @param quoted the $ is in double quotes.
+ * @param ifs the characters to split at.
+ * @return the character after the }.
+ */
+static const char *expand_braces(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                                 const struct vars *vars, struct field *field, struct expansion *expansion,
+                                 const char *c, const char *end, bool quoted, const char *ifs);
+
+/**
+ * Get the value of a variable.
+ *
+ * @param env the posix environment.
+ * @param vars the variables, or NULL for the environment.
+ * @param name the name, it does not have to end with a null byte.
+ * @param length the number of characters in name.
+ * @return the value or NULL if it is not set.
+ */
+static const char *lookup(const struct dc_posix_env *env, const struct vars *vars, const char *name, size_t length);
+
+/**
+ * Check if a character can start a variable name.
+ *
+ * @param c the character.
+ * @return true for a letter or _.
+ */
+static bool is_name_start(char c);
+
+/**
+ * Check if a character can be part of a variable name.
+ *
+ * @param c the character.
+ * @return true for a letter, digit or _.
+ */
+static bool is_name_char(char c);
+
+/**
+ * Add the paths that match a pattern, sorted, to the expansion.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena where to allocate the paths.
+ * @param pattern the pattern, with the characters that must match literally escaped by \.
+ * @param expansion the paths are added to the end.
+ * @return the number of paths that matched.
+ */
+static size_t glob_pattern(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                           const char *pattern, struct expansion *expansion);
+
+/**
+ * Add the entries of a directory that match one component of a pattern.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena where to allocate the paths.
+ * @param dir the directory ("" for the working directory).
+ * @param component the pattern for the names in the directory.
+ * @param need_dir only add the entries that are directories (there are more components to match inside them).
+ * @param paths the paths are added to the end.
+ */
+static void match_directory(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                            const char *dir, const char *component, bool need_dir, struct expansion *paths);
+
+/**
+ * Check if a pattern has an unescaped *, ? or [.
+ *
+ * @param pattern the pattern.
+ * @return true if it has to be matched against the directory.
+ */
+static bool has_glob(const char *pattern);
+
+/**
+ * Join a directory and a name.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena where to allocate the path.
+ * @param dir the directory, "" for none.
+ * @param name the name.
+ * @return the path.
+ */
+static char *join_path(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, const char *dir,
+                       const char *name);
+
+/**
+ * Add a word to the end of the expansion, doubling the array if it is full.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena where the array is allocated.
+ * @param expansion the expansion.
+ * @param word the word, the expansion takes ownership of it.
+ */
+static void add_word(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                     struct expansion *expansion, char *word);
+
+/**
+ * Free the words in an expansion and the array (nothing is freed for an arena).
+ *
+ * @param arena where the words are allocated.
+ * @param expansion the expansion, emptied.
+ */
+static void free_words(struct arena *arena, struct expansion *expansion);
+
+/**
+ * Compare two words for qsort.
+ *
+ * @param a a pointer to the first word.
+ * @param b a pointer to the second word.
+ * @return the order of the words (see strcmp).
+ */
+static int compare_words(const void *a, const void *b);
+
+/**
+ * Expand a word (see expand_word), or the value of an assignment where nothing is split or globbed.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena where to allocate the words and the array, or NULL to use malloc.
+ * @param vars the variables, or NULL for the environment.
+ * @param word the word as it was typed, with the quotes.
+ * @param length the number of characters in word.
+ * @param assignment expand as the value of NAME=value, which is always one word.
+ * @param expansion the words are added to the end.
+ */
+static void expand_fields(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                          const struct vars *vars, const char *word, size_t length, bool assignment,
+                          struct expansion *expansion);
+
+void expand_word(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, const struct vars *vars,
+                 const char *word, size_t length, struct expansion *expansion)
+{
+    expand_fields(env, err, arena, vars, word, length, false, expansion);
+}
+
+char *expand_assignment(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                        const struct vars *vars, const char *value, size_t length)
+{
+    struct expansion expansion;
+    char *expanded;
+
+    dc_memset(env, &expansion, 0, sizeof(struct expansion));
+    expand_fields(env, err, arena, vars, value, length, true, &expansion);
+
+    // FOO= has no word at all
+    if (expansion.count == 0)
+    {
+        expanded = arena_strdup(env, err, arena, "");
+    }
+    else
+    {
+        expanded        = expansion.words[0];
+        expansion.count = 0;
+    }
+
+    free_words(arena, &expansion);
+
+    return expanded;
+}
+
+static void expand_fields(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                          const struct vars *vars, const char *word, size_t length, bool assignment,
+                          struct expansion *expansion)
+{
+    struct field field;
+    const char *end;
+    const char *c;
+    const char *ifs;
+    char quote;
+
+    dc_memset(env, &field, 0, sizeof(struct field));
+    end   = word + length;
+    c     = word;
+    quote = '\0';
+    ifs   = lookup(env, vars, "IFS", 3);
+
+    if (ifs == NULL)
+    {
+        ifs = DEFAULT_IFS;
+    }
+
+    if (c < end && *c == '~')
+    {
+        c = expand_tilde(env, err, vars, &field, c, end);
+    }
+
+    while (c < end && dc_error_has_no_error(err))
+    {
+        if (quote == '\'')
+        {
+            const char *close;
+
+            for (close = c; close < end && *close != '\''; ++close)
+            {
+            }
+
+            append_literal(env, err, &field, c, (size_t)(close - c));
+            c     = close < end ? close + 1 : close;
+            quote = '\0';
+        }
+        else if (*c == '\'' && quote == '\0')
+        {
+            quote         = '\'';
+            field.started = true;
+            ++c;
+        }
+        else if (*c == '"')
+        {
+            quote         = quote == '"' ? '\0' : '"';
+            field.started = true;
+            ++c;
+        }
+        else if (*c == '\\' && c + 1 < end)
+        {
+            // inside double quotes a \ only quotes the characters that are special there
+            if (quote == '"' && dc_strchr(env, "$`\"\\\n", c[1]) == NULL)
+            {
+                append_literal(env, err, &field, c, 2);
+            }
+            else
+            {
+                append_literal(env, err, &field, c + 1, 1);
+            }
+            c += 2;
+        }
+        else if (*c == '$')
+        {
+            c = expand_parameter(env, err, arena, vars, &field, expansion, c, end, quote == '"' || assignment, ifs);
+        }
+        else if (quote == '\0' && !assignment && (*c == '*' || *c == '?' || *c == '['))
+        {
+            append_unquoted(env, err, &field, *c);
+            ++c;
+        }
+        else
+        {
+            const char *run;
+
+            // the characters up to the next one that may be special are copied as they are
+            for (run = c + 1; run < end && dc_strchr(env, "'\"\\$*?[", *run) == NULL; ++run)
+            {
+            }
+
+            append_literal(env, err, &field, c, (size_t)(run - c));
+            c = run;
+        }
+    }
+
+    if (field.started && dc_error_has_no_error(err))
+    {
+        finish_field(env, err, arena, &field, expansion);
+    }
+
+    free(field.text.data);
+    free(field.pattern.data);
+}
+
+char *expand_text(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, const struct vars *vars,
+                  const char *text, size_t length)
+{
+    struct field field;
+    struct expansion expansion;
+    const char *end;
+    const char *c;
+    char *expanded;
+
+    dc_memset(env, &field, 0, sizeof(struct field));
+    dc_memset(env, &expansion, 0, sizeof(struct expansion));
+    end = text + length;
+    c   = text;
+
+    while (c < end && dc_error_has_no_error(err))
+    {
+        if (*c == '\\' && c + 1 < end && dc_strchr(env, "$`\\", c[1]) != NULL)
+        {
+            append_literal(env, err, &field, c + 1, 1);
+            c += 2;
+        }
+        else if (*c == '$')
+        {
+            // as if it is quoted, so the value is never split
+            c = expand_parameter(env, err, arena, vars, &field, &expansion, c, end, true, DEFAULT_IFS);
+        }
+        else
+        {
+            const char *run;
+
+            for (run = c + 1; run < end && *run != '\\' && *run != '$'; ++run)
+            {
+            }
+
+            append_literal(env, err, &field, c, (size_t)(run - c));
+            c = run;
+        }
+    }
+
+    expanded = arena_strndup(env, err, arena, field.text.data ? field.text.data : "", field.text.length);
+    free_words(arena, &expansion);
+    free(field.text.data);
+    free(field.pattern.data);
+
+    return expanded;
+}
+
+static void buffer_append(const struct dc_posix_env *env, struct dc_error *err, struct buffer *buffer,
+                          const char *str, size_t length)
+{
+    if (buffer->length + length + 1 > buffer->capacity)
+    {
+        size_t capacity;
+        char *data;
+
+        capacity = buffer->capacity == 0 ? 64 : buffer->capacity;
+
+        while (capacity < buffer->length + length + 1)
+        {
+            capacity *= 2;
+        }
+
+        data = dc_realloc(env, err, buffer->data, capacity);
+
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+
+        buffer->data     = data;
+        buffer->capacity = capacity;
+    }
+
+    dc_memcpy(env, &buffer->data[buffer->length], str, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+}
+
+static void append_literal(const struct dc_posix_env *env, struct dc_error *err, struct field *field,
+                           const char *str, size_t length)
+{
+    const char *run;
+
+    field->started = true;
+    buffer_append(env, err, &field->text, str, length);
+    run = str;
+
+    // the pattern escapes anything fnmatch would treat as special
+    for (const char *c = str; c < str + length; ++c)
+    {
+        if (*c == '*' || *c == '?' || *c == '[' || *c == '\\')
+        {
+            buffer_append(env, err, &field->pattern, run, (size_t)(c - run));
+            buffer_append(env, err, &field->pattern, "\\", 1);
+            run = c;
+        }
+    }
+
+    buffer_append(env, err, &field->pattern, run, (size_t)(str + length - run));
+}
+
+static void append_unquoted(const struct dc_posix_env *env, struct dc_error *err, struct field *field, char c)
+{
+    if (c == '*' || c == '?' || c == '[')
+    {
+        field->started = true;
+        field->glob    = true;
+        buffer_append(env, err, &field->text, &c, 1);
+        buffer_append(env, err, &field->pattern, &c, 1);
+    }
+    else
+    {
+        append_literal(env, err, field, &c, 1);
+    }
+}
+
+static void append_value(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                         struct field *field, struct expansion *expansion, const char *value, size_t length,
+                         bool quoted, const char *ifs)
+{
+    if (quoted)
+    {
+        append_literal(env, err, field, value, length);
+        return;
+    }
+
+    for (size_t i = 0; i < length && dc_error_has_no_error(err); ++i)
+    {
+        if (value[i] != '\0' && dc_strchr(env, ifs, value[i]))
+        {
+            if (field->started)
+            {
+                finish_field(env, err, arena, field, expansion);
+            }
+        }
+        else
+        {
+            append_unquoted(env, err, field, value[i]);
+        }
+    }
+}
+
+static void finish_field(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                         struct field *field, struct expansion *expansion)
+{
+    // a glob that matches nothing is left as it is
+    if (!field->glob || glob_pattern(env, err, arena, field->pattern.data, expansion) == 0)
+    {
+        add_word(env, err, arena, expansion,
+                 arena_strndup(env, err, arena, field->text.data ? field->text.data : "", field->text.length));
+    }
+
+    field->text.length    = 0;
+    field->pattern.length = 0;
+    field->glob           = false;
+    field->started        = false;
+}
+
+static const char *expand_tilde(const struct dc_posix_env *env, struct dc_error *err, const struct vars *vars,
+                                struct field *field, const char *c, const char *end)
+{
+    const char *name_end;
+    const char *home;
+
+    for (name_end = c + 1; name_end < end && *name_end != '/'; ++name_end)
+    {
+        // ~"user" and ~$USER are not expanded
+        if (dc_strchr(env, "'\"\\$`", *name_end))
+        {
+            return c;
+        }
+    }
+
+    if (name_end == c + 1)
+    {
+        home = lookup(env, vars, "HOME", 4);
+
+        if (home == NULL)
+        {
+            struct passwd *pw;
+
+            pw   = getpwuid(getuid());
+            home = pw ? pw->pw_dir : NULL;
+        }
+    }
+    else
+    {
+        struct passwd *pw;
+        char *name;
+
+        name = strndup(c + 1, (size_t)(name_end - c - 1));
+        pw   = name ? getpwnam(name) : NULL;
+        home = pw ? pw->pw_dir : NULL;
+        free(name);
+    }
+
+    if (home == NULL)
+    {
+        return c;
+    }
+
+    append_literal(env, err, field, home, dc_strlen(env, home));
+
+    return name_end;
+}
+
+static const char *expand_parameter(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                                    const struct vars *vars, struct field *field, struct expansion *expansion,
+                                    const char *c, const char *end, bool quoted, const char *ifs)
+{
+    const char *name;
+    const char *name_end;
+    const char *value;
+
+    name = c + 1;
+
+    if (name < end && *name == '$')
+    {
+        char pid[32];
+
+        snprintf(pid, sizeof(pid), "%d", (int)getpid());
+        append_value(env, err, arena, field, expansion, pid, dc_strlen(env, pid), quoted, ifs);
+        return name + 1;
+    }
+
+    if (name < end && *name == '{')
+    {
+        return expand_braces(env, err, arena, vars, field, expansion, c, end, quoted, ifs);
+    }
+
+    // $(...), $1 and a $ on its own are kept as they are
+    if (name >= end || !is_name_start(*name))
+    {
+        append_literal(env, err, field, c, 1);
+        return name;
+    }
+
+    for (name_end = name; name_end < end && is_name_char(*name_end); ++name_end)
+    {
+    }
+
+    value = lookup(env, vars, name, (size_t)(name_end - name));
+
+    if (value)
+    {
+        append_value(env, err, arena, field, expansion, value, dc_strlen(env, value), quoted, ifs);
+    }
+    else if (quoted)
+    {
+        field->started = true;
+    }
+
+    return name_end;
+}
+
+static const char *expand_braces(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                                 const struct vars *vars, struct field *field, struct expansion *expansion,
+                                 const char *c, const char *end, bool quoted, const char *ifs)
+{
+    const char *close;
+    const char *name;
+    const char *name_end;
+    const char *value;
+    bool length;
+
+    for (close = c + 2; close < end && *close != '}'; ++close)
+    {
+    }
+
+    if (close >= end)
+    {
+        append_literal(env, err, field, c, 2);
+        return c + 2;
+    }
+
+    name   = c + 2;
+    length = name < close && *name == '#';
+
+    if (length)
+    {
+        ++name;
+    }
+
+    for (name_end = name; name_end < close && is_name_char(*name_end); ++name_end)
+    {
+    }
+
+    if (name_end == name || !is_name_start(*name) ||
+        (name_end < close && (length || (*name_end != '-' && (*name_end != ':' || name_end[1] != '-')))))
+    {
+        // ${VAR%...} and the rest are not supported, they are left as text
+        append_literal(env, err, field, c, (size_t)(close + 1 - c));
+        return close + 1;
+    }
+
+    value = lookup(env, vars, name, (size_t)(name_end - name));
+
+    if (length)
+    {
+        char count[32];
+
+        snprintf(count, sizeof(count), "%zu", value ? dc_strlen(env, value) : 0);
+        append_value(env, err, arena, field, expansion, count, dc_strlen(env, count), quoted, ifs);
+    }
+    else if (name_end < close && (value == NULL || (*name_end == ':' && *value == '\0')))
+    {
+        const char *word;
+
+        // the default is used as it is typed
+        word = name_end + (*name_end == ':' ? 2 : 1);
+        append_value(env, err, arena, field, expansion, word, (size_t)(close - word), quoted, ifs);
+    }
+    else if (value)
+    {
+        append_value(env, err, arena, field, expansion, value, dc_strlen(env, value), quoted, ifs);
+    }
+
+    if (quoted)
+    {
+        field->started = true;
+    }
+
+    return close + 1;
+}
+
+static const char *lookup(const struct dc_posix_env *env, const struct vars *vars, const char *name, size_t length)
+{
+    char copy[256];
+
+    if (vars)
+    {
+        return vars_get(vars, name, length);
+    }
+
+    if (length >= sizeof(copy))
+    {
+        return NULL;
+    }
+
+    dc_memcpy(env, copy, name, length);
+    copy[length] = '\0';
+
+    return dc_getenv(env, copy);
+}
+
+static bool is_name_start(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool is_name_char(char c)
+{
+    return is_name_start(c) || (c >= '0' && c <= '9');
+}
+
+static size_t glob_pattern(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                           const char *pattern, struct expansion *expansion)
+{
+    struct expansion paths;
+    const char *component;
+    size_t length;
+    size_t count;
+    bool literal_tail;
+
+    dc_memset(env, &paths, 0, sizeof(struct expansion));
+    length       = dc_strlen(env, pattern);
+    literal_tail = false;
+    add_word(env, err, arena, &paths, arena_strdup(env, err, arena, *pattern == '/' ? "/" : ""));
+
+    for (component = pattern; *component == '/'; ++component)
+    {
+    }
+
+    // one directory level at a time: the paths that match so far are the directories to look in next
+    while (*component && paths.count > 0 && dc_error_has_no_error(err))
+    {
+        struct expansion next;
+        const char *component_end;
+        char *part;
+        bool last;
+
+        component_end = dc_strchr(env, component, '/');
+
+        if (component_end == NULL)
+        {
+            component_end = component + dc_strlen(env, component);
+        }
+
+        // a pattern that ends with / only matches directories
+        last = *component_end == '\0';
+        part = arena_strndup(env, err, arena, component, (size_t)(component_end - component));
+        dc_memset(env, &next, 0, sizeof(struct expansion));
+
+        if (part && has_glob(part))
+        {
+            for (size_t i = 0; i < paths.count; ++i)
+            {
+                match_directory(env, err, arena, paths.words[i], part, !last, &next);
+            }
+            literal_tail = false;
+        }
+        else if (part)
+        {
+            char *name;
+            char *to;
+
+            // the escapes are only for fnmatch
+            name = part;
+            to   = part;
+            for (const char *from = part; *from; ++from)
+            {
+                if (*from == '\\' && from[1])
+                {
+                    ++from;
+                }
+                *to++ = *from;
+            }
+            *to = '\0';
+
+            for (size_t i = 0; i < paths.count; ++i)
+            {
+                add_word(env, err, arena, &next, join_path(env, err, arena, paths.words[i], name));
+            }
+            literal_tail = true;
+        }
+
+        arena_free(arena, part);
+        free_words(arena, &paths);
+        paths = next;
+
+        for (component = component_end; *component == '/'; ++component)
+        {
+        }
+    }
+
+    count = 0;
+
+    for (size_t i = 0; i < paths.count && dc_error_has_no_error(err); ++i)
+    {
+        struct stat st;
+        char *path;
+
+        path          = paths.words[i];
+        paths.words[i] = NULL;
+
+        // a literal name after a glob (eg. */Makefile) only counts if it is there
+        if (literal_tail && lstat(path, &st) == -1)
+        {
+            arena_free(arena, path);
+            continue;
+        }
+
+        if (length > 1 && pattern[length - 1] == '/')
+        {
+            char *dir;
+
+            dir = join_path(env, err, arena, path, "");
+            arena_free(arena, path);
+            path = dir;
+        }
+
+        add_word(env, err, arena, expansion, path);
+        count++;
+    }
+
+    free_words(arena, &paths);
+
+    if (count > 1)
+    {
+        qsort(&expansion->words[expansion->count - count], count, sizeof(char *), compare_words);
+    }
+
+    return count;
+}
+
+static void match_directory(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                            const char *dir, const char *component, bool need_dir, struct expansion *paths)
+{
+    DIR *stream;
+    struct dirent *entry;
+
+    stream = opendir(*dir ? dir : ".");
+
+    // a directory that cannot be read has no matches
+    if (stream == NULL)
+    {
+        return;
+    }
+
+    while ((entry = readdir(stream)) != NULL && dc_error_has_no_error(err))
+    {
+        char *path;
+
+        if (dc_strcmp(env, entry->d_name, ".") == 0 || dc_strcmp(env, entry->d_name, "..") == 0 ||
+            fnmatch(component, entry->d_name, FNM_PERIOD) != 0)
+        {
+            continue;
+        }
+
+        path = join_path(env, err, arena, dir, entry->d_name);
+
+        // d_type saves a stat for every entry, except on file systems that do not fill it in
+        if (need_dir && path && entry->d_type != DT_DIR)
+        {
+            struct stat st;
+
+            if (entry->d_type != DT_UNKNOWN && entry->d_type != DT_LNK)
+            {
+                arena_free(arena, path);
+                continue;
+            }
+
+            if (stat(path, &st) == -1 || !S_ISDIR(st.st_mode))
+            {
+                arena_free(arena, path);
+                continue;
+            }
+        }
+
+        add_word(env, err, arena, paths, path);
+    }
+
+    closedir(stream);
+}
+
+static bool has_glob(const char *pattern)
+{
+    for (const char *c = pattern; *c; ++c)
+    {
+        if (*c == '\\' && c[1])
+        {
+            ++c;
+        }
+        else if (*c == '*' || *c == '?' || *c == '[')
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static char *join_path(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, const char *dir,
+                       const char *name)
+{
+    size_t dir_length;
+    size_t name_length;
+    size_t separator;
+    char *path;
+
+    dir_length  = dc_strlen(env, dir);
+    name_length = dc_strlen(env, name);
+    separator   = dir_length > 0 && dir[dir_length - 1] != '/' ? 1 : 0;
+    path        = arena_alloc(env, err, arena, dir_length + separator + name_length + 1);
+
+    if (path)
+    {
+        dc_memcpy(env, path, dir, dir_length);
+        path[dir_length] = '/';
+        dc_memcpy(env, &path[dir_length + separator], name, name_length + 1);
+    }
+
+    return path;
+}
+
+static void add_word(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                     struct expansion *expansion, char *word)
+{
+    if (word == NULL)
+    {
+        return;
+    }
+
+    if (expansion->count == expansion->capacity)
+    {
+        size_t capacity;
+        char **words;
+
+        capacity = expansion->capacity == 0 ? 8 : expansion->capacity * 2;
+        words    = arena_realloc(env, err, arena, expansion->words, expansion->capacity * sizeof(char *),
+                                 capacity * sizeof(char *));
+
+        if (dc_error_has_error(err))
+        {
+            arena_free(arena, word);
+            return;
+        }
+
+        expansion->words    = words;
+        expansion->capacity = capacity;
+    }
+
+    expansion->words[expansion->count++] = word;
+}
+
+static void free_words(struct arena *arena, struct expansion *expansion)
+{
+    for (size_t i = 0; i < expansion->count; ++i)
+    {
+        arena_free(arena, expansion->words[i]);
+    }
+
+    arena_free(arena, expansion->words);
+    expansion->words    = NULL;
+    expansion->count    = 0;
+    expansion->capacity = 0;
+}
+
+static int compare_words(const void *a, const void *b)
+{
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
@@ -0,0 +1,345 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <dc_posix/dc_stdlib.h>
+#include "history.h"
+
+// "DCSHIST1" read as a little-endian word
+#define HISTORY_MAGIC UINT64_C(0x3154534948534344)
+
+// the ring starts after the header, on its own cache line
+#define HISTORY_HEADER_SIZE 64
+
+// the position, length and size words around the text of an entry
+#define HISTORY_ENTRY_OVERHEAD (3 * sizeof(uint64_t))
+
+/**
+ * Lock or unlock the whole file, so only one session sets up a new file.
+ *
+ * @param fd the file.
+ * @param type F_WRLCK or F_UNLCK.
+ * @return 0, or -1 with errno set.
+ */
+static int lock_file(int fd, short type);
+
+/**
+ * Get the word of the ring at a position.
+ *
+ * @param history the history.
+ * @param position a multiple of 8.
+ * @return the word.
+ */
+static uint64_t *ring_word(const struct history *history, uint64_t position);
+
+/**
+ * Check that no entry added since has reused the bytes of an entry.
+ *
+ * @param history the history.
+ * @param position the entry's position.
+ * @return true if the entry is still whole.
+ */
+static bool is_intact(const struct history *history, uint64_t position);
+
+/**
+ * Check that an entry has been written and is still whole.
+ *
+ * @param history the history.
+ * @param position the entry's position.
+ * @return true if the entry can be read.
+ */
+static bool is_valid(const struct history *history, uint64_t position);
+
+/**
+ * Copy bytes into the ring, going around the end if they need to.
+ *
+ * @param history the history.
+ * @param position where the bytes go in the ring.
+ * @param bytes the bytes.
+ * @param count the number of bytes.
+ */
+static void ring_write(const struct history *history, uint64_t position, const char *bytes, size_t count);
+
+/**
+ * Copy bytes out of the ring, going around the end if they need to.
+ *
+ * @param history the history.
+ * @param position where the bytes are in the ring.
+ * @param bytes where to copy them.
+ * @param count the number of bytes.
+ */
+static void ring_read(const struct history *history, uint64_t position, char *bytes, size_t count);
+
+struct history *history_open(const struct dc_posix_env *env, struct dc_error *err, const char *path,
+                             size_t capacity)
+{
+    struct history *history;
+    struct history_header header;
+    struct stat status;
+    int fd;
+
+    fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+
+    if (fd == -1)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        return NULL;
+    }
+
+    capacity = (capacity + 7) & ~(size_t)7;
+
+    // a session that finds an empty file sets it up while the others wait
+    if (lock_file(fd, F_WRLCK) == -1 || fstat(fd, &status) == -1)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        close(fd);
+        return NULL;
+    }
+
+    if (status.st_size == 0)
+    {
+        header.magic    = HISTORY_MAGIC;
+        header.capacity = capacity;
+        header.head     = 0;
+
+        if (ftruncate(fd, (off_t)(HISTORY_HEADER_SIZE + capacity)) == -1 ||
+            pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+        {
+            DC_ERROR_RAISE_ERRNO(err, errno);
+            close(fd);
+            return NULL;
+        }
+
+        status.st_size = (off_t)(HISTORY_HEADER_SIZE + capacity);
+    }
+    else if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+    {
+        header.magic = 0;
+    }
+
+    lock_file(fd, F_UNLCK);
+
+    // some other file, or one from a different version, is left alone
+    if (header.magic != HISTORY_MAGIC || header.capacity % 8 != 0 || header.capacity == 0 ||
+        (uint64_t)status.st_size != HISTORY_HEADER_SIZE + header.capacity)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    history = dc_calloc(env, err, 1, sizeof(struct history));
+
+    if (dc_error_has_error(err))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    history->fd       = fd;
+    history->capacity = (size_t)header.capacity;
+    history->map_size = HISTORY_HEADER_SIZE + history->capacity;
+    history->header   = mmap(NULL, history->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (history->header == MAP_FAILED)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        history->header = NULL;
+        history_close(env, &history);
+        return NULL;
+    }
+
+    history->ring = (unsigned char *)history->header + HISTORY_HEADER_SIZE;
+
+    return history;
+}
+
+void history_close(const struct dc_posix_env *env, struct history **phistory)
+{
+    struct history *history;
+
+    (void)env;
+    history = *phistory;
+
+    if (history)
+    {
+        if (history->header)
+        {
+            munmap(history->header, history->map_size);
+        }
+
+        close(history->fd);
+        free(history);
+    }
+
+    *phistory = NULL;
+}
+
+uint64_t history_add(struct history *history, const char *line, size_t length)
+{
+    uint64_t position;
+    uint64_t size;
+
+    if (length > history->capacity / 4)
+    {
+        return UINT64_MAX;
+    }
+
+    size     = HISTORY_ENTRY_OVERHEAD + ((length + 7) & ~(size_t)7);
+    position = __atomic_fetch_add(&history->header->head, size, __ATOMIC_ACQ_REL);
+
+    // the position goes in last, a reader does not trust the entry until it is there
+    __atomic_store_n(ring_word(history, position), UINT64_MAX, __ATOMIC_RELAXED);
+    __atomic_store_n(ring_word(history, position + 8), (uint64_t)length, __ATOMIC_RELAXED);
+    ring_write(history, position + 16, line, length);
+    __atomic_store_n(ring_word(history, position + size - 8), size, __ATOMIC_RELAXED);
+    __atomic_store_n(ring_word(history, position), position, __ATOMIC_RELEASE);
+
+    return position;
+}
+
+uint64_t history_end(const struct history *history)
+{
+    return __atomic_load_n(&history->header->head, __ATOMIC_ACQUIRE);
+}
+
+bool history_previous(const struct history *history, uint64_t position, uint64_t *previous)
+{
+    uint64_t size;
+    uint64_t max_size;
+
+    if (position < HISTORY_ENTRY_OVERHEAD || position % 8 != 0 || !is_intact(history, position - 8))
+    {
+        return false;
+    }
+
+    size     = __atomic_load_n(ring_word(history, position - 8), __ATOMIC_RELAXED);
+    max_size = HISTORY_ENTRY_OVERHEAD + history->capacity / 4 + 8;
+
+    if (size % 8 != 0 || size < HISTORY_ENTRY_OVERHEAD || size > max_size || size > position ||
+        !is_valid(history, position - size))
+    {
+        return false;
+    }
+
+    // the size that was read may be from before the entry was written
+    if (__atomic_load_n(ring_word(history, position - 8), __ATOMIC_RELAXED) != size)
+    {
+        return false;
+    }
+
+    *previous = position - size;
+
+    return true;
+}
+
+bool history_next(const struct history *history, uint64_t position, uint64_t *next)
+{
+    uint64_t length;
+
+    if (!is_valid(history, position))
+    {
+        return false;
+    }
+
+    length = __atomic_load_n(ring_word(history, position + 8), __ATOMIC_RELAXED);
+
+    if (length > history->capacity / 4 || !is_intact(history, position))
+    {
+        return false;
+    }
+
+    *next = position + HISTORY_ENTRY_OVERHEAD + ((length + 7) & ~(uint64_t)7);
+
+    return true;
+}
+
+bool history_read(const struct history *history, uint64_t position, char *line, size_t size, size_t *length)
+{
+    uint64_t text_length;
+    size_t count;
+
+    if (!is_valid(history, position))
+    {
+        return false;
+    }
+
+    text_length = __atomic_load_n(ring_word(history, position + 8), __ATOMIC_RELAXED);
+
+    if (text_length > history->capacity / 4)
+    {
+        return false;
+    }
+
+    count = size == 0 ? 0 : ((size_t)text_length < size ? (size_t)text_length : size - 1);
+    ring_read(history, position + 16, line, count);
+
+    if (size > 0)
+    {
+        line[count] = '\0';
+    }
+
+    *length = (size_t)text_length;
+
+    // another session may have reused the bytes while they were copied
+    return is_intact(history, position);
+}
+
+static int lock_file(int fd, short type)
+{
+    struct flock lock;
+    int result;
+
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type   = type;
+    lock.l_whence = SEEK_SET;
+
+    do
+    {
+        result = fcntl(fd, F_SETLKW, &lock);
+    }
+    while (result == -1 && errno == EINTR);
+
+    return result;
+}
+
+static uint64_t *ring_word(const struct history *history, uint64_t position)
+{
+    return (uint64_t *)(void *)&history->ring[position % history->capacity];
+}
+
+static bool is_intact(const struct history *history, uint64_t position)
+{
+    // the first byte of the entry is the first to be reused, once the head has gone a whole ring past it
+    return history_end(history) <= position + history->capacity;
+}
+
+static bool is_valid(const struct history *history, uint64_t position)
+{
+    return position % 8 == 0 && __atomic_load_n(ring_word(history, position), __ATOMIC_ACQUIRE) == position &&
+           is_intact(history, position);
+}
+
+static void ring_write(const struct history *history, uint64_t position, const char *bytes, size_t count)
+{
+    size_t offset;
+    size_t first;
+
+    offset = (size_t)(position % history->capacity);
+    first  = history->capacity - offset < count ? history->capacity - offset : count;
+    memcpy(&history->ring[offset], bytes, first);
+    memcpy(history->ring, &bytes[first], count - first);
+}
+
+static void ring_read(const struct history *history, uint64_t position, char *bytes, size_t count)
+{
+    size_t offset;
+    size_t first;
+
+    offset = (size_t)(position % history->capacity);
+    first  = history->capacity - offset < count ? history->capacity - offset : count;
+    memcpy(bytes, &history->ring[offset], first);
+    memcpy(&bytes[first], history->ring, count - first);
+}
@@ -0,0 +1,960 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <dc_posix/dc_stdlib.h>
+#include "history.h"
+#include "history_index.h"
+
+// "DCSHIDX1" read as a little-endian word
+#define HISTORY_INDEX_MAGIC UINT64_C(0x3158444948534344)
+
+// the number of trigram slots an empty index starts with
+#define HISTORY_INDEX_INITIAL_SLOTS 1024
+
+// the number of slots for the commands a search finds, twice the most it collects
+#define HISTORY_INDEX_MATCH_SLOTS 1024
+
+// a search stops once it has found this many entries, the older ones would hardly change the order
+#define HISTORY_INDEX_MAX_FOUND 512
+
+// the most trigrams of a query looked up, the text of each candidate is checked for the whole query anyway
+#define HISTORY_INDEX_MAX_TRIGRAMS 32
+
+// an entry this many entries old counts half as much as the newest one
+#define HISTORY_INDEX_RECENCY_SCALE 100.0
+
+/*! \struct history_index_header
+    \brief The start of a saved index, followed by the entries' positions and then each trigram's postings
+    (its key, its count and the sequence numbers).
+*/
+struct history_index_header
+{
+    uint64_t magic;         /**< HISTORY_INDEX_MAGIC */
+    uint64_t indexed_end;   /**< the history position up to which entries are indexed */
+    uint64_t entry_count;   /**< the number of entries */
+    uint64_t trigram_count; /**< the number of trigrams */
+    uint64_t base_seq;      /**< the sequence number of the first entry */
+};
+
+/**
+ * Get the key of the trigram starting at some text.
+ *
+ * @param text the three bytes.
+ * @return the key.
+ */
+static uint32_t trigram_key(const char *text);
+
+/**
+ * Find the slot for a trigram: the one it is in, or the empty one it would go in.
+ *
+ * @param index the index.
+ * @param key the trigram's key.
+ * @return the slot.
+ */
+static struct history_postings *find_slot(const struct history_index *index, uint32_t key);
+
+/**
+ * Find the postings of a trigram, adding a slot for it if there is none.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param index the index.
+ * @param key the trigram's key.
+ * @return the postings, or NULL if the table could not grow.
+ */
+static struct history_postings *add_slot(const struct dc_posix_env *env, struct dc_error *err,
+                                         struct history_index *index, uint32_t key);
+
+/**
+ * Double the number of trigram slots.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param index the index.
+ * @return false if it could not grow.
+ */
+static bool grow_slots(const struct dc_posix_env *env, struct dc_error *err, struct history_index *index);
+
+/**
+ * Add a sequence number to the end of some postings.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param postings the postings.
+ * @param seq the sequence number.
+ */
+static void add_posting(const struct dc_posix_env *env, struct dc_error *err, struct history_postings *postings,
+                        uint32_t seq);
+
+/**
+ * Forget every entry and trigram.
+ *
+ * @param index the index.
+ */
+static void clear(struct history_index *index);
+
+/**
+ * Read a saved index. A file that is missing, or not a valid index, leaves the index empty.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param index the index.
+ */
+static void load(const struct dc_posix_env *env, struct dc_error *err, struct history_index *index);
+
+/**
+ * Set up the index from the bytes of a saved one.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param index the empty index.
+ * @param bytes the saved index.
+ * @param size the number of bytes.
+ * @return false if the bytes are not a valid index.
+ */
+static bool parse(const struct dc_posix_env *env, struct dc_error *err, struct history_index *index,
+                  const unsigned char *bytes, size_t size);
+
+/**
+ * Copy the text of an entry into the index's text buffer, making it bigger if it has to.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param index the index.
+ * @param history the history.
+ * @param position the entry.
+ * @param length set to the length of the text.
+ * @return false if the entry is no longer valid.
+ */
+static bool read_text(const struct dc_posix_env *env, struct dc_error *err, struct history_index *index,
+                      const struct history *history, uint64_t position, size_t *length);
+
+/**
+ * Check whether some text contains a query.
+ *
+ * @param text the text.
+ * @param length the length of the text.
+ * @param query the query.
+ * @param query_length the length of the query.
+ * @return true if it does.
+ */
+static bool contains(const char *text, size_t length, const char *query, size_t query_length);
+
+/**
+ * Hash the text of a command, so the entries of the same command are counted together.
+ *
+ * @param text the text.
+ * @param length the length of the text.
+ * @return the hash, never 0.
+ */
+static uint64_t hash_text(const char *text, size_t length);
+
+/**
+ * Order matches by score, best first, then the newest first.
+ *
+ * @param a a struct history_match.
+ * @param b a struct history_match.
+ * @return the order.
+ */
+static int compare_matches(const void *a, const void *b);
+
+struct history_index *history_index_open(const struct dc_posix_env *env, struct dc_error *err, const char *path)
+{
+    struct history_index *index;
+
+    index = dc_calloc(env, err, 1, sizeof(struct history_index));
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    index->capacity = HISTORY_INDEX_INITIAL_SLOTS;
+    index->slots    = dc_calloc(env, err, index->capacity, sizeof(struct history_postings));
+
+    if (dc_error_has_error(err))
+    {
+        history_index_close(env, &index);
+        return NULL;
+    }
+
+    if (path)
+    {
+        index->path = dc_malloc(env, err, strlen(path) + 1);
+
+        if (dc_error_has_error(err))
+        {
+            history_index_close(env, &index);
+            return NULL;
+        }
+
+        strcpy(index->path, path);
+        load(env, err, index);
+
+        if (dc_error_has_error(err))
+        {
+            history_index_close(env, &index);
+            return NULL;
+        }
+    }
+
+    return index;
+}
+
+void history_index_close(const struct dc_posix_env *env, struct history_index **pindex)
+{
+    struct history_index *index;
+
+    (void)env;
+    index = *pindex;
+
+    if (index)
+    {
+        if (index->slots)
+        {
+            clear(index);
+        }
+
+        free(index->slots);
+        free(index->entries);
+        free(index->text);
+        free(index->matches);
+        free(index->pending);
+        free(index->path);
+        free(index);
+    }
+
+    *pindex = NULL;
+}
+
+void history_index_save(const struct dc_posix_env *env, struct dc_error *err, struct history_index *index)
+{
+    struct history_index_header header;
+    char *temporary;
+    size_t size;
+    FILE *file;
+    uint32_t first_seq;
+    int fd;
+
+    if (index->path == NULL)
+    {
+        return;
+    }
+
+    size      = strlen(index->path) + strlen(".XXXXXX") + 1;
+    temporary = dc_malloc(env, err, size);
+
+    if (temporary == NULL || dc_error_has_error(err))
+    {
+        return;
+    }
+
+    // written beside the index and renamed over it, so a session starting meanwhile loads the old one or the new one
+    snprintf(temporary, size, "%s.XXXXXX", index->path);
+    fd   = mkstemp(temporary);
+    file = fd == -1 ? NULL : fdopen(fd, "w");
+
+    if (file == NULL)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+
+        if (fd != -1)
+        {
+            close(fd);
+            unlink(temporary);
+        }
+
+        free(temporary);
+        return;
+    }
+
+    first_seq            = index->base_seq + (uint32_t)index->live;
+    header.magic         = HISTORY_INDEX_MAGIC;
+    header.indexed_end   = index->indexed_end;
+    header.entry_count   = index->entry_count - index->live;
+    header.base_seq      = first_seq;
+    header.trigram_count = 0;
+
+    for (size_t i = 0; i < index->capacity; ++i)
+    {
+        header.trigram_count += index->slots[i].key != 0 && index->slots[i].count > 0 &&
+                                index->slots[i].seqs[index->slots[i].count - 1] >= first_seq;
+    }
+
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(&index->entries[index->live], sizeof(uint64_t), index->entry_count - index->live, file);
+
+    // the postings of entries that were overwritten are left out, the oldest are first
+    for (size_t i = 0; i < index->capacity; ++i)
+    {
+        const struct history_postings *postings;
+        uint32_t start;
+        uint32_t count;
+
+        postings = &index->slots[i];
+
+        if (postings->key == 0 || postings->count == 0 || postings->seqs[postings->count - 1] < first_seq)
+        {
+            continue;
+        }
+
+        for (start = 0; postings->seqs[start] < first_seq; ++start)
+        {
+        }
+
+        count = postings->count - start;
+        fwrite(&postings->key, sizeof(uint32_t), 1, file);
+        fwrite(&count, sizeof(uint32_t), 1, file);
+        fwrite(&postings->seqs[start], sizeof(uint32_t), count, file);
+    }
+
+    if (ferror(file) || fclose(file) == EOF || rename(temporary, index->path) == -1)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        unlink(temporary);
+    }
+
+    free(temporary);
+}
+
+void history_index_add(const struct dc_posix_env *env, struct dc_error *err, struct history_index *index,
+                       uint64_t position, const char *line, size_t length)
+{
+    uint32_t seq;
+
+    if (index->entry_count == index->entry_capacity)
+    {
+        uint64_t *grown;
+        size_t capacity;
+
+        capacity = index->entry_capacity ? index->entry_capacity * 2 : 256;
+        grown    = dc_realloc(env, err, index->entries, capacity * sizeof(uint64_t));
+
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+
+        index->entries        = grown;
+        index->entry_capacity = capacity;
+    }
+
+    seq                                   = index->base_seq + (uint32_t)index->entry_count;
+    index->entries[index->entry_count++]  = position;
+    index->indexed_end                    = position + 1;
+
+    for (size_t i = 0; i + 3 <= length && dc_error_has_no_error(err); ++i)
+    {
+        struct history_postings *postings;
+
+        postings = add_slot(env, err, index, trigram_key(&line[i]));
+
+        // a trigram that is in the line more than once is only posted once
+        if (postings && (postings->count == 0 || postings->seqs[postings->count - 1] != seq))
+        {
+            add_posting(env, err, postings, seq);
+        }
+    }
+}
+
+void history_index_update(const struct dc_posix_env *env, struct dc_error *err, struct history_index *index,
+                          const struct history *history)
+{
+    uint64_t end;
+    uint64_t position;
+    uint64_t previous;
+    size_t count;
+    bool found;
+
+    end = history_end(history);
+
+    // the history file was replaced by a new one, the positions are of entries that are not there any more
+    if (end < index->indexed_end)
+    {
+        clear(index);
+    }
+
+    count    = 0;
+    position = end;
+
+    while ((found = history_previous(history, position, &previous)) && previous >= index->indexed_end)
+    {
+        if (count == index->pending_capacity)
+        {
+            uint64_t *grown;
+            size_t capacity;
+
+            capacity = index->pending_capacity ? index->pending_capacity * 2 : 64;
+            grown    = dc_realloc(env, err, index->pending, capacity * sizeof(uint64_t));
+
+            if (dc_error_has_error(err))
+            {
+                return;
+            }
+
+            index->pending          = grown;
+            index->pending_capacity = capacity;
+        }
+
+        index->pending[count++] = previous;
+        position                = previous;
+    }
+
+    // an entry that is too new to have been overwritten is still being written by another session,
+    // the ones after it wait for it, unless it was already waited for once (its session died writing it)
+    if (!found && position > index->indexed_end && end - position < history->capacity / 2 &&
+        position != index->stalled)
+    {
+        index->stalled = position;
+        return;
+    }
+
+    // oldest first, so the sequence numbers are in the order of the history
+    while (count > 0 && dc_error_has_no_error(err))
+    {
+        size_t length;
+
+        position = index->pending[--count];
+
+        if (read_text(env, err, index, history, position, &length))
+        {
+            history_index_add(env, err, index, position, index->text, length);
+        }
+    }
+
+    index->indexed_end = end > index->indexed_end ? end : index->indexed_end;
+
+    while (index->live < index->entry_count && index->entries[index->live] + history->capacity < end)
+    {
+        index->live++;
+    }
+
+    // the overwritten entries' positions are dropped once they are most of the array, their postings stay until a save
+    if (index->live > 1024 && index->live > index->entry_count / 2)
+    {
+        memmove(index->entries, &index->entries[index->live], (index->entry_count - index->live) * sizeof(uint64_t));
+        index->base_seq    += (uint32_t)index->live;
+        index->entry_count -= index->live;
+        index->live         = 0;
+    }
+}
+
+size_t history_index_search(const struct dc_posix_env *env, struct dc_error *err, struct history_index *index,
+                            const struct history *history, const char *query, size_t length, uint64_t *results,
+                            size_t max)
+{
+    const struct history_postings *trigrams[HISTORY_INDEX_MAX_TRIGRAMS];
+    uint32_t cursors[HISTORY_INDEX_MAX_TRIGRAMS];
+    const struct history_postings *rarest;
+    uint32_t first_seq;
+    uint32_t newest_seq;
+    size_t trigram_count;
+    size_t remaining;
+    size_t found;
+    size_t distinct;
+    size_t count;
+
+    if (index->matches == NULL)
+    {
+        index->matches = dc_malloc(env, err, HISTORY_INDEX_MATCH_SLOTS * sizeof(struct history_match));
+
+        if (dc_error_has_error(err))
+        {
+            return 0;
+        }
+
+        index->match_capacity = HISTORY_INDEX_MATCH_SLOTS;
+    }
+
+    memset(index->matches, 0, index->match_capacity * sizeof(struct history_match));
+    first_seq     = index->base_seq + (uint32_t)index->live;
+    newest_seq    = index->base_seq + (uint32_t)index->entry_count - 1;
+    rarest        = NULL;
+    trigram_count = 0;
+
+    // the candidates are the entries in the postings of the query's rarest trigram, a short query looks at every entry
+    for (size_t i = 0; i + 3 <= length && trigram_count < HISTORY_INDEX_MAX_TRIGRAMS; ++i)
+    {
+        const struct history_postings *postings;
+
+        postings = find_slot(index, trigram_key(&query[i]));
+
+        if (postings->key == 0)
+        {
+            return 0;
+        }
+
+        if (rarest == NULL || postings->count < rarest->count)
+        {
+            rarest = postings;
+        }
+
+        trigrams[trigram_count] = postings;
+        cursors[trigram_count]  = postings->count;
+        trigram_count++;
+    }
+
+    remaining = rarest ? rarest->count : index->entry_count;
+    found     = 0;
+    distinct  = 0;
+
+    while (remaining > 0 && found < HISTORY_INDEX_MAX_FOUND && dc_error_has_no_error(err))
+    {
+        struct history_match *match;
+        uint64_t position;
+        uint64_t hash;
+        uint32_t seq;
+        size_t text_length;
+        size_t slot;
+        bool in_all;
+
+        --remaining;
+        seq = rarest ? rarest->seqs[remaining] : index->base_seq + (uint32_t)remaining;
+
+        if (seq < first_seq)
+        {
+            break;
+        }
+
+        in_all = true;
+
+        // the entry must have every trigram of the query before its text is worth reading,
+        // the candidates go down so each trigram's postings are walked down once alongside them
+        for (size_t i = 0; in_all && i < trigram_count; ++i)
+        {
+            while (cursors[i] > 0 && trigrams[i]->seqs[cursors[i] - 1] > seq)
+            {
+                cursors[i]--;
+            }
+
+            in_all = cursors[i] > 0 && trigrams[i]->seqs[cursors[i] - 1] == seq;
+        }
+
+        position = index->entries[seq - index->base_seq];
+
+        if (!in_all || !read_text(env, err, index, history, position, &text_length) ||
+            !contains(index->text, text_length, query, length))
+        {
+            continue;
+        }
+
+        ++found;
+        hash = hash_text(index->text, text_length);
+
+        for (slot = hash & (index->match_capacity - 1); index->matches[slot].hash != 0 && index->matches[slot].hash != hash;
+             slot = (slot + 1) & (index->match_capacity - 1))
+        {
+        }
+
+        match = &index->matches[slot];
+
+        // the entries are visited newest first, so the first one of a command is the one to show
+        if (match->hash == 0)
+        {
+            match->hash     = hash;
+            match->position = position;
+            ++distinct;
+        }
+
+        match->score += 1.0 / (1.0 + (double)(newest_seq - seq) / HISTORY_INDEX_RECENCY_SCALE);
+
+        if (distinct == index->match_capacity / 2)
+        {
+            break;
+        }
+    }
+
+    count = 0;
+
+    for (size_t i = 0; i < index->match_capacity; ++i)
+    {
+        if (index->matches[i].hash != 0)
+        {
+            index->matches[count++] = index->matches[i];
+        }
+    }
+
+    qsort(index->matches, count, sizeof(struct history_match), compare_matches);
+    count = count < max ? count : max;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        results[i] = index->matches[i].position;
+    }
+
+    return count;
+}
+
+static uint32_t trigram_key(const char *text)
+{
+    const unsigned char *bytes;
+
+    bytes = (const unsigned char *)text;
+
+    return (UINT32_C(1) << 24) | ((uint32_t)bytes[0] << 16) | ((uint32_t)bytes[1] << 8) | bytes[2];
+}
+
+static struct history_postings *find_slot(const struct history_index *index, uint32_t key)
+{
+    size_t slot;
+
+    slot = (size_t)((key * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & (index->capacity - 1);
+
+    while (index->slots[slot].key != 0 && index->slots[slot].key != key)
+    {
+        slot = (slot + 1) & (index->capacity - 1);
+    }
+
+    return &index->slots[slot];
+}
+
+static struct history_postings *add_slot(const struct dc_posix_env *env, struct dc_error *err,
+                                         struct history_index *index, uint32_t key)
+{
+    struct history_postings *postings;
+
+    postings = find_slot(index, key);
+
+    if (postings->key != 0)
+    {
+        return postings;
+    }
+
+    // kept at most half full, so a probe stays short
+    if ((index->count + 1) * 2 > index->capacity)
+    {
+        if (!grow_slots(env, err, index))
+        {
+            return NULL;
+        }
+
+        postings = find_slot(index, key);
+    }
+
+    postings->key = key;
+    index->count++;
+
+    return postings;
+}
+
+static bool grow_slots(const struct dc_posix_env *env, struct dc_error *err, struct history_index *index)
+{
+    struct history_postings *old;
+    size_t old_capacity;
+
+    old          = index->slots;
+    old_capacity = index->capacity;
+    index->slots = dc_calloc(env, err, old_capacity * 2, sizeof(struct history_postings));
+
+    if (dc_error_has_error(err))
+    {
+        index->slots = old;
+        return false;
+    }
+
+    index->capacity = old_capacity * 2;
+
+    for (size_t i = 0; i < old_capacity; ++i)
+    {
+        if (old[i].key != 0)
+        {
+            *find_slot(index, old[i].key) = old[i];
+        }
+    }
+
+    free(old);
+
+    return true;
+}
+
+static void add_posting(const struct dc_posix_env *env, struct dc_error *err, struct history_postings *postings,
+                        uint32_t seq)
+{
+    if (postings->count == postings->capacity)
+    {
+        uint32_t *grown;
+        uint32_t capacity;
+
+        capacity = postings->capacity ? postings->capacity * 2 : 4;
+        grown    = dc_realloc(env, err, postings->seqs, capacity * sizeof(uint32_t));
+
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+
+        postings->seqs     = grown;
+        postings->capacity = capacity;
+    }
+
+    postings->seqs[postings->count++] = seq;
+}
+
+static void clear(struct history_index *index)
+{
+    for (size_t i = 0; i < index->capacity; ++i)
+    {
+        free(index->slots[i].seqs);
+    }
+
+    memset(index->slots, 0, index->capacity * sizeof(struct history_postings));
+    index->count       = 0;
+    index->entry_count = 0;
+    index->live        = 0;
+    index->base_seq    = 0;
+    index->indexed_end = 0;
+    index->stalled     = 0;
+}
+
+static void load(const struct dc_posix_env *env, struct dc_error *err, struct history_index *index)
+{
+    unsigned char *bytes;
+    struct stat status;
+    size_t done;
+    int fd;
+
+    fd = open(index->path, O_RDONLY | O_CLOEXEC);
+
+    // there is no index yet, the first update indexes the whole history
+    if (fd == -1 && errno == ENOENT)
+    {
+        return;
+    }
+
+    if (fd == -1 || fstat(fd, &status) == -1)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+
+        if (fd != -1)
+        {
+            close(fd);
+        }
+
+        return;
+    }
+
+    bytes = dc_malloc(env, err, (size_t)status.st_size + 1);
+
+    if (dc_error_has_error(err))
+    {
+        close(fd);
+        return;
+    }
+
+    for (done = 0; done < (size_t)status.st_size;)
+    {
+        ssize_t count;
+
+        count = read(fd, &bytes[done], (size_t)status.st_size - done);
+
+        if (count == -1 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (count <= 0)
+        {
+            break;
+        }
+
+        done += (size_t)count;
+    }
+
+    close(fd);
+
+    // an index that is damaged (or from another version) is thrown away and the history indexed again
+    if (!parse(env, err, index, bytes, done))
+    {
+        clear(index);
+    }
+
+    free(bytes);
+}
+
+static bool parse(const struct dc_posix_env *env, struct dc_error *err, struct history_index *index,
+                  const unsigned char *bytes, size_t size)
+{
+    struct history_index_header header;
+    size_t offset;
+
+    if (size < sizeof(header))
+    {
+        return false;
+    }
+
+    memcpy(&header, bytes, sizeof(header));
+    offset = sizeof(header);
+
+    if (header.magic != HISTORY_INDEX_MAGIC || header.base_seq > UINT32_MAX ||
+        header.entry_count > UINT32_MAX - header.base_seq || header.entry_count > (size - offset) / sizeof(uint64_t))
+    {
+        return false;
+    }
+
+    index->entry_capacity = header.entry_count > 256 ? (size_t)header.entry_count : 256;
+    index->entries        = dc_malloc(env, err, index->entry_capacity * sizeof(uint64_t));
+
+    if (dc_error_has_error(err))
+    {
+        index->entry_capacity = 0;
+        return false;
+    }
+
+    memcpy(index->entries, &bytes[offset], (size_t)header.entry_count * sizeof(uint64_t));
+    offset            += (size_t)header.entry_count * sizeof(uint64_t);
+    index->entry_count = (size_t)header.entry_count;
+    index->base_seq    = (uint32_t)header.base_seq;
+    index->indexed_end = header.indexed_end;
+
+    for (uint64_t i = 0; i < header.trigram_count; ++i)
+    {
+        struct history_postings *postings;
+        uint32_t key;
+        uint32_t count;
+
+        if (size - offset < 2 * sizeof(uint32_t))
+        {
+            return false;
+        }
+
+        memcpy(&key, &bytes[offset], sizeof(uint32_t));
+        memcpy(&count, &bytes[offset + sizeof(uint32_t)], sizeof(uint32_t));
+        offset += 2 * sizeof(uint32_t);
+
+        if ((key >> 24) != 1 || count == 0 || count > (size - offset) / sizeof(uint32_t) ||
+            find_slot(index, key)->key != 0)
+        {
+            return false;
+        }
+
+        postings = add_slot(env, err, index, key);
+
+        if (postings == NULL)
+        {
+            return false;
+        }
+
+        postings->seqs = dc_malloc(env, err, count * sizeof(uint32_t));
+
+        if (dc_error_has_error(err))
+        {
+            return false;
+        }
+
+        memcpy(postings->seqs, &bytes[offset], count * sizeof(uint32_t));
+        postings->count    = count;
+        postings->capacity = count;
+        offset            += count * sizeof(uint32_t);
+
+        // a search relies on the postings being in order and naming entries that are there
+        for (uint32_t j = 0; j < count; ++j)
+        {
+            if (postings->seqs[j] < index->base_seq || postings->seqs[j] - index->base_seq >= index->entry_count ||
+                (j > 0 && postings->seqs[j] <= postings->seqs[j - 1]))
+            {
+                return false;
+            }
+        }
+    }
+
+    return offset == size;
+}
+
+static bool read_text(const struct dc_posix_env *env, struct dc_error *err, struct history_index *index,
+                      const struct history *history, uint64_t position, size_t *length)
+{
+    char *grown;
+
+    if (!history_read(history, position, index->text, index->text_capacity, length))
+    {
+        return false;
+    }
+
+    if (*length < index->text_capacity)
+    {
+        return true;
+    }
+
+    grown = dc_realloc(env, err, index->text, *length + 1);
+
+    if (dc_error_has_error(err))
+    {
+        return false;
+    }
+
+    index->text          = grown;
+    index->text_capacity = *length + 1;
+
+    return history_read(history, position, index->text, index->text_capacity, length) &&
+           *length < index->text_capacity;
+}
+
+static bool contains(const char *text, size_t length, const char *query, size_t query_length)
+{
+    if (query_length == 0)
+    {
+        return true;
+    }
+
+    for (size_t i = 0; i + query_length <= length; ++i)
+    {
+        const char *first;
+
+        first = memchr(&text[i], query[0], length - query_length - i + 1);
+
+        if (first == NULL)
+        {
+            return false;
+        }
+
+        i = (size_t)(first - text);
+
+        if (memcmp(first, query, query_length) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static uint64_t hash_text(const char *text, size_t length)
+{
+    uint64_t hash;
+
+    // FNV-1a
+    hash = UINT64_C(14695981039346656037);
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= (unsigned char)text[i];
+        hash *= UINT64_C(1099511628211);
+    }
+
+    return hash | 1;
+}
+
+static int compare_matches(const void *a, const void *b)
+{
+    const struct history_match *first;
+    const struct history_match *second;
+
+    first  = a;
+    second = b;
+
+    if (first->score > second->score)
+    {
+        return -1;
+    }
+
+    if (first->score < second->score)
+    {
+        return 1;
+    }
+
+    return first->position > second->position ? -1 : first->position < second->position;
+}
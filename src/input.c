@@ -1,12 +1,235 @@
-#include <dc_util/strings.h>
-#include <dc_posix/dc_string.h>
+#include <ctype.h>
+#include <errno.h>
 #include <dc_posix/dc_stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include "input.h"
 
-char *read_command_line(const struct dc_posix_env *env, struct dc_error *err, FILE *stream, size_t *line_size) {
-    char *line = NULL;
-    dc_getline(env, err, &line, line_size, stream);
-    line = dc_strdup(env, err, dc_str_trim(env, line));
-    *line_size = dc_strlen(env, line);
-    return line;
+// a script is read in blocks of this size, a terminal only ever gives a line at a time
+#define INPUT_BLOCK_SIZE 65536
+
+/**
+ * Read more of the stream into the buffer after the bytes already there,
+ * moving the bytes that have not been returned to the start of the buffer (or growing it) if it is full.
+ * Sets input->eof at the end of the stream.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param input the reader.
+ * @return the number of bytes the start of the unreturned bytes moved back by.
+ */
+static size_t fill(const struct dc_posix_env *env, struct dc_error *err, struct input *input);
+
+struct input *input_create(const struct dc_posix_env *env, struct dc_error *err, FILE *stream)
+{
+    struct input *input;
+
+    input = dc_calloc(env, err, 1, sizeof(struct input));
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    input->stream   = stream;
+    input->fd       = stream ? fileno(stream) : -1;
+    input->eof      = stream == NULL;
+    input->capacity = INPUT_BLOCK_SIZE;
+    input->buffer   = dc_malloc(env, err, input->capacity);
+
+    if (dc_error_has_error(err))
+    {
+        input_destroy(env, &input);
+        return NULL;
+    }
+
+    input->buffer[0] = '\0';
+
+    return input;
+}
+
+void input_destroy(const struct dc_posix_env *env, struct input **pinput)
+{
+    (void)env;
+
+    if (*pinput)
+    {
+        free((*pinput)->buffer);
+        free(*pinput);
+    }
+
+    *pinput = NULL;
+}
+
+char *input_read_line(const struct dc_posix_env *env, struct dc_error *err, struct input *input, size_t *length)
+{
+    size_t from;
+    char *line;
+
+    from = input->start;
+
+    for (;;)
+    {
+        char *newline;
+
+        newline = memchr(&input->buffer[from], '\n', input->end - from);
+
+        if (newline)
+        {
+            line          = &input->buffer[input->start];
+            *newline      = '\0';
+            *length       = (size_t)(newline - line);
+            input->start  = (size_t)(newline + 1 - input->buffer);
+
+            return line;
+        }
+
+        if (input->eof || dc_error_has_error(err))
+        {
+            break;
+        }
+
+        // only the bytes read this time can have the newline
+        from  = input->end;
+        from -= fill(env, err, input);
+    }
+
+    // the buffer always has a byte spare after the end for the null byte
+    line                      = &input->buffer[input->start];
+    *length                   = input->end - input->start;
+    input->buffer[input->end] = '\0';
+    input->start              = input->end;
+
+    return *length > 0 ? line : NULL;
+}
+
+void input_release(struct input *input)
+{
+    off_t ahead;
+
+    if (input->fd == -1 || input->start == input->end)
+    {
+        return;
+    }
+
+    ahead = (off_t)(input->end - input->start);
+
+    if (lseek(input->fd, -ahead, SEEK_CUR) != -1)
+    {
+        input->end = input->start;
+        input->eof = false;
+    }
+}
+
+char *read_command_line(const struct dc_posix_env *env, struct dc_error *err, struct input *input,
+                        size_t *line_size)
+{
+    size_t length;
+    char *start;
+
+    start = input_read_line(env, err, input, &length);
+
+    // at the end of the stream the line is the empty string after the last line
+    if (start == NULL)
+    {
+        *line_size = 0;
+        return dc_error_has_error(err) ? NULL : &input->buffer[input->start];
+    }
+
+    return input_trim(start, length, line_size);
+}
+
+char *input_trim(char *line, size_t length, size_t *trimmed_length)
+{
+    char *start;
+    char *end;
+
+    // the length is already known, a '\0' inside the line still ends the command as it would a string
+    start = line;
+    end   = memchr(line, '\0', length);
+    end   = end ? end : line + length;
+
+    while (end > start && isspace((unsigned char)end[-1]))
+    {
+        --end;
+    }
+
+    while (start < end && isspace((unsigned char)*start))
+    {
+        ++start;
+    }
+
+    *end            = '\0';
+    *trimmed_length = (size_t)(end - start);
+
+    return start;
+}
+
+static size_t fill(const struct dc_posix_env *env, struct dc_error *err, struct input *input)
+{
+    size_t moved;
+    size_t room;
+    ssize_t count;
+
+    moved = 0;
+
+    // a line that does not fit in what is left of the buffer moves to the front, or the buffer doubles
+    if (input->end + 1 >= input->capacity)
+    {
+        if (input->start > 0)
+        {
+            moved = input->start;
+            memmove(input->buffer, &input->buffer[input->start], input->end - input->start);
+            input->end  -= input->start;
+            input->start = 0;
+        }
+        else
+        {
+            char *grown;
+
+            grown = dc_realloc(env, err, input->buffer, input->capacity * 2);
+
+            if (dc_error_has_error(err))
+            {
+                return 0;
+            }
+
+            input->buffer    = grown;
+            input->capacity *= 2;
+        }
+    }
+
+    room = input->capacity - input->end - 1;
+
+    if (input->fd != -1)
+    {
+        do
+        {
+            count = read(input->fd, &input->buffer[input->end], room);
+        }
+        while (count == -1 && errno == EINTR);
+
+        if (count == -1)
+        {
+            DC_ERROR_RAISE_ERRNO(err, errno);
+            return moved;
+        }
+    }
+    else
+    {
+        count = (ssize_t)fread(&input->buffer[input->end], 1, room, input->stream);
+
+        if (count == 0 && ferror(input->stream))
+        {
+            DC_ERROR_RAISE_ERRNO(err, EIO);
+            return moved;
+        }
+    }
+
+    input->reads++;
+    input->end += (size_t)count;
+    input->eof  = count == 0;
+
+    return moved;
 }
@@ -0,0 +1,535 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_string.h>
+#include "jobs.h"
+
+/**
+ * Set by the SIGCHLD handler, cleared when the jobs are reaped.
+ */
+static volatile sig_atomic_t sigchld_pending = 0;
+
+/**
+ * Set by the SIGINT and SIGQUIT handler of a shell with job control, see jobs->interrupted.
+ */
+static volatile sig_atomic_t interrupt_pending = 0;
+
+/**
+ * The signals a shell with job control handles, in the order of jobs->old_signals.
+ * The first two are caught by interrupt_handler, the rest are ignored.
+ */
+static const int job_control_signals[JOBS_SIGNAL_COUNT] = {SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU};
+
+/**
+ * Note that a child changed state, the reaping is done outside of the handler.
+ *
+ * @param signo the signal number (SIGCHLD).
+ */
+static void sigchld_handler(int signo);
+
+/**
+ * Note that ^C or ^\ was typed while the shell was in the foreground.
+ *
+ * @param signo the signal number (SIGINT or SIGQUIT).
+ */
+static void interrupt_handler(int signo);
+
+/**
+ * Record the new state of one of the job's processes.
+ *
+ * @param job the job.
+ * @param index the process that changed state.
+ * @param status the status from waitpid.
+ */
+static void update_job(struct job *job, size_t index, int status);
+
+/**
+ * Get the name of the job status.
+ *
+ * @param job the job.
+ * @param buf the buffer for "Exit n".
+ * @param size the size of the buffer.
+ * @return the status name.
+ */
+static const char *status_name(const struct job *job, char *buf, size_t size);
+
+struct jobs *jobs_create(const struct dc_posix_env *env, struct dc_error *err)
+{
+    struct jobs *jobs;
+    struct sigaction action;
+
+    jobs = dc_calloc(env, err, 1, sizeof(struct jobs));
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    dc_memset(env, &action, 0, sizeof(struct sigaction));
+    action.sa_handler = sigchld_handler;
+    sigemptyset(&action.sa_mask);
+    // reads of the next command line must not fail with EINTR
+    action.sa_flags = SA_RESTART;
+
+    if (sigaction(SIGCHLD, &action, &jobs->old_sigchld) == -1)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        free(jobs);
+        return NULL;
+    }
+
+    jobs->terminal    = -1;
+    jobs->pgid        = getpgrp();
+    jobs->interrupted = &interrupt_pending;
+
+    return jobs;
+}
+
+void jobs_control(const struct dc_posix_env *env, struct dc_error *err, struct jobs *jobs, int terminal)
+{
+    struct sigaction action;
+    pid_t foreground;
+
+    foreground = tcgetpgrp(terminal);
+
+    // not the controlling terminal, there is nothing to control
+    if (foreground == -1)
+    {
+        return;
+    }
+
+    // started in the background (eg. dc_shell &), the terminal stops the shell until it is brought to the foreground
+    while (foreground != getpgrp())
+    {
+        kill(-getpgrp(), SIGTTIN);
+        foreground = tcgetpgrp(terminal);
+    }
+
+    dc_memset(env, &action, 0, sizeof(struct sigaction));
+    sigemptyset(&action.sa_mask);
+
+    for (size_t i = 0; i < JOBS_SIGNAL_COUNT; ++i)
+    {
+        // no SA_RESTART, a ^C must get the shell out of a blocking call (eg. waitpid in wait)
+        action.sa_handler = job_control_signals[i] == SIGINT || job_control_signals[i] == SIGQUIT ? interrupt_handler
+                                                                                                   : SIG_IGN;
+
+        if (sigaction(job_control_signals[i], &action, &jobs->old_signals[i]) == -1)
+        {
+            DC_ERROR_RAISE_ERRNO(err, errno);
+
+            while (i > 0)
+            {
+                --i;
+                sigaction(job_control_signals[i], &jobs->old_signals[i], NULL);
+            }
+            return;
+        }
+    }
+
+    // a session leader (eg. started by login) is already its own group and cannot be moved
+    if (getpgrp() != getpid())
+    {
+        setpgid(0, 0);
+    }
+
+    jobs->pgid     = getpgrp();
+    jobs->terminal = terminal;
+    tcsetpgrp(terminal, jobs->pgid);
+}
+
+void jobs_release(struct jobs *jobs)
+{
+    if (jobs->terminal == -1)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < JOBS_SIGNAL_COUNT; ++i)
+    {
+        sigaction(job_control_signals[i], &jobs->old_signals[i], NULL);
+    }
+
+    jobs->terminal = -1;
+}
+
+void jobs_foreground(struct jobs *jobs, pid_t pgid)
+{
+    // the shell ignores SIGTTOU, so it can do this while it is in the background
+    if (jobs->terminal != -1 && pgid > 0)
+    {
+        tcsetpgrp(jobs->terminal, pgid);
+    }
+}
+
+void jobs_destroy(const struct dc_posix_env *env, struct jobs **pjobs)
+{
+    struct jobs *jobs;
+
+    jobs = *pjobs;
+
+    if (jobs)
+    {
+        sigaction(SIGCHLD, &jobs->old_sigchld, NULL);
+        jobs_release(jobs);
+
+        while (jobs->count > 0)
+        {
+            jobs_remove(env, jobs, &jobs->job[0]);
+        }
+
+        free(jobs->job);
+        free(jobs);
+    }
+
+    *pjobs = NULL;
+}
+
+struct job *jobs_add(const struct dc_posix_env *env, struct dc_error *err, struct jobs *jobs, const char *line,
+                     const pid_t *pids, const int *exit_codes, size_t count, bool pipefail)
+{
+    struct job *resized;
+    struct job *job;
+    int id;
+
+    resized = dc_realloc(env, err, jobs->job, (jobs->count + 1) * sizeof(struct job));
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    jobs->job = resized;
+    id        = 0;
+
+    for (size_t i = 0; i < jobs->count; ++i)
+    {
+        if (jobs->job[i].id > id)
+        {
+            id = jobs->job[i].id;
+        }
+    }
+
+    job = &jobs->job[jobs->count];
+    dc_memset(env, job, 0, sizeof(struct job));
+    job->line       = dc_strdup(env, err, line);
+    job->pids       = dc_calloc(env, err, count, sizeof(pid_t));
+    job->exit_codes = dc_calloc(env, err, count, sizeof(int));
+
+    if (dc_error_has_error(err))
+    {
+        free(job->line);
+        free(job->pids);
+        free(job->exit_codes);
+        return NULL;
+    }
+
+    job->id        = id + 1;
+    job->pid_count = count;
+    job->pipefail  = pipefail;
+    job->status    = JOB_RUNNING;
+    job->pgid      = -1;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        job->pids[i]       = pids[i];
+        job->exit_codes[i] = exit_codes[i];
+
+        if (pids[i] > 0)
+        {
+            job->live++;
+
+            if (job->pgid == -1)
+            {
+                job->pgid = pids[i];
+            }
+        }
+    }
+
+    if (job->live == 0)
+    {
+        job->status = JOB_DONE;
+    }
+
+    jobs->count++;
+
+    return job;
+}
+
+void jobs_reap(struct jobs *jobs)
+{
+    if (!sigchld_pending)
+    {
+        return;
+    }
+
+    // cleared first so a SIGCHLD that arrives while reaping is not lost
+    sigchld_pending = 0;
+
+    for (size_t i = 0; i < jobs->count; ++i)
+    {
+        struct job *job = &jobs->job[i];
+
+        for (size_t j = 0; j < job->pid_count; ++j)
+        {
+            int status;
+
+            while (job->pids[j] > 0 && waitpid(job->pids[j], &status, WNOHANG | WUNTRACED | WCONTINUED) > 0)
+            {
+                update_job(job, j, status);
+            }
+        }
+    }
+}
+
+bool jobs_update(struct jobs *jobs, pid_t pid, int status)
+{
+    for (size_t i = 0; i < jobs->count; ++i)
+    {
+        for (size_t j = 0; j < jobs->job[i].pid_count; ++j)
+        {
+            if (jobs->job[i].pids[j] == pid)
+            {
+                update_job(&jobs->job[i], j, status);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void jobs_notify(const struct dc_posix_env *env, struct jobs *jobs, FILE *stream)
+{
+    size_t i;
+
+    jobs_reap(jobs);
+    i = 0;
+
+    while (i < jobs->count)
+    {
+        struct job *job = &jobs->job[i];
+        char buf[32];
+
+        if (job->status == JOB_DONE)
+        {
+            if (stream)
+            {
+                fprintf(stream, "[%d] %s\t%s\n", job->id, status_name(job, buf, sizeof(buf)), job->line);
+            }
+            jobs_remove(env, jobs, job);
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+struct job *jobs_find(const struct dc_posix_env *env, struct jobs *jobs, const char *spec)
+{
+    if (jobs->count == 0)
+    {
+        return NULL;
+    }
+
+    if (spec == NULL || dc_strcmp(env, spec, "%") == 0 || dc_strcmp(env, spec, "%%") == 0 ||
+        dc_strcmp(env, spec, "%+") == 0)
+    {
+        return &jobs->job[jobs->count - 1];
+    }
+
+    if (spec[0] == '%')
+    {
+        long id = strtol(&spec[1], NULL, 10);
+
+        for (size_t i = 0; i < jobs->count; ++i)
+        {
+            if (jobs->job[i].id == id)
+            {
+                return &jobs->job[i];
+            }
+        }
+    }
+    else
+    {
+        long pid = strtol(spec, NULL, 10);
+
+        for (size_t i = 0; i < jobs->count; ++i)
+        {
+            for (size_t j = 0; j < jobs->job[i].pid_count; ++j)
+            {
+                if (pid > 0 && jobs->job[i].pids[j] == pid)
+                {
+                    return &jobs->job[i];
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+int jobs_wait(struct jobs *jobs, struct job *job)
+{
+    for (size_t j = 0; j < job->pid_count && job->status != JOB_STOPPED; ++j)
+    {
+        while (job->pids[j] > 0 && job->status != JOB_STOPPED)
+        {
+            int status;
+
+            if (*jobs->interrupted)
+            {
+                return 128 + *jobs->interrupted;
+            }
+
+            if (waitpid(job->pids[j], &status, WUNTRACED) == -1)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                // already reaped by someone else, nothing more to learn about it
+                job->pids[j] = -1;
+                job->live--;
+                break;
+            }
+            update_job(job, j, status);
+        }
+    }
+
+    if (job->live == 0)
+    {
+        job->status = JOB_DONE;
+    }
+
+    if (job->status == JOB_STOPPED)
+    {
+        return 128 + SIGTSTP;
+    }
+
+    return job_exit_code(job);
+}
+
+void jobs_continue(struct jobs *jobs, struct job *job)
+{
+    (void)jobs;
+
+    if (job->status == JOB_STOPPED && job->pgid > 0)
+    {
+        kill(-job->pgid, SIGCONT);
+        job->status = JOB_RUNNING;
+    }
+}
+
+void jobs_remove(const struct dc_posix_env *env, struct jobs *jobs, struct job *job)
+{
+    size_t index;
+
+    index = (size_t)(job - jobs->job);
+    free(job->line);
+    free(job->pids);
+    free(job->exit_codes);
+    dc_memmove(env, &jobs->job[index], &jobs->job[index + 1], (jobs->count - index - 1) * sizeof(struct job));
+    jobs->count--;
+}
+
+void jobs_display(const struct dc_posix_env *env, struct jobs *jobs, FILE *stream)
+{
+    (void)env;
+    jobs_reap(jobs);
+
+    for (size_t i = 0; i < jobs->count; ++i)
+    {
+        char buf[32];
+
+        fprintf(stream, "[%d] %s\t%s\n", jobs->job[i].id, status_name(&jobs->job[i], buf, sizeof(buf)),
+                jobs->job[i].line);
+    }
+}
+
+int job_exit_code(const struct job *job)
+{
+    int exit_code;
+
+    exit_code = job->exit_codes[job->pid_count - 1];
+
+    if (job->pipefail)
+    {
+        for (size_t i = job->pid_count; i > 0 && exit_code == 0; --i)
+        {
+            exit_code = job->exit_codes[i - 1];
+        }
+    }
+
+    return exit_code;
+}
+
+static void sigchld_handler(int signo)
+{
+    (void)signo;
+    sigchld_pending = 1;
+}
+
+static void interrupt_handler(int signo)
+{
+    interrupt_pending = signo;
+}
+
+static void update_job(struct job *job, size_t index, int status)
+{
+    if (WIFSTOPPED(status))
+    {
+        job->status = JOB_STOPPED;
+    }
+    else if (WIFCONTINUED(status))
+    {
+        job->status = JOB_RUNNING;
+    }
+    else
+    {
+        if (WIFEXITED(status))
+        {
+            job->exit_codes[index] = WEXITSTATUS(status);
+        }
+        else if (WIFSIGNALED(status))
+        {
+            job->exit_codes[index] = 128 + WTERMSIG(status);
+        }
+
+        job->pids[index] = -1;
+        job->live--;
+
+        if (job->live == 0)
+        {
+            job->status = JOB_DONE;
+        }
+    }
+}
+
+static const char *status_name(const struct job *job, char *buf, size_t size)
+{
+    int exit_code;
+
+    switch (job->status)
+    {
+        case JOB_RUNNING:
+            return "Running";
+        case JOB_STOPPED:
+            return "Stopped";
+        case JOB_DONE:
+        default:
+            exit_code = job_exit_code(job);
+
+            if (exit_code == 0)
+            {
+                return "Done";
+            }
+
+            snprintf(buf, size, "Exit %d", exit_code);
+            return buf;
+    }
+}
@@ -0,0 +1,454 @@
+#include <ctype.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+#include "lexer.h"
+#include "scan.h"
+
+#define CHAR_SPACE  0x01 /* skipped between tokens */
+#define CHAR_BREAK  0x02 /* ends an unquoted word */
+#define CHAR_QUOTE  0x04 /* quotes what comes after it */
+#define CHAR_EXPAND 0x08 /* marks the word for expand_word */
+
+// the largest descriptor number kept, a bigger one is still too big to use
+#define MAX_FD 65535
+
+// the characters of a word copied one at a time before the rest is left to scan_span, most words are shorter
+#define SHORT_RUN 16
+
+/**
+ * The class of every character, so that scanning a word is one lookup per character.
+ */
+static const unsigned char char_classes[UCHAR_MAX + 1] = {
+    ['\0'] = CHAR_BREAK,
+    [' ']  = CHAR_SPACE | CHAR_BREAK,
+    ['\t'] = CHAR_SPACE | CHAR_BREAK,
+    ['\n'] = CHAR_SPACE | CHAR_BREAK,
+    ['\v'] = CHAR_SPACE | CHAR_BREAK,
+    ['\f'] = CHAR_SPACE | CHAR_BREAK,
+    ['\r'] = CHAR_SPACE | CHAR_BREAK,
+    ['<']  = CHAR_BREAK,
+    ['>']  = CHAR_BREAK,
+    ['&']  = CHAR_BREAK,
+    ['\''] = CHAR_QUOTE,
+    ['"']  = CHAR_QUOTE,
+    ['\\'] = CHAR_QUOTE,
+    ['$']  = CHAR_EXPAND,
+    ['`']  = CHAR_EXPAND,
+    ['*']  = CHAR_EXPAND,
+    ['?']  = CHAR_EXPAND,
+    ['[']  = CHAR_EXPAND,
+};
+
+/**
+ * The characters that end a run of ordinary characters in a word, every class in char_classes but the end of the command.
+ */
+static const char word_chars[] = " \t\n\v\f\r<>&'\"\\$`*?[";
+
+/**
+ * The characters that are special inside "...".
+ */
+static const char double_quote_chars[] = "\"\\$`";
+
+static struct scan_set word_set;         /**< word_chars */
+static struct scan_set double_quote_set; /**< double_quote_chars */
+static struct scan_set redirect_set;     /**< < and > */
+static bool sets_ready;                  /**< true once the sets are built */
+
+/**
+ * Build the scan sets the first time a command is split.
+ */
+static void init_sets(void);
+
+/**
+ * Copy the characters up to the next one in a set (or the end of the command) into the word.
+ *
+ * @param lexer the lexer.
+ * @param set the characters to stop at.
+ * @param c the first character.
+ * @param out where to copy to.
+ * @return the number of characters copied.
+ */
+static size_t copy_run(const struct lexer *lexer, const struct scan_set *set, const char *c, char *out);
+
+/**
+ * Get the class of a character (see char_classes).
+ *
+ * @param c the character.
+ * @return the CHAR_ flags of the character.
+ */
+static unsigned char char_class(char c);
+
+/**
+ * Check for a character that is copied into a word as it is.
+ *
+ * @param c the character.
+ * @return false for whitespace, quotes, the characters that are expanded, < > & and the end of the command.
+ */
+static bool is_plain(char c);
+
+/**
+ * Check for a character that ends an unquoted word.
+ *
+ * @param c the character, and the ones after it.
+ * @return true for the end of the command, whitespace, <, > and &>.
+ */
+static bool ends_word(const char *c);
+
+/**
+ * Read a redirection operator that starts with < or > (the longest one that matches, so << before <).
+ *
+ * @param c the start of the operator.
+ * @param token the redirect and its default fd are set.
+ * @return the character after the operator.
+ */
+static const char *read_operator(const char *c, struct token *token);
+
+/**
+ * Read a word starting at the current position.
+ *
+ * @param lexer the lexer.
+ * @param token filled in with the word.
+ * @return false if there is a syntax error.
+ */
+static bool read_word(struct lexer *lexer, struct token *token);
+
+/**
+ * Finish a word that read_word could not: one with quotes in it, or a long run of ordinary characters.
+ *
+ * @param lexer the lexer.
+ * @param token the word.
+ * @param c the next character of the word.
+ * @param out where the text of the word continues.
+ * @return false if there is a syntax error.
+ */
+static bool read_long_word(struct lexer *lexer, struct token *token, const char *c, char *out);
+
+/**
+ * Terminate the text of a word and move the lexer past it.
+ *
+ * @param lexer the lexer.
+ * @param token the word.
+ * @param c the character after the word.
+ * @param out the end of the text of the word.
+ */
+static void end_word(struct lexer *lexer, struct token *token, const char *c, char *out);
+
+/**
+ * Skip the whitespace at the current position.
+ *
+ * @param lexer the lexer.
+ */
+static void skip_space(struct lexer *lexer);
+
+void lexer_init(struct lexer *lexer, const char *line, char *buffer)
+{
+    size_t length;
+
+    init_sets();
+    length        = strlen(line);
+    lexer->pos    = line;
+    lexer->end    = line + length;
+    lexer->buffer = buffer;
+    lexer->used   = 0;
+    lexer->error  = NULL;
+
+    lexer->redirects = scan_span(&redirect_set, line, length) < length;
+}
+
+bool lexer_next(struct lexer *lexer, struct token *token)
+{
+    const char *c;
+    int fd;
+
+    skip_space(lexer);
+    token->raw        = lexer->pos;
+    token->raw_length = 0;
+    token->text       = NULL;
+    token->expand     = false;
+    token->fd         = -1;
+
+    if (*lexer->pos == '\0')
+    {
+        token->type = TOKEN_END;
+        return true;
+    }
+
+    if (!lexer->redirects)
+    {
+        token->type = TOKEN_WORD;
+        return read_word(lexer, token);
+    }
+
+    // a number directly in front of < or > is the descriptor to redirect (2>err), otherwise it is a word
+    fd = -1;
+    for (c = lexer->pos; isdigit((unsigned char)*c); ++c)
+    {
+        // anything this big is a bad descriptor, it only has to stay one
+        fd = fd > MAX_FD ? fd : (fd == -1 ? 0 : fd * 10) + (*c - '0');
+    }
+
+    if (c == lexer->pos && c[0] == '&' && c[1] == '>')
+    {
+        token->type     = TOKEN_REDIRECT;
+        token->redirect = c[2] == '>' ? REDIRECT_APPEND_ERR : REDIRECT_OUT_ERR;
+        token->fd       = STDOUT_FILENO;
+        c += token->redirect == REDIRECT_APPEND_ERR ? 3 : 2;
+    }
+    else if (*c == '<' || *c == '>')
+    {
+        token->type = TOKEN_REDIRECT;
+        c           = read_operator(c, token);
+
+        if (fd != -1)
+        {
+            token->fd = fd;
+        }
+    }
+    else
+    {
+        token->type = TOKEN_WORD;
+        return read_word(lexer, token);
+    }
+
+    lexer->pos = c;
+    skip_space(lexer);
+
+    // the file name (or descriptor) is the next word
+    if (*lexer->pos == '\0')
+    {
+        lexer->error = "newline";
+        return false;
+    }
+
+    if (*lexer->pos == '<' || *lexer->pos == '>' || (lexer->pos[0] == '&' && lexer->pos[1] == '>'))
+    {
+        struct token next;
+
+        read_operator(lexer->pos[0] == '&' ? lexer->pos + 1 : lexer->pos, &next);
+        lexer->error = lexer->pos[0] == '&' ? "&>" : lexer_operator(next.redirect);
+        return false;
+    }
+
+    token->raw = lexer->pos;
+
+    return read_word(lexer, token);
+}
+
+const char *lexer_operator(enum redirect_type redirect)
+{
+    static const char *operators[] = {
+        [REDIRECT_IN]         = "<",
+        [REDIRECT_OUT]        = ">",
+        [REDIRECT_APPEND]     = ">>",
+        [REDIRECT_IN_OUT]     = "<>",
+        [REDIRECT_DUP_IN]     = "<&",
+        [REDIRECT_DUP_OUT]    = ">&",
+        [REDIRECT_OUT_ERR]    = "&>",
+        [REDIRECT_APPEND_ERR] = "&>>",
+        [REDIRECT_HEREDOC]     = "<<",
+        [REDIRECT_HEREDOC_TAB] = "<<-",
+        [REDIRECT_HERESTRING]  = "<<<",
+    };
+
+    return operators[redirect];
+}
+
+static const char *read_operator(const char *c, struct token *token)
+{
+    if (c[0] == '<' && c[1] == '<')
+    {
+        token->fd       = STDIN_FILENO;
+        token->redirect = c[2] == '<' ? REDIRECT_HERESTRING : (c[2] == '-' ? REDIRECT_HEREDOC_TAB : REDIRECT_HEREDOC);
+        return token->redirect == REDIRECT_HEREDOC ? c + 2 : c + 3;
+    }
+
+    if (c[0] == '<')
+    {
+        token->fd       = STDIN_FILENO;
+        token->redirect = c[1] == '>' ? REDIRECT_IN_OUT : (c[1] == '&' ? REDIRECT_DUP_IN : REDIRECT_IN);
+        return token->redirect == REDIRECT_IN ? c + 1 : c + 2;
+    }
+
+    token->fd       = STDOUT_FILENO;
+    token->redirect = c[1] == '>' ? REDIRECT_APPEND : (c[1] == '&' ? REDIRECT_DUP_OUT : REDIRECT_OUT);
+
+    return token->redirect == REDIRECT_OUT ? c + 1 : c + 2;
+}
+
+static void init_sets(void)
+{
+    if (!sets_ready)
+    {
+        scan_set_init(&word_set, word_chars, sizeof(word_chars) - 1);
+        scan_set_init(&double_quote_set, double_quote_chars, sizeof(double_quote_chars) - 1);
+        scan_set_init(&redirect_set, "<>", 2);
+        sets_ready = true;
+    }
+}
+
+static size_t copy_run(const struct lexer *lexer, const struct scan_set *set, const char *c, char *out)
+{
+    size_t run;
+
+    run = scan_span(set, c, (size_t)(lexer->end - c));
+    memcpy(out, c, run);
+
+    return run;
+}
+
+static unsigned char char_class(char c)
+{
+    return char_classes[(unsigned char)c];
+}
+
+static bool is_plain(char c)
+{
+    return (char_class(c) & (CHAR_QUOTE | CHAR_EXPAND | CHAR_BREAK)) == 0;
+}
+
+static bool ends_word(const char *c)
+{
+    // & only breaks a word when it starts &>, everywhere else it was already handled by separate_line
+    return (char_class(*c) & CHAR_BREAK) != 0 && (*c != '&' || c[1] == '>');
+}
+
+static bool read_word(struct lexer *lexer, struct token *token)
+{
+    const char *c;
+    const char *long_word;
+    char *out;
+
+    c         = lexer->pos;
+    long_word = c + SHORT_RUN;
+    out       = &lexer->buffer[lexer->used];
+
+    // ~user and ~/ only expand at the start of the word
+    token->expand = *c == '~';
+    token->text   = out;
+
+    // most words are short and unquoted, this loop makes no calls so it costs nothing to start
+    while (!ends_word(c))
+    {
+        if (is_plain(*c) && c < long_word)
+        {
+            *out = *c;
+            ++out;
+            ++c;
+        }
+        else if (*c == '\\' && c[1] != '\0')
+        {
+            *out++ = c[1];
+            c += 2;
+        }
+        else if (char_class(*c) & CHAR_EXPAND)
+        {
+            // $ ` * ? [
+            token->expand = true;
+            *out++        = *c++;
+        }
+        else
+        {
+            return read_long_word(lexer, token, c, out);
+        }
+    }
+
+    end_word(lexer, token, c, out);
+
+    return true;
+}
+
+// kept out of read_word, which would otherwise have to save registers for its calls on every word
+__attribute__((noinline)) static bool read_long_word(struct lexer *lexer, struct token *token, const char *c,
+                                                     char *out)
+{
+    size_t run;
+
+    while (!ends_word(c))
+    {
+        if (is_plain(*c))
+        {
+            run = copy_run(lexer, &word_set, c, out);
+            c += run;
+            out += run;
+        }
+        else if (*c == '\'')
+        {
+            const char *close;
+
+            close = memchr(c + 1, '\'', (size_t)(lexer->end - c - 1));
+
+            if (close == NULL)
+            {
+                lexer->error = "'";
+                return false;
+            }
+
+            memcpy(out, c + 1, (size_t)(close - c - 1));
+            out += close - c - 1;
+            c = close + 1;
+        }
+        else if (*c == '"')
+        {
+            ++c;
+            run = copy_run(lexer, &double_quote_set, c, out);
+            c += run;
+            out += run;
+
+            while (*c != '"')
+            {
+                if (*c == '\0')
+                {
+                    lexer->error = "\"";
+                    return false;
+                }
+
+                // only these can be quoted by \ inside "..."
+                if (*c == '\\' && (c[1] == '$' || c[1] == '`' || c[1] == '"' || c[1] == '\\'))
+                {
+                    ++c;
+                }
+                else if (*c == '$' || *c == '`')
+                {
+                    token->expand = true;
+                }
+                *out++ = *c++;
+                run = copy_run(lexer, &double_quote_set, c, out);
+                c += run;
+                out += run;
+            }
+            ++c;
+        }
+        else if (*c == '\\' && c[1] != '\0')
+        {
+            *out++ = c[1];
+            c += 2;
+        }
+        else
+        {
+            // $ ` * ? [, a \ at the end of the command, or an & that is not &>
+            token->expand = token->expand || (char_class(*c) & CHAR_EXPAND) != 0;
+            *out++        = *c++;
+        }
+    }
+
+    end_word(lexer, token, c, out);
+
+    return true;
+}
+
+static void end_word(struct lexer *lexer, struct token *token, const char *c, char *out)
+{
+    *out++ = '\0';
+    token->raw_length = (size_t)(c - token->raw);
+    lexer->used       = (size_t)(out - lexer->buffer);
+    lexer->pos        = c;
+}
+
+static void skip_space(struct lexer *lexer)
+{
+    while (char_class(*lexer->pos) & CHAR_SPACE)
+    {
+        lexer->pos++;
+    }
+}
@@ -20,13 +20,17 @@
 #include <dc_application/config.h>
 #include <dc_application/options.h>
 #include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_stdio.h>
 #include <dc_posix/dc_string.h>
 #include <getopt.h>
+#include <unistd.h>
 
 struct application_settings
 {
     struct dc_opt_settings  opts;
     struct dc_setting_bool *verbose;
+    struct dc_setting_string *file;
+    struct dc_setting_uint16 *parse_cache;
 };
 
 static struct dc_application_settings *create_settings(const struct dc_posix_env *env, struct dc_error *err);
@@ -75,6 +79,7 @@ int        main(int argc, char *argv[])
 static struct dc_application_settings *create_settings(const struct dc_posix_env *env, struct dc_error *err)
 {
     static bool                  default_verbose = false;
+    static uint16_t              default_parse_cache = PARSE_CACHE_DEFAULT_SIZE;
     struct application_settings *settings;
 
     DC_TRACE(env);
@@ -87,6 +92,8 @@ static struct dc_application_settings *create_settings(const struct dc_posix_env
 
     settings->opts.parent.config_path = dc_setting_path_create(env, err);
     settings->verbose                 = dc_setting_bool_create(env, err);
+    settings->file                    = dc_setting_string_create(env, err);
+    settings->parse_cache             = dc_setting_uint16_create(env, err);
 
     struct options opts[]             = {
         {(struct dc_setting *)settings->opts.parent.config_path,
@@ -109,6 +116,26 @@ static struct dc_application_settings *create_settings(const struct dc_posix_env
          "verbose",
          dc_flag_from_config,
          &default_verbose},
+        {(struct dc_setting *)settings->file,
+         dc_options_set_string,
+         "file",
+         required_argument,
+         'f',
+         "FILE",
+         dc_string_from_string,
+         "file",
+         dc_string_from_config,
+         NULL},
+        {(struct dc_setting *)settings->parse_cache,
+         dc_options_set_uint16,
+         "parse-cache",
+         required_argument,
+         'p',
+         "PARSE_CACHE",
+         dc_uint16_from_string,
+         "parse-cache",
+         dc_uint16_from_config,
+         &default_parse_cache},
     };
 
     // note the trick here - we use calloc and add 1 to ensure the last line is all 0/NULL
@@ -116,7 +143,7 @@ static struct dc_application_settings *create_settings(const struct dc_posix_env
     settings->opts.opts_size  = sizeof(struct options);
     settings->opts.opts       = dc_calloc(env, err, settings->opts.opts_count, settings->opts.opts_size);
     dc_memcpy(env, settings->opts.opts, opts, sizeof(opts));
-    settings->opts.flags      = "c:v:";
+    settings->opts.flags      = "c:v:f:p:";
     settings->opts.env_prefix = "DC_SHELL_";
 
     return (struct dc_application_settings *)settings;
@@ -131,6 +158,8 @@ static int destroy_settings(const struct dc_posix_env               *env,
     DC_TRACE(env);
     app_settings = (struct application_settings *)*psettings;
     dc_setting_bool_destroy(env, &app_settings->verbose);
+    dc_setting_string_destroy(env, &app_settings->file);
+    dc_setting_uint16_destroy(env, &app_settings->parse_cache);
     dc_free(env, app_settings->opts.opts, app_settings->opts.opts_count);
     dc_free(env, *psettings, sizeof(struct application_settings));
 
@@ -142,14 +171,48 @@ static int destroy_settings(const struct dc_posix_env               *env,
     return 0;
 }
 
-static int run(const struct dc_posix_env                              *env,
-               struct dc_error                                        *err,
-               __attribute__((unused)) struct dc_application_settings *settings)
+static int run(const struct dc_posix_env *env, struct dc_error *err, struct dc_application_settings *settings)
 {
+    struct application_settings *app_settings;
+    struct shell_options options;
+    const char *file;
+    FILE *in;
     int ret_val;
 
     DC_TRACE(env);
-    ret_val = run_shell(env, err, stdin, stdout, stderr);
+    app_settings = (struct application_settings *)settings;
+    file         = dc_setting_string_get(env, app_settings->file);
+    in           = stdin;
+
+    // parse-cache = 0 in ~/.dcshell.conf (or -p 0) parses every line
+    options.parse_cache_size = dc_setting_uint16_get(env, app_settings->parse_cache);
+
+    if(file)
+    {
+        // close on exec so the programs the script runs do not inherit it
+        in = dc_fopen(env, err, file, "re");
+
+        if(dc_error_has_error(err))
+        {
+            fprintf(stderr, "dc_shell: %s: %s\n", file, err->message);
+            return 127;
+        }
+    }
+
+    // a script or piped input runs without a prompt
+    if(file || !isatty(STDIN_FILENO))
+    {
+        ret_val = run_script(env, err, in, stdout, stderr, &options);
+    }
+    else
+    {
+        ret_val = run_shell(env, err, in, stdout, stderr, &options);
+    }
+
+    if(file)
+    {
+        dc_fclose(env, err, in);
+    }
 
     return ret_val;
 }
@@ -0,0 +1,428 @@
+// wait4 is not part of POSIX
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_string.h>
+#include "copy.h"
+#include "execute.h"
+#include "parallel.h"
+
+/**
+ * Replace every {} in the word with the argument.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param word the word from the template.
+ * @param arg the argument.
+ * @return the new word (must be freed).
+ */
+static char *substitute(const struct dc_posix_env *env, struct dc_error *err, const char *word, const char *arg);
+
+/**
+ * Join the command and its arguments with spaces, for messages.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param command the command.
+ * @return the command line (must be freed).
+ */
+static char *join_line(const struct dc_posix_env *env, struct dc_error *err, const struct command *command);
+
+/**
+ * Start a job, with its output going to a temporary file if the output is buffered.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param parallel the jobs.
+ * @param job the job to start.
+ * @param path_cache the cache of programs found in the PATH directories.
+ * @param jobs the job table, to give a new process group the terminal (can be NULL).
+ */
+static void start_job(const struct dc_posix_env *env, struct dc_error *err, struct parallel *parallel,
+                      struct parallel_job *job, struct path_cache *path_cache, struct jobs *jobs);
+
+/**
+ * Find the running job for a process.
+ *
+ * @param parallel the jobs.
+ * @param pid the process.
+ * @return the job or NULL if the process is not one of the jobs.
+ */
+static struct parallel_job *find_job(const struct parallel *parallel, pid_t pid);
+
+/**
+ * Copy the buffered output of a finished job and remove the temporary file.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param job the finished job.
+ * @param out_fd where the output goes.
+ */
+static void flush_job(const struct dc_posix_env *env, struct dc_error *err, struct parallel_job *job, int out_fd);
+
+struct parallel *parallel_create(const struct dc_posix_env *env, struct dc_error *err, char **template,
+                                 size_t template_count, char **args, size_t arg_count, size_t slots,
+                                 bool keep_order)
+{
+    struct parallel *parallel;
+    bool has_braces;
+
+    parallel = dc_calloc(env, err, 1, sizeof(struct parallel));
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    parallel->job = dc_calloc(env, err, arg_count + 1, sizeof(struct parallel_job));
+
+    if (dc_error_has_error(err))
+    {
+        free(parallel);
+        return NULL;
+    }
+
+    // -j 0 runs everything at once
+    parallel->slots      = slots > 0 ? slots : (arg_count > 0 ? arg_count : 1);
+    parallel->keep_order = keep_order;
+    parallel->pgid       = -1;
+    has_braces           = false;
+
+    for (size_t i = 0; i < template_count; ++i)
+    {
+        has_braces = has_braces || dc_strstr(env, template[i], "{}") != NULL;
+    }
+
+    for (size_t i = 0; i < arg_count && dc_error_has_no_error(err); ++i)
+    {
+        struct command *command;
+
+        command          = &parallel->job[i].command;
+        parallel->job[i].pid = -1;
+        parallel->count++;
+
+        // argv[0] is filled in with the program when it is started
+        command->argc    = template_count + (has_braces ? 0 : 1);
+        command->argv    = dc_calloc(env, err, command->argc + 1, sizeof(char *));
+        command->command = substitute(env, err, template[0], args[i]);
+
+        for (size_t j = 1; j < template_count && dc_error_has_no_error(err); ++j)
+        {
+            command->argv[j] = substitute(env, err, template[j], args[i]);
+        }
+
+        if (!has_braces && dc_error_has_no_error(err))
+        {
+            command->argv[template_count] = dc_strdup(env, err, args[i]);
+        }
+
+        if (dc_error_has_no_error(err))
+        {
+            command->line = join_line(env, err, command);
+        }
+    }
+
+    if (dc_error_has_error(err))
+    {
+        parallel_destroy(env, &parallel);
+    }
+
+    return parallel;
+}
+
+void parallel_destroy(const struct dc_posix_env *env, struct parallel **pparallel)
+{
+    struct parallel *parallel;
+
+    parallel = *pparallel;
+
+    if (parallel)
+    {
+        for (size_t i = 0; i < parallel->count; ++i)
+        {
+            // a buffered output that was never copied
+            if (parallel->job[i].output)
+            {
+                unlink(parallel->job[i].output);
+                free(parallel->job[i].output);
+            }
+
+            destroy_command(env, &parallel->job[i].command);
+        }
+
+        free(parallel->job);
+        free(parallel);
+    }
+
+    *pparallel = NULL;
+}
+
+size_t parallel_run(const struct dc_posix_env *env, struct dc_error *err, struct parallel *parallel,
+                    struct path_cache *path_cache, struct jobs *jobs, int out_fd)
+{
+    size_t next;
+    size_t flushed;
+    bool interrupted;
+
+    next        = 0;
+    flushed     = 0;
+    interrupted = false;
+
+    // with job control the jobs get a process group of their own, in the foreground
+    parallel->pgid = jobs && jobs->terminal != -1 ? 0 : -1;
+
+    while (((next < parallel->count && !interrupted) || parallel->running > 0) && dc_error_has_no_error(err))
+    {
+        struct parallel_job *job;
+        struct rusage usage;
+        pid_t pid;
+        int status;
+
+        // fill every free slot
+        while (parallel->running < parallel->slots && next < parallel->count && !interrupted &&
+               dc_error_has_no_error(err))
+        {
+            start_job(env, err, parallel, &parallel->job[next], path_cache, jobs);
+            next++;
+        }
+
+        if (parallel->running > 0)
+        {
+            pid = wait4(-1, &status, WUNTRACED, &usage);
+
+            if (pid == -1)
+            {
+                if (errno != EINTR)
+                {
+                    DC_ERROR_RAISE_ERRNO(err, errno);
+                }
+
+                continue;
+            }
+
+            job = find_job(parallel, pid);
+
+            if (job == NULL)
+            {
+                // one of the background jobs finished while waiting
+                if (jobs)
+                {
+                    jobs_update(jobs, pid, status);
+                }
+
+                continue;
+            }
+
+            // the run is part of the shell and cannot be stopped as a job, so a stopped process is continued
+            // (eg. ^Z, or a read of the terminal before its group was given the terminal)
+            if (WIFSTOPPED(status))
+            {
+                kill(pid, SIGCONT);
+                continue;
+            }
+
+            if (WIFEXITED(status))
+            {
+                job->command.exit_code = WEXITSTATUS(status);
+            }
+            else if (WIFSIGNALED(status))
+            {
+                job->command.exit_code = 128 + WTERMSIG(status);
+                interrupted            = interrupted || WTERMSIG(status) == SIGINT || WTERMSIG(status) == SIGQUIT;
+            }
+
+            job->command.rusage = usage;
+            job->pid            = -1;
+            job->done           = true;
+            parallel->running--;
+
+            // the group is gone with its last process, the next job starts a new one
+            if (parallel->running == 0 && parallel->pgid > 0)
+            {
+                parallel->pgid = 0;
+            }
+        }
+
+        // the output is printed in argument order, so a job can only be copied once every job before it is
+        while (parallel->keep_order && flushed < next && parallel->job[flushed].done && dc_error_has_no_error(err))
+        {
+            flush_job(env, err, &parallel->job[flushed], out_fd);
+            flushed++;
+        }
+    }
+
+    if (parallel->pgid != -1)
+    {
+        jobs_foreground(jobs, jobs->pgid);
+    }
+
+    parallel->failed = 0;
+
+    for (size_t i = 0; i < parallel->count; ++i)
+    {
+        if (parallel->job[i].done && parallel->job[i].command.exit_code != 0)
+        {
+            parallel->failed++;
+        }
+    }
+
+    return parallel->failed;
+}
+
+static char *substitute(const struct dc_posix_env *env, struct dc_error *err, const char *word, const char *arg)
+{
+    const char *brace;
+    char *result;
+    size_t count;
+    size_t arg_length;
+    size_t length;
+
+    count = 0;
+
+    for (brace = dc_strstr(env, word, "{}"); brace; brace = dc_strstr(env, brace + 2, "{}"))
+    {
+        count++;
+    }
+
+    arg_length = dc_strlen(env, arg);
+    length     = dc_strlen(env, word) - count * 2 + count * arg_length;
+    result     = dc_malloc(env, err, length + 1);
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    length = 0;
+
+    while ((brace = dc_strstr(env, word, "{}")) != NULL)
+    {
+        dc_memcpy(env, result + length, word, (size_t)(brace - word));
+        length += (size_t)(brace - word);
+        dc_memcpy(env, result + length, arg, arg_length);
+        length += arg_length;
+        word = brace + 2;
+    }
+
+    strcpy(result + length, word);
+
+    return result;
+}
+
+static char *join_line(const struct dc_posix_env *env, struct dc_error *err, const struct command *command)
+{
+    char *line;
+    size_t length;
+
+    length = dc_strlen(env, command->command) + 1;
+
+    for (size_t i = 1; i < command->argc; ++i)
+    {
+        length += dc_strlen(env, command->argv[i]) + 1;
+    }
+
+    line = dc_malloc(env, err, length);
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    strcpy(line, command->command);
+
+    for (size_t i = 1; i < command->argc; ++i)
+    {
+        strcat(line, " ");
+        strcat(line, command->argv[i]);
+    }
+
+    return line;
+}
+
+static void start_job(const struct dc_posix_env *env, struct dc_error *err, struct parallel *parallel,
+                      struct parallel_job *job, struct path_cache *path_cache, struct jobs *jobs)
+{
+    if (parallel->keep_order)
+    {
+        char name[] = "/tmp/dc_shell_parallelXXXXXX";
+        int fd;
+
+        fd = mkstemp(name);
+
+        if (fd == -1)
+        {
+            DC_ERROR_RAISE_ERRNO(err, errno);
+            return;
+        }
+
+        close(fd);
+        job->output = dc_strdup(env, err, name);
+        append_redirection(env, err, &job->command, REDIRECTION_WRITE, STDOUT_FILENO, -1, name);
+
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+    }
+
+    launch_pipeline(env, err, &job->command, 1, path_cache, parallel->pgid, &job->pid);
+
+    if (job->pid > 0)
+    {
+        parallel->running++;
+
+        // the first job makes the group and the ones after it join
+        if (parallel->pgid == 0)
+        {
+            parallel->pgid = job->pid;
+            jobs_foreground(jobs, parallel->pgid);
+        }
+    }
+    else
+    {
+        // the exit code was set when it could not be started
+        job->done = true;
+    }
+}
+
+static struct parallel_job *find_job(const struct parallel *parallel, pid_t pid)
+{
+    for (size_t i = 0; i < parallel->count; ++i)
+    {
+        if (parallel->job[i].pid == pid)
+        {
+            return &parallel->job[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void flush_job(const struct dc_posix_env *env, struct dc_error *err, struct parallel_job *job, int out_fd)
+{
+    int fd;
+
+    if (job->output == NULL)
+    {
+        return;
+    }
+
+    fd = open(job->output, O_RDONLY | O_CLOEXEC);
+
+    if (fd != -1)
+    {
+        copy_fd(env, err, fd, out_fd, COPY_FILE_RANGE, NULL, NULL);
+        close(fd);
+    }
+
+    unlink(job->output);
+    free(job->output);
+    job->output = NULL;
+}
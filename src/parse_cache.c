@@ -0,0 +1,388 @@
+#include <stdlib.h>
+#include <string.h>
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_string.h>
+#include "parse_cache.h"
+#include "command.h"
+
+// the commands of a typical line fit in one block
+#define PARSE_CACHE_ENTRY_ARENA_SIZE 512
+
+/**
+ * FNV-1a hash of the line.
+ *
+ * @param line the line.
+ * @return the hash.
+ */
+static size_t hash_line(const char *line);
+
+/**
+ * Find the entry for a line.
+ *
+ * @param cache the cache.
+ * @param line the line.
+ * @param hash the hash of the line.
+ * @return the entry or NULL.
+ */
+static struct parse_cache_entry *find_entry(const struct parse_cache *cache, const char *line, size_t hash);
+
+/**
+ * Take an entry out of the least recently used list.
+ *
+ * @param cache the cache.
+ * @param entry the entry.
+ */
+static void unlink_entry(struct parse_cache *cache, struct parse_cache_entry *entry);
+
+/**
+ * Put an entry at the most recently used end of the list.
+ *
+ * @param cache the cache.
+ * @param entry the entry.
+ */
+static void link_newest(struct parse_cache *cache, struct parse_cache_entry *entry);
+
+/**
+ * Remove the least recently used entry from the cache and free it.
+ *
+ * @param env the posix environment.
+ * @param cache the cache.
+ */
+static void evict_oldest(const struct dc_posix_env *env, struct parse_cache *cache);
+
+/**
+ * Copy a command, and all of its strings, into an arena.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena where to allocate the copy.
+ * @param to the copy.
+ * @param from the command to copy.
+ */
+static void copy_command(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                         struct command *to, const struct command *from);
+
+/**
+ * Copy a string into an arena.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param arena where to allocate the copy.
+ * @param str the string, may be NULL.
+ * @return the copy, or NULL if str is NULL.
+ */
+static char *copy_string(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, const char *str);
+
+struct parse_cache *parse_cache_create(const struct dc_posix_env *env, struct dc_error *err, size_t capacity)
+{
+    struct parse_cache *cache;
+
+    cache = dc_calloc(env, err, 1, sizeof(struct parse_cache));
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    // the table never grows, it has at least as many buckets as lines
+    cache->bucket_count = 16;
+    while (cache->bucket_count < capacity)
+    {
+        cache->bucket_count *= 2;
+    }
+
+    cache->capacity = capacity;
+    cache->buckets  = dc_calloc(env, err, cache->bucket_count, sizeof(struct parse_cache_entry *));
+
+    if (dc_error_has_error(err))
+    {
+        free(cache);
+        return NULL;
+    }
+
+    return cache;
+}
+
+void parse_cache_destroy(const struct dc_posix_env *env, struct parse_cache **pcache)
+{
+    struct parse_cache *cache;
+
+    cache = *pcache;
+
+    if (cache)
+    {
+        while (cache->oldest)
+        {
+            evict_oldest(env, cache);
+        }
+
+        free(cache->buckets);
+        free(cache);
+    }
+
+    *pcache = NULL;
+}
+
+bool parse_cache_lookup(const struct dc_posix_env *env, struct dc_error *err, struct parse_cache *cache,
+                        struct arena *arena, const char *line, struct command **commands, size_t *count)
+{
+    struct parse_cache_entry *entry;
+    struct command *copies;
+
+    entry = find_entry(cache, line, hash_line(line));
+
+    if (entry == NULL || arena == NULL)
+    {
+        cache->misses++;
+        return false;
+    }
+
+    copies = arena_alloc(env, err, arena, entry->command_count * sizeof(struct command));
+
+    if (dc_error_has_error(err))
+    {
+        return false;
+    }
+
+    // only the structs and argv arrays are copied, running a command never changes the strings or redirections
+    for (size_t i = 0; i < entry->command_count; ++i)
+    {
+        copies[i]       = entry->commands[i];
+        copies[i].arena = arena;
+        copies[i].argv  = arena_alloc(env, err, arena, (entry->commands[i].argc + 1) * sizeof(char *));
+
+        if (dc_error_has_error(err))
+        {
+            return false;
+        }
+
+        dc_memcpy(env, copies[i].argv, entry->commands[i].argv, (entry->commands[i].argc + 1) * sizeof(char *));
+    }
+
+    unlink_entry(cache, entry);
+    link_newest(cache, entry);
+    cache->hits++;
+    *commands = copies;
+    *count    = entry->command_count;
+
+    return true;
+}
+
+void parse_cache_add(const struct dc_posix_env *env, struct dc_error *err, struct parse_cache *cache,
+                     const char *line, const struct command *commands, size_t count)
+{
+    struct parse_cache_entry *entry;
+    size_t hash;
+    size_t bucket;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (commands[i].expanded)
+        {
+            return;
+        }
+    }
+
+    hash = hash_line(line);
+
+    if (count == 0 || find_entry(cache, line, hash))
+    {
+        return;
+    }
+
+    if (cache->count >= cache->capacity)
+    {
+        evict_oldest(env, cache);
+    }
+
+    entry = dc_calloc(env, err, 1, sizeof(struct parse_cache_entry));
+
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    entry->arena = arena_create(env, err, PARSE_CACHE_ENTRY_ARENA_SIZE);
+
+    if (dc_error_has_no_error(err))
+    {
+        entry->line     = arena_strdup(env, err, entry->arena, line);
+        entry->commands = arena_calloc(env, err, entry->arena, count, sizeof(struct command));
+    }
+
+    for (size_t i = 0; i < count && dc_error_has_no_error(err); ++i)
+    {
+        copy_command(env, err, entry->arena, &entry->commands[i], &commands[i]);
+    }
+
+    if (dc_error_has_error(err))
+    {
+        arena_destroy(env, &entry->arena);
+        free(entry);
+        return;
+    }
+
+    entry->hash            = hash;
+    entry->command_count   = count;
+    bucket                 = hash & (cache->bucket_count - 1);
+    entry->next            = cache->buckets[bucket];
+    cache->buckets[bucket] = entry;
+    link_newest(cache, entry);
+    cache->count++;
+}
+
+void parse_cache_display(const struct dc_posix_env *env, const struct parse_cache *cache, FILE *stream)
+{
+    (void)env;
+    fprintf(stream, "parse cache: %zu lines, %zu hits, %zu misses\n", cache->count, cache->hits, cache->misses);
+}
+
+static size_t hash_line(const char *line)
+{
+    size_t hash = 14695981039346656037UL;
+
+    for (const unsigned char *c = (const unsigned char *)line; *c; ++c)
+    {
+        hash ^= *c;
+        hash *= 1099511628211UL;
+    }
+
+    return hash;
+}
+
+static struct parse_cache_entry *find_entry(const struct parse_cache *cache, const char *line, size_t hash)
+{
+    struct parse_cache_entry *entry;
+
+    entry = cache->buckets[hash & (cache->bucket_count - 1)];
+
+    while (entry && (entry->hash != hash || strcmp(entry->line, line) != 0))
+    {
+        entry = entry->next;
+    }
+
+    return entry;
+}
+
+static void unlink_entry(struct parse_cache *cache, struct parse_cache_entry *entry)
+{
+    if (entry->newer)
+    {
+        entry->newer->older = entry->older;
+    }
+    else
+    {
+        cache->newest = entry->older;
+    }
+
+    if (entry->older)
+    {
+        entry->older->newer = entry->newer;
+    }
+    else
+    {
+        cache->oldest = entry->newer;
+    }
+
+    entry->newer = NULL;
+    entry->older = NULL;
+}
+
+static void link_newest(struct parse_cache *cache, struct parse_cache_entry *entry)
+{
+    entry->older = cache->newest;
+    entry->newer = NULL;
+
+    if (cache->newest)
+    {
+        cache->newest->newer = entry;
+    }
+    else
+    {
+        cache->oldest = entry;
+    }
+
+    cache->newest = entry;
+}
+
+static void evict_oldest(const struct dc_posix_env *env, struct parse_cache *cache)
+{
+    struct parse_cache_entry *entry;
+    struct parse_cache_entry **link;
+
+    entry = cache->oldest;
+
+    if (entry == NULL)
+    {
+        return;
+    }
+
+    link = &cache->buckets[entry->hash & (cache->bucket_count - 1)];
+    while (*link != entry)
+    {
+        link = &(*link)->next;
+    }
+
+    *link = entry->next;
+    unlink_entry(cache, entry);
+    arena_destroy(env, &entry->arena);
+    free(entry);
+    cache->count--;
+}
+
+static void copy_command(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                         struct command *to, const struct command *from)
+{
+    *to             = *from;
+    to->arena       = arena;
+    to->line        = copy_string(env, err, arena, from->line);
+    to->command     = copy_string(env, err, arena, from->command);
+    to->argv        = arena_calloc(env, err, arena, from->argc + 1, sizeof(char *));
+
+    if (from->redirection_count > 0)
+    {
+        to->redirections = arena_alloc(env, err, arena, from->redirection_count * sizeof(struct redirection));
+    }
+
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < from->redirection_count; ++i)
+    {
+        to->redirections[i]      = from->redirections[i];
+        to->redirections[i].file = copy_string(env, err, arena, from->redirections[i].file);
+    }
+
+    if (from->assignment_count > 0)
+    {
+        to->assignments = arena_alloc(env, err, arena, from->assignment_count * sizeof(char *));
+
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+    }
+
+    for (size_t i = 0; i < from->assignment_count; ++i)
+    {
+        to->assignments[i] = copy_string(env, err, arena, from->assignments[i]);
+    }
+
+    // argv[0] is filled in when the command is run
+    for (size_t i = 1; i < from->argc; ++i)
+    {
+        to->argv[i] = copy_string(env, err, arena, from->argv[i]);
+    }
+}
+
+static char *copy_string(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, const char *str)
+{
+    if (str == NULL)
+    {
+        return NULL;
+    }
+
+    return arena_strdup(env, err, arena, str);
+}
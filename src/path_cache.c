@@ -0,0 +1,377 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_string.h>
+#include "path_cache.h"
+
+#define PATH_CACHE_INITIAL_CAPACITY 64
+
+/**
+ * FNV-1a hash of the command name.
+ *
+ * @param name the command name.
+ * @return the hash.
+ */
+static size_t hash_name(const char *name);
+
+/**
+ * Find the slot for the name: either the slot holding it or the empty slot it would go in.
+ *
+ * @param cache the cache.
+ * @param name the command name.
+ * @return the slot.
+ */
+static struct path_cache_entry *find_slot(const struct path_cache *cache, const char *name);
+
+/**
+ * Double the size of the hash table.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param cache the cache.
+ */
+static void grow(const struct dc_posix_env *env, struct dc_error *err, struct path_cache *cache);
+
+/**
+ * Record the modification time of every PATH directory.
+ *
+ * @param cache the cache.
+ */
+static void snapshot_dirs(struct path_cache *cache);
+
+/**
+ * Check that none of the first count PATH directories changed since the snapshot.
+ *
+ * @param cache the cache.
+ * @param count the number of directories to check.
+ * @return true if they are unchanged.
+ */
+static bool dirs_unchanged(const struct path_cache *cache, size_t count);
+
+/**
+ * Get the modification time of a directory, or -1 seconds if it does not exist.
+ *
+ * @param dir the directory.
+ * @param mtime set to the modification time.
+ */
+static void dir_mtime(const char *dir, struct timespec *mtime);
+
+/**
+ * Search PATH for the program.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param cache the cache.
+ * @param name the command name.
+ * @param dir_index set to the directory the program was found in.
+ * @return the program (must be freed) or NULL.
+ */
+static char *search_path(const struct dc_posix_env *env, struct dc_error *err, const struct path_cache *cache,
+                         const char *name, size_t *dir_index);
+
+struct path_cache *path_cache_create(const struct dc_posix_env *env, struct dc_error *err, char **path)
+{
+    struct path_cache *cache;
+
+    cache = dc_calloc(env, err, 1, sizeof(struct path_cache));
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    cache->capacity = PATH_CACHE_INITIAL_CAPACITY;
+    cache->entries  = dc_calloc(env, err, cache->capacity, sizeof(struct path_cache_entry));
+
+    if (dc_error_has_error(err))
+    {
+        free(cache);
+        return NULL;
+    }
+
+    path_cache_set_path(env, err, cache, path);
+
+    return cache;
+}
+
+void path_cache_destroy(const struct dc_posix_env *env, struct path_cache **pcache)
+{
+    struct path_cache *cache;
+
+    cache = *pcache;
+
+    if (cache)
+    {
+        path_cache_flush(env, cache);
+        free(cache->entries);
+        free(cache->dir_mtimes);
+        free(cache);
+    }
+
+    *pcache = NULL;
+}
+
+void path_cache_set_path(const struct dc_posix_env *env, struct dc_error *err, struct path_cache *cache, char **path)
+{
+    size_t count;
+
+    path_cache_flush(env, cache);
+    free(cache->dir_mtimes);
+    cache->dir_mtimes = NULL;
+    cache->path       = path;
+    cache->dir_count  = 0;
+
+    count = 0;
+    while (path && path[count])
+    {
+        count++;
+    }
+
+    if (count > 0)
+    {
+        cache->dir_mtimes = dc_calloc(env, err, count, sizeof(struct timespec));
+
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+    }
+
+    cache->dir_count = count;
+    snapshot_dirs(cache);
+}
+
+void path_cache_flush(const struct dc_posix_env *env, struct path_cache *cache)
+{
+    for (size_t i = 0; i < cache->capacity; ++i)
+    {
+        free(cache->entries[i].name);
+        free(cache->entries[i].program);
+        dc_memset(env, &cache->entries[i], 0, sizeof(struct path_cache_entry));
+    }
+
+    cache->count = 0;
+}
+
+const char *path_cache_lookup(const struct dc_posix_env *env, struct dc_error *err, struct path_cache *cache,
+                              const char *name)
+{
+    struct path_cache_entry *entry;
+    char *program;
+    size_t dir_index;
+
+    entry = find_slot(cache, name);
+
+    if (entry->name)
+    {
+        // Only directories before the one the program is in can hide it, a miss depends on all of them.
+        size_t check = entry->program ? entry->dir_index + 1 : cache->dir_count;
+
+        if (dirs_unchanged(cache, check))
+        {
+            cache->hits++;
+            entry->hits++;
+            return entry->program;
+        }
+
+        path_cache_flush(env, cache);
+        snapshot_dirs(cache);
+    }
+
+    cache->misses++;
+    program = search_path(env, err, cache, name, &dir_index);
+
+    if (cache->count + 1 > cache->capacity / 4 * 3)
+    {
+        grow(env, err, cache);
+
+        if (dc_error_has_error(err))
+        {
+            free(program);
+            return NULL;
+        }
+    }
+
+    entry       = find_slot(cache, name);
+    entry->name = dc_strdup(env, err, name);
+
+    if (dc_error_has_error(err))
+    {
+        free(program);
+        return NULL;
+    }
+
+    entry->program   = program;
+    entry->dir_index = dir_index;
+    entry->hits      = 0;
+    cache->count++;
+
+    return program;
+}
+
+void path_cache_display(const struct dc_posix_env *env, const struct path_cache *cache, FILE *stream)
+{
+    (void)env;
+    fprintf(stream, "hits\tcommand\n");
+
+    for (size_t i = 0; i < cache->capacity; ++i)
+    {
+        const struct path_cache_entry *entry = &cache->entries[i];
+
+        if (entry->name)
+        {
+            if (entry->program)
+            {
+                fprintf(stream, "%4zu\t%s\n", entry->hits, entry->program);
+            }
+            else
+            {
+                fprintf(stream, "%4zu\t%s (not found)\n", entry->hits, entry->name);
+            }
+        }
+    }
+
+    fprintf(stream, "hash: %zu hits, %zu misses\n", cache->hits, cache->misses);
+}
+
+static size_t hash_name(const char *name)
+{
+    size_t hash = 14695981039346656037UL;
+
+    for (const unsigned char *c = (const unsigned char *)name; *c; ++c)
+    {
+        hash ^= *c;
+        hash *= 1099511628211UL;
+    }
+
+    return hash;
+}
+
+static struct path_cache_entry *find_slot(const struct path_cache *cache, const char *name)
+{
+    size_t mask;
+    size_t index;
+
+    mask  = cache->capacity - 1;
+    index = hash_name(name) & mask;
+
+    while (cache->entries[index].name && strcmp(cache->entries[index].name, name) != 0)
+    {
+        index = (index + 1) & mask;
+    }
+
+    return &cache->entries[index];
+}
+
+static void grow(const struct dc_posix_env *env, struct dc_error *err, struct path_cache *cache)
+{
+    struct path_cache_entry *old_entries;
+    size_t old_capacity;
+
+    old_entries  = cache->entries;
+    old_capacity = cache->capacity;
+    cache->entries = dc_calloc(env, err, old_capacity * 2, sizeof(struct path_cache_entry));
+
+    if (dc_error_has_error(err))
+    {
+        cache->entries = old_entries;
+        return;
+    }
+
+    cache->capacity = old_capacity * 2;
+
+    for (size_t i = 0; i < old_capacity; ++i)
+    {
+        if (old_entries[i].name)
+        {
+            *find_slot(cache, old_entries[i].name) = old_entries[i];
+        }
+    }
+
+    free(old_entries);
+}
+
+static void snapshot_dirs(struct path_cache *cache)
+{
+    for (size_t i = 0; i < cache->dir_count; ++i)
+    {
+        dir_mtime(cache->path[i], &cache->dir_mtimes[i]);
+    }
+}
+
+static bool dirs_unchanged(const struct path_cache *cache, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        struct timespec mtime;
+
+        dir_mtime(cache->path[i], &mtime);
+
+        if (mtime.tv_sec != cache->dir_mtimes[i].tv_sec || mtime.tv_nsec != cache->dir_mtimes[i].tv_nsec)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void dir_mtime(const char *dir, struct timespec *mtime)
+{
+    struct stat sb;
+
+    if (stat(dir, &sb) != 0)
+    {
+        mtime->tv_sec  = -1;
+        mtime->tv_nsec = 0;
+    }
+    else
+    {
+        *mtime = sb.st_mtim;
+    }
+}
+
+static char *search_path(const struct dc_posix_env *env, struct dc_error *err, const struct path_cache *cache,
+                         const char *name, size_t *dir_index)
+{
+    char *not_executable;
+
+    not_executable = NULL;
+
+    for (size_t index = 0; index < cache->dir_count; ++index)
+    {
+        struct stat sb;
+        size_t len = dc_strlen(env, cache->path[index]) + 1 + dc_strlen(env, name) + 1;
+        char *cmd  = dc_malloc(env, err, len * sizeof(char));
+
+        if (cmd == NULL)
+        {
+            break;
+        }
+
+        sprintf(cmd, "%s/%s", cache->path[index], name);
+
+        if (stat(cmd, &sb) == 0 && S_ISREG(sb.st_mode))
+        {
+            if (access(cmd, X_OK) == 0)
+            {
+                free(not_executable);
+                *dir_index = index;
+                return cmd;
+            }
+            if (not_executable == NULL)
+            {
+                not_executable = cmd;
+                cmd            = NULL;
+            }
+        }
+        free(cmd);
+    }
+
+    // Anything executable added to any of the directories would be used instead.
+    *dir_index = cache->dir_count == 0 ? 0 : cache->dir_count - 1;
+
+    return not_executable;
+}
@@ -0,0 +1,353 @@
+// gethostname is not in C11
+#define _DEFAULT_SOURCE
+
+#include <pwd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dc_posix/dc_stdlib.h>
+#include "prompt.h"
+
+/**
+ * Add text that does not change to the end of a prompt, joining it to the text before it.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param prompt the prompt.
+ * @param text the text.
+ * @param length the length of the text.
+ */
+static void add_text(const struct dc_posix_env *env, struct dc_error *err, struct prompt *prompt, const char *text,
+                     size_t length);
+
+/**
+ * Add a part to the end of a prompt.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param prompt the prompt.
+ * @param type what the part shows.
+ */
+static void add_part(const struct dc_posix_env *env, struct dc_error *err, struct prompt *prompt,
+                     enum prompt_part_type type);
+
+/**
+ * Get the name of the user the shell runs as.
+ *
+ * @param env the posix environment.
+ * @return the name, "" if it is not known.
+ */
+static const char *user_name(const struct dc_posix_env *env);
+
+/**
+ * Add to the prompt being rendered.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param prompt the prompt.
+ * @param size the bytes rendered so far.
+ * @param text the text to add.
+ * @param length the length of the text.
+ * @return the bytes rendered after the text.
+ */
+static size_t append(const struct dc_posix_env *env, struct dc_error *err, struct prompt *prompt, size_t size,
+                     const char *text, size_t length);
+
+struct prompt *prompt_create(const struct dc_posix_env *env, struct dc_error *err, const char *ps1)
+{
+    struct prompt *prompt;
+    const char *home;
+
+    prompt = dc_calloc(env, err, 1, sizeof(struct prompt));
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    home = dc_getenv(env, "HOME");
+
+    if (home && home[0])
+    {
+        prompt->home_length = strlen(home);
+
+        // /home/user/ is the same directory as /home/user
+        while (prompt->home_length > 1 && home[prompt->home_length - 1] == '/')
+        {
+            prompt->home_length--;
+        }
+
+        prompt->home = dc_malloc(env, err, prompt->home_length + 1);
+
+        if (prompt->home)
+        {
+            memcpy(prompt->home, home, prompt->home_length);
+            prompt->home[prompt->home_length] = '\0';
+        }
+    }
+
+    add_text(env, err, prompt, "[", 1);
+    add_part(env, err, prompt, PROMPT_DIRECTORY);
+    add_text(env, err, prompt, "] ", 2);
+
+    for (const char *c = ps1; *c && dc_error_has_no_error(err); ++c)
+    {
+        char host[256];
+        const char *text;
+        size_t length;
+
+        if (c[0] != '\\' || c[1] == '\0')
+        {
+            // the text up to the next escape goes in at once
+            length = strcspn(c, "\\");
+            add_text(env, err, prompt, c, length ? length : 1);
+            c += (length ? length : 1) - 1;
+            continue;
+        }
+
+        ++c;
+
+        switch (*c)
+        {
+            case 'u':
+                text = user_name(env);
+                add_text(env, err, prompt, text, strlen(text));
+                break;
+            case 'h':
+            case 'H':
+                if (gethostname(host, sizeof(host)) == -1)
+                {
+                    host[0] = '\0';
+                }
+
+                host[sizeof(host) - 1] = '\0';
+                add_text(env, err, prompt, host, *c == 'h' ? strcspn(host, ".") : strlen(host));
+                break;
+            case 'w':
+                add_part(env, err, prompt, PROMPT_HOME);
+                break;
+            case 'W':
+                add_part(env, err, prompt, PROMPT_BASENAME);
+                break;
+            case '$':
+                add_text(env, err, prompt, geteuid() == 0 ? "#" : "$", 1);
+                break;
+            case '?':
+                add_part(env, err, prompt, PROMPT_EXIT_CODE);
+                break;
+            case 'j':
+                add_part(env, err, prompt, PROMPT_JOBS);
+                break;
+            case 'n':
+                add_text(env, err, prompt, "\n", 1);
+                break;
+            case '\\':
+                add_text(env, err, prompt, "\\", 1);
+                break;
+            default:
+                add_text(env, err, prompt, c - 1, 2);
+                break;
+        }
+    }
+
+    if (dc_error_has_error(err))
+    {
+        prompt_destroy(env, &prompt);
+    }
+
+    return prompt;
+}
+
+void prompt_destroy(const struct dc_posix_env *env, struct prompt **pprompt)
+{
+    struct prompt *prompt;
+
+    (void)env;
+    prompt = *pprompt;
+
+    if (prompt)
+    {
+        free(prompt->text);
+        free(prompt->parts);
+        free(prompt->home);
+        free(prompt->buffer);
+        free(prompt);
+    }
+
+    *pprompt = NULL;
+}
+
+const char *prompt_render(const struct dc_posix_env *env, struct dc_error *err, struct prompt *prompt,
+                          const char *cwd, int exit_code, size_t jobs)
+{
+    size_t size;
+    bool at_home;
+
+    size    = 0;
+    cwd     = cwd ? cwd : "";
+    at_home = prompt->home && strncmp(cwd, prompt->home, prompt->home_length) == 0 &&
+              (cwd[prompt->home_length] == '\0' || cwd[prompt->home_length] == '/');
+
+    for (size_t i = 0; i < prompt->part_count; ++i)
+    {
+        const struct prompt_part *part;
+        const char *last;
+        char number[24];
+        int length;
+
+        part = &prompt->parts[i];
+
+        switch (part->type)
+        {
+            case PROMPT_TEXT:
+                size = append(env, err, prompt, size, &prompt->text[part->offset], part->length);
+                break;
+            case PROMPT_DIRECTORY:
+                size = append(env, err, prompt, size, cwd, strlen(cwd));
+                break;
+            case PROMPT_HOME:
+                // / as the home directory would turn every directory into ~
+                if (at_home && prompt->home_length > 1)
+                {
+                    size = append(env, err, prompt, size, "~", 1);
+                    size = append(env, err, prompt, size, &cwd[prompt->home_length],
+                                  strlen(&cwd[prompt->home_length]));
+                }
+                else
+                {
+                    size = append(env, err, prompt, size, cwd, strlen(cwd));
+                }
+                break;
+            case PROMPT_BASENAME:
+                last = strrchr(cwd, '/');
+
+                if (at_home && cwd[prompt->home_length] == '\0' && prompt->home_length > 1)
+                {
+                    size = append(env, err, prompt, size, "~", 1);
+                }
+                else
+                {
+                    last = last && last[1] ? last + 1 : cwd;
+                    size = append(env, err, prompt, size, last, strlen(last));
+                }
+                break;
+            case PROMPT_EXIT_CODE:
+                length = snprintf(number, sizeof(number), "%d", exit_code);
+                size   = append(env, err, prompt, size, number, (size_t)length);
+                break;
+            case PROMPT_JOBS:
+                length = snprintf(number, sizeof(number), "%zu", jobs);
+                size   = append(env, err, prompt, size, number, (size_t)length);
+                break;
+            default:
+                break;
+        }
+    }
+
+    append(env, err, prompt, size, "", 1);
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    return prompt->buffer;
+}
+
+static void add_text(const struct dc_posix_env *env, struct dc_error *err, struct prompt *prompt, const char *text,
+                     size_t length)
+{
+    char *grown;
+
+    grown = dc_realloc(env, err, prompt->text, prompt->text_size + length + 1);
+
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    prompt->text = grown;
+    memcpy(&prompt->text[prompt->text_size], text, length);
+
+    if (prompt->part_count == 0 || prompt->parts[prompt->part_count - 1].type != PROMPT_TEXT)
+    {
+        add_part(env, err, prompt, PROMPT_TEXT);
+
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+
+        prompt->parts[prompt->part_count - 1].offset = prompt->text_size;
+    }
+
+    prompt->parts[prompt->part_count - 1].length += length;
+    prompt->text_size                            += length;
+}
+
+static void add_part(const struct dc_posix_env *env, struct dc_error *err, struct prompt *prompt,
+                     enum prompt_part_type type)
+{
+    struct prompt_part *grown;
+
+    grown = dc_realloc(env, err, prompt->parts, (prompt->part_count + 1) * sizeof(struct prompt_part));
+
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    prompt->parts                     = grown;
+    prompt->parts[prompt->part_count] = (struct prompt_part){type, 0, 0};
+    prompt->part_count++;
+}
+
+static const char *user_name(const struct dc_posix_env *env)
+{
+    const struct passwd *user;
+    const char *name;
+
+    user = getpwuid(geteuid());
+
+    if (user && user->pw_name)
+    {
+        return user->pw_name;
+    }
+
+    name = dc_getenv(env, "USER");
+
+    return name ? name : "";
+}
+
+static size_t append(const struct dc_posix_env *env, struct dc_error *err, struct prompt *prompt, size_t size,
+                     const char *text, size_t length)
+{
+    if (dc_error_has_error(err))
+    {
+        return size;
+    }
+
+    // the buffer only grows for a longer prompt than any before it
+    if (size + length > prompt->capacity)
+    {
+        char *grown;
+        size_t capacity;
+
+        capacity = prompt->capacity ? prompt->capacity * 2 : 256;
+        capacity = capacity < size + length ? size + length : capacity;
+        grown    = dc_realloc(env, err, prompt->buffer, capacity);
+
+        if (dc_error_has_error(err))
+        {
+            return size;
+        }
+
+        prompt->buffer   = grown;
+        prompt->capacity = capacity;
+    }
+
+    memcpy(&prompt->buffer[size], text, length);
+
+    return size + length;
+}
@@ -0,0 +1,339 @@
+#include <stdint.h>
+#include <string.h>
+#include "scan.h"
+
+// the bytes looked at one at a time before a vector scanner starts, most words in a command are shorter
+#define SCAN_PREFIX 16
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SCAN_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * For each high nibble below 8, the bit that scan_set.low uses for it.
+ * Bytes of 128 and up have a high nibble of 8 or more, which is never in a set.
+ */
+static const unsigned char high_bits[16] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+
+/**
+ * Scan one byte at a time with the members table.
+ *
+ * @param set the set.
+ * @param text the text.
+ * @param length the number of bytes of the text.
+ * @return the index of the first byte in the set, or length.
+ */
+static size_t span_table(const struct scan_set *set, const char *text, size_t length);
+
+/**
+ * Scan the first SCAN_PREFIX bytes one at a time, so a short span does not pay for setting up the vectors.
+ *
+ * @param set the set.
+ * @param text the text.
+ * @param length the number of bytes of the text.
+ * @return the index of the first byte in the set, or the number of bytes looked at.
+ */
+static size_t span_prefix(const struct scan_set *set, const char *text, size_t length);
+
+/**
+ * Scan 8 bytes at a time, xoring each word with every byte of the set and looking for a zero byte.
+ *
+ * @param set the set.
+ * @param text the text.
+ * @param length the number of bytes of the text.
+ * @return the index of the first byte in the set, or length.
+ */
+static size_t span_swar(const struct scan_set *set, const char *text, size_t length);
+
+/**
+ * Get a word with 0x80 in every byte that is zero in x, and 0 in the others.
+ *
+ * @param x the word.
+ * @return the zero bytes of x.
+ */
+static uint64_t zero_bytes(uint64_t x);
+
+#ifdef SCAN_X86
+/**
+ * Scan 16 bytes at a time, comparing them with every byte of the set.
+ *
+ * @param set the set.
+ * @param text the text.
+ * @param length the number of bytes of the text.
+ * @return the index of the first byte in the set, or length.
+ */
+static size_t span_sse2(const struct scan_set *set, const char *text, size_t length);
+
+/**
+ * Scan 32 bytes at a time, looking up the low and high nibble of each byte and checking they share a bit.
+ *
+ * @param set the set.
+ * @param text the text.
+ * @param length the number of bytes of the text.
+ * @return the index of the first byte in the set, or length.
+ */
+static size_t span_avx2(const struct scan_set *set, const char *text, size_t length);
+#endif
+
+void scan_set_init(struct scan_set *set, const char *bytes, size_t count)
+{
+    memset(set, 0, sizeof(*set));
+
+    for (size_t i = 0; i < count && i < SCAN_SET_MAX; ++i)
+    {
+        unsigned char byte;
+
+        byte               = (unsigned char)bytes[i];
+        set->bytes[i]      = byte;
+        set->members[byte] = true;
+        set->low[byte & 0x0F] |= high_bits[byte >> 4];
+        set->count++;
+    }
+
+    if (scan_supported(SCAN_AVX2))
+    {
+        set->impl = SCAN_AVX2;
+    }
+    else if (scan_supported(SCAN_SSE2))
+    {
+        set->impl = SCAN_SSE2;
+    }
+    else
+    {
+        // every byte of the set costs a few instructions per word, past a handful the table is faster
+        set->impl = set->count <= 4 ? SCAN_SWAR : SCAN_TABLE;
+    }
+}
+
+bool scan_supported(enum scan_impl impl)
+{
+    switch (impl)
+    {
+        case SCAN_TABLE:
+        case SCAN_SWAR:
+        {
+            return true;
+        }
+#ifdef SCAN_X86
+        case SCAN_SSE2:
+        {
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse2");
+        }
+        case SCAN_AVX2:
+        {
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+        }
+#else
+        case SCAN_SSE2:
+        case SCAN_AVX2:
+        {
+            return false;
+        }
+#endif
+        default:
+        {
+            return false;
+        }
+    }
+}
+
+bool scan_set_use(struct scan_set *set, enum scan_impl impl)
+{
+    if (!scan_supported(impl))
+    {
+        return false;
+    }
+
+    set->impl = impl;
+
+    return true;
+}
+
+const char *scan_impl_name(enum scan_impl impl)
+{
+    static const char *names[] = {
+        [SCAN_TABLE] = "table",
+        [SCAN_SWAR]  = "swar",
+        [SCAN_SSE2]  = "sse2",
+        [SCAN_AVX2]  = "avx2",
+    };
+
+    return names[impl];
+}
+
+size_t scan_span(const struct scan_set *set, const char *text, size_t length)
+{
+    switch (set->impl)
+    {
+#ifdef SCAN_X86
+        case SCAN_AVX2:
+        {
+            return span_avx2(set, text, length);
+        }
+        case SCAN_SSE2:
+        {
+            return span_sse2(set, text, length);
+        }
+#else
+        case SCAN_AVX2:
+        case SCAN_SSE2:
+#endif
+        case SCAN_SWAR:
+        {
+            return span_swar(set, text, length);
+        }
+        case SCAN_TABLE:
+        default:
+        {
+            return span_table(set, text, length);
+        }
+    }
+}
+
+static size_t span_table(const struct scan_set *set, const char *text, size_t length)
+{
+    size_t i;
+
+    for (i = 0; i < length && !set->members[(unsigned char)text[i]]; ++i)
+    {
+    }
+
+    return i;
+}
+
+static size_t span_prefix(const struct scan_set *set, const char *text, size_t length)
+{
+    return span_table(set, text, length < SCAN_PREFIX ? length : SCAN_PREFIX);
+}
+
+static uint64_t zero_bytes(uint64_t x)
+{
+    const uint64_t low7 = UINT64_C(0x7F7F7F7F7F7F7F7F);
+
+    // adding 0x7F to the low 7 bits sets the top bit of every byte that is not zero, without carrying into the next
+    return ~(((x & low7) + low7) | x | low7);
+}
+
+static size_t span_swar(const struct scan_set *set, const char *text, size_t length)
+{
+    uint64_t repeated[SCAN_SET_MAX];
+    size_t i;
+
+    i = 0;
+
+    if (length >= sizeof(uint64_t))
+    {
+        for (size_t j = 0; j < set->count; ++j)
+        {
+            repeated[j] = set->bytes[j] * UINT64_C(0x0101010101010101);
+        }
+
+        for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t))
+        {
+            uint64_t word;
+            uint64_t hits;
+
+            memcpy(&word, &text[i], sizeof(word));
+            hits = 0;
+
+            for (size_t j = 0; j < set->count; ++j)
+            {
+                hits |= zero_bytes(word ^ repeated[j]);
+            }
+
+            if (hits != 0)
+            {
+                // the table finds which of the 8 it was without caring about the byte order
+                break;
+            }
+        }
+    }
+
+    return i + span_table(set, &text[i], length - i);
+}
+
+#ifdef SCAN_X86
+__attribute__((target("sse2"))) static size_t span_sse2(const struct scan_set *set, const char *text, size_t length)
+{
+    __m128i repeated[SCAN_SET_MAX];
+    size_t i;
+
+    i = span_prefix(set, text, length);
+
+    if (i == SCAN_PREFIX && length - i >= sizeof(__m128i))
+    {
+        for (size_t j = 0; j < set->count; ++j)
+        {
+            repeated[j] = _mm_set1_epi8((char)set->bytes[j]);
+        }
+
+        for (; i + sizeof(__m128i) <= length; i += sizeof(__m128i))
+        {
+            __m128i block;
+            __m128i hits;
+            unsigned int mask;
+
+            block = _mm_loadu_si128((const __m128i *)&text[i]);
+            hits  = _mm_setzero_si128();
+
+            for (size_t j = 0; j < set->count; ++j)
+            {
+                hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, repeated[j]));
+            }
+
+            mask = (unsigned int)_mm_movemask_epi8(hits);
+
+            if (mask != 0)
+            {
+                return i + (size_t)__builtin_ctz(mask);
+            }
+        }
+    }
+
+    return i + span_table(set, &text[i], length - i);
+}
+
+__attribute__((target("avx2"))) static size_t span_avx2(const struct scan_set *set, const char *text, size_t length)
+{
+    size_t i;
+
+    i = span_prefix(set, text, length);
+
+    if (i == SCAN_PREFIX && length - i >= sizeof(__m256i))
+    {
+        __m256i low;
+        __m256i high;
+        __m256i nibble;
+
+        // vpshufb looks up within each 128 bit half, so both halves get the same table
+        low    = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)set->low));
+        high   = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)high_bits));
+        nibble = _mm256_set1_epi8(0x0F);
+
+        for (; i + sizeof(__m256i) <= length; i += sizeof(__m256i))
+        {
+            __m256i block;
+            __m256i lows;
+            __m256i highs;
+            __m256i misses;
+            unsigned int mask;
+
+            block  = _mm256_loadu_si256((const __m256i *)&text[i]);
+            lows   = _mm256_shuffle_epi8(low, _mm256_and_si256(block, nibble));
+            highs  = _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble));
+            misses = _mm256_cmpeq_epi8(_mm256_and_si256(lows, highs), _mm256_setzero_si256());
+            mask   = ~(unsigned int)_mm256_movemask_epi8(misses);
+
+            if (mask != 0)
+            {
+                return i + (size_t)__builtin_ctz(mask);
+            }
+        }
+    }
+
+    return i + span_table(set, &text[i], length - i);
+}
+#endif
@@ -2,6 +2,22 @@
 #include "shell.h"
 #include "state.h"
 #include "shell_impl.h"
+#include "parse_cache.h"
+
+/**
+ * Run the shell FSM.
+ *
+ * @param env the posix environment.
+ * @param error the error object
+ * @param in the keyboard (stdin) file
+ * @param out the keyboard (stdout) file
+ * @param err the keyboard (stderr) file
+ * @param options the settings, NULL for the defaults
+ * @param state the state, with the mode (interactive or script) already set
+ * @return the exit code from the FSM.
+ */
+static int run(const struct dc_posix_env *env, struct dc_error *error, FILE *in, FILE *out, FILE *err,
+               const struct shell_options *options, struct state *state);
 
 static struct dc_fsm_transition transitions[] = {
         {DC_FSM_INIT,       INIT_STATE,        init_state},
@@ -10,12 +26,18 @@ static struct dc_fsm_transition transitions[] = {
 
         {READ_COMMANDS,     RESET_STATE,       reset_state},
         {READ_COMMANDS,     SEPARATE_COMMANDS, separate_commands},
+        {READ_COMMANDS,     EXIT,              do_exit},
         {READ_COMMANDS,     ERROR,             handle_error},
 
         {SEPARATE_COMMANDS, PARSE_COMMANDS,    parse_commands},
+        {SEPARATE_COMMANDS, EXECUTE_COMMANDS,  execute_commands},
+        {SEPARATE_COMMANDS, RESET_STATE,       reset_state},
+        {SEPARATE_COMMANDS, EXIT,              do_exit},
         {SEPARATE_COMMANDS, ERROR,             handle_error},
 
         {PARSE_COMMANDS,    EXECUTE_COMMANDS,  execute_commands},
+        {PARSE_COMMANDS,    RESET_STATE,       reset_state},
+        {PARSE_COMMANDS,    EXIT,              do_exit},
         {PARSE_COMMANDS,    ERROR,             handle_error},
 
         {EXECUTE_COMMANDS,  RESET_STATE,       reset_state},
@@ -31,24 +53,69 @@ static struct dc_fsm_transition transitions[] = {
         {DESTROY_STATE,     DC_FSM_EXIT, NULL}
 };
 
-int run_shell(const struct dc_posix_env *env, struct dc_error *error, FILE *in, FILE *out, FILE *err)
+int run_shell(const struct dc_posix_env *env, struct dc_error *error, FILE *in, FILE *out, FILE *err,
+              const struct shell_options *options)
+{
+    struct state state;
+    int ret_val;
+
+    state.interactive = true;
+    ret_val = run(env, error, in, out, err, options, &state);
+
+    return ret_val;
+}
+
+int run_script(const struct dc_posix_env *env, struct dc_error *error, FILE *in, FILE *out, FILE *err,
+               const struct shell_options *options)
+{
+    struct state state;
+    int ret_val;
+
+    // the output is flushed before any program is run (see execute_commands) so nothing is reordered
+    setvbuf(out, NULL, _IOFBF, BUFSIZ);
+    state.interactive = false;
+    state.exit_code = 0;
+    ret_val = run(env, error, in, out, err, options, &state);
+
+    if (ret_val == 0)
+    {
+        ret_val = state.exit_code;
+    }
+    fflush(out);
+
+    return ret_val;
+}
+
+static int run(const struct dc_posix_env *env, struct dc_error *error, FILE *in, FILE *out, FILE *err,
+               const struct shell_options *options, struct state *state)
 {
     int ret_val = 0;
+    size_t parse_cache_size;
     struct dc_fsm_info *fsm_info;
+
+    parse_cache_size   = options ? options->parse_cache_size : PARSE_CACHE_DEFAULT_SIZE;
+    state->parse_cache = NULL;
+
+    if (parse_cache_size > 0)
+    {
+        state->parse_cache = parse_cache_create(env, error, parse_cache_size);
+    }
+
     fsm_info = dc_fsm_info_create(env, error, "shell");
 
     if(dc_error_has_no_error(error))
     {
-        struct state state;
-        state.stdin = in;
-        state.stdout = out;
-        state.stderr = err;
+        state->stdin = in;
+        state->stdout = out;
+        state->stderr = err;
 
         int from_state;
         int to_state;
-        ret_val = dc_fsm_run(env, error, fsm_info, &from_state, &to_state, &state, transitions);
+        ret_val = dc_fsm_run(env, error, fsm_info, &from_state, &to_state, state, transitions);
         dc_fsm_info_destroy(env, &fsm_info);
     }
 
+    parse_cache_destroy(env, &state->parse_cache);
+
     return ret_val;
 }
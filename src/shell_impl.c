@@ -1,5 +1,7 @@
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <dc_posix/dc_stdlib.h>
 #include <dc_posix/dc_string.h>
 #include <stdlib.h>
 #include <dc_util/filesystem.h>
@@ -7,15 +9,167 @@
 #include "input.h"
 #include "util.h"
 #include "builtins.h"
+#include "completion.h"
+#include "editor.h"
+#include "history.h"
+#include "history_index.h"
+#include "jobs.h"
+#include "parse_cache.h"
+#include "prompt.h"
+#include "vars.h"
+
+extern char **environ;
+
+// big enough for the commands of a typical line, a longer line adds more blocks
+#define LINE_ARENA_SIZE 4096
+
+/**
+ * Run a single command in the foreground, either a builtin (see find_builtin) or a program.
+ * A builtin runs in the shell, with its redirections applied to the shell's own descriptors.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param state the current state
+ * @param command the command to run
+ * @return true if the command is exit.
+ */
+static bool execute_simple(const struct dc_posix_env *env, struct dc_error *err, struct state *state,
+                           struct command *command);
+
+/**
+ * Set the environment of each command of a pipeline to the exported variables (see vars_envp),
+ * with the command's own assignments (FOO=1 cmd) added without changing the shell's variables.
+ * It is done just before the pipeline runs, an earlier pipeline on the line may have changed the variables.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param state the current state
+ * @param commands the commands in the pipeline
+ * @param count the number of commands
+ */
+static void set_environment(const struct dc_posix_env *env, struct dc_error *err, struct state *state,
+                            struct command *commands, size_t count);
+
+/**
+ * Start a pipeline in the background and add it to the job table.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param state the current state
+ * @param commands the commands in the pipeline
+ * @param count the number of commands
+ * @return the exit code (0 unless the job could not be recorded).
+ */
+static int execute_background(const struct dc_posix_env *env, struct dc_error *err, struct state *state,
+                              struct command *commands, size_t count);
+
+/**
+ * Run a pipeline of programs in the foreground and wait for it.
+ * With job control the pipeline gets its own process group and the terminal while it runs;
+ * if it is stopped (eg. ^Z) it is added to the job table as a stopped job.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param state the current state
+ * @param commands the commands in the pipeline
+ * @param count the number of commands
+ * @return the exit code of the pipeline, or 128 + SIGTSTP if it stopped.
+ */
+static int execute_foreground(const struct dc_posix_env *env, struct dc_error *err, struct state *state,
+                              struct command *commands, size_t count);
+
+/**
+ * Join the lines of the commands of a pipeline with " | ", the command line shown for a job.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param commands the commands in the pipeline
+ * @param count the number of commands
+ * @return the line (must be freed) or NULL on error.
+ */
+static char *pipeline_line(const struct dc_posix_env *env, struct dc_error *err, const struct command *commands,
+                           size_t count);
+
+/**
+ * Remove a leading time keyword from the command.
+ *
+ * @param env the posix environment.
+ * @param command the first command of a pipeline
+ * @return true if the command started with time.
+ */
+static bool strip_time(const struct dc_posix_env *env, struct command *command);
+
+/**
+ * Print the real time and the user and system time used by the commands of a pipeline.
+ *
+ * @param stream where to print the times
+ * @param start when the pipeline was started
+ * @param commands the commands in the pipeline
+ * @param count the number of commands
+ */
+static void print_time(FILE *stream, const struct timespec *start, const struct command *commands, size_t count);
+
+/**
+ * Print the resources used by each command of a pipeline, one line per command.
+ *
+ * @param stream where to print the resources
+ * @param commands the commands in the pipeline
+ * @param count the number of commands
+ */
+static void print_rusage(FILE *stream, const struct command *commands, size_t count);
+
+/**
+ * Convert a time to seconds.
+ *
+ * @param time the time to convert
+ * @return the number of seconds.
+ */
+static double timeval_seconds(const struct timeval *time);
+
+/**
+ * Print a syntax error and set the exit code to 2.
+ *
+ * @param state the current state
+ * @param token the unexpected token, or the quote that is not closed
+ * @return EXIT for a script, otherwise RESET_STATE.
+ */
+static int report_syntax_error(struct state *state, const char *token);
+
+/**
+ * Check if any command on the line has a here-document whose body has not been read.
+ *
+ * @param state the current state
+ * @return true if read_heredocs has lines to read.
+ */
+static bool has_heredocs(const struct state *state);
+
+/**
+ * Open the history file ($HISTFILE, or ~/.dc_shell_history) and its index (the same name with .idx after it),
+ * then index the entries added since the index was saved.
+ * A history or index that cannot be opened is reported and the shell runs without it.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param state the current state, history and history_index are set.
+ */
+static void open_history(const struct dc_posix_env *env, struct dc_error *err, struct state *state);
+
+/**
+ * Add a line entered at the terminal to the history, unless it is the same as the newest entry.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param state the current state
+ * @param line the line.
+ * @param length the length of the line.
+ */
+static void remember_line(const struct dc_posix_env *env, struct dc_error *err, struct state *state,
+                          const char *line, size_t length);
 
 int init_state(const struct dc_posix_env *env, struct dc_error *err, void *arg)
 {
     struct state *state;
     char *path_str;
-    int status;
-    regex_t *in_regex;
-    regex_t *out_regex;
-    regex_t *err_regex;
 
     state                  = (struct state*) arg;
     state->fatal_error     = false;
@@ -26,52 +180,74 @@ int init_state(const struct dc_posix_env *env, struct dc_error *err, void *arg)
         return ERROR;
     }
 
-    in_regex  = dc_calloc(env, err, 1, sizeof(regex_t));
-    out_regex = dc_calloc(env, err, 1, sizeof(regex_t));
-    err_regex = dc_calloc(env, err, 1, sizeof(regex_t));
-
-    status = regcomp(in_regex, "[ \\t\\f\\v]<.*", REG_EXTENDED);
-    if (status != 0)
+    path_str = get_path(env, err);
+    if (dc_error_has_error(err))
     {
         state->fatal_error = true;
         return ERROR;
     }
-    state->in_redirect_regex = in_regex;
-    status = regcomp(out_regex, "[ \\t\\f\\v][1^2]?>[>]?.*", REG_EXTENDED);
-    if (status != 0)
+    state->path  = parse_path(env, err, path_str);
+    if (dc_error_has_error(err))
     {
         state->fatal_error = true;
         return ERROR;
     }
-    state->out_redirect_regex = out_regex;
 
-    status = regcomp(err_regex, "[ \\t\\f\\v]2>[>]?.*", REG_EXTENDED);
-    if (status != 0)
+    state->path_cache = path_cache_create(env, err, state->path);
+    if (dc_error_has_error(err))
     {
         state->fatal_error = true;
         return ERROR;
     }
-    state->err_redirect_regex = err_regex;
 
+    state->jobs = jobs_create(env, err);
     if (dc_error_has_error(err))
     {
         state->fatal_error = true;
         return ERROR;
     }
 
-    path_str = get_path(env, err);
+    state->arena = arena_create(env, err, LINE_ARENA_SIZE);
     if (dc_error_has_error(err))
     {
         state->fatal_error = true;
         return ERROR;
     }
-    state->path  = parse_path(env, err, path_str);
+
+    state->vars = vars_create(env, err, environ);
+    if (dc_error_has_error(err))
+    {
+        state->fatal_error = true;
+        return ERROR;
+    }
+
+    state->input = input_create(env, err, state->stdin);
     if (dc_error_has_error(err))
     {
         state->fatal_error = true;
         return ERROR;
     }
 
+    // only a terminal gets the line editor and the history, a script reads plain lines
+    state->history       = NULL;
+    state->history_index = NULL;
+    state->editor        = NULL;
+    state->completion    = NULL;
+
+    if (state->interactive && state->stdin && isatty(fileno(state->stdin)))
+    {
+        jobs_control(env, err, state->jobs, fileno(state->stdin));
+        open_history(env, err, state);
+        state->completion = completion_create(env, err, state->path);
+        state->editor     = editor_create(env, err, fileno(state->stdin), fileno(state->stdout), state->history,
+                                          state->history_index, state->completion);
+        if (dc_error_has_error(err))
+        {
+            state->fatal_error = true;
+            return ERROR;
+        }
+    }
+
     state->prompt = get_prompt(env, err);
     if (dc_error_has_error(err))
     {
@@ -79,9 +255,38 @@ int init_state(const struct dc_posix_env *env, struct dc_error *err, void *arg)
         return ERROR;
     }
 
+    // the prompt is compiled once and the working directory read once, cd reads it again
+    state->prompt_template = NULL;
+    state->cwd             = NULL;
+
+    if (state->interactive)
+    {
+        state->prompt_template = prompt_create(env, err, state->prompt);
+        if (dc_error_has_error(err))
+        {
+            state->fatal_error = true;
+            return ERROR;
+        }
+
+        // a working directory that was removed has no name, the prompt leaves it out
+        state->cwd = dc_get_working_dir(env, err);
+        if (dc_error_has_error(err))
+        {
+            free(state->cwd);
+            state->cwd = NULL;
+            dc_error_reset(err);
+        }
+    }
+
     state->current_line = NULL;
     state->current_line_length = 0;
     state->command = NULL;
+    state->command_count = 0;
+    state->pipefail = false;
+    state->errexit = false;
+    state->log_rusage = false;
+    state->log_allocs = false;
+    state->exit_code = 0;
     free(path_str);
 
     return READ_COMMANDS;
@@ -97,27 +302,41 @@ int destroy_state(const struct dc_posix_env *env, struct dc_error *err,
 
     state->fatal_error = false;
 
-    regfree(state->in_redirect_regex);
-    free(state->in_redirect_regex);
-    state->in_redirect_regex = NULL;
+    free(state->prompt);
+    state->prompt = NULL;
+    prompt_destroy(env, &state->prompt_template);
+    free(state->cwd);
+    state->cwd = NULL;
 
-    regfree(state->out_redirect_regex);
-    free(state->out_redirect_regex);
-    state->out_redirect_regex = NULL;
+    input_destroy(env, &state->input);
+    editor_destroy(env, &state->editor);
+    completion_destroy(env, &state->completion);
 
-    regfree(state->err_redirect_regex);
-    free(state->err_redirect_regex);
-    state->err_redirect_regex = NULL;
+    // saved so the next session only indexes what is added after this
+    if (state->history_index)
+    {
+        history_index_update(env, err, state->history_index, state->history);
+        history_index_save(env, err, state->history_index);
 
-    free(state->prompt);
-    state->prompt = NULL;
+        if (dc_error_has_error(err))
+        {
+            fprintf(state->stderr, "dc_shell: %s: %s, the history index was not saved\n", state->history_index->path,
+                    err->message);
+            dc_error_reset(err);
+        }
+    }
 
-    free(state->current_line);
+    history_index_close(env, &state->history_index);
+    history_close(env, &state->history);
     state->current_line = NULL;
 
     state->max_line_length = 0;
     state->current_line_length = 0;
 
+    path_cache_destroy(env, &state->path_cache);
+    jobs_destroy(env, &state->jobs);
+    vars_destroy(env, &state->vars);
+
     index = 0;
     while (state->path[index])
     {
@@ -127,12 +346,10 @@ int destroy_state(const struct dc_posix_env *env, struct dc_error *err,
     free(state->path[index]);
     free(state->path);
     state->path = NULL;
-    if (state->command)
-    {
-        destroy_command(env, state->command);
-        free(state->command);
-        state->command = NULL;
-    }
+    arena_destroy(env, &state->arena);
+    state->command = NULL;
+    state->command_count = 0;
+    state->pipefail = false;
     if (dc_error_has_error(err))
     {
         dc_error_reset(err);
@@ -157,23 +374,83 @@ int read_commands(const struct dc_posix_env *env, struct dc_error *err,
     state = (struct state*) arg;
     size_t len;
     char *str;
+    const char *prompt;
+    const char *newline;
+    bool eof;
 
-    char *cwd = dc_get_working_dir(env, err);
+    prompt = NULL;
+
+    if (state->interactive)
+    {
+        // finished background jobs are reported before the prompt
+        jobs_notify(env, state->jobs, state->stdout);
+
+        prompt = prompt_render(env, err, state->prompt_template, state->cwd, state->exit_code,
+                               state->jobs ? state->jobs->count : 0);
+
+        if (dc_error_has_error(err))
+        {
+            state->fatal_error = true;
+            return ERROR;
+        }
+
+        // the editor draws the prompt itself, again after every key, so it only gets the last line of it
+        if (state->editor)
+        {
+            newline = strrchr(prompt, '\n');
+
+            if (newline)
+            {
+                fwrite(prompt, 1, (size_t)(newline + 1 - prompt), state->stdout);
+                prompt = newline + 1;
+            }
+        }
+        else
+        {
+            fputs(prompt, state->stdout);
+        }
+
+        // the input is read from its descriptor, which does not flush stdout the way reading stdin does
+        fflush(state->stdout);
+    }
+    else
+    {
+        // a script has no prompt, so there is nowhere to report finished jobs
+        jobs_notify(env, state->jobs, NULL);
+    }
 
-    fprintf(state->stdout, "[%s] %s", cwd, state->prompt);
+    if (state->editor && prompt)
+    {
+        str = editor_read_line(env, err, state->editor, prompt, &len);
+        eof = str == NULL;
+        str = input_trim(eof ? state->editor->line : str, eof ? 0 : len, &len);
+    }
+    else
+    {
+        str = read_command_line(env, err, state->input, &len);
+        eof = len == 0 && state->input->eof;
+    }
 
-    str = read_command_line(env, err, state->stdin, &len);
     if(dc_error_has_error(err))
     {
         state->fatal_error = true;
         return ERROR;
     }
-    state->current_line = strdup(str);
-    state->current_line_length = dc_strlen(env, str);
+    state->current_line = str;
+    state->current_line_length = len;
 
-    free(cwd);
-    free(str);
-    if (len == 0)
+    if (eof)
+    {
+        return EXIT;
+    }
+
+    if (state->history && len > 0)
+    {
+        remember_line(env, err, state, str, len);
+    }
+
+    // blank lines and comments (including a #! line) have nothing to run
+    if (len == 0 || str[0] == '#')
     {
         return RESET_STATE;
     }
@@ -184,29 +461,27 @@ int separate_commands(const struct dc_posix_env *env, struct dc_error *err,
                       void *arg)
 {
     struct state *state;
+    const char *syntax_error;
 
     state = (struct state *) arg;
 
     state->fatal_error = false;
 
-    state->command = dc_calloc(env, err, 1, sizeof(struct command));
+    // a line that was run before, with nothing to expand, is ready to run without being parsed again
+    if (state->parse_cache &&
+        parse_cache_lookup(env, err, state->parse_cache, state->arena, state->current_line, &state->command,
+                           &state->command_count))
+    {
+        return EXECUTE_COMMANDS;
+    }
 
     if (dc_error_has_error(err))
     {
         state->fatal_error = true;
         return ERROR;
     }
-    state->command->line = strdup(state->current_line);
-    state->command->command = NULL;
-    state->command->argc = 0;
-    state->command->argv = NULL;
-    state->command->stdin_file = NULL;
-    state->command->stdout_file = NULL;
-    state->command->stderr_file = NULL;
-    state->command->stderr_overwrite = false;
-    state->command->stdout_overwrite = false;
-    state->command->exit_code = 0;
-    state->command->stderr_file = NULL;
+
+    state->command = separate_line(env, err, state->arena, state->current_line, &state->command_count, &syntax_error);
 
     if (dc_error_has_error(err))
     {
@@ -214,6 +489,11 @@ int separate_commands(const struct dc_posix_env *env, struct dc_error *err,
         return ERROR;
     }
 
+    if (syntax_error)
+    {
+        return report_syntax_error(state, syntax_error);
+    }
+
     return PARSE_COMMANDS;
 }
 
@@ -221,9 +501,37 @@ int parse_commands(const struct dc_posix_env *env, struct dc_error *err,
                    void *arg)
 {
     struct state *state;
-    state = (struct state *) arg;
+    const char *syntax_error;
+
+    state        = (struct state *) arg;
+    syntax_error = NULL;
+
+    for (size_t i = 0; i < state->command_count && dc_error_has_no_error(err) && !state->fatal_error && !syntax_error; ++i)
+    {
+        syntax_error = lex_command(env, err, &state->command[i]);
+    }
+
+    if (syntax_error && dc_error_has_no_error(err))
+    {
+        return report_syntax_error(state, syntax_error);
+    }
+
+    // reading the bodies can move the input's buffer (or reuse the editor's line), and the line is still needed
+    // for the parse cache
+    if (has_heredocs(state))
+    {
+        state->current_line = arena_strndup(env, err, state->arena, state->current_line, state->current_line_length);
+    }
 
-    parse_command(env, err, state, state->command);
+    // the bodies of the here-documents are the lines after this one, in the order of the commands
+    for (size_t i = 0; i < state->command_count && dc_error_has_no_error(err); ++i)
+    {
+        if (!read_heredocs(env, err, state->vars, &state->command[i], state->input, state->editor,
+                           state->interactive ? state->stdout : NULL))
+        {
+            fprintf(state->stderr, "warning: here-document delimited by end-of-file\n");
+        }
+    }
 
     if (dc_error_has_error(err)) {
         state->fatal_error = true;
@@ -234,6 +542,18 @@ int parse_commands(const struct dc_posix_env *env, struct dc_error *err,
     {
         return ERROR;
     }
+
+    if (state->parse_cache)
+    {
+        parse_cache_add(env, err, state->parse_cache, state->current_line, state->command, state->command_count);
+
+        if (dc_error_has_error(err))
+        {
+            state->fatal_error = true;
+            return ERROR;
+        }
+    }
+
     return EXECUTE_COMMANDS;
 }
 
@@ -241,27 +561,352 @@ int execute_commands(const struct dc_posix_env *env, struct dc_error *err,
                      void *arg)
 {
     struct state *state;
-    state = (struct state *)arg;
-    if (dc_strcmp(env, state->command->command, "cd") == 0)
+    const char *syntax_error;
+    int exit_code;
+    size_t start;
+    enum command_connector previous;
+    bool failed;
+
+    state        = (struct state *)arg;
+    syntax_error = NULL;
+    exit_code    = 0;
+    start        = 0;
+    previous     = CONNECTOR_NONE;
+    failed       = false;
+
+    // Each pass runs one pipeline: the commands up to the first one that is not piped into the next.
+    while (start < state->command_count && !failed)
     {
-        builtin_cd(env, err, state->command, state->stderr);
+        struct command *commands;
+        size_t count;
+        bool timed;
+        struct timespec start_time;
+
+        commands = &state->command[start];
+        count    = 1;
+        while (start + count < state->command_count && commands[count - 1].connector == CONNECTOR_PIPE)
+        {
+            count++;
+        }
+
+        start += count;
+
+        // a && b skips b when a fails and a || b skips b when a succeeds, the exit code is left as it was
+        if ((previous == CONNECTOR_AND && exit_code != 0) || (previous == CONNECTOR_OR && exit_code == 0))
+        {
+            previous = commands[count - 1].connector;
+            continue;
+        }
+
+        previous = commands[count - 1].connector;
+
+        // the words are expanded now, not when the line was parsed, so they see what the pipelines before did
+        for (size_t i = 0; i < count && syntax_error == NULL && dc_error_has_no_error(err); ++i)
+        {
+            syntax_error = expand_command(env, err, state, &commands[i]);
+        }
+
+        if (dc_error_has_error(err))
+        {
+            state->fatal_error = true;
+            return ERROR;
+        }
+
+        if (syntax_error)
+        {
+            return report_syntax_error(state, syntax_error);
+        }
+
+        timed = previous != CONNECTOR_BACKGROUND && strip_time(env, commands);
+
+        // a ^C typed before this pipeline is not meant for it
+        if (state->jobs)
+        {
+            *state->jobs->interrupted = 0;
+        }
+
+        // output from the shell must come before output from the programs it runs
+        fflush(state->stdout);
+        fflush(state->stderr);
+
+        // give back the script input read ahead of the current line so that programs reading stdin get the rest
+        if (!state->interactive && state->input->fd == STDIN_FILENO)
+        {
+            input_release(state->input);
+        }
+
+        set_environment(env, err, state, commands, count);
+
+        if (dc_error_has_error(err))
+        {
+            state->fatal_error = true;
+            return ERROR;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+        if (previous == CONNECTOR_BACKGROUND)
+        {
+            exit_code = execute_background(env, err, state, commands, count);
+        }
+        else if (count > 1)
+        {
+            exit_code = execute_foreground(env, err, state, commands, count);
+        }
+        else if (execute_simple(env, err, state, commands))
+        {
+            return EXIT;
+        }
+        else
+        {
+            exit_code = commands->exit_code;
+        }
+
+        if (state->log_rusage && previous != CONNECTOR_BACKGROUND)
+        {
+            print_rusage(state->stderr, commands, count);
+        }
+
+        if (timed)
+        {
+            print_time(state->stderr, &start_time, commands, count);
+        }
+
+        // set -e ignores a failure that is tested by && or ||
+        failed = state->errexit && exit_code != 0 && previous != CONNECTOR_AND && previous != CONNECTOR_OR;
     }
-    else if(dc_strcmp(env, state->command->command, "exit") == 0)
+
+    state->exit_code = exit_code;
+
+    if (state->interactive)
+    {
+        fprintf(state->stdout, "%d\n", exit_code);
+    }
+
+    if (state->fatal_error)
+    {
+        return ERROR;
+    }
+
+    if (failed)
     {
         return EXIT;
     }
-    else
+    return RESET_STATE;
+}
+
+static bool execute_simple(const struct dc_posix_env *env, struct dc_error *err, struct state *state,
+                           struct command *command)
+{
+    const struct builtin *builtin;
+    struct saved_fds saved;
+
+    // a command with only assignments and redirections (or a time on its own) has no name
+    if (command->command == NULL)
     {
-        execute(env, err, state->command, state->path);
+        assign_variables(env, err, command, state);
+        execute(env, err, command, state->path_cache);
+        return false;
     }
 
-    fprintf(state->stdout, "%d\n", state->command->exit_code);
+    if(dc_strcmp(env, command->command, "exit") == 0)
+    {
+        return true;
+    }
 
-    if (state->fatal_error)
+    builtin = find_builtin(env, command->command);
+
+    if (builtin == NULL)
     {
-        return ERROR;
+        execute_foreground(env, err, state, command, 1);
     }
-    return RESET_STATE;
+    else if (command->redirection_count == 0 || dc_strcmp(env, command->command, "exec") == 0)
+    {
+        // exec applies its redirections to the shell itself, they are not undone
+        builtin->func(env, err, command, state);
+    }
+    else if (redirect_shell(env, err, command, &saved))
+    {
+        builtin->func(env, err, command, state);
+        // the output is still in the streams until it is flushed to the redirected descriptors
+        fflush(state->stdout);
+        fflush(state->stderr);
+        restore_shell(&saved);
+    }
+
+    return false;
+}
+
+static void set_environment(const struct dc_posix_env *env, struct dc_error *err, struct state *state,
+                            struct command *commands, size_t count)
+{
+    if (state->vars == NULL)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < count && dc_error_has_no_error(err); ++i)
+    {
+        if (commands[i].assignment_count == 0)
+        {
+            commands[i].envp = vars_envp(env, err, state->vars);
+        }
+        else
+        {
+            commands[i].envp = vars_envp_with(env, err, state->vars, state->arena, commands[i].assignments,
+                                              commands[i].assignment_count);
+        }
+    }
+}
+
+static int execute_background(const struct dc_posix_env *env, struct dc_error *err, struct state *state,
+                              struct command *commands, size_t count)
+{
+    struct job *job;
+    pid_t *pids;
+    int *exit_codes;
+    char *line;
+
+    pids       = dc_calloc(env, err, count, sizeof(pid_t));
+    exit_codes = dc_calloc(env, err, count, sizeof(int));
+    line       = pipeline_line(env, err, commands, count);
+
+    if (dc_error_has_error(err))
+    {
+        free(pids);
+        free(exit_codes);
+        free(line);
+        state->fatal_error = true;
+        return EXIT_FAILURE;
+    }
+
+    launch_pipeline(env, err, commands, count, state->path_cache, 0, pids);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        exit_codes[i] = commands[i].exit_code;
+    }
+
+    job = jobs_add(env, err, state->jobs, line, pids, exit_codes, count, state->pipefail);
+
+    if (job && state->interactive)
+    {
+        fprintf(state->stdout, "[%d] %d\n", job->id, (int)pids[count - 1]);
+    }
+
+    free(pids);
+    free(exit_codes);
+    free(line);
+
+    return EXIT_SUCCESS;
+}
+
+static int execute_foreground(const struct dc_posix_env *env, struct dc_error *err, struct state *state,
+                              struct command *commands, size_t count)
+{
+    struct job *job;
+    pid_t *pids;
+    int *exit_codes;
+    char *line;
+    pid_t pgid;
+    bool stopped;
+    int exit_code;
+
+    if (state->jobs == NULL || state->jobs->terminal == -1)
+    {
+        return execute_pipeline(env, err, commands, count, state->path_cache, state->pipefail);
+    }
+
+    pids = dc_calloc(env, err, count, sizeof(pid_t));
+
+    if (dc_error_has_error(err))
+    {
+        state->fatal_error = true;
+        return EXIT_FAILURE;
+    }
+
+    launch_pipeline(env, err, commands, count, state->path_cache, 0, pids);
+
+    // every process is in the group of the first one that started
+    pgid = -1;
+    for (size_t i = 0; i < count && pgid == -1; ++i)
+    {
+        pgid = pids[i];
+    }
+
+    jobs_foreground(state->jobs, pgid);
+
+    exit_code = wait_pipeline(commands, count, pids, state->pipefail, true);
+    jobs_foreground(state->jobs, state->jobs->pgid);
+    stopped = false;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        stopped = stopped || pids[i] > 0;
+    }
+
+    if (stopped)
+    {
+        exit_codes = dc_calloc(env, err, count, sizeof(int));
+        line       = pipeline_line(env, err, commands, count);
+        job        = NULL;
+
+        if (dc_error_has_no_error(err))
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                exit_codes[i] = commands[i].exit_code;
+            }
+
+            job = jobs_add(env, err, state->jobs, line, pids, exit_codes, count, state->pipefail);
+        }
+
+        if (job)
+        {
+            // the first process may have exited, its group is still the job's
+            job->pgid   = pgid;
+            job->status = JOB_STOPPED;
+            fprintf(state->stdout, "[%d] Stopped\t%s\n", job->id, job->line);
+        }
+
+        free(exit_codes);
+        free(line);
+        exit_code = 128 + SIGTSTP;
+    }
+
+    free(pids);
+
+    return exit_code;
+}
+
+static char *pipeline_line(const struct dc_posix_env *env, struct dc_error *err, const struct command *commands,
+                           size_t count)
+{
+    char *line;
+    size_t len;
+
+    len = 1;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        len += dc_strlen(env, commands[i].line) + 3;
+    }
+
+    line = dc_malloc(env, err, len);
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    line[0] = '\0';
+    for (size_t i = 0; i < count; ++i)
+    {
+        strcat(line, commands[i].line);
+        strcat(line, i + 1 < count ? " | " : "");
+    }
+
+    return line;
 }
 
 int do_exit(const struct dc_posix_env *env, struct dc_error *err, void *arg)
@@ -294,3 +939,203 @@ int handle_error(const struct dc_posix_env *env, struct dc_error *err,
     }
     return RESET_STATE;
 }
+
+static bool strip_time(const struct dc_posix_env *env, struct command *command)
+{
+    if (command->command == NULL || dc_strcmp(env, command->command, "time") != 0)
+    {
+        return false;
+    }
+
+    // argv[0] is filled in from command when it is run, the arguments start at argv[1]
+    arena_free(command->arena, command->command);
+    command->command = command->argv[1];
+
+    if (command->argc > 1)
+    {
+        memmove(&command->argv[1], &command->argv[2], (command->argc - 1) * sizeof(char *));
+    }
+
+    command->argc--;
+
+    return true;
+}
+
+static void print_time(FILE *stream, const struct timespec *start, const struct command *commands, size_t count)
+{
+    struct timespec end;
+    double real;
+    double user;
+    double sys;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    real = (double)(end.tv_sec - start->tv_sec) + (double)(end.tv_nsec - start->tv_nsec) / 1e9;
+    user = 0;
+    sys  = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        user += timeval_seconds(&commands[i].rusage.ru_utime);
+        sys  += timeval_seconds(&commands[i].rusage.ru_stime);
+    }
+
+    fprintf(stream, "real\t%.3f\nuser\t%.3f\nsys\t%.3f\n", real, user, sys);
+}
+
+static void print_rusage(FILE *stream, const struct command *commands, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const struct rusage *usage;
+
+        // builtins run in the shell and have nothing to report
+        if (commands[i].command == NULL || commands[i].argv[0] == NULL)
+        {
+            continue;
+        }
+
+        usage = &commands[i].rusage;
+        fprintf(stream, "rusage: %s: user %.3f sys %.3f maxrss %ld majflt %ld minflt %ld nvcsw %ld nivcsw %ld\n",
+                commands[i].command, timeval_seconds(&usage->ru_utime), timeval_seconds(&usage->ru_stime),
+                usage->ru_maxrss, usage->ru_majflt, usage->ru_minflt, usage->ru_nvcsw, usage->ru_nivcsw);
+    }
+}
+
+static double timeval_seconds(const struct timeval *time)
+{
+    return (double)time->tv_sec + (double)time->tv_usec / 1e6;
+}
+
+static int report_syntax_error(struct state *state, const char *token)
+{
+    if (token[0] == '\'' || token[0] == '"')
+    {
+        fprintf(state->stderr, "unexpected EOF while looking for matching `%s'\n", token);
+    }
+    else
+    {
+        fprintf(state->stderr, "syntax error near unexpected token `%s'\n", token);
+    }
+
+    state->exit_code = 2;
+
+    // the rest of a script cannot be trusted
+    if (!state->interactive)
+    {
+        return EXIT;
+    }
+    return RESET_STATE;
+}
+
+static bool has_heredocs(const struct state *state)
+{
+    for (size_t i = 0; i < state->command_count; ++i)
+    {
+        for (size_t j = 0; j < state->command[i].redirection_count; ++j)
+        {
+            if (state->command[i].redirections[j].delimiter)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static void open_history(const struct dc_posix_env *env, struct dc_error *err, struct state *state)
+{
+    const char *path;
+    const char *home;
+    char *home_path;
+    char *index_path;
+
+    path      = vars_get(state->vars, "HISTFILE", strlen("HISTFILE"));
+    home      = vars_get(state->vars, "HOME", strlen("HOME"));
+    home_path = NULL;
+
+    if (path == NULL && home)
+    {
+        home_path = dc_malloc(env, err, strlen(home) + strlen("/.dc_shell_history") + 1);
+
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+
+        sprintf(home_path, "%s/.dc_shell_history", home);
+        path = home_path;
+    }
+
+    if (path == NULL || path[0] == '\0')
+    {
+        return;
+    }
+
+    state->history = history_open(env, err, path, HISTORY_DEFAULT_CAPACITY);
+
+    if (dc_error_has_error(err))
+    {
+        fprintf(state->stderr, "dc_shell: %s: %s, there is no history\n", path, err->message);
+        dc_error_reset(err);
+    }
+    else if (state->history == NULL)
+    {
+        fprintf(state->stderr, "dc_shell: %s is not a history file, there is no history\n", path);
+    }
+    else
+    {
+        index_path = dc_malloc(env, err, strlen(path) + strlen(".idx") + 1);
+
+        if (dc_error_has_no_error(err))
+        {
+            sprintf(index_path, "%s.idx", path);
+            state->history_index = history_index_open(env, err, index_path);
+            free(index_path);
+        }
+
+        if (state->history_index)
+        {
+            history_index_update(env, err, state->history_index, state->history);
+        }
+
+        if (dc_error_has_error(err))
+        {
+            fprintf(state->stderr, "dc_shell: %s.idx: %s, there is no history search\n", path, err->message);
+            dc_error_reset(err);
+            history_index_close(env, &state->history_index);
+        }
+    }
+
+    free(home_path);
+}
+
+static void remember_line(const struct dc_posix_env *env, struct dc_error *err, struct state *state,
+                          const char *line, size_t length)
+{
+    uint64_t newest;
+    char *previous;
+    size_t previous_length;
+
+    previous = arena_alloc(env, err, state->arena, length + 1);
+
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    // running the same command again does not fill the history with copies of it
+    if (history_previous(state->history, history_end(state->history), &newest) &&
+        history_read(state->history, newest, previous, length + 1, &previous_length) &&
+        previous_length == length && memcmp(previous, line, length) == 0)
+    {
+        return;
+    }
+
+    history_add(state->history, line, length);
+
+    if (state->history_index)
+    {
+        history_index_update(env, err, state->history_index, state->history);
+    }
+}
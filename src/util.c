@@ -3,7 +3,9 @@
 #include <dc_posix/dc_stdlib.h>
 #include <stdlib.h>
 #include "util.h"
+#include "arena.h"
 #include "command.h"
+#include "parse_cache.h"
 
 char *get_prompt(const struct dc_posix_env *env, struct dc_error *err)
 {
@@ -67,18 +69,35 @@ char **parse_path(const struct dc_posix_env *env, struct dc_error *err,
 
 void do_reset_state(const struct dc_posix_env *env, struct dc_error *err, struct state *state)
 {
-    free(state->current_line);
+    if (state->log_allocs && state->command_count > 0)
+    {
+        display_allocs(env, state, state->stderr);
+    }
+
+    // the line is in the input's buffer and the commands are in the arena, there is nothing to free one by one
+    arena_reset(state->arena);
     state->current_line = NULL;
     state->fatal_error = false;
     state->current_line_length = 0;
-    if (state->command)
-    {
-        destroy_command(env, state->command);
-    }
     state->command = NULL;
+    state->command_count = 0;
     dc_error_reset(err);
 }
 
+void display_allocs(const struct dc_posix_env *env, const struct state *state, FILE *stream)
+{
+    if (state->arena)
+    {
+        fprintf(stream, "allocs: %zu allocations, %zu bytes, %zu blocks: %s\n", state->arena->allocations,
+                state->arena->bytes, state->arena->blocks, state->current_line ? state->current_line : "");
+    }
+
+    if (state->parse_cache)
+    {
+        parse_cache_display(env, state->parse_cache, stream);
+    }
+}
+
 void display_state(const struct dc_posix_env *env, const struct state *state, FILE *stream)
 {
     char *str;
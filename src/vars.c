@@ -0,0 +1,409 @@
+#include <stdlib.h>
+#include <string.h>
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_string.h>
+#include "vars.h"
+
+// a shell starts with a few dozen variables from its environment
+#define VARS_INITIAL_CAPACITY 64
+
+/**
+ * FNV-1a hash of a name.
+ *
+ * @param name the name.
+ * @param length the number of characters in name.
+ * @return the hash.
+ */
+static size_t hash_name(const char *name, size_t length);
+
+/**
+ * Find the slot holding a variable, or the empty slot where it would go.
+ *
+ * @param vars the variables.
+ * @param name the name.
+ * @param length the number of characters in name.
+ * @param hash the hash of the name.
+ * @return the slot.
+ */
+static struct var *find_slot(const struct vars *vars, const char *name, size_t length, size_t hash);
+
+/**
+ * Double the number of slots and put every variable back.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param vars the variables.
+ */
+static void grow(const struct dc_posix_env *env, struct dc_error *err, struct vars *vars);
+
+/**
+ * Check if two NAME=value strings (or names) are for the same variable.
+ *
+ * @param a the first string.
+ * @param b the second string.
+ * @return true if the names before the = are the same.
+ */
+static bool same_name(const char *a, const char *b);
+
+struct vars *vars_create(const struct dc_posix_env *env, struct dc_error *err, char **environment)
+{
+    struct vars *vars;
+
+    vars = dc_calloc(env, err, 1, sizeof(struct vars));
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    vars->capacity = VARS_INITIAL_CAPACITY;
+    vars->slots    = dc_calloc(env, err, vars->capacity, sizeof(struct var));
+
+    for (char **var = environment; var && *var && dc_error_has_no_error(err); ++var)
+    {
+        const char *equals;
+
+        equals = strchr(*var, '=');
+
+        if (equals)
+        {
+            vars_set(env, err, vars, *var, (size_t)(equals - *var), equals + 1, true);
+        }
+    }
+
+    if (dc_error_has_error(err))
+    {
+        vars_destroy(env, &vars);
+    }
+
+    return vars;
+}
+
+void vars_destroy(const struct dc_posix_env *env, struct vars **pvars)
+{
+    struct vars *vars;
+
+    (void)env;
+    vars = *pvars;
+
+    if (vars)
+    {
+        for (size_t i = 0; vars->slots && i < vars->capacity; ++i)
+        {
+            free(vars->slots[i].entry);
+        }
+
+        free(vars->slots);
+        free(vars->envp);
+        free(vars);
+    }
+
+    *pvars = NULL;
+}
+
+const char *vars_get(const struct vars *vars, const char *name, size_t length)
+{
+    struct var *var;
+
+    var = find_slot(vars, name, length, hash_name(name, length));
+
+    return var->entry ? &var->entry[length + 1] : NULL;
+}
+
+void vars_set(const struct dc_posix_env *env, struct dc_error *err, struct vars *vars, const char *name,
+              size_t length, const char *value, bool export)
+{
+    struct var *var;
+    size_t hash;
+    size_t value_length;
+    char *entry;
+
+    // at most 3/4 full so a probe ends quickly
+    if ((vars->count + 1) * 4 > vars->capacity * 3)
+    {
+        grow(env, err, vars);
+
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+    }
+
+    value_length = dc_strlen(env, value);
+    entry        = dc_malloc(env, err, length + 1 + value_length + 1);
+
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    dc_memcpy(env, entry, name, length);
+    entry[length] = '=';
+    dc_memcpy(env, &entry[length + 1], value, value_length + 1);
+    hash = hash_name(name, length);
+    var  = find_slot(vars, name, length, hash);
+
+    if (var->entry == NULL)
+    {
+        var->name_length = length;
+        var->hash        = hash;
+        var->exported    = false;
+        vars->count++;
+    }
+
+    free(var->entry);
+    var->entry    = entry;
+    var->exported = var->exported || export;
+
+    if (var->exported)
+    {
+        vars->envp_stale = true;
+    }
+}
+
+bool vars_export(struct vars *vars, const char *name, size_t length)
+{
+    struct var *var;
+
+    var = find_slot(vars, name, length, hash_name(name, length));
+
+    if (var->entry == NULL)
+    {
+        return false;
+    }
+
+    if (!var->exported)
+    {
+        var->exported    = true;
+        vars->envp_stale = true;
+    }
+
+    return true;
+}
+
+bool vars_unset(struct vars *vars, const char *name, size_t length)
+{
+    struct var *hole;
+    size_t mask;
+    size_t i;
+
+    hole = find_slot(vars, name, length, hash_name(name, length));
+
+    if (hole->entry == NULL)
+    {
+        return false;
+    }
+
+    if (hole->exported)
+    {
+        vars->envp_stale = true;
+    }
+
+    free(hole->entry);
+    hole->entry = NULL;
+    vars->count--;
+    mask = vars->capacity - 1;
+    i    = (size_t)(hole - vars->slots);
+
+    // move back the variables after the hole that could not be in their own slot because of it
+    for (size_t next = (i + 1) & mask; vars->slots[next].entry; next = (next + 1) & mask)
+    {
+        size_t home;
+
+        home = vars->slots[next].hash & mask;
+
+        // the variable stays if its home is after the hole (cyclically) and at or before where it is
+        if (((next - home) & mask) >= ((next - i) & mask))
+        {
+            vars->slots[i]          = vars->slots[next];
+            vars->slots[next].entry = NULL;
+            i                       = next;
+        }
+    }
+
+    return true;
+}
+
+char **vars_envp(const struct dc_posix_env *env, struct dc_error *err, struct vars *vars)
+{
+    size_t count;
+
+    if (vars->envp && !vars->envp_stale)
+    {
+        return vars->envp;
+    }
+
+    if (vars->envp_capacity < vars->count + 1)
+    {
+        char **envp;
+
+        envp = dc_realloc(env, err, vars->envp, (vars->count + 1) * sizeof(char *));
+
+        if (dc_error_has_error(err))
+        {
+            return NULL;
+        }
+
+        vars->envp          = envp;
+        vars->envp_capacity = vars->count + 1;
+    }
+
+    count = 0;
+
+    for (size_t i = 0; i < vars->capacity; ++i)
+    {
+        if (vars->slots[i].entry && vars->slots[i].exported)
+        {
+            vars->envp[count++] = vars->slots[i].entry;
+        }
+    }
+
+    vars->envp[count] = NULL;
+    vars->envp_stale  = false;
+    vars->envp_builds++;
+
+    return vars->envp;
+}
+
+char **vars_envp_with(const struct dc_posix_env *env, struct dc_error *err, struct vars *vars,
+                      struct arena *arena, char **assignments, size_t count)
+{
+    char **base;
+    char **envp;
+    size_t size;
+    size_t length;
+
+    base = vars_envp(env, err, vars);
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    for (size = 0; base[size]; ++size)
+    {
+    }
+
+    envp = arena_alloc(env, err, arena, (size + count + 1) * sizeof(char *));
+
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    length = 0;
+
+    // the variables that are not replaced, then the assignments (the last one wins for a name given twice)
+    for (size_t i = 0; i < size; ++i)
+    {
+        bool replaced;
+
+        replaced = false;
+
+        for (size_t j = 0; j < count && !replaced; ++j)
+        {
+            replaced = same_name(base[i], assignments[j]);
+        }
+
+        if (!replaced)
+        {
+            envp[length++] = base[i];
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        bool replaced;
+
+        replaced = false;
+
+        for (size_t j = i + 1; j < count && !replaced; ++j)
+        {
+            replaced = same_name(assignments[i], assignments[j]);
+        }
+
+        if (!replaced)
+        {
+            envp[length++] = assignments[i];
+        }
+    }
+
+    envp[length] = NULL;
+
+    return envp;
+}
+
+static size_t hash_name(const char *name, size_t length)
+{
+    size_t hash = 14695981039346656037UL;
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= (unsigned char)name[i];
+        hash *= 1099511628211UL;
+    }
+
+    return hash;
+}
+
+static struct var *find_slot(const struct vars *vars, const char *name, size_t length, size_t hash)
+{
+    size_t mask;
+    size_t i;
+
+    mask = vars->capacity - 1;
+
+    // the table is never full, so there is always an empty slot to stop at
+    for (i = hash & mask; vars->slots[i].entry; i = (i + 1) & mask)
+    {
+        const struct var *var;
+
+        var = &vars->slots[i];
+
+        if (var->hash == hash && var->name_length == length && memcmp(var->entry, name, length) == 0)
+        {
+            break;
+        }
+    }
+
+    return &vars->slots[i];
+}
+
+static void grow(const struct dc_posix_env *env, struct dc_error *err, struct vars *vars)
+{
+    struct var *old;
+    size_t old_capacity;
+
+    old          = vars->slots;
+    old_capacity = vars->capacity;
+    vars->slots  = dc_calloc(env, err, old_capacity * 2, sizeof(struct var));
+
+    if (dc_error_has_error(err))
+    {
+        vars->slots = old;
+        return;
+    }
+
+    vars->capacity = old_capacity * 2;
+
+    for (size_t i = 0; i < old_capacity; ++i)
+    {
+        if (old[i].entry)
+        {
+            *find_slot(vars, old[i].entry, old[i].name_length, old[i].hash) = old[i];
+        }
+    }
+
+    free(old);
+}
+
+static bool same_name(const char *a, const char *b)
+{
+    while (*a != '\0' && *a != '=' && *a == *b)
+    {
+        ++a;
+        ++b;
+    }
+
+    return (*a == '\0' || *a == '=') && (*b == '\0' || *b == '=');
+}
@@ -0,0 +1,130 @@
+#include "tests.h"
+#include "arena.h"
+#include <stdalign.h>
+#include <stdint.h>
+
+Describe(arena);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+
+BeforeEach(arena)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+}
+
+AfterEach(arena)
+{
+    dc_error_reset(&error);
+}
+
+Ensure(arena, alloc)
+{
+    struct arena *arena;
+    char *first;
+    char *second;
+    char *big;
+    char **words;
+    char **grown;
+
+    arena = arena_create(&environ, &error, 64);
+    assert_that(arena, is_not_null);
+    assert_that(arena->blocks, is_equal_to(1));
+
+    first  = arena_strdup(&environ, &error, arena, "hello");
+    second = arena_strndup(&environ, &error, arena, "world wide", 5);
+    assert_that(first, is_equal_to_string("hello"));
+    assert_that(second, is_equal_to_string("world"));
+    assert_that((uintptr_t)second % alignof(max_align_t), is_equal_to(0));
+    assert_that(arena->allocations, is_equal_to(2));
+    assert_that(arena->bytes, is_equal_to(12));
+
+    // an allocation bigger than a block gets a block of its own
+    big = arena_calloc(&environ, &error, arena, 100, 1);
+    assert_that(big, is_not_null);
+    assert_that(big[99], is_equal_to(0));
+    assert_that(arena->blocks, is_equal_to(2));
+    assert_that(first, is_equal_to_string("hello"));
+
+    // the most recent allocation grows in place
+    words    = arena_calloc(&environ, &error, arena, 2, sizeof(char *));
+    words[0] = first;
+    grown    = arena_realloc(&environ, &error, arena, words, 2 * sizeof(char *), 4 * sizeof(char *));
+    assert_that(grown, is_equal_to(words));
+    words[3] = second;
+
+    // anything else is copied
+    second = arena_strdup(&environ, &error, arena, "x");
+    words  = arena_realloc(&environ, &error, arena, words, 4 * sizeof(char *), 6 * sizeof(char *));
+    assert_that(words[0], is_equal_to_string("hello"));
+    assert_that(words[3], is_equal_to_string("world"));
+    assert_false(dc_error_has_error(&error));
+
+    arena_destroy(&environ, &arena);
+    assert_that(arena, is_null);
+}
+
+Ensure(arena, reset)
+{
+    struct arena *arena;
+    char *first;
+    char *again;
+    size_t blocks;
+
+    arena = arena_create(&environ, &error, 64);
+    first = arena_strdup(&environ, &error, arena, "abc");
+
+    for (int i = 0; i < 20; ++i)
+    {
+        arena_strdup(&environ, &error, arena, "a string that takes up most of a block");
+    }
+
+    blocks = arena->blocks;
+    assert_that(blocks, is_greater_than(1));
+
+    // the same allocations after a reset reuse the blocks and start from the same place
+    arena_reset(arena);
+    assert_that(arena->allocations, is_equal_to(0));
+    assert_that(arena->bytes, is_equal_to(0));
+    again = arena_strdup(&environ, &error, arena, "def");
+    assert_that(again, is_equal_to(first));
+
+    for (int i = 0; i < 20; ++i)
+    {
+        arena_strdup(&environ, &error, arena, "a string that takes up most of a block");
+    }
+
+    assert_that(arena->blocks, is_equal_to(blocks));
+    assert_that(arena->allocations, is_equal_to(21));
+
+    arena_reset(NULL);
+    arena_destroy(&environ, &arena);
+}
+
+Ensure(arena, malloc)
+{
+    char *str;
+    char **words;
+
+    // without an arena the memory comes from malloc and must be freed
+    str   = arena_strdup(&environ, &error, NULL, "hello");
+    words = arena_calloc(&environ, &error, NULL, 2, sizeof(char *));
+    words = arena_realloc(&environ, &error, NULL, words, 2 * sizeof(char *), 4 * sizeof(char *));
+    words[0] = str;
+    assert_that(words[0], is_equal_to_string("hello"));
+    arena_free(NULL, str);
+    arena_free(NULL, words);
+}
+
+TestSuite *arena_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, arena, alloc);
+    add_test_with_context(suite, arena, reset);
+    add_test_with_context(suite, arena, malloc);
+
+    return suite;
+}
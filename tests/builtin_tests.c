@@ -1,12 +1,15 @@
 #include "tests.h"
 #include "util.h"
 #include "builtins.h"
+#include "shell_impl.h"
+#include "vars.h"
 #include <dc_util/filesystem.h>
 #include <dc_util/path.h>
 #include <dc_util/strings.h>
 #include <unistd.h>
 
 static void test_builtin_cd(const char *line, const char *cmd, size_t argc, char **argv, const char *expected_dir, const char *expected_message);
+static size_t count_exported(struct state *state, const char *entry);
 
 Describe(builtin);
 
@@ -71,6 +74,7 @@ static void test_builtin_cd(const char *line, const char *cmd, size_t argc, char
     char message[1024];
     FILE *stderr_file;
     char *working_dir;
+    char *cwd;
 
     memset(&command, 0, sizeof(struct command));
     command.line = strdup(line);
@@ -79,13 +83,16 @@ static void test_builtin_cd(const char *line, const char *cmd, size_t argc, char
     command.argv = argv;
     memset(message, 0, sizeof(message));
     stderr_file = fmemopen(message, sizeof(message), "w");
-    builtin_cd(&environ, &error, &command, stderr_file);
+    cwd = strdup("/before");
+    builtin_cd(&environ, &error, &command, &cwd, stderr_file);
 
     if(dc_error_has_no_error(&error))
     {
         // TODO: wny does this hang if chdir failed?
         working_dir = dc_get_working_dir(&environ, &error);
         assert_that(working_dir, is_equal_to_string(expected_dir));
+        // the cached directory the prompt shows is read again once it changed, and only then
+        assert_that(cwd, is_equal_to_string(expected_dir));
         assert_that(command.exit_code, is_equal_to(0));
         free(working_dir);
     }
@@ -93,19 +100,483 @@ static void test_builtin_cd(const char *line, const char *cmd, size_t argc, char
     {
         fflush(stderr_file);
         assert_that(message, is_equal_to_string(expected_message));
+        assert_that(cwd, is_equal_to_string("/before"));
         assert_that(command.exit_code, is_equal_to(1));
     }
 
     fclose(stderr_file);
+    free(cwd);
     destroy_command(&environ, &command);
 }
 
+Ensure(builtin, builtin_hash)
+{
+    struct command command;
+    struct path_cache *path_cache;
+    char **path;
+    char out[1024];
+    char message[1024];
+    FILE *out_file;
+    FILE *err_file;
+
+    path = dc_strs_to_array(&environ, &error, 3, "/bin", "/usr/bin", NULL);
+    path_cache = path_cache_create(&environ, &error, path);
+    path_cache_lookup(&environ, &error, path_cache, "ls");
+    path_cache_lookup(&environ, &error, path_cache, "ls");
+
+    memset(&command, 0, sizeof(struct command));
+    command.command = strdup("hash");
+    command.argc = 1;
+    command.argv = dc_strs_to_array(&environ, &error, 2, NULL, NULL);
+    memset(out, 0, sizeof(out));
+    out_file = fmemopen(out, sizeof(out), "w");
+    builtin_hash(&environ, &error, &command, path_cache, out_file, stderr);
+    fflush(out_file);
+    assert_that(out, is_equal_to_string("hits\tcommand\n   1\t/bin/ls\nhash: 1 hits, 1 misses\n"));
+    assert_that(command.exit_code, is_equal_to(0));
+    fclose(out_file);
+    destroy_command(&environ, &command);
+
+    memset(&command, 0, sizeof(struct command));
+    command.command = strdup("hash");
+    command.argc = 3;
+    command.argv = dc_strs_to_array(&environ, &error, 4, NULL, "-r", "asdasdasdfddfgsdfgasderdfdsf", NULL);
+    memset(message, 0, sizeof(message));
+    err_file = fmemopen(message, sizeof(message), "w");
+    builtin_hash(&environ, &error, &command, path_cache, stdout, err_file);
+    fflush(err_file);
+    assert_that(message, is_equal_to_string("hash: asdasdasdfddfgsdfgasderdfdsf: not found\n"));
+    assert_that(command.exit_code, is_equal_to(1));
+    assert_that(path_cache->count, is_equal_to(1));
+    fclose(err_file);
+    destroy_command(&environ, &command);
+
+    path_cache_destroy(&environ, &path_cache);
+    dc_strs_destroy_array(&environ, 3, path);
+    free(path);
+}
+
+Ensure(builtin, builtin_set)
+{
+    struct state state;
+    struct command command;
+    char out[1024];
+    char message[1024];
+    FILE *out_file;
+    FILE *err_file;
+
+    memset(out, 0, sizeof(out));
+    memset(message, 0, sizeof(message));
+    out_file = fmemopen(out, sizeof(out), "w");
+    err_file = fmemopen(message, sizeof(message), "w");
+    memset(&state, 0, sizeof(struct state));
+    state.stdout = out_file;
+
+    memset(&command, 0, sizeof(struct command));
+    command.argc = 3;
+    command.argv = dc_strs_to_array(&environ, &error, 4, NULL, "-o", "pipefail", NULL);
+    builtin_set(&environ, &error, &command, &state, err_file);
+    assert_true(state.pipefail);
+    assert_that(command.exit_code, is_equal_to(0));
+    destroy_command(&environ, &command);
+
+    command.argc = 2;
+    command.argv = dc_strs_to_array(&environ, &error, 3, NULL, "-o", NULL);
+    builtin_set(&environ, &error, &command, &state, err_file);
+    fflush(out_file);
+    assert_that(out, is_equal_to_string("allocs\toff\nerrexit\toff\npipefail\ton\nrusage\toff\n"));
+    destroy_command(&environ, &command);
+
+    command.argc = 2;
+    command.argv = dc_strs_to_array(&environ, &error, 3, NULL, "-e", NULL);
+    builtin_set(&environ, &error, &command, &state, err_file);
+    assert_true(state.errexit);
+    destroy_command(&environ, &command);
+
+    command.argc = 3;
+    command.argv = dc_strs_to_array(&environ, &error, 4, NULL, "+o", "errexit", NULL);
+    builtin_set(&environ, &error, &command, &state, err_file);
+    assert_false(state.errexit);
+    destroy_command(&environ, &command);
+
+    command.argc = 3;
+    command.argv = dc_strs_to_array(&environ, &error, 4, NULL, "+o", "pipefail", NULL);
+    builtin_set(&environ, &error, &command, &state, err_file);
+    assert_false(state.pipefail);
+    destroy_command(&environ, &command);
+
+    command.argc = 3;
+    command.argv = dc_strs_to_array(&environ, &error, 4, NULL, "-o", "nounset", NULL);
+    builtin_set(&environ, &error, &command, &state, err_file);
+    fflush(err_file);
+    assert_that(message, is_equal_to_string("set: nounset: invalid option name\n"));
+    assert_that(command.exit_code, is_equal_to(1));
+    destroy_command(&environ, &command);
+
+    fclose(out_file);
+    fclose(err_file);
+}
+
+Ensure(builtin, builtin_jobs)
+{
+    struct jobs *jobs;
+    struct command command;
+    char out[1024];
+    char message[1024];
+    FILE *out_file;
+    FILE *err_file;
+    pid_t pid;
+    int exit_code;
+
+    memset(out, 0, sizeof(out));
+    memset(message, 0, sizeof(message));
+    out_file = fmemopen(out, sizeof(out), "w");
+    err_file = fmemopen(message, sizeof(message), "w");
+    jobs = jobs_create(&environ, &error);
+
+    pid = fork();
+    if (pid == 0)
+    {
+        _exit(3);
+    }
+    exit_code = 0;
+    jobs_add(&environ, &error, jobs, "exit 3", &pid, &exit_code, 1, false);
+
+    memset(&command, 0, sizeof(struct command));
+    command.argc = 2;
+    command.argv = dc_strs_to_array(&environ, &error, 3, NULL, "%1", NULL);
+    builtin_wait(&environ, &error, &command, jobs, err_file);
+    assert_that(command.exit_code, is_equal_to(3));
+    assert_that(jobs->count, is_equal_to(0));
+    builtin_wait(&environ, &error, &command, jobs, err_file);
+    fflush(err_file);
+    assert_that(command.exit_code, is_equal_to(127));
+    assert_that(message, is_equal_to_string("wait: %1: no such job\n"));
+    destroy_command(&environ, &command);
+
+    pid = fork();
+    if (pid == 0)
+    {
+        _exit(0);
+    }
+    jobs_add(&environ, &error, jobs, "true", &pid, &exit_code, 1, false);
+
+    command.argc = 1;
+    command.argv = dc_strs_to_array(&environ, &error, 2, NULL, NULL);
+    builtin_wait(&environ, &error, &command, jobs, err_file);
+    assert_that(command.exit_code, is_equal_to(0));
+    assert_that(jobs->count, is_equal_to(0));
+    destroy_command(&environ, &command);
+
+    pid = fork();
+    if (pid == 0)
+    {
+        _exit(0);
+    }
+    jobs_add(&environ, &error, jobs, "true", &pid, &exit_code, 1, false);
+    jobs_wait(jobs, &jobs->job[0]);
+
+    command.argc = 1;
+    command.argv = dc_strs_to_array(&environ, &error, 2, NULL, NULL);
+    builtin_jobs(&environ, &error, &command, jobs, out_file);
+    fflush(out_file);
+    assert_that(out, is_equal_to_string("[1] Done\ttrue\n"));
+    assert_that(jobs->count, is_equal_to(0));
+    destroy_command(&environ, &command);
+
+    jobs_destroy(&environ, &jobs);
+    fclose(out_file);
+    fclose(err_file);
+}
+
+Ensure(builtin, find_builtin)
+{
+    static const char *names[] = {"bg", "cd", "echo", "export", "false", "fg", "hash", "jobs", "pwd", "set", "true",
+                                  "unset", "wait", NULL};
+    const struct builtin *builtin;
+
+    for (size_t i = 0; names[i]; ++i)
+    {
+        builtin = find_builtin(&environ, names[i]);
+        assert_that(builtin, is_not_null);
+        assert_that(builtin->name, is_equal_to_string(names[i]));
+    }
+
+    assert_that(find_builtin(&environ, "exit"), is_null);
+    assert_that(find_builtin(&environ, "ls"), is_null);
+    assert_that(find_builtin(&environ, "a"), is_null);
+    assert_that(find_builtin(&environ, "zzz"), is_null);
+    assert_that(find_builtin(&environ, ""), is_null);
+}
+
+Ensure(builtin, builtin_echo)
+{
+    struct command command;
+    char out[1024];
+    FILE *out_file;
+
+    memset(out, 0, sizeof(out));
+    out_file = fmemopen(out, sizeof(out), "w");
+    memset(&command, 0, sizeof(struct command));
+
+    command.argc = 3;
+    command.argv = dc_strs_to_array(&environ, &error, 4, NULL, "hello", "world", NULL);
+    builtin_echo(&environ, &error, &command, out_file);
+    destroy_command(&environ, &command);
+
+    command.argc = 1;
+    command.argv = dc_strs_to_array(&environ, &error, 2, NULL, NULL);
+    builtin_echo(&environ, &error, &command, out_file);
+    destroy_command(&environ, &command);
+
+    command.argc = 3;
+    command.argv = dc_strs_to_array(&environ, &error, 4, NULL, "-n", "x", NULL);
+    builtin_echo(&environ, &error, &command, out_file);
+    assert_that(command.exit_code, is_equal_to(0));
+    destroy_command(&environ, &command);
+
+    fflush(out_file);
+    assert_that(out, is_equal_to_string("hello world\n\nx"));
+    fclose(out_file);
+}
+
+Ensure(builtin, builtin_pwd)
+{
+    struct command command;
+    char out[1024];
+    char expected[1024];
+    char *cwd;
+    FILE *out_file;
+
+    memset(out, 0, sizeof(out));
+    out_file = fmemopen(out, sizeof(out), "w");
+    memset(&command, 0, sizeof(struct command));
+    command.argc = 1;
+    command.argv = dc_strs_to_array(&environ, &error, 2, NULL, NULL);
+    command.exit_code = 1;
+    builtin_pwd(&environ, &error, &command, out_file, stderr);
+    fflush(out_file);
+
+    cwd = dc_get_working_dir(&environ, &error);
+    sprintf(expected, "%s\n", cwd);
+    assert_that(out, is_equal_to_string(expected));
+    assert_that(command.exit_code, is_equal_to(0));
+    free(cwd);
+    destroy_command(&environ, &command);
+    fclose(out_file);
+}
+
+Ensure(builtin, builtin_parallel)
+{
+    struct command command;
+    struct path_cache *path_cache;
+    char **path;
+    char out[1024];
+    char message[1024];
+    FILE *out_file;
+    FILE *err_file;
+    size_t len;
+
+    path       = dc_strs_to_array(&environ, &error, 3, "/usr/bin", "/bin", NULL);
+    path_cache = path_cache_create(&environ, &error, path);
+    memset(message, 0, sizeof(message));
+    out_file = tmpfile();
+    err_file = fmemopen(message, sizeof(message), "w");
+
+    memset(&command, 0, sizeof(struct command));
+    command.argc = 9;
+    command.argv = dc_strs_to_array(&environ, &error, 10, NULL, "-j1", "--keep-order", "sh", "-c",
+                                    "echo {}; exit {}", ":::", "0", "1", NULL);
+    builtin_parallel(&environ, &error, &command, path_cache, NULL, out_file, err_file);
+    assert_that(command.exit_code, is_equal_to(1));
+    fflush(err_file);
+    assert_that(message, is_equal_to_string("parallel: 1 of 2 failed\nparallel: exit 1: sh -c echo 1; exit 1\n"));
+    rewind(out_file);
+    len = fread(out, 1, sizeof(out) - 1, out_file);
+    out[len] = '\0';
+    assert_that(out, is_equal_to_string("0\n1\n"));
+    destroy_command(&environ, &command);
+
+    memset(message, 0, sizeof(message));
+    rewind(err_file);
+    command.argc = 3;
+    command.argv = dc_strs_to_array(&environ, &error, 4, NULL, "-j", "x", NULL);
+    builtin_parallel(&environ, &error, &command, path_cache, NULL, out_file, err_file);
+    assert_that(command.exit_code, is_equal_to(2));
+    fflush(err_file);
+    assert_that(message, is_equal_to_string("parallel: x: invalid number of jobs\n"));
+    destroy_command(&environ, &command);
+
+    memset(message, 0, sizeof(message));
+    rewind(err_file);
+    command.argc = 3;
+    command.argv = dc_strs_to_array(&environ, &error, 4, NULL, ":::", "a", NULL);
+    builtin_parallel(&environ, &error, &command, path_cache, NULL, out_file, err_file);
+    assert_that(command.exit_code, is_equal_to(2));
+    fflush(err_file);
+    assert_that(message, contains_string("parallel: usage: "));
+    destroy_command(&environ, &command);
+
+    fclose(out_file);
+    fclose(err_file);
+    path_cache_destroy(&environ, &path_cache);
+    dc_strs_destroy_array(&environ, 3, path);
+    free(path);
+}
+
+Ensure(builtin, builtin_cat)
+{
+    struct command command;
+    char out[1024];
+    char message[1024];
+    char name[32];
+    FILE *out_file;
+    FILE *err_file;
+    FILE *file;
+    size_t len;
+    int fd;
+
+    strcpy(name, "/tmp/catXXXXXX");
+    fd = mkstemp(name);
+    write(fd, "abc\n", 4);
+    close(fd);
+
+    memset(message, 0, sizeof(message));
+    out_file = tmpfile();
+    err_file = fmemopen(message, sizeof(message), "w");
+    memset(&command, 0, sizeof(struct command));
+    command.argc = 4;
+    command.argv = dc_strs_to_array(&environ, &error, 5, NULL, name, "/does/not/exist", name, NULL);
+    fprintf(out_file, "before\n");
+    builtin_cat(&environ, &error, &command, NULL, out_file, err_file);
+    assert_that(command.exit_code, is_equal_to(1));
+    assert_false(dc_error_has_error(&error));
+    fflush(err_file);
+    assert_that(message, is_equal_to_string("cat: /does/not/exist: No such file or directory\n"));
+    rewind(out_file);
+    len = fread(out, 1, sizeof(out) - 1, out_file);
+    out[len] = '\0';
+    assert_that(out, is_equal_to_string("before\nabc\nabc\n"));
+    destroy_command(&environ, &command);
+    fclose(out_file);
+
+    // cat a >> a
+    memset(message, 0, sizeof(message));
+    rewind(err_file);
+    file = fopen(name, "a");
+    command.argc = 2;
+    command.argv = dc_strs_to_array(&environ, &error, 3, NULL, name, NULL);
+    builtin_cat(&environ, &error, &command, NULL, file, err_file);
+    assert_that(command.exit_code, is_equal_to(1));
+    fflush(err_file);
+    assert_that(message, contains_string(": input file is output file\n"));
+    destroy_command(&environ, &command);
+    fclose(file);
+
+    fclose(err_file);
+    unlink(name);
+}
+
+Ensure(builtin, builtin_export)
+{
+    struct state state;
+    struct command command;
+    char message[1024];
+    FILE *err_file;
+    char *path;
+
+    memset(message, 0, sizeof(message));
+    err_file = fmemopen(message, sizeof(message), "w");
+    state.stdin = stdin;
+    state.stdout = stdout;
+    state.stderr = stderr;
+    init_state(&environ, &error, &state);
+    path = strdup(getenv("PATH"));
+
+    memset(&command, 0, sizeof(struct command));
+    command.argc = 3;
+    command.argv = dc_strs_to_array(&environ, &error, 4, NULL, "DC_SHELL_TEST=a=b", "1X=2", NULL);
+    builtin_export(&environ, &error, &command, &state, err_file);
+    fflush(err_file);
+    assert_that(vars_get(state.vars, "DC_SHELL_TEST", 13), is_equal_to_string("a=b"));
+    // the shell's own environment is not changed, the programs it runs get the exported variables
+    assert_that(getenv("DC_SHELL_TEST"), is_null);
+    assert_that(count_exported(&state, "DC_SHELL_TEST=a=b"), is_equal_to(1));
+    assert_that(command.argv[1], is_equal_to_string("DC_SHELL_TEST=a=b"));
+    assert_that(message, is_equal_to_string("export: `1X=2': not a valid identifier\n"));
+    assert_that(command.exit_code, is_equal_to(1));
+    destroy_command(&environ, &command);
+
+    command.argc = 2;
+    command.argv = dc_strs_to_array(&environ, &error, 3, NULL, "PATH=/dc_shell_a:/dc_shell_b", NULL);
+    builtin_export(&environ, &error, &command, &state, err_file);
+    assert_that(command.exit_code, is_equal_to(0));
+    assert_that(state.path[0], is_equal_to_string("/dc_shell_a"));
+    assert_that(state.path[1], is_equal_to_string("/dc_shell_b"));
+    assert_that(state.path[2], is_null);
+    assert_that(path_cache_lookup(&environ, &error, state.path_cache, "ls"), is_null);
+    destroy_command(&environ, &command);
+
+    command.argc = 3;
+    command.argv = dc_strs_to_array(&environ, &error, 4, NULL, "DC_SHELL_TEST", "PATH", NULL);
+    builtin_unset(&environ, &error, &command, &state, err_file);
+    assert_that(command.exit_code, is_equal_to(0));
+    assert_that(vars_get(state.vars, "DC_SHELL_TEST", 13), is_null);
+    assert_that(vars_get(state.vars, "PATH", 4), is_null);
+    assert_that(count_exported(&state, "DC_SHELL_TEST=a=b"), is_equal_to(0));
+    assert_that(state.path[0], is_null);
+    destroy_command(&environ, &command);
+
+    // a shell variable is only passed on once it is exported
+    memset(&command, 0, sizeof(struct command));
+    command.assignment_count = 1;
+    command.assignments      = dc_strs_to_array(&environ, &error, 1, "LOCAL=1");
+    assign_variables(&environ, &error, &command, &state);
+    assert_that(vars_get(state.vars, "LOCAL", 5), is_equal_to_string("1"));
+    assert_that(count_exported(&state, "LOCAL=1"), is_equal_to(0));
+    destroy_command(&environ, &command);
+
+    command.argc = 2;
+    command.argv = dc_strs_to_array(&environ, &error, 3, NULL, "LOCAL", NULL);
+    builtin_export(&environ, &error, &command, &state, err_file);
+    assert_that(count_exported(&state, "LOCAL=1"), is_equal_to(1));
+    destroy_command(&environ, &command);
+
+    assert_that(getenv("PATH"), is_equal_to_string(path));
+    free(path);
+    destroy_state(&environ, &error, &state);
+    fclose(err_file);
+}
+
+static size_t count_exported(struct state *state, const char *entry)
+{
+    size_t count;
+
+    count = 0;
+
+    for (char **var = vars_envp(&environ, &error, state->vars); *var; ++var)
+    {
+        count += strcmp(*var, entry) == 0;
+    }
+
+    return count;
+}
+
 TestSuite *builtin_tests(void)
 {
     TestSuite *suite;
 
     suite = create_test_suite();
     add_test_with_context(suite, builtin, builtin_cd);
+    add_test_with_context(suite, builtin, builtin_hash);
+    add_test_with_context(suite, builtin, builtin_set);
+    add_test_with_context(suite, builtin, builtin_jobs);
+    add_test_with_context(suite, builtin, find_builtin);
+    add_test_with_context(suite, builtin, builtin_echo);
+    add_test_with_context(suite, builtin, builtin_pwd);
+    add_test_with_context(suite, builtin, builtin_cat);
+    add_test_with_context(suite, builtin, builtin_parallel);
+    add_test_with_context(suite, builtin, builtin_export);
 
     return suite;
 }
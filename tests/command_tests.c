@@ -1,8 +1,11 @@
 #include "tests.h"
+#include "input.h"
+#include "vars.h"
 #include "util.h"
 #include "shell_impl.h"
 #include <dc_util/path.h>
 #include <dc_util/strings.h>
+#include <unistd.h>
 
 static void test_parse_command(const char *expected_line,
                                const char *expected_command,
@@ -14,6 +17,20 @@ static void test_parse_command(const char *expected_line,
                                const char *expected_stderr_file,
                                bool expected_stderr_overwrite);
 static void expand_path(const char *expected_file, char **expanded_file);
+static void assert_redirection(const struct command *command, int fd, enum redirection_type type,
+                               const char *file);
+/*! \struct expected_redirection
+    \brief A redirection a line should parse to.
+*/
+struct expected_redirection
+{
+    enum redirection_type type;
+    int fd;
+    int source_fd;
+    const char *file;
+};
+
+static void test_redirections(const char *line, size_t count, const struct expected_redirection *expected);
 static void test_destroy_command(const char *expected_line);
 
 Describe(command);
@@ -179,18 +196,31 @@ Ensure(command, parse_command)
     dc_strs_destroy_array(&environ, 5, argv);
     free(argv);
 
-    /*
-    argv = dc_strs_to_array(&environ, &error, 5, NULL, "/User/ds/hello", "evil", "world", NULL);
-    test_parse_command("foo ~/hello ~/def/evil \"world rocks\"",
+    argv = dc_strs_to_array(&environ, &error, 5, NULL, "hello  evil", "world rocks", "a b", NULL);
+    test_parse_command("foo 'hello  evil' \"world rocks\" a\\ b > out.txt 2>>err.txt",
                        "foo",
                        4,
                        argv,
                        NULL,
-                       NULL,
+                       "out.txt",
+                       false,
+                       "err.txt",
+                       true);
+    dc_strs_destroy_array(&environ, 5, argv);
+    free(argv);
+
+    argv = dc_strs_to_array(&environ, &error, 3, NULL, "x", NULL);
+    test_parse_command("a>out.txt<in.txt x",
+                       "a",
+                       2,
+                       argv,
+                       "in.txt",
+                       "out.txt",
                        false,
                        NULL,
                        false);
-    */
+    dc_strs_destroy_array(&environ, 3, argv);
+    free(argv);
 }
 
 static void test_parse_command(const char *expected_line,
@@ -215,8 +245,9 @@ static void test_parse_command(const char *expected_line,
     state.stdout = NULL;
     state.stderr = NULL;
     init_state(&environ, &error, &state);
-    state.command = calloc(1, sizeof(struct command));
-    state.command->line = strdup(expected_line);
+    state.command = arena_calloc(&environ, &error, state.arena, 1, sizeof(struct command));
+    state.command->arena = state.arena;
+    state.command->line = arena_strdup(&environ, &error, state.arena, expected_line);
     parse_command(&environ, &error, &state, state.command);
     assert_that(state.command->line, is_equal_to_string(expected_line));
     assert_that(state.command->command, is_equal_to_string(expected_command));
@@ -230,11 +261,11 @@ static void test_parse_command(const char *expected_line,
         assert_that(state.command->argv[i], is_equal_to_string(expected_argv[i]));
     }
 
-    assert_that(state.command->stdin_file, is_equal_to_string(expanded_stdin_file));
-    assert_that(state.command->stdout_file, is_equal_to_string(expanded_stdout_file));
-    assert_that(state.command->stdout_overwrite, is_equal_to(expected_stdout_overwrite));
-    assert_that(state.command->stderr_file, is_equal_to_string(expanded_stderr_file));
-    assert_that(state.command->stderr_overwrite, is_equal_to(expected_stderr_overwrite));
+    assert_redirection(state.command, STDIN_FILENO, REDIRECTION_READ, expanded_stdin_file);
+    assert_redirection(state.command, STDOUT_FILENO,
+                       expected_stdout_overwrite ? REDIRECTION_APPEND : REDIRECTION_WRITE, expanded_stdout_file);
+    assert_redirection(state.command, STDERR_FILENO,
+                       expected_stderr_overwrite ? REDIRECTION_APPEND : REDIRECTION_WRITE, expanded_stderr_file);
     assert_that(state.command->exit_code, is_equal_to(0));
     free(expanded_stdin_file);
     free(expanded_stdout_file);
@@ -242,6 +273,32 @@ static void test_parse_command(const char *expected_line,
     destroy_state(&environ, &error, &state);
 }
 
+static void assert_redirection(const struct command *command, int fd, enum redirection_type type,
+                               const char *file)
+{
+    const struct redirection *found;
+
+    found = NULL;
+    for (size_t i = 0; i < command->redirection_count; ++i)
+    {
+        if (command->redirections[i].fd == fd)
+        {
+            found = &command->redirections[i];
+        }
+    }
+
+    if (file == NULL)
+    {
+        assert_that(found, is_null);
+    }
+    else
+    {
+        assert_that(found, is_not_null);
+        assert_that(found->type, is_equal_to(type));
+        assert_that(found->file, is_equal_to_string(file));
+    }
+}
+
 static void expand_path(const char *expected_file, char **expanded_file)
 {
     if(expected_file == NULL)
@@ -274,19 +331,370 @@ static void test_destroy_command(const char *expected_line)
     state.stdout = NULL;
     state.stderr = NULL;
     init_state(&environ, &error, &state);
-    state.command = calloc(1, sizeof(struct command));
-    state.command->line = strdup(expected_line);
+    state.command = arena_calloc(&environ, &error, state.arena, 1, sizeof(struct command));
+    state.command->arena = state.arena;
+    state.command->line = arena_strdup(&environ, &error, state.arena, expected_line);
     parse_command(&environ, &error, &state, state.command);
     destroy_command(&environ, state.command);
     assert_that(state.command->line, is_null);
     assert_that(state.command->command, is_null);
     assert_that(state.command->argv, is_null);
-    assert_that(state.command->stdin_file, is_null);
-    assert_that(state.command->stdout_file, is_null);
-    assert_that(state.command->stderr_file, is_null);
+    assert_that(state.command->redirections, is_null);
+    assert_that(state.command->redirection_count, is_equal_to(0));
     destroy_state(&environ, &error, &state);
 }
 
+Ensure(command, redirections)
+{
+    static const struct expected_redirection err_to_out[] = {
+        {REDIRECTION_WRITE, 1, -1, "log"},
+        {REDIRECTION_DUP,   2,  1, NULL},
+    };
+    static const struct expected_redirection out_err[] = {
+        {REDIRECTION_APPEND, 1, -1, "log"},
+        {REDIRECTION_DUP,    2,  1, NULL},
+    };
+    static const struct expected_redirection numbered[] = {
+        {REDIRECTION_READ,       3, -1, "in"},
+        {REDIRECTION_READ_WRITE, 0, -1, "both"},
+        {REDIRECTION_CLOSE,      4, -1, NULL},
+        {REDIRECTION_DUP,        0,  3, NULL},
+    };
+    static const struct expected_redirection dup_word[] = {
+        {REDIRECTION_WRITE, 1, -1, "log"},
+        {REDIRECTION_DUP,   2,  1, NULL},
+        {REDIRECTION_WRITE, 2, -1, "err"},
+    };
+
+    // applied in the order they are written, so 2>&1 > log is not the same as > log 2>&1
+    test_redirections("cmd > log 2>&1", 2, err_to_out);
+    test_redirections("cmd &>>log", 2, out_err);
+    test_redirections("cmd 3<in <> both 4>&- <&3", 4, numbered);
+    test_redirections("cmd >& log 2>err", 3, dup_word);
+}
+
+Ensure(command, bad_redirections)
+{
+    static const char *lines[][2] = {
+        {"cmd >&",       "newline"},
+        {"cmd 2>&1x",    ">&"},
+        {"cmd 3>&log",   ">&"},
+        {"cmd <&- <& x", "<&"},
+        {"cmd < &> x",   "&>"},
+    };
+    struct state state;
+    const char *syntax_error;
+
+    for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); ++i)
+    {
+        state.stdin  = NULL;
+        state.stdout = NULL;
+        state.stderr = NULL;
+        init_state(&environ, &error, &state);
+        state.command        = arena_calloc(&environ, &error, state.arena, 1, sizeof(struct command));
+        state.command->arena = state.arena;
+        state.command->line  = arena_strdup(&environ, &error, state.arena, lines[i][0]);
+        syntax_error         = parse_command(&environ, &error, &state, state.command);
+        assert_that(syntax_error, is_equal_to_string(lines[i][1]));
+        destroy_state(&environ, &error, &state);
+    }
+}
+
+Ensure(command, assignments)
+{
+    struct state state;
+
+    state.stdin  = NULL;
+    state.stdout = NULL;
+    state.stderr = NULL;
+    init_state(&environ, &error, &state);
+    vars_set(&environ, &error, state.vars, "X", 1, "x y", false);
+    vars_set(&environ, &error, state.vars, "HOME", 4, "/home/vars", false);
+    state.command        = arena_calloc(&environ, &error, state.arena, 2, sizeof(struct command));
+    state.command->arena = state.arena;
+    state.command->line  = arena_strdup(&environ, &error, state.arena, "FOO=~ BAR='a b'$X > out ls X=2");
+    assert_that(parse_command(&environ, &error, &state, state.command), is_null);
+    assert_that(state.command->assignment_count, is_equal_to(2));
+    assert_that(state.command->assignments[0], is_equal_to_string("FOO=/home/vars"));
+    assert_that(state.command->assignments[1], is_equal_to_string("BAR=a bx y"));
+    assert_that(state.command->command, is_equal_to_string("ls"));
+    // after the command it is an argument
+    assert_that(state.command->argc, is_equal_to(2));
+    assert_that(state.command->argv[1], is_equal_to_string("X=2"));
+    assert_that(state.command->redirection_count, is_equal_to(1));
+
+    // a quoted name is not an assignment
+    state.command[1].arena = state.arena;
+    state.command[1].line  = arena_strdup(&environ, &error, state.arena, "\"FOO\"=1 =2");
+    assert_that(parse_command(&environ, &error, &state, &state.command[1]), is_null);
+    assert_that(state.command[1].assignment_count, is_equal_to(0));
+    assert_that(state.command[1].command, is_equal_to_string("FOO=1"));
+    assert_that(state.command[1].argv[1], is_equal_to_string("=2"));
+
+    assert_false(dc_error_has_error(&error));
+    destroy_state(&environ, &error, &state);
+}
+
+Ensure(command, heredocs)
+{
+    struct command command;
+    FILE *stream;
+    struct input *reader;
+    size_t length;
+    char input[] = "hello $NAME\n\tEOF\nEOF\n$NAME\n\t\tindented\n\tEND\nnext line\n";
+    char line[]  = "cat <<EOF 3<<'END' <<< \"$NAME x\"";
+
+    setenv("NAME", "world", true);
+    memset(&command, 0, sizeof(struct command));
+    command.line = line;
+    assert_that(parse_command(&environ, &error, NULL, &command), is_null);
+    assert_that(command.redirection_count, is_equal_to(3));
+    assert_that(command.redirections[0].delimiter, is_equal_to_string("EOF"));
+    assert_false(command.redirections[0].literal);
+    assert_that(command.redirections[1].delimiter, is_equal_to_string("END"));
+    assert_that(command.redirections[1].fd, is_equal_to(3));
+    assert_true(command.redirections[1].literal);
+    assert_that(command.redirections[2].type, is_equal_to(REDIRECTION_HEREDOC));
+    assert_that(command.redirections[2].delimiter, is_null);
+    assert_that(command.redirections[2].file, is_equal_to_string("world x\n"));
+    assert_true(command.expanded);
+
+    // only <<- removes the tabs, so "\tEOF" is part of the first body
+    command.redirections[1].strip_tabs = true;
+    stream = fmemopen(input, strlen(input), "r");
+    reader = input_create(&environ, &error, stream);
+    assert_true(read_heredocs(&environ, &error, NULL, &command, reader, NULL, NULL));
+    assert_that(command.redirections[0].file, is_equal_to_string("hello world\n\tEOF\n"));
+    assert_that(command.redirections[0].delimiter, is_null);
+    assert_that(command.redirections[1].file, is_equal_to_string("$NAME\nindented\n"));
+
+    // the lines after the last delimiter are left for the shell
+    assert_that(input_read_line(&environ, &error, reader, &length), is_equal_to_string("next line"));
+    input_destroy(&environ, &reader);
+    fclose(stream);
+    command.line = NULL;
+    destroy_command(&environ, &command);
+
+    memset(&command, 0, sizeof(struct command));
+    command.line = line;
+    parse_command(&environ, &error, NULL, &command);
+    stream = fmemopen(input, 5, "r");
+    reader = input_create(&environ, &error, stream);
+    assert_false(read_heredocs(&environ, &error, NULL, &command, reader, NULL, NULL));
+    assert_that(command.redirections[0].file, is_equal_to_string("hello\n"));
+    assert_that(command.redirections[1].file, is_equal_to_string(""));
+    input_destroy(&environ, &reader);
+    fclose(stream);
+    command.line = NULL;
+    destroy_command(&environ, &command);
+    assert_false(dc_error_has_error(&error));
+}
+
+Ensure(command, lex_then_expand)
+{
+    struct command command;
+    FILE *stream;
+    struct input *reader;
+    char input[] = "body $NAME\nEOF\n";
+    char line[]  = "echo $NAME <<EOF";
+    char plain[] = "ls -l";
+    char dup[]   = "ls 2>&$NAME";
+
+    // the words and the body are expanded with the value NAME has when expand_command runs
+    setenv("NAME", "early", true);
+    memset(&command, 0, sizeof(struct command));
+    command.line = line;
+    assert_that(lex_command(&environ, &error, &command), is_null);
+    assert_that(command.tokens, is_not_null);
+    assert_that(command.command, is_null);
+    assert_that(command.redirection_count, is_equal_to(1));
+    assert_that(command.redirections[0].delimiter, is_equal_to_string("EOF"));
+    assert_true(command.expanded);
+    stream = fmemopen(input, strlen(input), "r");
+    reader = input_create(&environ, &error, stream);
+    assert_true(read_heredocs(&environ, &error, NULL, &command, reader, NULL, NULL));
+    input_destroy(&environ, &reader);
+    fclose(stream);
+    setenv("NAME", "later", true);
+    assert_that(expand_command(&environ, &error, NULL, &command), is_null);
+    assert_that(command.tokens, is_null);
+    assert_that(command.command, is_equal_to_string("echo"));
+    assert_that(command.argc, is_equal_to(2));
+    assert_that(command.argv[1], is_equal_to_string("later"));
+    assert_that(command.redirection_count, is_equal_to(1));
+    assert_that(command.redirections[0].file, is_equal_to_string("body later\n"));
+    command.line = NULL;
+    destroy_command(&environ, &command);
+
+    // a command with nothing to expand is filled in by lex_command
+    memset(&command, 0, sizeof(struct command));
+    command.line = plain;
+    assert_that(lex_command(&environ, &error, &command), is_null);
+    assert_that(command.tokens, is_null);
+    assert_that(command.command, is_equal_to_string("ls"));
+    assert_that(expand_command(&environ, &error, NULL, &command), is_null);
+    assert_that(command.argc, is_equal_to(2));
+    command.line = NULL;
+    destroy_command(&environ, &command);
+
+    // a descriptor that comes from a parameter can only be checked once it is expanded
+    memset(&command, 0, sizeof(struct command));
+    command.line = dup;
+    assert_that(lex_command(&environ, &error, &command), is_null);
+    assert_that(expand_command(&environ, &error, NULL, &command), is_equal_to_string(">&"));
+    command.line = NULL;
+    destroy_command(&environ, &command);
+    unsetenv("NAME");
+    assert_false(dc_error_has_error(&error));
+}
+
+static void test_redirections(const char *line, size_t count, const struct expected_redirection *expected)
+{
+    struct state state;
+
+    state.stdin  = NULL;
+    state.stdout = NULL;
+    state.stderr = NULL;
+    init_state(&environ, &error, &state);
+    state.command        = arena_calloc(&environ, &error, state.arena, 1, sizeof(struct command));
+    state.command->arena = state.arena;
+    state.command->line  = arena_strdup(&environ, &error, state.arena, line);
+    parse_command(&environ, &error, &state, state.command);
+    assert_that(state.command->exit_code, is_equal_to(0));
+    assert_that(state.command->command, is_equal_to_string("cmd"));
+    assert_that(state.command->redirection_count, is_equal_to(count));
+
+    for (size_t i = 0; i < count && i < state.command->redirection_count; ++i)
+    {
+        const struct redirection *redirection = &state.command->redirections[i];
+
+        assert_that(redirection->type, is_equal_to(expected[i].type));
+        assert_that(redirection->fd, is_equal_to(expected[i].fd));
+        assert_that(redirection->source_fd, is_equal_to(expected[i].source_fd));
+        if (expected[i].file == NULL)
+        {
+            assert_that(redirection->file, is_null);
+        }
+        else
+        {
+            assert_that(redirection->file, is_equal_to_string(expected[i].file));
+        }
+    }
+
+    destroy_state(&environ, &error, &state);
+}
+
+Ensure(command, separate_line)
+{
+    struct command *commands;
+    size_t count;
+    const char *syntax_error;
+
+    commands = separate_line(&environ, &error, NULL, "ls -al", &count, &syntax_error);
+    assert_that(count, is_equal_to(1));
+    assert_that(syntax_error, is_null);
+    assert_that(commands[0].line, is_equal_to_string("ls -al"));
+    assert_that(commands[0].connector, is_equal_to(CONNECTOR_NONE));
+    destroy_command(&environ, &commands[0]);
+    free(commands);
+
+    commands = separate_line(&environ, &error, NULL, "cat < in.txt | grep 'a|b' |wc -l > out.txt", &count, &syntax_error);
+    assert_that(count, is_equal_to(3));
+    assert_that(syntax_error, is_null);
+    assert_that(commands[0].line, is_equal_to_string("cat < in.txt"));
+    assert_that(commands[0].connector, is_equal_to(CONNECTOR_PIPE));
+    assert_that(commands[1].line, is_equal_to_string("grep 'a|b'"));
+    assert_that(commands[1].connector, is_equal_to(CONNECTOR_PIPE));
+    assert_that(commands[2].line, is_equal_to_string("wc -l > out.txt"));
+    assert_that(commands[2].connector, is_equal_to(CONNECTOR_NONE));
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        destroy_command(&environ, &commands[i]);
+    }
+    free(commands);
+
+    commands = separate_line(&environ, &error, NULL, "echo \"\\\"|\" \\| x", &count, &syntax_error);
+    assert_that(count, is_equal_to(1));
+    destroy_command(&environ, &commands[0]);
+    free(commands);
+
+    // separators on either side of a scanned block, and a quote left open
+    commands = separate_line(&environ, &error, NULL,
+                             "echo 'abcdefghijklmnopqrstuvwxyz0123456789|;&' \"abcdefghijklmnopqrstuvwxyz\\\"|\"|wc 'x|",
+                             &count, &syntax_error);
+    assert_that(count, is_equal_to(2));
+    assert_that(commands[0].line, is_equal_to_string(
+        "echo 'abcdefghijklmnopqrstuvwxyz0123456789|;&' \"abcdefghijklmnopqrstuvwxyz\\\"|\""));
+    assert_that(commands[1].line, is_equal_to_string("wc 'x|"));
+    destroy_command(&environ, &commands[0]);
+    destroy_command(&environ, &commands[1]);
+    free(commands);
+
+    commands = separate_line(&environ, &error, NULL, "| wc", &count, &syntax_error);
+    assert_that(commands, is_null);
+    assert_that(count, is_equal_to(0));
+    assert_that(syntax_error, is_equal_to_string("|"));
+
+    commands = separate_line(&environ, &error, NULL, "ls | | wc", &count, &syntax_error);
+    assert_that(commands, is_null);
+    assert_that(syntax_error, is_equal_to_string("|"));
+
+    commands = separate_line(&environ, &error, NULL, "ls |  ", &count, &syntax_error);
+    assert_that(commands, is_null);
+    assert_that(syntax_error, is_equal_to_string("newline"));
+
+    commands = separate_line(&environ, &error, NULL, "sleep 1 | cat & ls 2>&1 &", &count, &syntax_error);
+    assert_that(count, is_equal_to(3));
+    assert_that(syntax_error, is_null);
+    assert_that(commands[0].connector, is_equal_to(CONNECTOR_PIPE));
+    assert_that(commands[1].line, is_equal_to_string("cat"));
+    assert_that(commands[1].connector, is_equal_to(CONNECTOR_BACKGROUND));
+    assert_that(commands[2].line, is_equal_to_string("ls 2>&1"));
+    assert_that(commands[2].connector, is_equal_to(CONNECTOR_BACKGROUND));
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        destroy_command(&environ, &commands[i]);
+    }
+    free(commands);
+
+    commands = separate_line(&environ, &error, NULL, "& ls", &count, &syntax_error);
+    assert_that(commands, is_null);
+    assert_that(syntax_error, is_equal_to_string("&"));
+
+    commands = separate_line(&environ, &error, NULL, "make && ./a.out 'x;y' || echo fail; ls &> out.txt;", &count, &syntax_error);
+    assert_that(count, is_equal_to(4));
+    assert_that(syntax_error, is_null);
+    assert_that(commands[0].line, is_equal_to_string("make"));
+    assert_that(commands[0].connector, is_equal_to(CONNECTOR_AND));
+    assert_that(commands[1].line, is_equal_to_string("./a.out 'x;y'"));
+    assert_that(commands[1].connector, is_equal_to(CONNECTOR_OR));
+    assert_that(commands[2].line, is_equal_to_string("echo fail"));
+    assert_that(commands[2].connector, is_equal_to(CONNECTOR_SEQUENCE));
+    assert_that(commands[3].line, is_equal_to_string("ls &> out.txt"));
+    assert_that(commands[3].connector, is_equal_to(CONNECTOR_SEQUENCE));
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        destroy_command(&environ, &commands[i]);
+    }
+    free(commands);
+
+    commands = separate_line(&environ, &error, NULL, "ls ;; wc", &count, &syntax_error);
+    assert_that(commands, is_null);
+    assert_that(syntax_error, is_equal_to_string(";"));
+
+    commands = separate_line(&environ, &error, NULL, "|| wc", &count, &syntax_error);
+    assert_that(commands, is_null);
+    assert_that(syntax_error, is_equal_to_string("||"));
+
+    commands = separate_line(&environ, &error, NULL, "ls &&", &count, &syntax_error);
+    assert_that(commands, is_null);
+    assert_that(syntax_error, is_equal_to_string("newline"));
+    assert_false(dc_error_has_error(&error));
+}
+
 TestSuite *command_tests(void)
 {
     TestSuite *suite;
@@ -294,6 +702,12 @@ TestSuite *command_tests(void)
     suite = create_test_suite();
     add_test_with_context(suite, command, parse_command);
     add_test_with_context(suite, command, destroy_command);
+    add_test_with_context(suite, command, redirections);
+    add_test_with_context(suite, command, bad_redirections);
+    add_test_with_context(suite, command, assignments);
+    add_test_with_context(suite, command, heredocs);
+    add_test_with_context(suite, command, lex_then_expand);
+    add_test_with_context(suite, command, separate_line);
 
     return suite;
 }
@@ -0,0 +1,152 @@
+#include "tests.h"
+#include "completion.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void make_file(const char *name, mode_t mode);
+static void remove_all(void);
+
+Describe(completion);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+static char dir[] = "/tmp/dc_shell_completion_XXXXXX";
+static char file_path[sizeof(dir) + 64];
+
+BeforeEach(completion)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+    strcpy(dir, "/tmp/dc_shell_completion_XXXXXX");
+    mkdtemp(dir);
+}
+
+AfterEach(completion)
+{
+    remove_all();
+    dc_error_reset(&error);
+}
+
+Ensure(completion, commands)
+{
+    struct completion *completion;
+    const char *const *matches;
+    char missing[] = "/nonexistent";
+    char *path[2];
+
+    make_file("dc_prog_a", 0755);
+    make_file("dc_prog_b", 0755);
+    make_file("dc_data", 0644);
+    snprintf(file_path, sizeof(file_path), "%s/dc_prog_dir", dir);
+    mkdir(file_path, 0755);
+
+    path[0]    = dir;
+    path[1]    = NULL;
+    completion = completion_create(&environ, &error, path);
+    assert_that(completion, is_not_null);
+
+    // only the executable files, not the other files or the directories
+    assert_that(completion_commands(&environ, &error, completion, "dc_", 3, &matches), is_equal_to(2));
+    assert_that(matches[0], is_equal_to_string("dc_prog_a"));
+    assert_that(matches[1], is_equal_to_string("dc_prog_b"));
+    assert_that(completion_commands(&environ, &error, completion, "dc_x", 4, &matches), is_equal_to(0));
+
+    // the builtins (and exit) are commands too
+    assert_that(completion_commands(&environ, &error, completion, "ec", 2, &matches), is_equal_to(1));
+    assert_that(matches[0], is_equal_to_string("echo"));
+    assert_that(completion_commands(&environ, &error, completion, "exi", 3, &matches), is_equal_to(1));
+    assert_that(matches[0], is_equal_to_string("exit"));
+
+    // a program added, made executable or removed is seen by the next completion
+    make_file("dc_prog_c", 0755);
+    snprintf(file_path, sizeof(file_path), "%s/dc_data", dir);
+    chmod(file_path, 0755);
+    snprintf(file_path, sizeof(file_path), "%s/dc_prog_a", dir);
+    unlink(file_path);
+    assert_that(completion_commands(&environ, &error, completion, "dc_", 3, &matches), is_equal_to(3));
+    assert_that(matches[0], is_equal_to_string("dc_data"));
+    assert_that(matches[1], is_equal_to_string("dc_prog_b"));
+    assert_that(matches[2], is_equal_to_string("dc_prog_c"));
+
+    // a new PATH replaces the directories
+    path[0] = missing;
+    completion_set_path(&environ, &error, completion, path);
+    assert_that(completion_commands(&environ, &error, completion, "dc_", 3, &matches), is_equal_to(0));
+    completion_set_path(&environ, &error, completion, NULL);
+    assert_that(completion_commands(&environ, &error, completion, "cd", 2, &matches), is_equal_to(1));
+
+    completion_destroy(&environ, &completion);
+    assert_that(completion, is_null);
+    assert_false(dc_error_has_error(&error));
+}
+
+Ensure(completion, files)
+{
+    struct completion *completion;
+    const char *const *matches;
+
+    make_file("alpha.txt", 0644);
+    make_file(".alpha", 0644);
+    snprintf(file_path, sizeof(file_path), "%s/alpine", dir);
+    mkdir(file_path, 0755);
+    completion = completion_create(&environ, &error, NULL);
+
+    // a directory has a / after it, a hidden name is only found once the dot is typed
+    assert_that(completion_files(&environ, &error, completion, dir, "al", 2, &matches), is_equal_to(2));
+    assert_that(matches[0], is_equal_to_string("alpha.txt"));
+    assert_that(matches[1], is_equal_to_string("alpine/"));
+    assert_that(completion_files(&environ, &error, completion, dir, "", 0, &matches), is_equal_to(2));
+    assert_that(completion_files(&environ, &error, completion, dir, ".", 1, &matches), is_equal_to(1));
+    assert_that(matches[0], is_equal_to_string(".alpha"));
+
+    make_file("also", 0644);
+    assert_that(completion_files(&environ, &error, completion, dir, "al", 2, &matches), is_equal_to(3));
+
+    // another directory, then one that is not there
+    snprintf(file_path, sizeof(file_path), "%s/alpine", dir);
+    assert_that(completion_files(&environ, &error, completion, file_path, "", 0, &matches), is_equal_to(0));
+    assert_that(completion_files(&environ, &error, completion, "/nonexistent", "", 0, &matches), is_equal_to(0));
+    assert_that(completion_files(&environ, &error, completion, dir, "alpi", 4, &matches), is_equal_to(1));
+
+    completion_destroy(&environ, &completion);
+    assert_false(dc_error_has_error(&error));
+}
+
+static void make_file(const char *name, mode_t mode)
+{
+    snprintf(file_path, sizeof(file_path), "%s/%s", dir, name);
+    close(open(file_path, O_WRONLY | O_CREAT | O_TRUNC, mode));
+    chmod(file_path, mode);
+}
+
+static void remove_all(void)
+{
+    static const char *names[] = {"dc_prog_a", "dc_prog_b", "dc_prog_c", "dc_data", "alpha.txt", ".alpha", "also"};
+
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+    {
+        snprintf(file_path, sizeof(file_path), "%s/%s", dir, names[i]);
+        unlink(file_path);
+    }
+
+    snprintf(file_path, sizeof(file_path), "%s/dc_prog_dir", dir);
+    rmdir(file_path);
+    snprintf(file_path, sizeof(file_path), "%s/alpine", dir);
+    rmdir(file_path);
+    rmdir(dir);
+}
+
+TestSuite *completion_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, completion, commands);
+    add_test_with_context(suite, completion, files);
+
+    return suite;
+}
@@ -0,0 +1,157 @@
+#include "tests.h"
+#include "copy.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void make_file(char *template, const char *data, size_t length);
+static void check_file(const char *name, const char *data, size_t length);
+
+Describe(copy);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+
+BeforeEach(copy)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+}
+
+AfterEach(copy)
+{
+    dc_error_reset(&error);
+}
+
+Ensure(copy, copy_fd)
+{
+    char in_name[32];
+    char out_name[32];
+    char *data;
+    size_t length;
+
+    // bigger than one read/write buffer
+    length = 300 * 1024 + 7;
+    data   = malloc(length);
+    for (size_t i = 0; i < length; ++i)
+    {
+        data[i] = (char)('a' + i % 26);
+    }
+    make_file(in_name, data, length);
+
+    for (enum copy_method method = COPY_FILE_RANGE; method <= COPY_READ_WRITE; ++method)
+    {
+        enum copy_method used;
+        int in_fd;
+        int out_fd;
+
+        make_file(out_name, "", 0);
+        in_fd  = open(in_name, O_RDONLY);
+        out_fd = open(out_name, O_WRONLY | O_TRUNC);
+        assert_that(copy_fd(&environ, &error, in_fd, out_fd, method, &used, NULL), is_equal_to(length));
+        assert_false(dc_error_has_error(&error));
+        assert_true(used >= method);
+        close(in_fd);
+        close(out_fd);
+        check_file(out_name, data, length);
+        unlink(out_name);
+    }
+
+    unlink(in_name);
+    free(data);
+}
+
+Ensure(copy, append)
+{
+    char in_name[32];
+    char out_name[32];
+    int in_fd;
+    int out_fd;
+
+    make_file(in_name, "world\n", 6);
+    make_file(out_name, "hello ", 6);
+    in_fd  = open(in_name, O_RDONLY);
+    out_fd = open(out_name, O_WRONLY | O_APPEND);
+    assert_that(copy_fd(&environ, &error, in_fd, out_fd, COPY_FILE_RANGE, NULL, NULL), is_equal_to(6));
+    assert_false(dc_error_has_error(&error));
+    close(in_fd);
+    close(out_fd);
+    check_file(out_name, "hello world\n", 12);
+    unlink(in_name);
+    unlink(out_name);
+}
+
+Ensure(copy, pipe)
+{
+    char out_name[32];
+    enum copy_method used;
+    volatile sig_atomic_t interrupted;
+    int fds[2];
+    int out_fd;
+
+    make_file(out_name, "", 0);
+    pipe(fds);
+    write(fds[1], "abc", 3);
+    close(fds[1]);
+    out_fd = open(out_name, O_WRONLY);
+    assert_that(copy_fd(&environ, &error, fds[0], out_fd, COPY_FILE_RANGE, &used, NULL), is_equal_to(3));
+    assert_false(dc_error_has_error(&error));
+    assert_that(used, is_equal_to(COPY_SPLICE));
+    close(fds[0]);
+    close(out_fd);
+    check_file(out_name, "abc", 3);
+    unlink(out_name);
+
+    // once interrupted (eg. ^C) nothing more is copied, from the kernel or through the buffer
+    interrupted = 1;
+    pipe(fds);
+    write(fds[1], "abc", 3);
+    out_fd = open("/dev/null", O_WRONLY);
+    assert_that(copy_fd(&environ, &error, fds[0], out_fd, COPY_FILE_RANGE, NULL, &interrupted), is_equal_to(0));
+    assert_that(copy_fd(&environ, &error, fds[0], out_fd, COPY_READ_WRITE, NULL, &interrupted), is_equal_to(0));
+    assert_false(dc_error_has_error(&error));
+    close(fds[0]);
+    close(fds[1]);
+
+    // a directory cannot be read
+    fds[0] = open("/", O_RDONLY);
+    copy_fd(&environ, &error, fds[0], out_fd, COPY_FILE_RANGE, NULL, NULL);
+    assert_true(dc_error_has_error(&error));
+    close(fds[0]);
+    close(out_fd);
+}
+
+static void make_file(char *template, const char *data, size_t length)
+{
+    int fd;
+
+    strcpy(template, "/tmp/copyXXXXXX");
+    fd = mkstemp(template);
+    assert_that(write(fd, data, length), is_equal_to(length));
+    close(fd);
+}
+
+static void check_file(const char *name, const char *data, size_t length)
+{
+    char *buf;
+    FILE *file;
+
+    buf  = calloc(1, length + 1);
+    file = fopen(name, "r");
+    assert_that(fread(buf, 1, length + 1, file), is_equal_to(length));
+    assert_that(memcmp(buf, data, length), is_equal_to(0));
+    fclose(file);
+    free(buf);
+}
+
+TestSuite *copy_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, copy, copy_fd);
+    add_test_with_context(suite, copy, append);
+    add_test_with_context(suite, copy, pipe);
+
+    return suite;
+}
@@ -0,0 +1,252 @@
+#include "tests.h"
+#include "command.h"
+#include "completion.h"
+#include "editor.h"
+#include "history.h"
+#include "history_index.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+static void open_terminal(void);
+static const char *type_line(const char *keys, size_t *length);
+
+Describe(editor);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+static struct editor *editor;
+static int master;
+static int slave;
+
+BeforeEach(editor)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+    open_terminal();
+}
+
+AfterEach(editor)
+{
+    editor_destroy(&environ, &editor);
+    close(slave);
+    close(master);
+    dc_error_reset(&error);
+}
+
+Ensure(editor, edit)
+{
+    size_t length;
+
+    editor = editor_create(&environ, &error, slave, slave, NULL, NULL, NULL);
+    assert_that(editor, is_not_null);
+
+    assert_that(type_line("ls -l\r", &length), is_equal_to_string("ls -l"));
+    assert_that(length, is_equal_to(5));
+    // Left three times, then a character goes in before the cursor
+    assert_that(type_line("echo wrld\x1b[D\x1b[D\x1b[Do\r", &length), is_equal_to_string("echo world"));
+    assert_that(type_line("ab\x7f\r", &length), is_equal_to_string("a"));
+    assert_that(type_line("ab\x01\x1b[3~\r", &length), is_equal_to_string("b"));
+    assert_that(type_line("bc\x1b[Ha\x1b[Fd\r", &length), is_equal_to_string("abcd"));
+    assert_that(type_line("abc def\x17xyz\r", &length), is_equal_to_string("abc xyz"));
+    assert_that(type_line("junk\x15ls\r", &length), is_equal_to_string("ls"));
+    assert_that(type_line("ls junk\x02\x02\x02\x02\x0b\r", &length), is_equal_to_string("ls "));
+
+    // Ctrl-C gives up the line, Ctrl-D only ends the input when the line is empty
+    assert_that(type_line("rm -rf\x03", &length), is_equal_to_string(""));
+    assert_that(length, is_equal_to(0));
+    assert_that(type_line("ab\x01\x04\r", &length), is_equal_to_string("b"));
+    assert_that(type_line("\x04", &length), is_null);
+    assert_false(dc_error_has_error(&error));
+}
+
+Ensure(editor, history)
+{
+    struct history *history;
+    char path[] = "/tmp/dc_shell_editor_XXXXXX";
+    size_t length;
+
+    close(mkstemp(path));
+    history = history_open(&environ, &error, path, 4096);
+    history_add(history, "first", 5);
+    history_add(history, "second", 6);
+    editor = editor_create(&environ, &error, slave, slave, history, NULL, NULL);
+
+    assert_that(type_line("\x1b[A\r", &length), is_equal_to_string("second"));
+    assert_that(type_line("\x1b[A\x1b[A\r", &length), is_equal_to_string("first"));
+    // Up stops at the oldest entry
+    assert_that(type_line("\x1b[A\x1b[A\x1b[A\r", &length), is_equal_to_string("first"));
+    assert_that(type_line("\x1b[A\x1b[A\x1b[B\r", &length), is_equal_to_string("second"));
+    // Down past the newest entry gives back what was being typed
+    assert_that(type_line("typed\x1b[A\x1b[B\r", &length), is_equal_to_string("typed"));
+    assert_that(type_line("\x10\x10\x0e\r", &length), is_equal_to_string("second"));
+    // an entry can be edited like any line
+    assert_that(type_line("\x1b[A -n\r", &length), is_equal_to_string("second -n"));
+
+    history_close(&environ, &history);
+    unlink(path);
+    assert_false(dc_error_has_error(&error));
+}
+
+Ensure(editor, search)
+{
+    struct history *history;
+    struct history_index *index;
+    char path[] = "/tmp/dc_shell_editor_XXXXXX";
+    size_t length;
+
+    close(mkstemp(path));
+    history = history_open(&environ, &error, path, 4096);
+    index   = history_index_open(&environ, &error, NULL);
+    history_add(history, "git status", 10);
+    history_add(history, "make", 4);
+    history_add(history, "git log", 7);
+    editor = editor_create(&environ, &error, slave, slave, history, index, NULL);
+
+    // Ctrl-R, the query, then Enter runs the match, Ctrl-R again goes to the next one
+    assert_that(type_line("\x12git\r", &length), is_equal_to_string("git log"));
+    assert_that(type_line("\x12git\x12\r", &length), is_equal_to_string("git status"));
+    assert_that(type_line("\x12gitx\x7f\x12\r", &length), is_equal_to_string("git status"));
+    // a query that matches nothing keeps the last match
+    assert_that(type_line("\x12makez\r", &length), is_equal_to_string("make"));
+    // another key takes the match to edit it, Ctrl-G gives up the search
+    assert_that(type_line("\x12stat\x05 -s\r", &length), is_equal_to_string("git status -s"));
+    assert_that(type_line("typed\x12make\x07\r", &length), is_equal_to_string("typed"));
+
+    // the entries added since the index was updated are found too
+    history_add(history, "git push", 8);
+    assert_that(type_line("\x12git\r", &length), is_equal_to_string("git push"));
+
+    history_index_close(&environ, &index);
+    history_close(&environ, &history);
+    unlink(path);
+    assert_false(dc_error_has_error(&error));
+}
+
+Ensure(editor, complete)
+{
+    struct completion *completion;
+    char dir[] = "/tmp/dc_shell_editor_XXXXXX";
+    char keys[128];
+    char expected[128];
+    char file[64];
+    size_t length;
+
+    mkdtemp(dir);
+    snprintf(file, sizeof(file), "%s/alpha.txt", dir);
+    close(open(file, O_WRONLY | O_CREAT, 0644));
+    snprintf(file, sizeof(file), "%s/alpine", dir);
+    mkdir(file, 0755);
+    completion = completion_create(&environ, &error, NULL);
+    editor     = editor_create(&environ, &error, slave, slave, NULL, NULL, completion);
+
+    // a command, a single match gets a space after it
+    assert_that(type_line("ec\t\r", &length), is_equal_to_string("echo "));
+    assert_that(type_line("ls | ec\t\r", &length), is_equal_to_string("ls | echo "));
+
+    // a file name goes as far as every match agrees, a directory gets a / instead of a space
+    snprintf(keys, sizeof(keys), "cat %s/al\t\r", dir);
+    snprintf(expected, sizeof(expected), "cat %s/alp", dir);
+    assert_that(type_line(keys, &length), is_equal_to_string(expected));
+    snprintf(keys, sizeof(keys), "cat %s/alpi\t\r", dir);
+    snprintf(expected, sizeof(expected), "cat %s/alpine/", dir);
+    assert_that(type_line(keys, &length), is_equal_to_string(expected));
+
+    // nothing more to add lists the matches, nothing found leaves the line alone
+    snprintf(keys, sizeof(keys), "cat %s/alp\t\r", dir);
+    snprintf(expected, sizeof(expected), "cat %s/alp", dir);
+    assert_that(type_line(keys, &length), is_equal_to_string(expected));
+    assert_that(type_line("cat nothing_like_this\t\r", &length), is_equal_to_string("cat nothing_like_this"));
+
+    completion_destroy(&environ, &completion);
+    rmdir(file);
+    snprintf(file, sizeof(file), "%s/alpha.txt", dir);
+    unlink(file);
+    rmdir(dir);
+    assert_false(dc_error_has_error(&error));
+}
+
+Ensure(editor, heredoc)
+{
+    const char *keys = "cat <<EOF\rbody\rEOF\recho done\r";
+    struct command command;
+    char line[] = "cat <<EOF";
+    size_t length;
+
+    // pasted at once, the editor reads the body and the line after it along with the command
+    editor = editor_create(&environ, &error, slave, slave, NULL, NULL, NULL);
+    assert_that(write(master, keys, strlen(keys)), is_equal_to(strlen(keys)));
+    assert_that(editor_read_line(&environ, &error, editor, "$ ", &length), is_equal_to_string("cat <<EOF"));
+    memset(&command, 0, sizeof(struct command));
+    command.line = line;
+    assert_that(parse_command(&environ, &error, NULL, &command), is_null);
+    assert_true(read_heredocs(&environ, &error, NULL, &command, NULL, editor, NULL));
+    assert_that(command.redirections[0].file, is_equal_to_string("body\n"));
+    assert_that(type_line("", &length), is_equal_to_string("echo done"));
+    command.line = NULL;
+    destroy_command(&environ, &command);
+    assert_false(dc_error_has_error(&error));
+}
+
+Ensure(editor, not_a_terminal)
+{
+    int fds[2];
+
+    assert_that(pipe(fds), is_equal_to(0));
+    assert_that(editor_create(&environ, &error, fds[0], fds[1], NULL, NULL, NULL), is_null);
+    assert_false(dc_error_has_error(&error));
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static void open_terminal(void)
+{
+    struct termios settings;
+
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    grantpt(master);
+    unlockpt(master);
+    slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+
+    // the keys are typed before the editor reads them, so the terminal must not act on them (eg. Ctrl-U) itself
+    tcgetattr(slave, &settings);
+    settings.c_iflag &= (tcflag_t)~(ICRNL | IXON);
+    settings.c_lflag &= (tcflag_t)~(ECHO | ICANON | IEXTEN | ISIG);
+    tcsetattr(slave, TCSANOW, &settings);
+    fcntl(master, F_SETFL, O_NONBLOCK);
+}
+
+static const char *type_line(const char *keys, size_t *length)
+{
+    char screen[4096];
+    const char *line;
+
+    assert_that(write(master, keys, strlen(keys)), is_equal_to(strlen(keys)));
+    line = editor_read_line(&environ, &error, editor, "$ ", length);
+
+    // what the editor drew is not checked, it only has to be read so the terminal does not fill up
+    while (read(master, screen, sizeof(screen)) > 0)
+    {
+    }
+
+    return line;
+}
+
+TestSuite *editor_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, editor, edit);
+    add_test_with_context(suite, editor, history);
+    add_test_with_context(suite, editor, search);
+    add_test_with_context(suite, editor, complete);
+    add_test_with_context(suite, editor, heredoc);
+    add_test_with_context(suite, editor, not_a_terminal);
+
+    return suite;
+}
@@ -1,11 +1,15 @@
 #include "tests.h"
 #include "execute.h"
+#include "shell_impl.h"
 #include <dc_util/strings.h>
+#include <limits.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+static void test_execute_pipeline(const char *line, bool pipefail, int expected_exit_code, const char *expected_output);
 static void test_execute(const char *cmd, size_t argc, char **argv, char **path, bool check_exit_code, int expected_exit_code, const char *out_file_name, const char *err_file_name);
 static void check_redirection(const char *file_name);
+static void test_execute_redirections(const char *format, int expected_exit_code, const char *expected_output);
 
 Describe(execute);
 
@@ -64,7 +68,9 @@ Ensure(execute, execute)
 static void test_execute(const char *cmd, size_t argc, char **argv, char **path, bool check_exit_code, int expected_exit_code, const char *out_file_name, const char *err_file_name)
 {
     struct command command;
+    struct path_cache *path_cache;
 
+    path_cache = path_cache_create(&environ, &error, path);
     memset(&command, 0, sizeof(struct command));
     command.command = strdup(cmd);
     command.argc = argc;
@@ -72,15 +78,15 @@ static void test_execute(const char *cmd, size_t argc, char **argv, char **path,
 
     if(out_file_name)
     {
-        command.stdout_file = strdup(out_file_name);
+        append_redirection(&environ, &error, &command, REDIRECTION_WRITE, STDOUT_FILENO, -1, out_file_name);
     }
 
     if(err_file_name)
     {
-        command.stderr_file = strdup(err_file_name);
+        append_redirection(&environ, &error, &command, REDIRECTION_WRITE, STDERR_FILENO, -1, err_file_name);
     }
 
-    execute(&environ, &error, &command, path);
+    execute(&environ, &error, &command, path_cache);
 
     if(check_exit_code)
     {
@@ -91,6 +97,7 @@ static void test_execute(const char *cmd, size_t argc, char **argv, char **path,
     check_redirection(err_file_name);
 
     destroy_command(&environ, &command);
+    path_cache_destroy(&environ, &path_cache);
     dc_error_reset(&error);
 }
 
@@ -108,12 +115,232 @@ static void check_redirection(const char *file_name)
     }
 }
 
+Ensure(execute, execute_pipeline)
+{
+    test_execute_pipeline("printf abc | tr a-z A-Z", false, 0, "ABC");
+    test_execute_pipeline("printf 'one\\ntwo\\nthree\\n' | sort -r | head -n 1", false, 0, "two\n");
+    test_execute_pipeline("false | true", false, 0, "");
+    test_execute_pipeline("false | true", true, 1, "");
+    test_execute_pipeline("true | false", false, 1, "");
+    test_execute_pipeline("asdasdasdfddfgsdfgasderdfdsf | true", true, 127, "");
+    test_execute_pipeline("asdasdasdfddfgsdfgasderdfdsf | printf x", false, 0, "x");
+}
+
+static void test_execute_pipeline(const char *line, bool pipefail, int expected_exit_code, const char *expected_output)
+{
+    struct state state;
+    struct command *commands;
+    size_t count;
+    const char *syntax_error;
+    char template[16];
+    char buf[1024];
+    FILE *file;
+    size_t len;
+    int exit_code;
+
+    state.stdin = NULL;
+    state.stdout = NULL;
+    state.stderr = NULL;
+    init_state(&environ, &error, &state);
+    strcpy(template, "/tmp/fileXXXXXX");
+    close(mkstemp(template));
+
+    commands = separate_line(&environ, &error, NULL, line, &count, &syntax_error);
+    assert_that(count, is_greater_than(1));
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        parse_command(&environ, &error, &state, &commands[i]);
+    }
+
+    append_redirection(&environ, &error, &commands[count - 1], REDIRECTION_WRITE, STDOUT_FILENO, -1, template);
+    exit_code = execute_pipeline(&environ, &error, commands, count, state.path_cache, pipefail);
+    assert_that(exit_code, is_equal_to(expected_exit_code));
+
+    file = fopen(template, "r");
+    len = fread(buf, 1, sizeof(buf) - 1, file);
+    buf[len] = '\0';
+    fclose(file);
+    assert_that(buf, is_equal_to_string(expected_output));
+    unlink(template);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        destroy_command(&environ, &commands[i]);
+    }
+    free(commands);
+    destroy_state(&environ, &error, &state);
+    dc_error_reset(&error);
+}
+
+Ensure(execute, redirections)
+{
+    // %s is replaced by the file the output is checked in
+    test_execute_redirections("sh -c 'echo out; echo err >&2' > %s 2>&1", 0, "out\nerr\n");
+    test_execute_redirections("sh -c 'echo out; echo err >&2' &> %s", 0, "out\nerr\n");
+    test_execute_redirections("sh -c 'echo err >&2' 2>&1 > %s", 0, "");
+    // the file is opened once, so the second write does not start over at the beginning
+    test_execute_redirections("sh -c 'echo out; echo err >&2' > %s 2> %s", 0, "out\nerr\n");
+    test_execute_redirections("sh -c 'echo moved >&3' 3> %s", 0, "moved\n");
+    test_execute_redirections("sh -c 'cat <&3' 3< /dev/null > %s", 0, "");
+    test_execute_redirections("sh -c 'echo closed >&2; true' 2>&- > %s", 0, "");
+    test_execute_redirections("printf x 7>&- >&7 > %s", EBADF, "");
+}
+
+static void test_execute_redirections(const char *format, int expected_exit_code, const char *expected_output)
+{
+    struct state state;
+    struct command command;
+    char template[16];
+    char line[256];
+    char buf[64];
+    FILE *file;
+    size_t len;
+
+    state.stdin  = NULL;
+    state.stdout = NULL;
+    state.stderr = NULL;
+    init_state(&environ, &error, &state);
+    strcpy(template, "/tmp/fileXXXXXX");
+    close(mkstemp(template));
+    len = 0;
+
+    // every %s in the format is the file
+    for (const char *piece = format; piece != NULL && len < sizeof(line);)
+    {
+        const char *next;
+        size_t piece_length;
+
+        next         = strstr(piece, "%s");
+        piece_length = next ? (size_t)(next - piece) : strlen(piece);
+        len         += (size_t)snprintf(&line[len], sizeof(line) - len, "%.*s%s", (int)piece_length, piece,
+                                        next ? template : "");
+        piece        = next ? next + 2 : NULL;
+    }
+
+    memset(&command, 0, sizeof(struct command));
+    command.line = strdup(line);
+    parse_command(&environ, &error, &state, &command);
+    execute(&environ, &error, &command, state.path_cache);
+    assert_that(command.exit_code, is_equal_to(expected_exit_code));
+
+    file = fopen(template, "r");
+    len  = fread(buf, 1, sizeof(buf) - 1, file);
+    buf[len] = '\0';
+    fclose(file);
+    assert_that(buf, is_equal_to_string(expected_output));
+    unlink(template);
+
+    destroy_command(&environ, &command);
+    destroy_state(&environ, &error, &state);
+    dc_error_reset(&error);
+}
+
+Ensure(execute, heredoc)
+{
+    struct command command;
+    char template[16];
+    char *text;
+    char *buf;
+    FILE *file;
+    size_t len;
+    const size_t sizes[] = {0, 6, PIPE_BUF, PIPE_BUF + 1, 1 << 20};
+
+    // small ones go through a pipe and big ones through a memfd, the program can not tell
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+        text = malloc(sizes[i] + 1);
+        buf  = malloc(sizes[i] + 2);
+        for (size_t j = 0; j < sizes[i]; ++j)
+        {
+            text[j] = (char)('a' + j % 26);
+        }
+        text[sizes[i]] = '\0';
+
+        strcpy(template, "/tmp/fileXXXXXX");
+        close(mkstemp(template));
+        memset(&command, 0, sizeof(struct command));
+        command.command = strdup("/bin/cat");
+        command.argc    = 1;
+        command.argv    = calloc(2, sizeof(char *));
+        append_redirection(&environ, &error, &command, REDIRECTION_HEREDOC, STDIN_FILENO, -1, text);
+        append_redirection(&environ, &error, &command, REDIRECTION_WRITE, STDOUT_FILENO, -1, template);
+        execute(&environ, &error, &command, NULL);
+        assert_that(command.exit_code, is_equal_to(0));
+
+        file = fopen(template, "r");
+        len  = fread(buf, 1, sizes[i] + 1, file);
+        buf[len] = '\0';
+        fclose(file);
+        assert_that(len, is_equal_to(sizes[i]));
+        assert_true(strcmp(buf, text) == 0);
+        unlink(template);
+
+        destroy_command(&environ, &command);
+        free(text);
+        free(buf);
+    }
+}
+
+Ensure(execute, redirect_shell)
+{
+    struct command command;
+    struct stat before;
+    struct stat after;
+    struct saved_fds saved;
+    char template[16];
+    char buf[64];
+    FILE *file;
+    size_t len;
+
+    strcpy(template, "/tmp/fileXXXXXX");
+    close(mkstemp(template));
+    memset(&command, 0, sizeof(struct command));
+    append_redirection(&environ, &error, &command, REDIRECTION_WRITE, STDOUT_FILENO, -1, template);
+    append_redirection(&environ, &error, &command, REDIRECTION_DUP, STDERR_FILENO, STDOUT_FILENO, NULL);
+    fstat(STDOUT_FILENO, &before);
+
+    fflush(stdout);
+    assert_true(redirect_shell(&environ, &error, &command, &saved));
+    assert_that(saved.count, is_equal_to(2));
+    assert_that(saved.fds[0], is_equal_to(STDOUT_FILENO));
+    assert_that(saved.copies[0], is_greater_than(9));
+    assert_that(saved.fds[1], is_equal_to(STDERR_FILENO));
+    printf("redirected");
+    fflush(stdout);
+    restore_shell(&saved);
+
+    fstat(STDOUT_FILENO, &after);
+    assert_that(after.st_ino, is_equal_to(before.st_ino));
+    assert_that(saved.count, is_equal_to(0));
+
+    file = fopen(template, "r");
+    len = fread(buf, 1, sizeof(buf) - 1, file);
+    buf[len] = '\0';
+    fclose(file);
+    assert_that(buf, is_equal_to_string("redirected"));
+    unlink(template);
+    destroy_command(&environ, &command);
+
+    memset(&command, 0, sizeof(struct command));
+    append_redirection(&environ, &error, &command, REDIRECTION_READ, STDIN_FILENO, -1,
+                       "/asdasdasdfddfgsdfgasderdfdsf");
+    assert_false(redirect_shell(&environ, &error, &command, &saved));
+    assert_that(command.exit_code, is_equal_to(ENOENT));
+    assert_false(dc_error_has_error(&error));
+    destroy_command(&environ, &command);
+}
+
 TestSuite *execute_tests(void)
 {
     TestSuite *suite;
 
     suite = create_test_suite();
     add_test_with_context(suite, execute, execute);
+    add_test_with_context(suite, execute, execute_pipeline);
+    add_test_with_context(suite, execute, redirections);
+    add_test_with_context(suite, execute, heredoc);
+    add_test_with_context(suite, execute, redirect_shell);
 
     return suite;
 }
@@ -0,0 +1,250 @@
+#include "tests.h"
+#include "expand.h"
+#include "vars.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void test_expand(struct arena *arena, const char *word, const char *expected);
+static void make_files(const char *dir, const char **names);
+
+Describe(expand);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+
+BeforeEach(expand)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+}
+
+AfterEach(expand)
+{
+    dc_error_reset(&error);
+}
+
+Ensure(expand, parameters)
+{
+    struct arena *arena;
+
+    arena = arena_create(&environ, &error, 256);
+    setenv("HOME", "/home/me", true);
+    setenv("X", "a  b", true);
+    setenv("EMPTY", "", true);
+    unsetenv("UNSET");
+    unsetenv("IFS");
+
+    test_expand(arena, "~", "[/home/me]");
+    test_expand(arena, "~/x", "[/home/me/x]");
+    test_expand(arena, "~root/x", "[/root/x]");
+    test_expand(arena, "~no_such_user_here", "[~no_such_user_here]");
+    test_expand(arena, "\"~\"/x", "[~/x]");
+    test_expand(arena, "$X", "[a][b]");
+    test_expand(arena, "\"$X\"", "[a  b]");
+    test_expand(arena, "x${X}y", "[xa][by]");
+    test_expand(arena, "${#X}", "[4]");
+    test_expand(arena, "$UNSET", "");
+    test_expand(arena, "\"$UNSET\"", "[]");
+    test_expand(arena, "${UNSET:-d e}", "[d][e]");
+    test_expand(arena, "${EMPTY:-d}${EMPTY-e}", "[d]");
+    test_expand(arena, "'$X' \\$X", "[$X $X]");
+    test_expand(arena, "\"a\\$X\\\"\\b\"", "[a$X\"\\b]");
+
+    // nothing is ever run
+    test_expand(arena, "$(id)", "[$(id)]");
+    test_expand(arena, "`id`", "[`id`]");
+    test_expand(arena, "${X%a} $ $1", "[${X%a} $ $1]");
+
+    setenv("IFS", ":", true);
+    setenv("X", "a:b c", true);
+    test_expand(arena, "$X", "[a][b c]");
+    unsetenv("IFS");
+
+    arena_destroy(&environ, &arena);
+}
+
+Ensure(expand, glob)
+{
+    static const char *names[] = {"b.c", "a.c", "c.h", ".hidden.c", "sub/", "sub/x.c", "sub/y.h", "s*", NULL};
+    char dir[] = "/tmp/dc_shell_expandXXXXXX";
+    char word[128];
+    char expected[512];
+
+    mkdtemp(dir);
+    make_files(dir, names);
+
+    // the working directory is used as it is, without a ./ in front of the names
+    chdir(dir);
+    test_expand(NULL, "*.c", "[a.c][b.c]");
+    test_expand(NULL, ".*.c", "[.hidden.c]");
+    test_expand(NULL, "?.[ch]", "[a.c][b.c][c.h]");
+    test_expand(NULL, "*/*.c", "[sub/x.c]");
+    test_expand(NULL, "*/", "[sub/]");
+    test_expand(NULL, "*/y.h", "[sub/y.h]");
+    test_expand(NULL, "*/z.h", "[*/z.h]");
+    test_expand(NULL, "*.x", "[*.x]");
+    test_expand(NULL, "'*'.c \"s*\"", "[*.c s*]");
+    test_expand(NULL, "s\\*", "[s*]");
+    chdir("/");
+
+    snprintf(word, sizeof(word), "%s/*.c", dir);
+    snprintf(expected, sizeof(expected), "[%s/a.c][%s/b.c]", dir, dir);
+    test_expand(NULL, word, expected);
+
+    setenv("GLOB", "*.h", true);
+    snprintf(word, sizeof(word), "%s/$GLOB", dir);
+    snprintf(expected, sizeof(expected), "[%s/c.h]", dir);
+    test_expand(NULL, word, expected);
+
+    snprintf(word, sizeof(word), "rm -rf %s", dir);
+    system(word);
+}
+
+Ensure(expand, many)
+{
+    struct arena *arena;
+    struct expansion expansion;
+    char dir[] = "/tmp/dc_shell_expandXXXXXX";
+    char path[128];
+
+    mkdtemp(dir);
+
+    for (int i = 2999; i >= 0; --i)
+    {
+        snprintf(path, sizeof(path), "%s/f%04d", dir, i);
+        close(open(path, O_CREAT | O_WRONLY, 0600));
+    }
+
+    arena = arena_create(&environ, &error, 4096);
+    memset(&expansion, 0, sizeof(expansion));
+    snprintf(path, sizeof(path), "%s/f*", dir);
+    expand_word(&environ, &error, arena, NULL, path, strlen(path), &expansion);
+    assert_that(expansion.count, is_equal_to(3000));
+
+    // sorted, whatever order the directory has them in
+    for (size_t i = 1; i < expansion.count; ++i)
+    {
+        assert_that(strcmp(expansion.words[i - 1], expansion.words[i]), is_less_than(0));
+    }
+
+    arena_destroy(&environ, &arena);
+    snprintf(path, sizeof(path), "rm -rf %s", dir);
+    system(path);
+}
+
+Ensure(expand, text)
+{
+    static const char *texts[][2] = {
+        {"plain text\n",                   "plain text\n"},
+        {"$X and ${X}\n",                  "a  b and a  b\n"},
+        {"'$X' \"$X\" *\n",                "'a  b' \"a  b\" *\n"},
+        {"\\$X \\\\ \\n $UNSET.\n",          "$X \\ \\n .\n"},
+        {"${UNSET:-none} $(date) `x`\n",   "none $(date) `x`\n"},
+    };
+    struct arena *arena;
+    char *expanded;
+
+    arena = arena_create(&environ, &error, 256);
+    setenv("X", "a  b", true);
+    unsetenv("UNSET");
+
+    for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); ++i)
+    {
+        expanded = expand_text(&environ, &error, arena, NULL, texts[i][0], strlen(texts[i][0]));
+        assert_that(expanded, is_equal_to_string(texts[i][1]));
+    }
+
+    assert_false(dc_error_has_error(&error));
+    arena_destroy(&environ, &arena);
+}
+
+Ensure(expand, vars)
+{
+    char home[]         = "HOME=/home/vars";
+    char x[]            = "X=a  b";
+    char *environment[] = {home, x, NULL};
+    struct expansion expansion;
+    struct vars *vars;
+    struct arena *arena;
+    char *value;
+
+    arena = arena_create(&environ, &error, 256);
+    vars  = vars_create(&environ, &error, environment);
+    setenv("X", "from the environment", true);
+
+    // the variables come from the table, not the environment
+    memset(&expansion, 0, sizeof(expansion));
+    expand_word(&environ, &error, arena, vars, "~/$X", strlen("~/$X"), &expansion);
+    assert_that(expansion.count, is_equal_to(2));
+    assert_that(expansion.words[0], is_equal_to_string("/home/vars/a"));
+    assert_that(expansion.words[1], is_equal_to_string("b"));
+    assert_that(expand_text(&environ, &error, arena, vars, "$X.", strlen("$X.")), is_equal_to_string("a  b."));
+
+    // the value of an assignment is not split or globbed
+    value = expand_assignment(&environ, &error, arena, vars, "~/$X*", strlen("~/$X*"));
+    assert_that(value, is_equal_to_string("/home/vars/a  b*"));
+    value = expand_assignment(&environ, &error, arena, vars, "'q r'\\ $UNSET", strlen("'q r'\\ $UNSET"));
+    assert_that(value, is_equal_to_string("q r "));
+    value = expand_assignment(&environ, &error, arena, vars, "", 0);
+    assert_that(value, is_equal_to_string(""));
+
+    assert_false(dc_error_has_error(&error));
+    vars_destroy(&environ, &vars);
+    arena_destroy(&environ, &arena);
+}
+
+static void test_expand(struct arena *arena, const char *word, const char *expected)
+{
+    struct expansion expansion;
+    char out[1024];
+
+    memset(&expansion, 0, sizeof(expansion));
+    expand_word(&environ, &error, arena, NULL, word, strlen(word), &expansion);
+    assert_false(dc_error_has_error(&error));
+    out[0] = '\0';
+
+    for (size_t i = 0; i < expansion.count; ++i)
+    {
+        strcat(out, "[");
+        strcat(out, expansion.words[i]);
+        strcat(out, "]");
+        arena_free(arena, expansion.words[i]);
+    }
+
+    arena_free(arena, expansion.words);
+    assert_that(out, is_equal_to_string(expected));
+}
+
+static void make_files(const char *dir, const char **names)
+{
+    char path[128];
+
+    for (size_t i = 0; names[i]; ++i)
+    {
+        snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+
+        if (path[strlen(path) - 1] == '/')
+        {
+            mkdir(path, 0700);
+        }
+        else
+        {
+            close(open(path, O_CREAT | O_WRONLY, 0600));
+        }
+    }
+}
+
+TestSuite *expand_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, expand, parameters);
+    add_test_with_context(suite, expand, glob);
+    add_test_with_context(suite, expand, many);
+    add_test_with_context(suite, expand, text);
+    add_test_with_context(suite, expand, vars);
+
+    return suite;
+}
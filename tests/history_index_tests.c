@@ -0,0 +1,199 @@
+#include "tests.h"
+#include "history.h"
+#include "history_index.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char *result_text(const uint64_t *results, size_t i);
+
+Describe(history_index);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+static struct history *history;
+static char path[] = "/tmp/dc_shell_history_index_XXXXXX";
+static char index_path[sizeof(path) + 4];
+
+BeforeEach(history_index)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+    strcpy(path, "/tmp/dc_shell_history_index_XXXXXX");
+    close(mkstemp(path));
+    sprintf(index_path, "%s.idx", path);
+    history = history_open(&environ, &error, path, 65536);
+}
+
+AfterEach(history_index)
+{
+    history_close(&environ, &history);
+    unlink(path);
+    unlink(index_path);
+    dc_error_reset(&error);
+}
+
+Ensure(history_index, search)
+{
+    struct history_index *index;
+    uint64_t results[8];
+
+    index = history_index_open(&environ, &error, NULL);
+
+    // git status is entered more often, git log more recently
+    for (int i = 0; i < 5; ++i)
+    {
+        history_add(history, "git status", 10);
+        history_add(history, "make", 4);
+    }
+
+    history_add(history, "git log", 7);
+    history_add(history, "abcXbcd", 7);
+    history_index_update(&environ, &error, index, history);
+    assert_that(index->entry_count, is_equal_to(12));
+
+    assert_that(history_index_search(&environ, &error, index, history, "git", 3, results, 8), is_equal_to(2));
+    assert_that(result_text(results, 0), is_equal_to_string("git status"));
+    assert_that(result_text(results, 1), is_equal_to_string("git log"));
+
+    // with no trigram to look up every entry is checked, and a command is only found once
+    assert_that(history_index_search(&environ, &error, index, history, "a", 1, results, 8), is_equal_to(3));
+    assert_that(result_text(results, 0), is_equal_to_string("make"));
+    assert_that(history_index_search(&environ, &error, index, history, "t l", 3, results, 8), is_equal_to(1));
+    assert_that(result_text(results, 0), is_equal_to_string("git log"));
+
+    // every trigram of the query is in the entry, the query is not
+    assert_that(history_index_search(&environ, &error, index, history, "abcd", 4, results, 8), is_equal_to(0));
+    assert_that(history_index_search(&environ, &error, index, history, "svn", 3, results, 8), is_equal_to(0));
+
+    // the entries another session adds are indexed by the next update
+    for (int i = 0; i < 6; ++i)
+    {
+        history_add(history, "git log", 7);
+    }
+
+    history_index_update(&environ, &error, index, history);
+    assert_that(index->entry_count, is_equal_to(18));
+    assert_that(history_index_search(&environ, &error, index, history, "git", 3, results, 1), is_equal_to(1));
+    assert_that(result_text(results, 0), is_equal_to_string("git log"));
+
+    history_index_close(&environ, &index);
+    assert_that(index, is_null);
+    assert_false(dc_error_has_error(&error));
+}
+
+Ensure(history_index, save_and_load)
+{
+    struct history_index *index;
+    uint64_t results[4];
+    char line[32];
+
+    for (int i = 0; i < 100; ++i)
+    {
+        snprintf(line, sizeof(line), "echo %d", i);
+        history_add(history, line, strlen(line));
+    }
+
+    // there is no file yet, the whole history is indexed
+    index = history_index_open(&environ, &error, index_path);
+    history_index_update(&environ, &error, index, history);
+    assert_that(index->entry_count, is_equal_to(100));
+    history_index_save(&environ, &error, index);
+    history_index_close(&environ, &index);
+
+    // the saved index is loaded, only the entry added since is indexed
+    history_add(history, "echo 100", 8);
+    index = history_index_open(&environ, &error, index_path);
+    assert_that(index->entry_count, is_equal_to(100));
+    history_index_update(&environ, &error, index, history);
+    assert_that(index->entry_count, is_equal_to(101));
+    assert_that(history_index_search(&environ, &error, index, history, "o 42", 4, results, 4), is_equal_to(1));
+    assert_that(result_text(results, 0), is_equal_to_string("echo 42"));
+    assert_that(history_index_search(&environ, &error, index, history, "100", 3, results, 4), is_equal_to(1));
+    history_index_close(&environ, &index);
+    assert_false(dc_error_has_error(&error));
+}
+
+Ensure(history_index, overwritten)
+{
+    struct history_index *index;
+    uint64_t results[64];
+    char line[32];
+    size_t count;
+
+    history_close(&environ, &history);
+    unlink(path);
+    history = history_open(&environ, &error, path, 512);
+    index   = history_index_open(&environ, &error, index_path);
+
+    // the ring goes around many times, only the entries still in it are found
+    for (int i = 0; i < 200; ++i)
+    {
+        snprintf(line, sizeof(line), "command %d", i);
+        history_add(history, line, strlen(line));
+        history_index_update(&environ, &error, index, history);
+    }
+
+    count = history_index_search(&environ, &error, index, history, "command", 7, results, 64);
+    assert_true(count > 5 && count < 20);
+    assert_that(result_text(results, 0), is_equal_to_string("command 199"));
+    assert_that(history_index_search(&environ, &error, index, history, "command 19", 10, results, 64),
+                is_less_than(count));
+    assert_that(history_index_search(&environ, &error, index, history, "command 5", 9, results, 64),
+                is_equal_to(0));
+
+    // the overwritten entries are not saved
+    history_index_save(&environ, &error, index);
+    history_index_close(&environ, &index);
+    index = history_index_open(&environ, &error, index_path);
+    assert_that(index->entry_count, is_equal_to(count));
+    history_index_close(&environ, &index);
+    assert_false(dc_error_has_error(&error));
+}
+
+Ensure(history_index, damaged)
+{
+    struct history_index *index;
+    FILE *file;
+
+    file = fopen(index_path, "w");
+    fputs("this is not an index", file);
+    fclose(file);
+
+    // the file is ignored and the history indexed again
+    history_add(history, "ls", 2);
+    index = history_index_open(&environ, &error, index_path);
+    assert_that(index, is_not_null);
+    assert_that(index->entry_count, is_equal_to(0));
+    history_index_update(&environ, &error, index, history);
+    assert_that(index->entry_count, is_equal_to(1));
+    history_index_close(&environ, &index);
+    assert_false(dc_error_has_error(&error));
+}
+
+static const char *result_text(const uint64_t *results, size_t i)
+{
+    static char line[64];
+    size_t length;
+
+    if (!history_read(history, results[i], line, sizeof(line), &length))
+    {
+        return "";
+    }
+
+    return line;
+}
+
+TestSuite *history_index_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, history_index, search);
+    add_test_with_context(suite, history_index, save_and_load);
+    add_test_with_context(suite, history_index, overwritten);
+    add_test_with_context(suite, history_index, damaged);
+
+    return suite;
+}
@@ -0,0 +1,226 @@
+#include "tests.h"
+#include "history.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static size_t count_entries(const struct history *history);
+
+Describe(history);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+static char path[] = "/tmp/dc_shell_history_XXXXXX";
+
+BeforeEach(history)
+{
+    int fd;
+
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+    strcpy(path, "/tmp/dc_shell_history_XXXXXX");
+    fd = mkstemp(path);
+    close(fd);
+}
+
+AfterEach(history)
+{
+    unlink(path);
+    dc_error_reset(&error);
+}
+
+Ensure(history, add_and_read)
+{
+    struct history *history;
+    struct history *other;
+    uint64_t first;
+    uint64_t second;
+    uint64_t position;
+    char line[64];
+    size_t length;
+
+    // the empty file made by mkstemp is set up as a new history
+    history = history_open(&environ, &error, path, 4096);
+    assert_that(history, is_not_null);
+    assert_that(history->capacity, is_equal_to(4096));
+    assert_that(history_end(history), is_equal_to(0));
+    assert_false(history_previous(history, history_end(history), &position));
+
+    first  = history_add(history, "ls -l", 5);
+    second = history_add(history, "echo hello world", 16);
+    assert_that(first, is_equal_to(0));
+    assert_true(second > first);
+
+    assert_true(history_previous(history, history_end(history), &position));
+    assert_that(position, is_equal_to(second));
+    assert_true(history_read(history, position, line, sizeof(line), &length));
+    assert_that(line, is_equal_to_string("echo hello world"));
+    assert_that(length, is_equal_to(16));
+    assert_true(history_previous(history, position, &position));
+    assert_that(position, is_equal_to(first));
+    assert_false(history_previous(history, position, &position));
+
+    assert_true(history_next(history, first, &position));
+    assert_that(position, is_equal_to(second));
+    assert_true(history_next(history, second, &position));
+    assert_that(position, is_equal_to(history_end(history)));
+
+    // a line that does not fit is cut short, the length is still the whole length
+    assert_true(history_read(history, second, line, 5, &length));
+    assert_that(line, is_equal_to_string("echo"));
+    assert_that(length, is_equal_to(16));
+
+    // another session sees the entries, and this one sees what it adds
+    other = history_open(&environ, &error, path, 1);
+    assert_that(other, is_not_null);
+    assert_that(other->capacity, is_equal_to(4096));
+    assert_that(count_entries(other), is_equal_to(2));
+    history_add(other, "pwd", 3);
+    assert_that(count_entries(history), is_equal_to(3));
+    history_close(&environ, &other);
+    assert_that(other, is_null);
+
+    assert_that(history_add(history, line, 4096 / 4 + 1), is_equal_to(UINT64_MAX));
+    history_close(&environ, &history);
+    assert_false(dc_error_has_error(&error));
+}
+
+Ensure(history, wrap)
+{
+    struct history *history;
+    char line[32];
+    char expected[32];
+    size_t wrong;
+    size_t count;
+    uint64_t position;
+
+    history = history_open(&environ, &error, path, 256);
+
+    // many more entries than fit, so the ring goes around several times and entries are split at its end
+    for (int i = 0; i < 100; ++i)
+    {
+        snprintf(line, sizeof(line), "command %d", i);
+        history_add(history, line, strlen(line));
+    }
+
+    count = count_entries(history);
+    assert_true(count > 2 && count < 10);
+    wrong    = 0;
+    position = history_end(history);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t length;
+
+        history_previous(history, position, &position);
+        snprintf(expected, sizeof(expected), "command %zu", 99 - i);
+        wrong += !history_read(history, position, line, sizeof(line), &length) || strcmp(line, expected) != 0;
+    }
+
+    assert_that(wrong, is_equal_to(0));
+    history_close(&environ, &history);
+    assert_false(dc_error_has_error(&error));
+}
+
+Ensure(history, sessions)
+{
+    struct history *history;
+    uint64_t position;
+    size_t wrong;
+    int next[4];
+
+    history = history_open(&environ, &error, path, 65536);
+
+    // several sessions add entries at the same time, every one of them must come out whole
+    for (int child = 0; child < 4; ++child)
+    {
+        if (fork() == 0)
+        {
+            struct history *session;
+            char line[32];
+
+            session = history_open(&environ, &error, path, 65536);
+
+            for (int i = 0; i < 200; ++i)
+            {
+                snprintf(line, sizeof(line), "session %d entry %d", child, i);
+                history_add(session, line, strlen(line));
+            }
+
+            _exit(0);
+        }
+    }
+
+    for (int child = 0; child < 4; ++child)
+    {
+        wait(NULL);
+        next[child] = 199;
+    }
+
+    assert_that(count_entries(history), is_equal_to(800));
+    wrong = 0;
+
+    // going back through the history, each session's entries are in the reverse of the order it added them
+    for (position = history_end(history); history_previous(history, position, &position);)
+    {
+        char line[32];
+        size_t length;
+        int child;
+        int i;
+
+        history_read(history, position, line, sizeof(line), &length);
+
+        if (sscanf(line, "session %d entry %d", &child, &i) != 2 || child < 0 || child > 3 || i != next[child]--)
+        {
+            ++wrong;
+        }
+    }
+
+    assert_that(wrong, is_equal_to(0));
+    history_close(&environ, &history);
+}
+
+Ensure(history, not_history)
+{
+    FILE *file;
+
+    file = fopen(path, "w");
+    fputs("echo this is a bash history file\n", file);
+    fclose(file);
+
+    assert_that(history_open(&environ, &error, path, 4096), is_null);
+    assert_false(dc_error_has_error(&error));
+
+    assert_that(history_open(&environ, &error, "/nonexistent/history", 4096), is_null);
+    assert_true(dc_error_has_error(&error));
+}
+
+static size_t count_entries(const struct history *history)
+{
+    uint64_t position;
+    size_t count;
+
+    count = 0;
+
+    for (position = history_end(history); history_previous(history, position, &position);)
+    {
+        ++count;
+    }
+
+    return count;
+}
+
+TestSuite *history_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, history, add_and_read);
+    add_test_with_context(suite, history, wrap);
+    add_test_with_context(suite, history, sessions);
+    add_test_with_context(suite, history, not_history);
+
+    return suite;
+}
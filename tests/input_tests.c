@@ -1,6 +1,7 @@
 #include "tests.h"
 #include "util.h"
 #include "input.h"
+#include <unistd.h>
 
 static void test_read_command_line(const char *data, ...);
 
@@ -26,9 +27,63 @@ Ensure(input, read_command_line)
     test_read_command_line(" evil \n", "evil", NULL);
     test_read_command_line(" \t\f\vabc def  \t\f\v\n", "abc def", NULL);
     test_read_command_line("four\nthree\n", "four", "three", NULL);
+    test_read_command_line(" \t \n", "", NULL);
+    test_read_command_line("  last", "last", NULL);
     test_read_command_line("./a.out hello < in.txt > out.txt 2>err.txt\n", "./a.out hello < in.txt > out.txt 2>err.txt", NULL);
 }
 
+Ensure(input, read_line)
+{
+    FILE *stream;
+    struct input *input;
+    char *long_line;
+    char *line;
+    size_t length;
+    size_t size;
+
+    // a line longer than a block makes the buffer grow, the lines around it are moved to the front
+    size      = 200000;
+    long_line = malloc(size + 1);
+    memset(long_line, 'x', size);
+    long_line[size] = '\0';
+    stream = tmpfile();
+    fprintf(stream, "first\n\n%s\nlast\nrest\n", long_line);
+    rewind(stream);
+    input = input_create(&environ, &error, stream);
+    assert_that(input->fd, is_equal_to(fileno(stream)));
+
+    line = input_read_line(&environ, &error, input, &length);
+    assert_that(line, is_equal_to_string("first"));
+    assert_that(length, is_equal_to(5));
+    line = input_read_line(&environ, &error, input, &length);
+    assert_that(line, is_equal_to_string(""));
+    line = input_read_line(&environ, &error, input, &length);
+    assert_that(length, is_equal_to(size));
+    assert_that(line, is_equal_to_string(long_line));
+    assert_true(input->capacity > size);
+    line = input_read_line(&environ, &error, input, &length);
+    assert_that(line, is_equal_to_string("last"));
+
+    // a program reading the file after the shell starts at the line after the current one
+    input_release(input);
+    assert_that(lseek(input->fd, 0, SEEK_CUR), is_equal_to(strlen("first\n\n") + size + strlen("\nlast\n")));
+
+    line = input_read_line(&environ, &error, input, &length);
+    assert_that(line, is_equal_to_string("rest"));
+    assert_that(input_read_line(&environ, &error, input, &length), is_null);
+    assert_true(input->eof);
+    assert_false(dc_error_has_error(&error));
+
+    input_destroy(&environ, &input);
+    fclose(stream);
+    free(long_line);
+
+    // without a stream there are no lines
+    input = input_create(&environ, &error, NULL);
+    assert_that(input_read_line(&environ, &error, input, &length), is_null);
+    input_destroy(&environ, &input);
+}
+
 static void test_read_command_line(const char *data, ...)
 {
     FILE *strstream;
@@ -36,10 +91,12 @@ static void test_read_command_line(const char *data, ...)
     size_t buf_size;
     char *str;
     char *expected_line;
+    struct input *input;
 
     buf_size = strlen(data) + 1;
     str = strdup(data);
     strstream = fmemopen(str, buf_size, "r");
+    input = input_create(&environ, &error, strstream);
 
     va_start(strings, data);
 
@@ -49,7 +106,7 @@ static void test_read_command_line(const char *data, ...)
         size_t line_size;
 
         line_size = buf_size;
-        line = read_command_line(&environ, &error, strstream, &line_size);
+        line = read_command_line(&environ, &error, input, &line_size);
         expected_line = va_arg(strings, char *);
 
         if(expected_line == NULL)
@@ -63,12 +120,15 @@ static void test_read_command_line(const char *data, ...)
             assert_that(line_size, is_equal_to(strlen(line)));
         }
 
-        free(line);
+        // the line is inside the buffer, which is reused for the next line
+        assert_true(line >= input->buffer && line < input->buffer + input->capacity);
     }
     while(expected_line);
 
     va_end(strings);
 
+    input_destroy(&environ, &input);
+    assert_that(input, is_null);
     fclose(strstream);
     free(str);
 }
@@ -79,6 +139,7 @@ TestSuite *input_tests(void)
 
     suite = create_test_suite();
     add_test_with_context(suite, input, read_command_line);
+    add_test_with_context(suite, input, read_line);
 
     return suite;
 }
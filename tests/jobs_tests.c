@@ -0,0 +1,223 @@
+#include "tests.h"
+#include "jobs.h"
+#include "command.h"
+#include "execute.h"
+#include "shell_impl.h"
+#include "state.h"
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+static struct job *start_job(struct state *state, const char *line);
+
+Describe(jobs);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+
+BeforeEach(jobs)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+}
+
+AfterEach(jobs)
+{
+    dc_error_reset(&error);
+}
+
+Ensure(jobs, wait)
+{
+    struct state state;
+    struct job *job;
+
+    state.stdin = stdin;
+    state.stdout = stdout;
+    state.stderr = stderr;
+    init_state(&environ, &error, &state);
+
+    job = start_job(&state, "true");
+    assert_that(job->id, is_equal_to(1));
+    assert_that(job->status, is_equal_to(JOB_RUNNING));
+    assert_that(jobs_wait(state.jobs, job), is_equal_to(0));
+    assert_that(job->status, is_equal_to(JOB_DONE));
+    jobs_remove(&environ, state.jobs, job);
+
+    job = start_job(&state, "printf abc | false");
+    assert_that(job->pid_count, is_equal_to(2));
+    assert_that(job->line, is_equal_to_string("printf abc | false"));
+    assert_that(jobs_wait(state.jobs, job), is_equal_to(1));
+    jobs_remove(&environ, state.jobs, job);
+
+    job = start_job(&state, "sleep 5");
+    kill(-job->pgid, SIGSTOP);
+    assert_that(jobs_wait(state.jobs, job), is_equal_to(128 + SIGTSTP));
+    assert_that(job->status, is_equal_to(JOB_STOPPED));
+    jobs_continue(state.jobs, job);
+    assert_that(job->status, is_equal_to(JOB_RUNNING));
+
+    // ^C at the shell ends the wait but not the job
+    *state.jobs->interrupted = SIGINT;
+    assert_that(jobs_wait(state.jobs, job), is_equal_to(128 + SIGINT));
+    assert_that(job->status, is_equal_to(JOB_RUNNING));
+    *state.jobs->interrupted = 0;
+    kill(-job->pgid, SIGTERM);
+    assert_that(jobs_wait(state.jobs, job), is_equal_to(128 + SIGTERM));
+    assert_that(state.jobs->count, is_equal_to(1));
+
+    destroy_state(&environ, &error, &state);
+    assert_that(state.jobs, is_null);
+}
+
+Ensure(jobs, find)
+{
+    struct state state;
+    struct job *first;
+    struct job *second;
+    char spec[32];
+
+    state.stdin = stdin;
+    state.stdout = stdout;
+    state.stderr = stderr;
+    init_state(&environ, &error, &state);
+
+    assert_that(jobs_find(&environ, state.jobs, NULL), is_null);
+    start_job(&state, "true");
+    start_job(&state, "true");
+    first  = &state.jobs->job[0];
+    second = &state.jobs->job[1];
+
+    assert_that(second->id, is_equal_to(2));
+    assert_that(jobs_find(&environ, state.jobs, NULL), is_equal_to(second));
+    assert_that(jobs_find(&environ, state.jobs, "%%"), is_equal_to(second));
+    assert_that(jobs_find(&environ, state.jobs, "%1"), is_equal_to(first));
+    assert_that(jobs_find(&environ, state.jobs, "%3"), is_null);
+    snprintf(spec, sizeof(spec), "%d", (int)first->pids[0]);
+    assert_that(jobs_find(&environ, state.jobs, spec), is_equal_to(first));
+
+    jobs_wait(state.jobs, first);
+    jobs_wait(state.jobs, second);
+    destroy_state(&environ, &error, &state);
+}
+
+Ensure(jobs, notify)
+{
+    struct state state;
+    char out[1024];
+    FILE *out_file;
+    struct timespec delay = {0, 10000000};
+
+    memset(out, 0, sizeof(out));
+    out_file = fmemopen(out, sizeof(out), "w");
+    state.stdin = stdin;
+    state.stdout = stdout;
+    state.stderr = stderr;
+    init_state(&environ, &error, &state);
+
+    start_job(&state, "false");
+
+    // the job is reaped once the SIGCHLD has arrived
+    for (int i = 0; i < 500 && state.jobs->count > 0; ++i)
+    {
+        jobs_notify(&environ, state.jobs, out_file);
+        nanosleep(&delay, NULL);
+    }
+
+    fflush(out_file);
+    assert_that(state.jobs->count, is_equal_to(0));
+    assert_that(out, is_equal_to_string("[1] Exit 1\tfalse\n"));
+
+    fclose(out_file);
+    destroy_state(&environ, &error, &state);
+}
+
+Ensure(jobs, foreground_stop)
+{
+    struct state state;
+    struct command *commands;
+    size_t count;
+    const char *syntax_error;
+    pid_t pids[2];
+
+    state.stdin = stdin;
+    state.stdout = stdout;
+    state.stderr = stderr;
+    init_state(&environ, &error, &state);
+
+    // without a terminal there is no job control
+    jobs_control(&environ, &error, state.jobs, -1);
+    assert_that(state.jobs->terminal, is_equal_to(-1));
+    assert_false(dc_error_has_error(&error));
+
+    commands = separate_line(&environ, &error, NULL, "true | sleep 5", &count, &syntax_error);
+    for (size_t i = 0; i < count; ++i)
+    {
+        parse_command(&environ, &error, &state, &commands[i]);
+    }
+
+    launch_pipeline(&environ, &error, commands, count, state.path_cache, 0, pids);
+    assert_that(getpgid(pids[1]), is_equal_to(pids[0]));
+    kill(pids[1], SIGSTOP);
+
+    // the stopped command keeps its pid so that it can be added to the job table
+    assert_that(wait_pipeline(commands, count, pids, false, true), is_equal_to(128 + SIGSTOP));
+    assert_that(pids[0], is_equal_to(-1));
+    assert_that(pids[1], is_greater_than(0));
+    assert_that(commands[0].exit_code, is_equal_to(0));
+
+    kill(pids[1], SIGKILL);
+    assert_that(wait_pipeline(commands, count, pids, false, true), is_equal_to(128 + SIGKILL));
+    assert_that(pids[1], is_equal_to(-1));
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        destroy_command(&environ, &commands[i]);
+    }
+    free(commands);
+    destroy_state(&environ, &error, &state);
+}
+
+static struct job *start_job(struct state *state, const char *line)
+{
+    struct command *commands;
+    struct job *job;
+    size_t count;
+    const char *syntax_error;
+    pid_t pids[8];
+    int exit_codes[8];
+
+    commands = separate_line(&environ, &error, NULL, line, &count, &syntax_error);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        parse_command(&environ, &error, state, &commands[i]);
+    }
+
+    launch_pipeline(&environ, &error, commands, count, state->path_cache, 0, pids);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        exit_codes[i] = commands[i].exit_code;
+        destroy_command(&environ, &commands[i]);
+    }
+    free(commands);
+
+    job = jobs_add(&environ, &error, state->jobs, line, pids, exit_codes, count, false);
+    assert_that(job, is_not_null);
+    assert_that(job->pgid, is_equal_to(pids[0]));
+
+    return job;
+}
+
+TestSuite *jobs_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, jobs, wait);
+    add_test_with_context(suite, jobs, find);
+    add_test_with_context(suite, jobs, notify);
+    add_test_with_context(suite, jobs, foreground_stop);
+
+    return suite;
+}
@@ -0,0 +1,166 @@
+#include "tests.h"
+#include "lexer.h"
+
+static void test_lexer(const char *line, const char *expected);
+static void test_lexer_error(const char *line, const char *expected_error);
+
+Describe(lexer);
+
+BeforeEach(lexer)
+{
+}
+
+AfterEach(lexer)
+{
+}
+
+Ensure(lexer, lexer_next)
+{
+    test_lexer("", "");
+    test_lexer("   \t ", "");
+    test_lexer("ls", "[ls]");
+    test_lexer("  ls   -al\t/tmp ", "[ls][-al][/tmp]");
+    test_lexer("echo 'a  b' \"c  d\" e\\ f", "[echo][a  b][c  d][e f]");
+    test_lexer("echo a'b'\"c\"d ''", "[echo][abcd][]");
+    test_lexer("echo 'a\\b' \"a\\b\\\"c\\$\" \\'", "[echo][a\\b][a\\b\"c$][']");
+    test_lexer("a<in>out 2>>err", "[a]<0:in>1:out>>2:err");
+    test_lexer("a 2> err 12>x 1>>y", "[a]>2:err>12:x>>1:y");
+    test_lexer("a '2>b' 2\\>b a2>b", "[a][2>b][2>b][a2]>1:b");
+    test_lexer("a > 'my file'", "[a]>1:my file");
+    test_lexer("seq 2 10\t3", "[seq][2][10][3]");
+    test_lexer("a\r\v\fb", "[a][b]");
+    test_lexer("a 2>&1 >&- 3<&0", "[a]>&2:1>&1:-<&3:0");
+    test_lexer("a <>x 4<> y", "[a]<>0:x<>4:y");
+    test_lexer("a &>x&>>y b&>z", "[a]&>1:x&>>1:y[b]&>1:z");
+    test_lexer("a&b", "[a&b]");
+    test_lexer("a 99999999999>x", "[a]>99999:x");
+    test_lexer("cat <<EOF 2<<-'E F' <<< $x", "[cat]<<0:EOF<<-2:E F<<<0:$x");
+    // words longer than a scanned block, with the special characters on either side of a block boundary
+    test_lexer("abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz'quoted  'abcdefghijklmnopqrstuv\\ x",
+               "[abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyzquoted  abcdefghijklmnopqrstuv x]");
+    test_lexer("\"abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz\\\"\" 0123456789abcdefghijklmnopqrstuv>x",
+               "[abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz\"][0123456789abcdefghijklmnopqrstuv]>1:x");
+}
+
+Ensure(lexer, redirects)
+{
+    struct lexer lexer;
+    char buffer[64];
+
+    lexer_init(&lexer, "seq 2 10", buffer);
+    assert_false(lexer.redirects);
+    lexer_init(&lexer, "echo '>'", buffer);
+    assert_true(lexer.redirects);
+    lexer_init(&lexer, "wc<in", buffer);
+    assert_true(lexer.redirects);
+}
+
+Ensure(lexer, expand)
+{
+    struct lexer lexer;
+    struct token token;
+    char buffer[64];
+    static const struct
+    {
+        const char *word;
+        bool expand;
+    } words[] = {
+        {"abc", false},
+        {"~/x", true},
+        {"a~", false},
+        {"$HOME", true},
+        {"'$HOME'", false},
+        {"\"$HOME\"", true},
+        {"\\$HOME", false},
+        {"*.c", true},
+        {"\"*.c\"", false},
+        {"a?", true},
+        {"[ab]", true},
+    };
+
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); ++i)
+    {
+        lexer_init(&lexer, words[i].word, buffer);
+        assert_true(lexer_next(&lexer, &token));
+        assert_that(token.expand, is_equal_to(words[i].expand));
+        assert_that(token.raw_length, is_equal_to(strlen(words[i].word)));
+    }
+}
+
+Ensure(lexer, errors)
+{
+    test_lexer_error("echo 'abc", "'");
+    test_lexer_error("echo \"abc", "\"");
+    test_lexer_error("echo \"abc'", "\"");
+    test_lexer_error("echo >", "newline");
+    test_lexer_error("echo >  ", "newline");
+    test_lexer_error("echo > < a", "<");
+    test_lexer_error("echo 2> >>a", ">>");
+    test_lexer_error("echo >& <>a", "<>");
+    test_lexer_error("echo > &>a", "&>");
+    test_lexer_error("cat <<", "newline");
+    test_lexer_error("cat << <<<a", "<<<");
+    test_lexer_error("echo \"abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwxyz\\", "\"");
+}
+
+static void test_lexer(const char *line, const char *expected)
+{
+    struct lexer lexer;
+    struct token token;
+    char *buffer;
+    char out[1024];
+
+    buffer = malloc(strlen(line) + 1);
+    out[0] = '\0';
+    lexer_init(&lexer, line, buffer);
+
+    while (lexer_next(&lexer, &token) && token.type != TOKEN_END)
+    {
+        char item[256];
+
+        if (token.type == TOKEN_WORD)
+        {
+            snprintf(item, sizeof(item), "[%s]", token.text);
+        }
+        else
+        {
+            snprintf(item, sizeof(item), "%s%d:%s", lexer_operator(token.redirect), token.fd, token.text);
+        }
+        strcat(out, item);
+    }
+
+    assert_that(lexer.error, is_null);
+    assert_that(out, is_equal_to_string(expected));
+    assert_that(lexer.used, is_less_than(strlen(line) + 2));
+    free(buffer);
+}
+
+static void test_lexer_error(const char *line, const char *expected_error)
+{
+    struct lexer lexer;
+    struct token token;
+    char *buffer;
+
+    buffer = malloc(strlen(line) + 1);
+    lexer_init(&lexer, line, buffer);
+
+    while (lexer_next(&lexer, &token) && token.type != TOKEN_END)
+    {
+    }
+
+    assert_that(lexer.error, is_equal_to_string(expected_error));
+    free(buffer);
+}
+
+TestSuite *lexer_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, lexer, lexer_next);
+    add_test_with_context(suite, lexer, redirects);
+    add_test_with_context(suite, lexer, expand);
+    add_test_with_context(suite, lexer, errors);
+
+    return suite;
+}
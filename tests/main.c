@@ -12,10 +12,25 @@ int main(int argc, char **argv)
     add_suite(suite, util_tests());
     add_suite(suite, input_tests());
     add_suite(suite, command_tests());
+    add_suite(suite, completion_tests());
     add_suite(suite, shell_impl_tests());
     add_suite(suite, builtin_tests());
     add_suite(suite, shell_tests());
     add_suite(suite, execute_tests());
+    add_suite(suite, parse_cache_tests());
+    add_suite(suite, path_cache_tests());
+    add_suite(suite, prompt_tests());
+    add_suite(suite, jobs_tests());
+    add_suite(suite, copy_tests());
+    add_suite(suite, parallel_tests());
+    add_suite(suite, lexer_tests());
+    add_suite(suite, arena_tests());
+    add_suite(suite, expand_tests());
+    add_suite(suite, scan_tests());
+    add_suite(suite, vars_tests());
+    add_suite(suite, history_index_tests());
+    add_suite(suite, history_tests());
+    add_suite(suite, editor_tests());
 
     if(argc > 1)
     {
@@ -0,0 +1,212 @@
+#include "tests.h"
+#include "parallel.h"
+#include <dc_util/strings.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <wordexp.h>
+
+static struct parallel *create_parallel(const char *template, const char *args, size_t slots, bool keep_order);
+static double run_time(struct parallel *parallel, struct path_cache *path_cache, int out_fd);
+
+Describe(parallel);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+
+BeforeEach(parallel)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+}
+
+AfterEach(parallel)
+{
+    dc_error_reset(&error);
+}
+
+Ensure(parallel, create)
+{
+    struct parallel *parallel;
+    char **template;
+    char **args;
+
+    template = dc_strs_to_array(&environ, &error, 3, "echo", "a{}b{}", NULL);
+    args     = dc_strs_to_array(&environ, &error, 3, "x", "yz", NULL);
+    parallel = parallel_create(&environ, &error, template, 2, args, 2, 4, false);
+    assert_that(parallel->count, is_equal_to(2));
+    assert_that(parallel->slots, is_equal_to(4));
+    assert_that(parallel->job[0].command.command, is_equal_to_string("echo"));
+    assert_that(parallel->job[0].command.argc, is_equal_to(2));
+    assert_that(parallel->job[0].command.argv[1], is_equal_to_string("axbx"));
+    assert_that(parallel->job[1].command.argv[1], is_equal_to_string("ayzbyz"));
+    assert_that(parallel->job[1].command.argv[2], is_null);
+    assert_that(parallel->job[1].command.line, is_equal_to_string("echo ayzbyz"));
+    parallel_destroy(&environ, &parallel);
+    assert_that(parallel, is_null);
+
+    // without a {} the argument goes at the end, -j 0 is one slot per argument
+    parallel = parallel_create(&environ, &error, template, 1, args, 2, 0, false);
+    assert_that(parallel->slots, is_equal_to(2));
+    assert_that(parallel->job[1].command.argc, is_equal_to(2));
+    assert_that(parallel->job[1].command.argv[1], is_equal_to_string("yz"));
+    assert_that(parallel->job[1].command.line, is_equal_to_string("echo yz"));
+    parallel_destroy(&environ, &parallel);
+
+    dc_strs_destroy_array(&environ, 3, template);
+    dc_strs_destroy_array(&environ, 3, args);
+    free(template);
+    free(args);
+}
+
+Ensure(parallel, run)
+{
+    struct parallel *parallel;
+    struct path_cache *path_cache;
+    char **path;
+    char name[32];
+    char buf[64];
+    ssize_t len;
+    double elapsed;
+    int fd;
+
+    path       = dc_strs_to_array(&environ, &error, 3, "/usr/bin", "/bin", NULL);
+    path_cache = path_cache_create(&environ, &error, path);
+    strcpy(name, "/tmp/parallelXXXXXX");
+    fd = mkstemp(name);
+
+    // the slowest job is first, its output still comes first
+    parallel = create_parallel("sh -c 'sleep 0.$((4 - {})); echo {}'", "1 2 3", 3, true);
+    elapsed  = run_time(parallel, path_cache, fd);
+    assert_that(parallel->failed, is_equal_to(0));
+    assert_that(elapsed < 0.55, is_true);
+    parallel_destroy(&environ, &parallel);
+    len = pread(fd, buf, sizeof(buf) - 1, 0);
+    buf[len] = '\0';
+    assert_that(buf, is_equal_to_string("1\n2\n3\n"));
+
+    // two slots for four jobs of 0.2 seconds: two rounds
+    parallel = create_parallel("sleep '0.2{}'", "0 0 0 0", 2, false);
+    elapsed  = run_time(parallel, path_cache, fd);
+    assert_that(elapsed > 0.35 && elapsed < 0.6, is_true);
+    parallel_destroy(&environ, &parallel);
+
+    parallel = create_parallel("sh -c 'exit {}'", "0 3 0", 2, false);
+    run_time(parallel, path_cache, fd);
+    assert_that(parallel->failed, is_equal_to(1));
+    assert_that(parallel->job[1].command.exit_code, is_equal_to(3));
+    parallel_destroy(&environ, &parallel);
+
+    // a program that is not found counts as a failure
+    parallel = create_parallel("asdasdasdfddfgsdfgasderdfdsf", "0 3 0", 2, false);
+    run_time(parallel, path_cache, fd);
+    assert_that(parallel->failed, is_equal_to(3));
+    assert_that(parallel->job[0].command.exit_code, is_equal_to(127));
+    parallel_destroy(&environ, &parallel);
+
+    close(fd);
+    unlink(name);
+    path_cache_destroy(&environ, &path_cache);
+    dc_strs_destroy_array(&environ, 3, path);
+    free(path);
+}
+
+Ensure(parallel, signals)
+{
+    static const int ignored[] = {SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU, SIGUSR1};
+    struct sigaction old_actions[6];
+    struct sigaction action;
+    struct parallel *parallel;
+    struct path_cache *path_cache;
+    char **path;
+    char name[32];
+    char buf[128];
+    char *line;
+    unsigned long mask;
+    ssize_t len;
+    int fd;
+
+    path       = dc_strs_to_array(&environ, &error, 3, "/usr/bin", "/bin", NULL);
+    path_cache = path_cache_create(&environ, &error, path);
+    strcpy(name, "/tmp/parallelXXXXXX");
+    fd = mkstemp(name);
+
+    // the way a shell with job control leaves them (see jobs_control), plus one the shell was started with
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = SIG_IGN;
+    sigemptyset(&action.sa_mask);
+    for (size_t i = 0; i < 6; ++i)
+    {
+        sigaction(ignored[i], &action, &old_actions[i]);
+    }
+
+    parallel = create_parallel("grep ^SigIgn: '/proc/self/{}'", "status", 1, true);
+    run_time(parallel, path_cache, fd);
+    assert_that(parallel->failed, is_equal_to(0));
+    parallel_destroy(&environ, &parallel);
+
+    for (size_t i = 0; i < 6; ++i)
+    {
+        sigaction(ignored[i], &old_actions[i], NULL);
+    }
+
+    len = pread(fd, buf, sizeof(buf) - 1, 0);
+    buf[len > 0 ? len : 0] = '\0';
+    line = strstr(buf, "SigIgn:");
+    assert_that(line, is_not_null);
+    mask = strtoul(line + strlen("SigIgn:"), NULL, 16);
+
+    // the job control signals are back to their default action, the rest are inherited
+    for (size_t i = 0; i < 5; ++i)
+    {
+        assert_that(mask & (1UL << (ignored[i] - 1)), is_equal_to(0));
+    }
+    assert_that(mask & (1UL << (SIGUSR1 - 1)), is_not_equal_to(0));
+
+    close(fd);
+    unlink(name);
+    path_cache_destroy(&environ, &path_cache);
+    dc_strs_destroy_array(&environ, 3, path);
+    free(path);
+}
+
+static struct parallel *create_parallel(const char *template, const char *args, size_t slots, bool keep_order)
+{
+    struct parallel *parallel;
+    wordexp_t template_words;
+    wordexp_t arg_words;
+
+    wordexp(template, &template_words, 0);
+    wordexp(args, &arg_words, 0);
+    parallel = parallel_create(&environ, &error, template_words.we_wordv, template_words.we_wordc,
+                               arg_words.we_wordv, arg_words.we_wordc, slots, keep_order);
+    wordfree(&template_words);
+    wordfree(&arg_words);
+
+    return parallel;
+}
+
+static double run_time(struct parallel *parallel, struct path_cache *path_cache, int out_fd)
+{
+    struct timespec start;
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    parallel_run(&environ, &error, parallel, path_cache, NULL, out_fd);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    assert_false(dc_error_has_error(&error));
+
+    return (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+TestSuite *parallel_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, parallel, create);
+    add_test_with_context(suite, parallel, run);
+    add_test_with_context(suite, parallel, signals);
+
+    return suite;
+}
@@ -0,0 +1,164 @@
+#include "tests.h"
+#include "parse_cache.h"
+#include "command.h"
+
+static struct command *parse_line(struct arena *arena, const char *line, size_t *count);
+
+Describe(parse_cache);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+
+BeforeEach(parse_cache)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+}
+
+AfterEach(parse_cache)
+{
+    dc_error_reset(&error);
+}
+
+Ensure(parse_cache, lookup)
+{
+    struct parse_cache *cache;
+    struct arena *arena;
+    struct command *commands;
+    struct command *cached;
+    char program[] = "/bin/ls";
+    size_t count;
+    bool hit;
+
+    cache = parse_cache_create(&environ, &error, 8);
+    arena = arena_create(&environ, &error, 256);
+    assert_that(cache, is_not_null);
+
+    hit = parse_cache_lookup(&environ, &error, cache, arena, "ls -l | wc > out.txt", &cached, &count);
+    assert_false(hit);
+    assert_that(cache->misses, is_equal_to(1));
+
+    commands = parse_line(arena, "ls -l | wc > out.txt", &count);
+    parse_cache_add(&environ, &error, cache, "ls -l | wc > out.txt", commands, count);
+    assert_that(cache->count, is_equal_to(1));
+    arena_reset(arena);
+
+    hit = parse_cache_lookup(&environ, &error, cache, arena, "ls -l | wc > out.txt", &cached, &count);
+    assert_true(hit);
+    assert_that(cache->hits, is_equal_to(1));
+    assert_that(count, is_equal_to(2));
+    assert_that(cached[0].arena, is_equal_to(arena));
+    assert_that(cached[0].command, is_equal_to_string("ls"));
+    assert_that(cached[0].argc, is_equal_to(2));
+    assert_that(cached[0].argv[0], is_null);
+    assert_that(cached[0].argv[1], is_equal_to_string("-l"));
+    assert_that(cached[0].argv[2], is_null);
+    assert_that(cached[0].connector, is_equal_to(CONNECTOR_PIPE));
+    assert_that(cached[1].command, is_equal_to_string("wc"));
+    assert_that(cached[1].redirection_count, is_equal_to(1));
+    assert_that(cached[1].redirections[0].type, is_equal_to(REDIRECTION_WRITE));
+    assert_that(cached[1].redirections[0].file, is_equal_to_string("out.txt"));
+
+    // running the commands changes the copies, not the cache
+    cached[0].argv[0]   = program;
+    cached[0].exit_code = 1;
+    hit = parse_cache_lookup(&environ, &error, cache, arena, "ls -l | wc > out.txt", &cached, &count);
+    assert_true(hit);
+    assert_that(cached[0].argv[0], is_null);
+    assert_that(cached[0].exit_code, is_equal_to(0));
+
+    hit = parse_cache_lookup(&environ, &error, cache, arena, "ls -l | wc > out", &cached, &count);
+    assert_false(hit);
+    assert_false(dc_error_has_error(&error));
+
+    arena_destroy(&environ, &arena);
+    parse_cache_destroy(&environ, &cache);
+    assert_that(cache, is_null);
+}
+
+Ensure(parse_cache, expanded)
+{
+    struct parse_cache *cache;
+    struct arena *arena;
+    struct command *commands;
+    size_t count;
+
+    cache = parse_cache_create(&environ, &error, 8);
+    arena = arena_create(&environ, &error, 256);
+
+    // the value of $HOME, or the files matching a glob, can change before the line is run again
+    commands = parse_line(arena, "echo $HOME", &count);
+    parse_cache_add(&environ, &error, cache, "echo $HOME", commands, count);
+    commands = parse_line(arena, "cat < *.txt", &count);
+    parse_cache_add(&environ, &error, cache, "cat < *.txt", commands, count);
+    commands = parse_line(arena, "echo '$HOME' \"*\"", &count);
+    parse_cache_add(&environ, &error, cache, "echo '$HOME' \"*\"", commands, count);
+    assert_that(cache->count, is_equal_to(1));
+
+    arena_destroy(&environ, &arena);
+    parse_cache_destroy(&environ, &cache);
+}
+
+Ensure(parse_cache, evict)
+{
+    static const char *lines[] = {"a", "b", "c"};
+    struct parse_cache *cache;
+    struct arena *arena;
+    struct command *commands;
+    size_t count;
+    bool hit;
+
+    cache = parse_cache_create(&environ, &error, 2);
+    arena = arena_create(&environ, &error, 256);
+
+    for (size_t i = 0; i < 2; ++i)
+    {
+        commands = parse_line(arena, lines[i], &count);
+        parse_cache_add(&environ, &error, cache, lines[i], commands, count);
+    }
+
+    // a is used after b, so b is the one dropped for c
+    hit = parse_cache_lookup(&environ, &error, cache, arena, "a", &commands, &count);
+    assert_true(hit);
+    commands = parse_line(arena, "c", &count);
+    parse_cache_add(&environ, &error, cache, "c", commands, count);
+    assert_that(cache->count, is_equal_to(2));
+
+    hit = parse_cache_lookup(&environ, &error, cache, arena, "b", &commands, &count);
+    assert_false(hit);
+    hit = parse_cache_lookup(&environ, &error, cache, arena, "a", &commands, &count);
+    assert_true(hit);
+    hit = parse_cache_lookup(&environ, &error, cache, arena, "c", &commands, &count);
+    assert_true(hit);
+    assert_that(commands[0].command, is_equal_to_string("c"));
+
+    arena_destroy(&environ, &arena);
+    parse_cache_destroy(&environ, &cache);
+}
+
+static struct command *parse_line(struct arena *arena, const char *line, size_t *count)
+{
+    struct command *commands;
+    const char *syntax_error;
+
+    commands = separate_line(&environ, &error, arena, line, count, &syntax_error);
+
+    for (size_t i = 0; i < *count; ++i)
+    {
+        parse_command(&environ, &error, NULL, &commands[i]);
+    }
+
+    return commands;
+}
+
+TestSuite *parse_cache_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, parse_cache, lookup);
+    add_test_with_context(suite, parse_cache, expanded);
+    add_test_with_context(suite, parse_cache, evict);
+
+    return suite;
+}
@@ -0,0 +1,173 @@
+#include "tests.h"
+#include "path_cache.h"
+#include <dc_util/strings.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static void make_program(const char *dir, const char *name, mode_t mode);
+
+Describe(path_cache);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+
+BeforeEach(path_cache)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+}
+
+AfterEach(path_cache)
+{
+    dc_error_reset(&error);
+}
+
+Ensure(path_cache, lookup)
+{
+    char **path;
+    struct path_cache *cache;
+
+    path  = dc_strs_to_array(&environ, &error, 3, "/bin", "/usr/bin", NULL);
+    cache = path_cache_create(&environ, &error, path);
+    assert_that(cache, is_not_null);
+    assert_that(cache->dir_count, is_equal_to(2));
+
+    assert_that(path_cache_lookup(&environ, &error, cache, "ls"), is_equal_to_string("/bin/ls"));
+    assert_that(cache->misses, is_equal_to(1));
+    assert_that(cache->hits, is_equal_to(0));
+
+    assert_that(path_cache_lookup(&environ, &error, cache, "ls"), is_equal_to_string("/bin/ls"));
+    assert_that(cache->misses, is_equal_to(1));
+    assert_that(cache->hits, is_equal_to(1));
+
+    // negative entries are cached too
+    assert_that(path_cache_lookup(&environ, &error, cache, "asdasdasdfddfgsdfgasderdfdsf"), is_null);
+    assert_that(path_cache_lookup(&environ, &error, cache, "asdasdasdfddfgsdfgasderdfdsf"), is_null);
+    assert_that(cache->misses, is_equal_to(2));
+    assert_that(cache->hits, is_equal_to(2));
+    assert_that(cache->count, is_equal_to(2));
+
+    path_cache_flush(&environ, cache);
+    assert_that(cache->count, is_equal_to(0));
+    assert_false(dc_error_has_error(&error));
+
+    path_cache_destroy(&environ, &cache);
+    assert_that(cache, is_null);
+    dc_strs_destroy_array(&environ, 3, path);
+    free(path);
+}
+
+Ensure(path_cache, invalidate)
+{
+    char first[32];
+    char second[32];
+    char **path;
+    struct path_cache *cache;
+    char expected[64];
+
+    strcpy(first, "/tmp/dirXXXXXX");
+    strcpy(second, "/tmp/dirXXXXXX");
+    mkdtemp(first);
+    mkdtemp(second);
+    path  = dc_strs_to_array(&environ, &error, 3, first, second, NULL);
+    cache = path_cache_create(&environ, &error, path);
+
+    assert_that(path_cache_lookup(&environ, &error, cache, "prog"), is_null);
+
+    // a new program in the directory invalidates the negative entry
+    make_program(second, "prog", S_IRWXU);
+    sprintf(expected, "%s/prog", second);
+    assert_that(path_cache_lookup(&environ, &error, cache, "prog"), is_equal_to_string(expected));
+
+    // a program earlier in the path hides the cached one
+    make_program(first, "prog", S_IRWXU);
+    sprintf(expected, "%s/prog", first);
+    assert_that(path_cache_lookup(&environ, &error, cache, "prog"), is_equal_to_string(expected));
+    assert_that(cache->misses, is_equal_to(3));
+
+    // a file that cannot be run is only used if nothing else is found
+    make_program(first, "data", S_IRUSR);
+    sprintf(expected, "%s/data", first);
+    assert_that(path_cache_lookup(&environ, &error, cache, "data"), is_equal_to_string(expected));
+    make_program(second, "data", S_IRWXU);
+    sprintf(expected, "%s/data", second);
+    assert_that(path_cache_lookup(&environ, &error, cache, "data"), is_equal_to_string(expected));
+
+    sprintf(expected, "%s/prog", first);
+    unlink(expected);
+    sprintf(expected, "%s/data", first);
+    unlink(expected);
+    rmdir(first);
+
+    // changing the path flushes everything
+    path_cache_set_path(&environ, &error, cache, path + 1);
+    assert_that(cache->count, is_equal_to(0));
+    assert_that(cache->dir_count, is_equal_to(1));
+    sprintf(expected, "%s/prog", second);
+    assert_that(path_cache_lookup(&environ, &error, cache, "prog"), is_equal_to_string(expected));
+
+    unlink(expected);
+    sprintf(expected, "%s/data", second);
+    unlink(expected);
+    rmdir(second);
+    path_cache_destroy(&environ, &cache);
+    dc_strs_destroy_array(&environ, 3, path);
+    free(path);
+}
+
+Ensure(path_cache, grow)
+{
+    char **path;
+    struct path_cache *cache;
+    char name[32];
+
+    path  = dc_strs_to_array(&environ, &error, 2, "/bin", NULL);
+    cache = path_cache_create(&environ, &error, path);
+
+    for (int i = 0; i < 500; ++i)
+    {
+        sprintf(name, "missing-%d", i);
+        assert_that(path_cache_lookup(&environ, &error, cache, name), is_null);
+    }
+
+    assert_that(cache->count, is_equal_to(500));
+    assert_that(cache->capacity, is_greater_than(500));
+
+    for (int i = 0; i < 500; ++i)
+    {
+        sprintf(name, "missing-%d", i);
+        assert_that(path_cache_lookup(&environ, &error, cache, name), is_null);
+    }
+
+    assert_that(cache->hits, is_equal_to(500));
+    path_cache_destroy(&environ, &cache);
+    dc_strs_destroy_array(&environ, 2, path);
+    free(path);
+}
+
+static void make_program(const char *dir, const char *name, mode_t mode)
+{
+    struct timespec delay = {0, 10000000};
+    char file_name[64];
+    int fd;
+
+    sprintf(file_name, "%s/%s", dir, name);
+    fd = open(file_name, O_CREAT | O_WRONLY, mode);
+    close(fd);
+    // make sure the directory modification time changes even on coarse clocks
+    nanosleep(&delay, NULL);
+}
+
+TestSuite *path_cache_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, path_cache, lookup);
+    add_test_with_context(suite, path_cache, invalidate);
+    add_test_with_context(suite, path_cache, grow);
+
+    return suite;
+}
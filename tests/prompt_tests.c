@@ -0,0 +1,92 @@
+#include "tests.h"
+#include "prompt.h"
+#include <pwd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+Describe(prompt);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+static char *home;
+
+BeforeEach(prompt)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+    home = getenv("HOME") ? strdup(getenv("HOME")) : NULL;
+    setenv("HOME", "/home/dc/", true);
+}
+
+AfterEach(prompt)
+{
+    if (home)
+    {
+        setenv("HOME", home, true);
+        free(home);
+    }
+    else
+    {
+        unsetenv("HOME");
+    }
+
+    dc_error_reset(&error);
+}
+
+Ensure(prompt, escapes)
+{
+    struct prompt *prompt;
+    char host[256];
+    char expected[1024];
+
+    gethostname(host, sizeof(host));
+    host[strcspn(host, ".")] = '\0';
+    snprintf(expected, sizeof(expected), "[/home/dc/src] %s@%s:~/src src %d %d%c \\ \\x\n> ",
+             getpwuid(geteuid())->pw_name, host, 2, 1, geteuid() == 0 ? '#' : '$');
+
+    // the user, host and $ are filled in once, the rest every time
+    prompt = prompt_create(&environ, &error, "\\u@\\h:\\w \\W \\? \\j\\$ \\\\ \\x\\n> ");
+    assert_that(prompt, is_not_null);
+    assert_that(prompt_render(&environ, &error, prompt, "/home/dc/src", 2, 1), is_equal_to_string(expected));
+    prompt_destroy(&environ, &prompt);
+    assert_that(prompt, is_null);
+    assert_false(dc_error_has_error(&error));
+}
+
+Ensure(prompt, directories)
+{
+    struct prompt *prompt;
+    const char *rendered;
+
+    prompt = prompt_create(&environ, &error, "\\w|\\W> ");
+    assert_that(prompt_render(&environ, &error, prompt, "/home/dc", 0, 0), is_equal_to_string("[/home/dc] ~|~> "));
+    assert_that(prompt_render(&environ, &error, prompt, "/home/dcx/a", 0, 0),
+                is_equal_to_string("[/home/dcx/a] /home/dcx/a|a> "));
+    assert_that(prompt_render(&environ, &error, prompt, "/", 0, 0), is_equal_to_string("[/] /|/> "));
+    assert_that(prompt_render(&environ, &error, prompt, NULL, 0, 0), is_equal_to_string("[] |> "));
+
+    // the same buffer is used for every prompt
+    rendered = prompt_render(&environ, &error, prompt, "/usr/local/share", 0, 0);
+    assert_that(rendered, is_equal_to_string("[/usr/local/share] /usr/local/share|share> "));
+    assert_that(prompt_render(&environ, &error, prompt, "/tmp", 0, 0), is_equal_to(rendered));
+    prompt_destroy(&environ, &prompt);
+
+    // without escapes the prompt is PS1 as it is
+    prompt = prompt_create(&environ, &error, "3=D ");
+    assert_that(prompt_render(&environ, &error, prompt, "/tmp", 0, 0), is_equal_to_string("[/tmp] 3=D "));
+    prompt_destroy(&environ, &prompt);
+    assert_false(dc_error_has_error(&error));
+}
+
+TestSuite *prompt_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, prompt, escapes);
+    add_test_with_context(suite, prompt, directories);
+
+    return suite;
+}
@@ -0,0 +1,96 @@
+#include "tests.h"
+#include "scan.h"
+
+static void test_scan_span(enum scan_impl impl, const char *bytes, size_t count, char filler);
+
+Describe(scan);
+
+BeforeEach(scan)
+{
+}
+
+AfterEach(scan)
+{
+}
+
+Ensure(scan, scan_set_init)
+{
+    struct scan_set set;
+
+    scan_set_init(&set, "<>", 2);
+    assert_that(set.count, is_equal_to(2));
+    assert_true(set.members['<']);
+    assert_false(set.members['a']);
+    assert_true(scan_supported(set.impl));
+    assert_true(scan_supported(SCAN_TABLE));
+    assert_true(scan_supported(SCAN_SWAR));
+    assert_that(scan_impl_name(SCAN_AVX2), is_equal_to_string("avx2"));
+
+    // a scanner the CPU does not have is never used
+    for (enum scan_impl impl = SCAN_TABLE; impl <= SCAN_AVX2; ++impl)
+    {
+        bool used;
+
+        used = scan_set_use(&set, impl);
+        assert_that(used, is_equal_to(scan_supported(impl)));
+    }
+}
+
+Ensure(scan, scan_span)
+{
+    static const char word_chars[] = " \t\n\v\f\r<>&'\"\\$`*?[";
+
+    for (enum scan_impl impl = SCAN_TABLE; impl <= SCAN_AVX2; ++impl)
+    {
+        if (scan_supported(impl))
+        {
+            test_scan_span(impl, word_chars, sizeof(word_chars) - 1, 'a');
+            test_scan_span(impl, "<>", 2, 'a');
+            // bytes with the top bit set share their low nibble with members
+            test_scan_span(impl, "|&;'\"\\", 6, (char)0xA6);
+            test_scan_span(impl, "\0\n", 2, (char)0xFF);
+        }
+    }
+}
+
+static void test_scan_span(enum scan_impl impl, const char *bytes, size_t count, char filler)
+{
+    struct scan_set set;
+    char text[100];
+    size_t wrong;
+
+    scan_set_init(&set, bytes, count);
+    assert_true(scan_set_use(&set, impl));
+    wrong = 0;
+
+    for (size_t length = 0; length < sizeof(text); ++length)
+    {
+        memset(text, filler, sizeof(text));
+        wrong += scan_span(&set, text, length) != length;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            // every position in and around a block, and never past the length
+            for (size_t pos = 0; pos < sizeof(text); ++pos)
+            {
+                memset(text, filler, sizeof(text));
+                text[pos] = bytes[i];
+                wrong += scan_span(&set, text, length) != (pos < length ? pos : length);
+            }
+        }
+    }
+
+    // one assert per scanner, not one per position
+    assert_that(wrong, is_equal_to(0));
+}
+
+TestSuite *scan_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, scan, scan_set_init);
+    add_test_with_context(suite, scan, scan_span);
+
+    return suite;
+}
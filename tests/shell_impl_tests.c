@@ -48,6 +48,8 @@ static void test_init_state(const char *expected_prompt, FILE *in, FILE *out, FI
     state.stdin  = in;
     state.stdout = out;
     state.stderr = err;
+    state.interactive = true;
+    state.parse_cache = NULL;
     line_length = sysconf(_SC_ARG_MAX);
     assert_that_expression(line_length >= 0);
     next_state = init_state(&environ, &error, &state);
@@ -57,10 +59,9 @@ static void test_init_state(const char *expected_prompt, FILE *in, FILE *out, FI
     assert_that(state.stdin, is_equal_to(in));
     assert_that(state.stdout, is_equal_to(out));
     assert_that(state.stderr, is_equal_to(err));
-    assert_that(state.in_redirect_regex, is_not_null);
-    assert_that(state.out_redirect_regex, is_not_null);
-    assert_that(state.err_redirect_regex, is_not_null);
     assert_that(state.path, is_not_null);
+    assert_that(state.path_cache, is_not_null);
+    assert_that(state.arena, is_not_null);
     assert_that(state.prompt, is_equal_to_string(expected_prompt));
     assert_that(state.max_line_length, is_equal_to(line_length));
     assert_that(state.current_line, is_null);
@@ -83,6 +84,8 @@ static void test_destroy_state(bool initial_fatal)
     state.stdin  = stdin;
     state.stdout = stdout;
     state.stderr = stderr;
+    state.interactive = true;
+    state.parse_cache = NULL;
     init_state(&environ, &error, &state);
     state.fatal_error = initial_fatal;
     next_state = destroy_state(&environ, &error, &state);
@@ -92,11 +95,10 @@ static void test_destroy_state(bool initial_fatal)
     assert_that(state.stdin, is_equal_to(stdin));
     assert_that(state.stdout, is_equal_to(stdout));
     assert_that(state.stderr, is_equal_to(stderr));
-    assert_that(state.in_redirect_regex, is_null);
-    assert_that(state.out_redirect_regex, is_null);
-    assert_that(state.err_redirect_regex, is_null);
+    assert_that(state.arena, is_null);
     assert_that(state.prompt, is_null);
     assert_that(state.path, is_null);
+    assert_that(state.path_cache, is_null);
     assert_that(state.max_line_length, is_equal_to(0));
     assert_that(state.current_line, is_null);
     assert_that(state.current_line_length, is_equal_to(0));
@@ -127,6 +129,8 @@ static void test_reset_state(const char *expected_prompt, bool initial_fatal)
     state.stdin  = stdin;
     state.stdout = stdout;
     state.stderr = stderr;
+    state.interactive = true;
+    state.parse_cache = NULL;
     line_length = sysconf(_SC_ARG_MAX);
     assert_that_expression(line_length >= 0);
     init_state(&environ, &error, &state);
@@ -138,9 +142,6 @@ static void test_reset_state(const char *expected_prompt, bool initial_fatal)
     assert_that(state.stdin, is_equal_to(stdin));
     assert_that(state.stdout, is_equal_to(stdout));
     assert_that(state.stderr, is_equal_to(stderr));
-    assert_that(state.in_redirect_regex, is_not_null);
-    assert_that(state.out_redirect_regex, is_not_null);
-    assert_that(state.err_redirect_regex, is_not_null);
     assert_that(state.prompt, is_equal_to_string(expected_prompt));
     assert_that(state.path, is_not_null);
     assert_that(state.max_line_length, is_equal_to(line_length));
@@ -174,6 +175,8 @@ static void test_read_commands(const char *command, const char *expected_command
     state.stdin = in;
     state.stdout = out;
     state.stderr = stderr;
+    state.interactive = true;
+    state.parse_cache = NULL;
     unsetenv("PS1");
     next_state = init_state(&environ, &error, &state);
     assert_false(dc_error_has_error(&error));
@@ -204,6 +207,7 @@ Ensure(shell_impl, separate_commands)
     test_separate_commands("./a.out", "./a.out", SEPARATE_COMMANDS);
     test_separate_commands("cd ~\n", "cd ~", SEPARATE_COMMANDS);
     test_separate_commands("\n", "", RESET_STATE);
+    test_separate_commands("ls -al | wc -l\n", "ls -al | wc -l", SEPARATE_COMMANDS);
 }
 
 static void test_separate_commands(const char *command, const char *expected_command, int expected_return)
@@ -221,6 +225,8 @@ static void test_separate_commands(const char *command, const char *expected_com
     state.stdin = in;
     state.stdout = out;
     state.stderr = stderr;
+    state.interactive = true;
+    state.parse_cache = NULL;
     unsetenv("PS1");
 
     next_state = init_state(&environ, &error, &state);
@@ -247,16 +253,27 @@ static void test_separate_commands(const char *command, const char *expected_com
     assert_that(next_state, is_equal_to(PARSE_COMMANDS));
     assert_false(state.fatal_error);
     assert_that(state.command, is_not_null);
+
+    if(strchr(expected_command, '|'))
+    {
+        assert_that(state.command_count, is_equal_to(2));
+        assert_that(state.command[0].connector, is_equal_to(CONNECTOR_PIPE));
+        assert_that(state.command[1].connector, is_equal_to(CONNECTOR_NONE));
+        fclose(in);
+        fclose(out);
+        free(in_buf);
+        destroy_state(&environ, &error, &state);
+        return;
+    }
+
+    assert_that(state.command_count, is_equal_to(1));
     assert_that(state.command->line, is_equal_to_string(state.current_line));
     assert_that(state.command->line, is_not_equal_to(state.current_line));
     assert_that(state.command->command, is_null);
     assert_that(state.command->argc, is_equal_to(0));
     assert_that(state.command->argv, is_null);
-    assert_that(state.command->stdin_file, is_null);
-    assert_that(state.command->stdout_file, is_null);
-    assert_false(state.command->stdout_overwrite);
-    assert_that(state.command->stderr_file, is_null);
-    assert_false(state.command->stderr_overwrite);
+    assert_that(state.command->redirections, is_null);
+    assert_that(state.command->redirection_count, is_equal_to(0));
     assert_that(state.command->exit_code, is_equal_to(0));
     fclose(in);
     fclose(out);
@@ -285,6 +302,8 @@ static void test_parse_commands(const char *command, const char *expected_comman
     state.stdin = in;
     state.stdout = out;
     state.stderr = stderr;
+    state.interactive = true;
+    state.parse_cache = NULL;
     unsetenv("PS1");
 
     next_state = init_state(&environ, &error, &state);
@@ -328,6 +347,18 @@ Ensure(shell_impl, execute_commands)
     free(current_working_dir);
 
     test_execute_command("ls", RESET_STATE, "0\n", "");
+    test_execute_command("ls | wc -l > /dev/null", RESET_STATE, "0\n", "");
+    test_execute_command("false | true", RESET_STATE, "0\n", "");
+    test_execute_command("false; true", RESET_STATE, "0\n", "");
+    test_execute_command("true && false", RESET_STATE, "1\n", "");
+    test_execute_command("false && true", RESET_STATE, "1\n", "");
+    test_execute_command("false || true", RESET_STATE, "0\n", "");
+    test_execute_command("true || false && exit", EXIT, "", "");
+    test_execute_command("false && exit || true", RESET_STATE, "0\n", "");
+    test_execute_command("echo  hello   world", RESET_STATE, "hello world\n0\n", "");
+    test_execute_command("pwd", RESET_STATE, "/\n0\n", "");
+    test_execute_command("false", RESET_STATE, "1\n", "");
+    test_execute_command("unset 1X", RESET_STATE, "1\n", "unset: `1X': not a valid identifier\n");
 }
 
 static void test_execute_command(const char *command, int expected_next_state, const char *expected_exit_code, const char *expected_error_message)
@@ -350,6 +381,8 @@ static void test_execute_command(const char *command, int expected_next_state, c
     state.stdin = in;
     state.stdout = out;
     state.stderr = err;
+    state.interactive = true;
+    state.parse_cache = NULL;
     unsetenv("PS1");
 
     next_state = init_state(&environ, &error, &state);
@@ -391,6 +424,7 @@ Ensure(shell_impl, do_exit)
     struct state state;
     int next_state;
 
+    state.stdin = NULL;
     next_state = init_state(&environ, &error, &state);
     assert_false(dc_error_has_error(&error));
     assert_false(state.fatal_error);
@@ -427,8 +461,11 @@ static void test_handle_error(const char *current_line, bool is_fatal, int expec
     memset(err_buf, 0, sizeof(err_buf));
     out_file = fmemopen(out_buf, sizeof(out_buf), "w");
     err_file = fmemopen(err_buf, sizeof(err_buf), "w");
+    state.stdin = NULL;
     state.stdout = out_file;
     state.stderr = err_file;
+    state.interactive = true;
+    state.parse_cache = NULL;
     init_state(&environ, &error, &state);
     dc_error_init(&err, NULL);
     err.err_code = expected_error_code;
@@ -436,7 +473,7 @@ static void test_handle_error(const char *current_line, bool is_fatal, int expec
 
     if(current_line != NULL)
     {
-        state.current_line = strdup(current_line);
+        state.current_line = arena_strdup(&environ, &error, state.arena, current_line);
         state.current_line_length = strlen(state.current_line);
     }
 
@@ -2,8 +2,10 @@
 #include "tests.h"
 #include "util.h"
 #include "input.h"
+#include <unistd.h>
 
 static void test_run_shell(const char *in, const char *expected_out, const char *expected_err);
+static void test_run_script(const char *in, int expected_exit_code, const char *expected_out, const char *expected_err);
 
 Describe(shell);
 
@@ -57,7 +59,7 @@ static void test_run_shell(const char *in, const char *expected_out, const char
     in_file = fmemopen(in_buf, strlen(in_buf) + 1, "r");
     out_file = fmemopen(out_buf, sizeof(out_buf), "w");
     err_file = fmemopen(err_buf, sizeof(err_buf), "w");
-    ret_val = run_shell(&environ, &error, in_file, out_file, err_file);
+    ret_val = run_shell(&environ, &error, in_file, out_file, err_file, NULL);
     assert_that(ret_val, is_equal_to(0));
     fflush(out_file);
     assert_that(out_buf, is_equal_to_string(expected_out));
@@ -69,12 +71,131 @@ static void test_run_shell(const char *in, const char *expected_out, const char
     free(in_buf);
 }
 
+Ensure(shell, run_script)
+{
+    test_run_script("set -o\n", 0, "allocs\toff\nerrexit\toff\npipefail\toff\nrusage\toff\n", "");
+    test_run_script("set -o pipefail\nset -o", 0, "allocs\toff\nerrexit\toff\npipefail\ton\nrusage\toff\n", "");
+    test_run_script("#!/bin/dc_shell\n\n# nothing to run\n", 0, "", "");
+    test_run_script("false\n", 1, "", "");
+    test_run_script("false\ntrue\n", 0, "", "");
+    test_run_script("set -e\nfalse\nset -o\n", 1, "", "");
+    test_run_script("set -e\nfalse | true\nset -o\n", 0, "allocs\toff\nerrexit\ton\npipefail\toff\nrusage\toff\n", "");
+    test_run_script("ls |\nset -o\n", 2, "", "syntax error near unexpected token `newline'\n");
+    test_run_script("false && set -o\n", 1, "", "");
+    test_run_script("false || set -o pipefail && set -o; false\n", 1, "allocs\toff\nerrexit\toff\npipefail\ton\nrusage\toff\n", "");
+    test_run_script("set -e; false || true; true && false; set -o\n", 1, "", "");
+    test_run_script("set -e; false && true; set -o\n", 0, "allocs\toff\nerrexit\ton\npipefail\toff\nrusage\toff\n", "");
+    test_run_script("echo 'abc\nset -o\n", 2, "", "unexpected EOF while looking for matching `''\n");
+    test_run_script("true; ls >\nset -o\n", 2, "", "syntax error near unexpected token `newline'\n");
+    test_run_script("> /dev/null\n", 0, "", "");
+    // the body is not run, the line after the delimiter is
+    test_run_script("/bin/cat <<EOF > /dev/null\nset -o\nEOF\nset -o\n", 0,
+                    "allocs\toff\nerrexit\toff\npipefail\toff\nrusage\toff\n", "");
+    test_run_script("/bin/cat <<-EOF > /dev/null\nset -o\n\tEOF\nfalse\n", 1, "", "");
+    test_run_script("/bin/cat <<EOF > /dev/null\nset -o\n", 0, "", "warning: here-document delimited by end-of-file\n");
+    // the third line is run from the parse cache
+    test_run_script("set -o pipefail; set -o\nset +o pipefail\nset -o pipefail; set -o\n", 0,
+                    "allocs\toff\nerrexit\toff\npipefail\ton\nrusage\toff\n"
+                    "allocs\toff\nerrexit\toff\npipefail\ton\nrusage\toff\n", "");
+}
+
+Ensure(shell, expand_when_run)
+{
+    char template[] = "/tmp/dc_shell_expand_XXXXXX";
+    char *cwd;
+    char *dir;
+    char line[128];
+    char path[128];
+
+    cwd = dc_get_working_dir(&environ, &error);
+    dir = mkdtemp(template);
+    assert_that(dir, is_not_null);
+    sprintf(path, "%s/a.txt", dir);
+    fclose(fopen(path, "w"));
+    sprintf(path, "%s/b.txt", dir);
+    fclose(fopen(path, "w"));
+
+    // each pipeline is expanded just before it runs, after the ones before it on the line
+    sprintf(line, "cd %s; echo *\n", dir);
+    test_run_script(line, 0, "a.txt b.txt\n", "");
+    test_run_script("export X=1; echo $X [$X]\n", 0, "1 [1]\n", "");
+
+    chdir(cwd);
+    sprintf(path, "%s/a.txt", dir);
+    unlink(path);
+    sprintf(path, "%s/b.txt", dir);
+    unlink(path);
+    rmdir(dir);
+    free(cwd);
+}
+
+Ensure(shell, time)
+{
+    char *in_buf;
+    char out_buf[1024];
+    char err_buf[1024];
+    FILE *in_file;
+    FILE *out_file;
+    FILE *err_file;
+
+    memset(out_buf, 0, sizeof(out_buf));
+    memset(err_buf, 0, sizeof(err_buf));
+    in_buf = strdup("time printf abc | tr a-z A-Z > /dev/null\nset -o rusage\nls / > /dev/null\ntime\n");
+    in_file = fmemopen(in_buf, strlen(in_buf), "r");
+    out_file = fmemopen(out_buf, sizeof(out_buf), "w");
+    err_file = fmemopen(err_buf, sizeof(err_buf), "w");
+    assert_that(run_script(&environ, &error, in_file, out_file, err_file, NULL), is_equal_to(0));
+    fflush(out_file);
+    assert_that(out_buf, is_equal_to_string(""));
+    fflush(err_file);
+    assert_that(err_buf, contains_string("real\t0."));
+    assert_that(err_buf, contains_string("\nuser\t0."));
+    assert_that(err_buf, contains_string("\nsys\t0."));
+    assert_that(err_buf, contains_string("rusage: ls: user "));
+    assert_that(err_buf, contains_string("real\t0.000\nuser\t0.000\nsys\t0.000\n"));
+    fclose(in_file);
+    fclose(out_file);
+    fclose(err_file);
+    free(in_buf);
+}
+
+static void test_run_script(const char *in, int expected_exit_code, const char *expected_out, const char *expected_err)
+{
+    char *in_buf;
+    char out_buf[1024];
+    char err_buf[1024];
+    FILE *in_file;
+    FILE *out_file;
+    FILE *err_file;
+    int ret_val;
+
+    memset(out_buf, 0, sizeof(out_buf));
+    memset(err_buf, 0, sizeof(err_buf));
+    in_buf = strdup(in);
+    in_file = fmemopen(in_buf, strlen(in_buf), "r");
+    out_file = fmemopen(out_buf, sizeof(out_buf), "w");
+    err_file = fmemopen(err_buf, sizeof(err_buf), "w");
+    ret_val = run_script(&environ, &error, in_file, out_file, err_file, NULL);
+    assert_that(ret_val, is_equal_to(expected_exit_code));
+    fflush(out_file);
+    assert_that(out_buf, is_equal_to_string(expected_out));
+    fflush(err_file);
+    assert_that(err_buf, is_equal_to_string(expected_err));
+    fclose(in_file);
+    fclose(out_file);
+    fclose(err_file);
+    free(in_buf);
+}
+
 TestSuite *shell_tests(void)
 {
     TestSuite *suite;
 
     suite = create_test_suite();
     add_test_with_context(suite, shell, run_shell);
+    add_test_with_context(suite, shell, run_script);
+    add_test_with_context(suite, shell, expand_when_run);
+    add_test_with_context(suite, shell, time);
 
     return suite;
 }
@@ -4,12 +4,27 @@
 
 #include <cgreen/cgreen.h>
 
+TestSuite *arena_tests(void);
 TestSuite *builtin_tests(void);
 TestSuite *command_tests(void);
+TestSuite *completion_tests(void);
+TestSuite *copy_tests(void);
+TestSuite *editor_tests(void);
 TestSuite *execute_tests(void);
+TestSuite *expand_tests(void);
+TestSuite *history_index_tests(void);
+TestSuite *history_tests(void);
 TestSuite *input_tests(void);
+TestSuite *jobs_tests(void);
+TestSuite *lexer_tests(void);
+TestSuite *parallel_tests(void);
+TestSuite *parse_cache_tests(void);
+TestSuite *path_cache_tests(void);
+TestSuite *prompt_tests(void);
+TestSuite *scan_tests(void);
 TestSuite *shell_impl_tests(void);
 TestSuite *shell_tests(void);
 TestSuite *util_tests(void);
+TestSuite *vars_tests(void);
 
 #endif // LIBDC_POSIX_TESTS_H
@@ -100,37 +100,49 @@ static void test_parse_path(const char *path_str, char **dirs)
 Ensure(util, do_reset_state)
 {
     struct state state;
+    char line[64];
+    const char *syntax_error;
 
     state.stdin = stdin;
     state.stdout = stdout;
     state.stderr = stderr;
-    state.in_redirect_regex = NULL;
-    state.out_redirect_regex = NULL;
-    state.err_redirect_regex = NULL;
     state.path = NULL;
     state.prompt = NULL;
     state.max_line_length = 0;
     state.current_line = NULL;
     state.current_line_length = 0;
+    state.arena = arena_create(&environ, &error, 256);
     state.command = NULL;
+    state.command_count = 0;
+    state.log_allocs = false;
     state.fatal_error = false;
 
     do_reset_state(&environ, &error, &state);
     check_state_reset(&error, &state, stdin, stdout, stderr);
 
-    state.current_line = strdup("");
+    strcpy(line, "");
+    state.current_line = line;
     state.current_line_length = strlen(state.current_line);
     do_reset_state(&environ, &error, &state);
     check_state_reset(&error, &state, stdin, stdout, stderr);
 
-    state.current_line = strdup("ls");
+    strcpy(line, "ls");
+    state.current_line = line;
     state.current_line_length = strlen(state.current_line);
+    state.command = separate_line(&environ, &error, state.arena, state.current_line, &state.command_count, &syntax_error);
+    assert_that(state.arena->allocations, is_greater_than(0));
     do_reset_state(&environ, &error, &state);
     check_state_reset(&error, &state, stdin, stdout, stderr);
 
-    state.current_line = strdup("ls");
+    strcpy(line, "ls -al | wc > out.txt");
+    state.current_line = line;
     state.current_line_length = strlen(state.current_line);
-    state.command = calloc(1, sizeof(struct command));
+    state.command = separate_line(&environ, &error, state.arena, state.current_line, &state.command_count, &syntax_error);
+    parse_command(&environ, &error, &state, &state.command[0]);
+    parse_command(&environ, &error, &state, &state.command[1]);
+    assert_that(state.command_count, is_equal_to(2));
+    assert_that(state.command[1].redirection_count, is_equal_to(1));
+    assert_that(state.command[1].redirections[0].file, is_equal_to_string("out.txt"));
     do_reset_state(&environ, &error, &state);
     check_state_reset(&error, &state, stdin, stdout, stderr);
 
@@ -141,6 +153,7 @@ Ensure(util, do_reset_state)
     state.fatal_error = true;
     do_reset_state(&environ, &error, &state);
     check_state_reset(&error, &state, stdin, stdout, stderr);
+    arena_destroy(&environ, &state.arena);
 }
 
 static void check_state_reset(const struct dc_error *error, const struct state *state, FILE *in, FILE *out, FILE *err)
@@ -149,6 +162,9 @@ static void check_state_reset(const struct dc_error *error, const struct state *
     assert_that(state->current_line, is_null);
     assert_that(state->current_line_length, is_equal_to(0));
     assert_that(state->command, is_null);
+    assert_that(state->command_count, is_equal_to(0));
+    assert_that(state->arena->allocations, is_equal_to(0));
+    assert_that(state->arena->bytes, is_equal_to(0));
     assert_that(state->stdin, is_equal_to(in));
     assert_that(state->stdout, is_equal_to(out));
     assert_that(state->stderr, is_equal_to(err));
@@ -168,9 +184,6 @@ Ensure(util, state_to_string)
     struct state state;
     char *str;
 
-    state.in_redirect_regex = NULL;
-    state.out_redirect_regex = NULL;
-    state.err_redirect_regex = NULL;
     state.path = NULL;
     state.prompt = NULL;
     state.max_line_length = 0;
@@ -0,0 +1,231 @@
+#include "tests.h"
+#include "shell.h"
+#include "vars.h"
+#include <stdio.h>
+
+static size_t count_envp(char **envp);
+static const char *find_envp(char **envp, const char *entry);
+
+Describe(vars);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+
+BeforeEach(vars)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+}
+
+AfterEach(vars)
+{
+    dc_error_reset(&error);
+}
+
+Ensure(vars, set_and_get)
+{
+    char home[]         = "HOME=/home/user";
+    char empty[]        = "EMPTY=";
+    char no_equals[]    = "NOEQUALS";
+    char *environment[] = {home, empty, no_equals, NULL};
+    struct vars *vars;
+
+    vars = vars_create(&environ, &error, environment);
+    assert_that(vars, is_not_null);
+    assert_that(vars->count, is_equal_to(2));
+    assert_that(vars_get(vars, "HOME", 4), is_equal_to_string("/home/user"));
+    assert_that(vars_get(vars, "EMPTY", 5), is_equal_to_string(""));
+    assert_that(vars_get(vars, "NOEQUALS", 8), is_null);
+    // the name does not have to end at a null byte
+    assert_that(vars_get(vars, "HOMEWARD", 4), is_equal_to_string("/home/user"));
+    assert_that(vars_get(vars, "HOM", 3), is_null);
+
+    vars_set(&environ, &error, vars, "HOME", 4, "/tmp", false);
+    assert_that(vars_get(vars, "HOME", 4), is_equal_to_string("/tmp"));
+    assert_that(vars->count, is_equal_to(2));
+    vars_set(&environ, &error, vars, "LOCAL", 5, "1", false);
+    assert_that(vars_get(vars, "LOCAL", 5), is_equal_to_string("1"));
+    assert_that(vars->count, is_equal_to(3));
+
+    assert_true(vars_unset(vars, "HOME", 4));
+    assert_false(vars_unset(vars, "HOME", 4));
+    assert_that(vars_get(vars, "HOME", 4), is_null);
+    assert_that(vars->count, is_equal_to(2));
+
+    vars_destroy(&environ, &vars);
+    assert_that(vars, is_null);
+}
+
+Ensure(vars, grow_and_unset)
+{
+    struct vars *vars;
+    char name[16];
+    size_t wrong;
+
+    vars  = vars_create(&environ, &error, NULL);
+    wrong = 0;
+
+    // enough to grow the table a few times, then remove every other one so the rest have to move back
+    for (int i = 0; i < 1000; ++i)
+    {
+        snprintf(name, sizeof(name), "V%d", i);
+        vars_set(&environ, &error, vars, name, strlen(name), name, false);
+    }
+
+    assert_that(vars->count, is_equal_to(1000));
+
+    for (int i = 0; i < 1000; i += 2)
+    {
+        snprintf(name, sizeof(name), "V%d", i);
+        wrong += !vars_unset(vars, name, strlen(name));
+    }
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        const char *value;
+
+        snprintf(name, sizeof(name), "V%d", i);
+        value = vars_get(vars, name, strlen(name));
+        wrong += i % 2 == 0 ? value != NULL : value == NULL || strcmp(value, name) != 0;
+    }
+
+    assert_that(wrong, is_equal_to(0));
+    assert_that(vars->count, is_equal_to(500));
+    vars_destroy(&environ, &vars);
+}
+
+Ensure(vars, envp)
+{
+    char home[]         = "HOME=/home/user";
+    char path[]         = "PATH=/bin";
+    char *environment[] = {home, path, NULL};
+    struct vars *vars;
+    char **envp;
+
+    vars = vars_create(&environ, &error, environment);
+    envp = vars_envp(&environ, &error, vars);
+    assert_that(count_envp(envp), is_equal_to(2));
+    assert_that(find_envp(envp, "HOME=/home/user"), is_not_null);
+    assert_that(find_envp(envp, "PATH=/bin"), is_not_null);
+    assert_that(vars->envp_builds, is_equal_to(1));
+
+    // a variable that is not exported does not change the environment
+    vars_set(&environ, &error, vars, "LOCAL", 5, "1", false);
+    envp = vars_envp(&environ, &error, vars);
+    assert_that(count_envp(envp), is_equal_to(2));
+    assert_that(vars->envp_builds, is_equal_to(1));
+
+    assert_true(vars_export(vars, "LOCAL", 5));
+    assert_false(vars_export(vars, "MISSING", 7));
+    envp = vars_envp(&environ, &error, vars);
+    assert_that(count_envp(envp), is_equal_to(3));
+    assert_that(find_envp(envp, "LOCAL=1"), is_not_null);
+    assert_that(vars->envp_builds, is_equal_to(2));
+
+    // an exported variable stays exported when it is set again
+    vars_set(&environ, &error, vars, "HOME", 4, "/tmp", false);
+    envp = vars_envp(&environ, &error, vars);
+    assert_that(find_envp(envp, "HOME=/tmp"), is_not_null);
+    assert_that(vars->envp_builds, is_equal_to(3));
+
+    vars_unset(vars, "PATH", 4);
+    envp = vars_envp(&environ, &error, vars);
+    assert_that(count_envp(envp), is_equal_to(2));
+    assert_that(find_envp(envp, "PATH=/bin"), is_null);
+    assert_that(vars->envp_builds, is_equal_to(4));
+
+    vars_destroy(&environ, &vars);
+}
+
+Ensure(vars, envp_with)
+{
+    char home[]         = "HOME=/home/user";
+    char path[]         = "PATH=/bin";
+    char new_path[]     = "PATH=/usr/bin";
+    char foo_1[]        = "FOO=1";
+    char foo_2[]        = "FOO=2";
+    char *environment[] = {home, path, NULL};
+    char *assignments[] = {new_path, foo_1, foo_2};
+    struct vars *vars;
+    char **envp;
+
+    vars = vars_create(&environ, &error, environment);
+    envp = vars_envp_with(&environ, &error, vars, NULL, assignments, 3);
+    assert_that(count_envp(envp), is_equal_to(3));
+    assert_that(find_envp(envp, "HOME=/home/user"), is_not_null);
+    assert_that(find_envp(envp, "PATH=/usr/bin"), is_not_null);
+    assert_that(find_envp(envp, "PATH=/bin"), is_null);
+    assert_that(find_envp(envp, "FOO=2"), is_not_null);
+    assert_that(find_envp(envp, "FOO=1"), is_null);
+    free(envp);
+
+    // the shell's own variables are not changed
+    assert_that(vars_get(vars, "PATH", 4), is_equal_to_string("/bin"));
+    assert_that(vars_get(vars, "FOO", 3), is_null);
+    assert_that(count_envp(vars_envp(&environ, &error, vars)), is_equal_to(2));
+
+    vars_destroy(&environ, &vars);
+}
+
+Ensure(vars, assignment_seen_by_line)
+{
+    char in_buf[] = "X=1; echo $X ${X:-d}\nY=2 && echo $Y; unset Y; echo [$Y]\n";
+    char out_buf[64];
+    char err_buf[64];
+    FILE *in_file;
+    FILE *out_file;
+    FILE *err_file;
+
+    // a variable set by one command on the line is there when the next one is expanded
+    memset(out_buf, 0, sizeof(out_buf));
+    memset(err_buf, 0, sizeof(err_buf));
+    in_file  = fmemopen(in_buf, strlen(in_buf), "r");
+    out_file = fmemopen(out_buf, sizeof(out_buf), "w");
+    err_file = fmemopen(err_buf, sizeof(err_buf), "w");
+    assert_that(run_script(&environ, &error, in_file, out_file, err_file, NULL), is_equal_to(0));
+    fflush(out_file);
+    assert_that(out_buf, is_equal_to_string("1 1\n2\n[]\n"));
+    fflush(err_file);
+    assert_that(err_buf, is_equal_to_string(""));
+    fclose(in_file);
+    fclose(out_file);
+    fclose(err_file);
+}
+
+static size_t count_envp(char **envp)
+{
+    size_t count;
+
+    for (count = 0; envp[count]; ++count)
+    {
+    }
+
+    return count;
+}
+
+static const char *find_envp(char **envp, const char *entry)
+{
+    for (size_t i = 0; envp[i]; ++i)
+    {
+        if (strcmp(envp[i], entry) == 0)
+        {
+            return envp[i];
+        }
+    }
+
+    return NULL;
+}
+
+TestSuite *vars_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, vars, set_and_get);
+    add_test_with_context(suite, vars, grow_and_unset);
+    add_test_with_context(suite, vars, envp);
+    add_test_with_context(suite, vars, envp_with);
+    add_test_with_context(suite, vars, assignment_seen_by_line);
+
+    return suite;
+}